@@ -0,0 +1,41 @@
+#ifndef CAPTURE_FORMAT_H
+#define CAPTURE_FORMAT_H
+
+#include <stdint.h>
+
+// Oversampled line capture, as streamed by the Pico 2 `capture` command and
+// read back by soft_uart_decoder:
+//
+//   [lifi_capture_hdr_t][uint32_t word]...[uint32_t word]
+//
+// All fields and words are little-endian. Each word holds 32 consecutive
+// samples of the RX pin, earliest sample in bit 0 (the PIO shifts right).
+// Samples are the raw pin level; `inverted` says whether idle reads low
+// (the default TLV3501 wiring, where the start bit is HIGH).
+
+#define CAPTURE_MAGIC      "LIFICAP1"
+#define CAPTURE_MAGIC_SIZE 8
+#define CAPTURE_VERSION    1
+
+#define CAPTURE_OSR_MIN 4
+#define CAPTURE_OSR_MAX 8
+
+typedef struct __attribute__((packed)) {
+    char magic[CAPTURE_MAGIC_SIZE];  // CAPTURE_MAGIC, no terminator
+    uint16_t version;                // CAPTURE_VERSION
+    uint16_t osr;                    // samples per bit at `baud`
+    uint32_t baud;                   // nominal line rate the capture targets
+    uint32_t sample_hz;              // actual rate after the PIO clock divider
+    uint32_t sys_hz;                 // clk_sys of the capturing Pico
+    uint32_t words;                  // sample words that follow the header
+    uint8_t pin;                     // GPIO sampled
+    uint8_t inverted;                // 1 if idle (stop level) reads as 0
+    uint16_t reserved;
+} lifi_capture_hdr_t;
+
+#define CAPTURE_HDR_SIZE 32
+
+typedef char capture_hdr_size_check[(sizeof(lifi_capture_hdr_t) ==
+                                     CAPTURE_HDR_SIZE) ? 1 : -1];
+
+#endif  // CAPTURE_FORMAT_H
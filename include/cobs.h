@@ -0,0 +1,60 @@
+#ifndef COBS_H
+#define COBS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * Consistent Overhead Byte Stuffing. Encoded data contains no 0x00, so a
+ * 0x00 byte can delimit packets on a byte stream. Overhead is one byte per
+ * 254 bytes of input (plus one).
+ */
+#define COBS_MAX_ENCODED(n) ((n) + (n) / 254 + 1)
+
+/**
+ * Encode `len` bytes from src into dst (no delimiter is written).
+ * dst must hold COBS_MAX_ENCODED(len) bytes.
+ * Returns the encoded length.
+ */
+static inline size_t cobs_encode(const uint8_t *src, size_t len, uint8_t *dst) {
+    size_t code_at = 0, o = 1;
+    uint8_t code = 1;
+    for (size_t i = 0; i < len; i++) {
+        if (src[i] != 0) {
+            dst[o++] = src[i];
+            code++;
+        }
+        if (src[i] == 0 || code == 0xFF) {
+            dst[code_at] = code;
+            code = 1;
+            code_at = o++;
+        }
+    }
+    dst[code_at] = code;
+    return o;
+}
+
+/**
+ * Decode one packet (without its 0x00 delimiter).
+ * Returns the decoded length, or (size_t)-1 if src is not valid COBS or
+ * does not fit in dst_cap bytes.
+ */
+static inline size_t cobs_decode(const uint8_t *src, size_t len,
+                                 uint8_t *dst, size_t dst_cap) {
+    size_t i = 0, o = 0;
+    while (i < len) {
+        uint8_t code = src[i++];
+        if (code == 0 || i + code - 1 > len) return (size_t)-1;
+        for (uint8_t k = 1; k < code; k++) {
+            if (src[i] == 0 || o >= dst_cap) return (size_t)-1;
+            dst[o++] = src[i++];
+        }
+        if (code != 0xFF && i < len) {
+            if (o >= dst_cap) return (size_t)-1;
+            dst[o++] = 0;
+        }
+    }
+    return o;
+}
+
+#endif /* COBS_H */
@@ -0,0 +1,47 @@
+#ifndef CRYPTO_BENCH_H
+#define CRYPTO_BENCH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Microbenchmarks for the primitives in sst_crypto_embedded.h, shared by the
+// host tool (receiver/src/crypto_bench_tool.c, once per backend) and the
+// Pico firmware (sender/src/pico_crypto_bench.c), so every platform prints
+// the same rows:
+//
+//   backend,platform,op,bytes,iters,ns_per_op,ops_per_sec,mb_per_sec,cycles_per_byte,min_ns,max_ns
+//
+// One row per primitive and payload size (16 B to 8 KB). Other output lines
+// start with '#', so the block can be fed to a CSV reader as is. cycles_per_byte
+// is left empty when the platform has no way to count cycles. min_ns/max_ns
+// are the fastest and slowest of 32 single calls, i.e. the jitter around
+// ns_per_op (clock resolution permitting: 1 us on the Pico).
+
+#define CRYPTO_BENCH_MAX_LEN 8192
+
+typedef struct {
+    const char *platform;       // e.g. "x86_64", "rp2040"
+    uint64_t (*now_ns)(void);   // monotonic clock
+    // Cycle counter, or NULL to derive cycles from time and cpu_hz
+    uint64_t (*cycles)(void);
+    uint32_t cpu_hz;            // 0 if unknown
+    uint32_t min_ms;            // time spent on each row
+    // Key hash to time as "key_hash" (e.g. compute_key_hash on the Pico);
+    // NULL uses sst_sha256() over ID || key
+    void (*key_hash)(const uint8_t *id, const uint8_t *key, uint8_t *out);
+} crypto_bench_cfg_t;
+
+// Prints the header row.
+void crypto_bench_header(void);
+
+// Runs every primitive whose name starts with `op` (NULL or "" for all) at
+// every size and prints one row each.
+//
+// @return number of rows printed, or -1 if a primitive failed
+int crypto_bench_run(const crypto_bench_cfg_t *cfg, const char *op);
+
+// Space-separated primitive names, for usage text.
+const char *crypto_bench_ops(void);
+
+#endif  // CRYPTO_BENCH_H
@@ -0,0 +1,71 @@
+#ifndef FRAME_DECRYPT_H
+#define FRAME_DECRYPT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "frame_parser.h"
+#include "protocol.h"
+#include "sst_crypto_embedded.h"
+
+// AES-GCM decryption of LiFi frames that overlaps with reception.
+//
+// While frame_parser_next() is waiting on an encrypted frame,
+// frame_decrypt_poll() decrypts whatever ciphertext has arrived so far into
+// a private buffer. When the frame completes, frame_decrypt_finish() only
+// has the last few bytes and the tag left to do, instead of the whole
+// payload. The plaintext in `plain` may only be used after
+// frame_decrypt_finish() returns 0; a failed tag check wipes it.
+//
+// Frames that were never polled (they arrived in one read, or no key was
+// loaded yet) are decrypted in one go by frame_decrypt_finish(), so a
+// receiver may call it for every GCM frame. ChaCha20-Poly1305 frames
+// (MSG_TYPE_IS_CHACHA) are always opened that way.
+
+typedef struct {
+    sst_gcm_stream_t gcm;
+    bool active;                     // gcm holds the candidate below
+    uint32_t seq;                    // its frame_parser candidate number
+    uint8_t key[SST_KEY_SIZE];       // and the key it was started with
+    uint8_t plain[MAX_MSG_LEN + 1];  // +1 so callers can NUL-terminate
+
+    // ChaCha20-Poly1305 key derived from cc_src, redone on a key change
+    bool have_cc;
+    uint8_t cc_src[SST_KEY_SIZE];
+    uint8_t cc_key[SST_CHACHAPOLY_KEY_SIZE];
+
+    // Counters, cumulative since frame_decrypt_init().
+    uint32_t streamed;  // frames finished from a running stream
+    uint32_t oneshot;   // frames decrypted after their last byte arrived
+} frame_decrypt_t;
+
+// @param d Decryptor to initialize
+void frame_decrypt_init(frame_decrypt_t *d);
+
+// Frees the cipher context.
+//
+// @param d Decryptor
+void frame_decrypt_free(frame_decrypt_t *d);
+
+// Decrypts the ciphertext received so far of the pending GCM candidate.
+// Call it after frame_parser_next() returns FRAME_NONE.
+//
+// @param d Decryptor
+// @param p Parser the frames come from
+// @param key Current AES-128 session key, or NULL if none is loaded
+void frame_decrypt_poll(frame_decrypt_t *d, const frame_parser_t *p,
+                        const uint8_t *key);
+
+// Finishes decryption of a FRAME_OK encrypted frame (any MSG_TYPE_IS_AEAD
+// type; version 2 and ChaCha20-Poly1305 types authenticate TYPE|LEN as
+// additional data).
+//
+// @param d Decryptor
+// @param f Frame from frame_parser_next()
+// @param key AES-128 session key
+// @return 0 with f->len - NONCE_SIZE - TAG_SIZE bytes of plaintext in
+//         d->plain, non-zero if the tag does not verify
+int frame_decrypt_finish(frame_decrypt_t *d, const lifi_frame_t *f,
+                         const uint8_t *key);
+
+#endif  // FRAME_DECRYPT_H
@@ -0,0 +1,170 @@
+#ifndef FRAME_PARSER_H
+#define FRAME_PARSER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "protocol.h"
+
+// Buffered, resynchronizing parser for LiFi frames:
+//
+//   [PREAMBLE AB CD EF 12][TYPE:1][LEN:2 BE][PAYLOAD][CRC16:2 BE]
+//
+// Version 2 GCM frames (MSG_TYPE_ENCRYPTED_V2 / MSG_TYPE_FILE_V2) end after
+// PAYLOAD: their integrity check is the GCM tag, with TYPE|LEN as additional
+// data, so the parser only delimits them. A receiver whose tag check fails
+// calls frame_parser_reject() to have the bytes rescanned like a CRC failure.
+//
+// Bytes are pushed in bulk as they arrive and complete frames are pulled out
+// with frame_parser_next(). The parser never discards a byte it has not
+// proven to be garbage: when a candidate frame fails the length check, the
+// CRC or its arrival deadline, scanning restarts one byte after the false
+// preamble, so a real frame hidden inside the rejected bytes is still found.
+//
+// No file descriptors or clocks are touched here; the caller supplies a
+// monotonic millisecond timestamp, so the same code runs on the Linux
+// receivers and on the Pico.
+
+#define FRAME_HDR_SIZE 3  // TYPE + LEN
+#define FRAME_MAX_SIZE (PREAMBLE_SIZE + FRAME_HDR_SIZE + MAX_MSG_LEN + CRC16_SIZE)
+
+// Room for one worst-case frame still being assembled plus a second one
+// behind it, so a stalled candidate never blocks incoming data.
+#define FRAME_PARSER_BUF_SIZE (2 * FRAME_MAX_SIZE)
+
+// A candidate whose header has not arrived yet is dropped after this long.
+// Once LEN is known, the deadline grows by 1 ms per 10 payload bytes, which
+// matches the scaling the receivers used for their blocking reads.
+#define FRAME_TIMEOUT_BASE_MS 200
+
+typedef enum {
+    FRAME_NONE = 0,  // nothing more to report until more bytes arrive
+    FRAME_OK,        // *out holds a complete, CRC-checked (or V2 GCM) frame
+    FRAME_DROPPED    // a candidate was rejected; out->error says why
+} frame_result_t;
+
+typedef enum {
+    FRAME_ERR_NONE = 0,
+    FRAME_ERR_TYPE,     // TYPE byte is not a LiFi frame type
+    FRAME_ERR_LEN,      // LEN is outside the bounds for TYPE
+    FRAME_ERR_CRC,      // CRC16 mismatch
+    FRAME_ERR_TIMEOUT   // frame did not complete before its deadline
+} frame_error_t;
+
+typedef struct {
+    uint8_t type;
+    uint16_t len;            // payload length from the header
+    const uint8_t *payload;  // FRAME_OK only
+    uint16_t crc_rx;         // FRAME_OK and FRAME_ERR_CRC (0 for V2 GCM)
+    uint16_t crc_calc;       // FRAME_OK and FRAME_ERR_CRC (0 for V2 GCM)
+
+    // Bytes starting at TYPE, for diagnostics on FRAME_DROPPED (and the
+    // whole TYPE..CRC span on FRAME_OK; TYPE..TAG for V2 GCM, so the first
+    // FRAME_HDR_SIZE bytes are the GCM additional data).
+    const uint8_t *raw;
+    size_t raw_len;
+    frame_error_t error;
+
+    // Candidate number: frame_parser_peek() reports the same value as the
+    // FRAME_OK or FRAME_DROPPED that eventually ends that candidate.
+    uint32_t seq;
+} lifi_frame_t;
+
+typedef struct {
+    uint8_t buf[FRAME_PARSER_BUF_SIZE];
+    size_t head;  // first byte not yet proven to be garbage
+    size_t tail;  // one past the last received byte
+
+    bool waiting;           // a candidate at `head` is incomplete
+    uint32_t wait_start_ms; // when that candidate was first seen
+    uint32_t seq;           // bumped for every new candidate
+
+    bool last_ok;           // the last frame_parser_next() returned FRAME_OK
+    size_t last_head;       // and its preamble started here
+
+    // Counters, cumulative since frame_parser_init().
+    uint32_t frames_ok;
+    uint32_t type_fail;
+    uint32_t len_fail;
+    uint32_t crc_fail;
+    uint32_t auth_fail;      // V2 GCM frames handed back by frame_parser_reject()
+    uint32_t timeouts;
+    uint32_t resyncs;        // rescans started inside a rejected candidate
+    uint32_t bytes_skipped;  // bytes discarded while hunting for a preamble
+    uint32_t overflows;      // bytes refused by frame_parser_push()
+} frame_parser_t;
+
+// Resets the parser, dropping any buffered bytes and zeroing the counters.
+//
+// @param p Parser to initialize
+void frame_parser_init(frame_parser_t *p);
+
+// Drops buffered bytes but keeps the counters (e.g. after a baud change).
+//
+// @param p Parser to reset
+void frame_parser_reset(frame_parser_t *p);
+
+// Copies received bytes into the parser.
+//
+// @param p Parser
+// @param data Received bytes
+// @param len Number of bytes in `data`
+// @return Number of bytes accepted; less than `len` only if the buffer is
+//         full, in which case the rest are counted in `overflows`
+size_t frame_parser_push(frame_parser_t *p, const uint8_t *data, size_t len);
+
+// Returns a pointer to free space at the end of the buffer so the caller can
+// read() straight into it, followed by frame_parser_commit().
+//
+// @param p Parser
+// @param space Out: number of bytes that may be written
+// @return Write pointer (valid until the next call into the parser)
+uint8_t *frame_parser_write_ptr(frame_parser_t *p, size_t *space);
+
+// Marks `n` bytes written through frame_parser_write_ptr() as received.
+//
+// @param p Parser
+// @param n Number of bytes written
+void frame_parser_commit(frame_parser_t *p, size_t n);
+
+// Extracts the next frame or rejection. Call repeatedly until it returns
+// FRAME_NONE; pointers in *out stay valid until the next call into the
+// parser.
+//
+// @param p Parser
+// @param now_ms Monotonic time in milliseconds (wraparound is fine)
+// @param out Filled in for FRAME_OK and FRAME_DROPPED
+// @return FRAME_NONE, FRAME_OK or FRAME_DROPPED
+frame_result_t frame_parser_next(frame_parser_t *p, uint32_t now_ms,
+                                 lifi_frame_t *out);
+
+// Describes the incomplete candidate frame_parser_next() is waiting on, so a
+// receiver can start on its payload (e.g. GCM decryption) before the last
+// byte arrives. Only meaningful after frame_parser_next() returned
+// FRAME_NONE; pointers stay valid until the next call into the parser.
+//
+// @param p Parser
+// @param out Filled in with type, len, seq, and raw / raw_len covering the
+//            bytes from TYPE that have arrived so far
+// @return true if a candidate whose header passed the TYPE and LEN checks
+//         is pending
+bool frame_parser_peek(const frame_parser_t *p, lifi_frame_t *out);
+
+// Takes back the frame just returned as FRAME_OK: it no longer counts in
+// frames_ok, and scanning resumes one byte after its preamble. Meant for V2
+// GCM frames whose tag check failed, since no CRC vouches for their LEN.
+// Call it before pushing more bytes or calling frame_parser_next() again.
+//
+// @param p Parser
+void frame_parser_reject(frame_parser_t *p);
+
+// Returns true if no partial frame is pending (the line is quiet).
+//
+// @param p Parser
+bool frame_parser_idle(const frame_parser_t *p);
+
+// Human-readable name for a frame_error_t.
+const char *frame_error_str(frame_error_t err);
+
+#endif  // FRAME_PARSER_H
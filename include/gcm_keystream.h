@@ -0,0 +1,89 @@
+#ifndef GCM_KEYSTREAM_H
+#define GCM_KEYSTREAM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "mbedtls/aes.h"
+#include "sst_crypto_embedded.h"
+
+// AES-GCM with the AES work done ahead of time, for the Pico sender.
+//
+// The sender's nonces are salt || counter (pico_nonce_generate()), so the
+// counter blocks of the next few messages are known before anything is
+// typed. gcm_ks_fill() encrypts them while the core would otherwise spin
+// in the USB poll loop; gcm_ks_encrypt() then only XORs the plaintext with
+// stored keystream and runs GHASH (4-bit tables, built once per key).
+// Blocks past GCM_KS_BLOCKS, or a nonce the pool has not reached, are
+// encrypted on the spot, and the result is the same frame
+// sst_encrypt_gcm_aad() produces.
+//
+// Each entry is wiped as soon as its nonce is used. A new salt
+// (pico_nonce_on_key_change() draws one) or a different key empties the
+// whole pool, so stale keystream is never applied to a frame.
+
+#define GCM_KS_DEPTH  4    // upcoming nonces kept ready
+#define GCM_KS_BLOCKS 16   // keystream blocks per nonce (256 bytes of message)
+
+typedef struct {
+    bool used;                      // holds blocks for `ctr`
+    uint32_t ctr;                   // nonce counter (last 4 nonce bytes)
+    uint8_t done;                   // blocks filled: E(J0), then E(J0 + i)
+    uint8_t ekj0[16];               // E(K, J0), masks the tag
+    uint8_t ks[GCM_KS_BLOCKS * 16];
+} gcm_ks_entry_t;
+
+typedef struct {
+    bool keyed;
+    uint8_t key[SST_KEY_SIZE];
+    uint8_t salt[SST_NONCE_SIZE - 4];
+    mbedtls_aes_context aes;
+    uint64_t hl[16], hh[16];        // GHASH multiples of H
+    gcm_ks_entry_t ent[GCM_KS_DEPTH];
+
+    // Counters, cumulative since gcm_ks_init().
+    uint32_t hits;                  // frames that found E(J0) ready
+    uint32_t misses;                // frames encrypted from scratch
+    uint32_t blocks_used;           // precomputed blocks consumed
+} gcm_ks_pool_t;
+
+// @param p Pool to clear (no key; gcm_ks_fill() does nothing until keyed)
+void gcm_ks_init(gcm_ks_pool_t *p);
+
+// Wipes all keystream and the key schedule. Call on every key change.
+//
+// @param p Pool
+void gcm_ks_reset(gcm_ks_pool_t *p);
+
+// Precomputes up to `max_blocks` AES blocks for `next_nonce` and the
+// GCM_KS_DEPTH - 1 counters after it. Meant for the idle loop, a few
+// blocks per pass, so the UART FIFO is still drained in time.
+//
+// @param p Pool
+// @param key AES-128 session key the next frames will use
+// @param next_nonce Nonce the next frame will get (pico_nonce_peek())
+// @param max_blocks AES blocks to compute in this call
+// @return Blocks computed (0 once the pool is full)
+int gcm_ks_fill(gcm_ks_pool_t *p, const uint8_t *key,
+                const uint8_t *next_nonce, int max_blocks);
+
+// sst_encrypt_gcm_aad(), using the precomputed blocks for `nonce` if the
+// pool has them.
+//
+// @param p Pool
+// @param key AES-128 session key (16 bytes)
+// @param nonce Nonce from pico_nonce_generate() (12 bytes)
+// @param aad Data authenticated but not encrypted (may be NULL if aad_len is 0)
+// @param aad_len Length of aad
+// @param input Plaintext
+// @param input_len Length of plaintext
+// @param ciphertext Output buffer for encrypted data
+// @param tag Output buffer for authentication tag (16 bytes)
+// @return 0 on success, non-zero on failure
+int gcm_ks_encrypt(gcm_ks_pool_t *p, const uint8_t *key, const uint8_t *nonce,
+                   const uint8_t *aad, size_t aad_len,
+                   const uint8_t *input, size_t input_len,
+                   uint8_t *ciphertext, uint8_t *tag);
+
+#endif  // GCM_KEYSTREAM_H
@@ -26,6 +26,12 @@ void get_random_bytes(uint8_t *buffer, size_t len);
 // @return true if key received, false otherwise
 bool receive_new_key_with_timeout(uint8_t *id_out, uint8_t *key_out, uint32_t timeout_ms);
 
+// SHA-256 over ID || key, stored with each flash key block to validate it.
+// @param id Key ID (8 bytes)
+// @param key Key (16 bytes)
+// @param out_hash Output buffer (32 bytes)
+void compute_key_hash(const uint8_t *id, const uint8_t *key, uint8_t *out_hash);
+
 // Fills a key buffer with zeros.
 // @param key Key buffer to clear
 void zero_key(uint8_t *key);
@@ -133,6 +139,13 @@ void pico_nonce_init(void);
 // @param out12 Caller-allocated output buffer (must be 12 bytes).
 void pico_nonce_generate(uint8_t out12[12]);
 
+// The nonce the next pico_nonce_generate() call will return, without
+// using it up; lets the sender precompute its AES-CTR blocks while idle
+// (gcm_keystream.h).
+//
+// @param out12 Caller-allocated output buffer (must be 12 bytes).
+void pico_nonce_peek(uint8_t out12[12]);
+
 // Resets the nonce state when a new session key is installed.
 // Must be called whenever the session key changes to ensure nonce uniqueness.
 void pico_nonce_on_key_change(void);
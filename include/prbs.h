@@ -0,0 +1,131 @@
+#ifndef PRBS_H
+#define PRBS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Pseudo-random bit sequences for link bit-error-rate tests:
+//
+//   PRBS-7   x^7  + x^6  + 1   (period 127 bits)
+//   PRBS-15  x^15 + x^14 + 1   (period 32767 bits)
+//   PRBS-23  x^23 + x^18 + 1   (period 8388607 bits)
+//
+// Bits go out LSB first within each byte, the same order the UART sends
+// them, so a byte lost or duplicated by the receiver shows up as a clean
+// byte slip rather than as random errors.
+//
+// The generator is inline so the sender needs nothing else. The checker
+// (src/prbs.c) locks onto the received stream, then compares it against a
+// free-running copy of the generator and reports bit errors, error bursts
+// and byte slips.
+
+typedef struct {
+    uint32_t state;  // last `order` bits, bit 0 = most recent
+    uint8_t  order;  // 7, 15 or 23
+    uint8_t  tap;    // second feedback tap: 6, 14 or 18
+} prbs_t;
+
+static inline bool prbs_order_valid(int order) {
+    return order == 7 || order == 15 || order == 23;
+}
+
+/**
+ * Start a generator. Any non-zero seed gives the same sequence at a
+ * different phase; the receiver locks on from whatever it sees first.
+ */
+static inline void prbs_init(prbs_t *g, int order) {
+    g->order = (uint8_t)order;
+    g->tap   = (uint8_t)(order == 7 ? 6 : order == 15 ? 14 : 18);
+    g->state = (1u << order) - 1;
+}
+
+static inline uint32_t prbs_next_bit(prbs_t *g) {
+    uint32_t b = ((g->state >> (g->order - 1)) ^ (g->state >> (g->tap - 1))) & 1u;
+    g->state = ((g->state << 1) | b) & ((1u << g->order) - 1);
+    return b;
+}
+
+static inline uint8_t prbs_next_byte(prbs_t *g) {
+    uint8_t v = 0;
+    for (int i = 0; i < 8; i++) v |= (uint8_t)(prbs_next_bit(g) << i);
+    return v;
+}
+
+// ── Checker ──────────────────────────────────────────────────────────────────
+
+// Error bursts: errors closer than PRBS_BURST_GAP error-free bits belong to
+// one burst. Histogram bins by burst span: 1, 2, 3-4, 5-8, 9-16, 17+ bits.
+#define PRBS_BURST_GAP  8
+#define PRBS_BURST_BINS 6
+
+// Lock is declared lost when the last PRBS_WIN_BYTES bytes hold more than
+// PRBS_LOSS_ERRORS bit errors (a slipped stream compares at ~50% errors).
+// Those bytes are discarded rather than counted as bit errors.
+#define PRBS_WIN_BYTES    8
+#define PRBS_LOSS_ERRORS  16
+
+// Bytes that must match exactly before a fresh lock is trusted
+#define PRBS_VERIFY_BYTES 4
+
+// Largest byte slip that is measured; larger ones count as resyncs
+#define PRBS_MAX_SLIP 8
+
+typedef struct {
+    uint64_t bits;            // bits compared against the sequence
+    uint64_t errors;          // bit errors among them
+    uint64_t unchecked_bits;  // bits received while unlocked / discarded
+    uint32_t bytes;           // bytes fed in
+    uint32_t slips;           // byte slip events
+    uint32_t bytes_lost;      // total bytes missing across slips
+    uint32_t bytes_extra;     // total bytes inserted across slips
+    uint32_t resyncs;         // lock lost without a measurable slip
+    uint32_t bursts[PRBS_BURST_BINS];
+    uint32_t max_burst;       // longest burst span in bits
+    bool     ever_locked;
+} prbs_stats_t;
+
+typedef struct {
+    prbs_t   gen;             // expected sequence (valid once locked)
+    int      order;
+    int      phase;           // 0 = acquiring, 1 = verifying, 2 = locked
+    uint32_t acq;             // acquisition shift register
+    int      acq_bits;
+    int      verify_left;
+
+    // Bytes not yet committed to the stats, oldest first
+    uint8_t  win_err[PRBS_WIN_BYTES];
+    uint32_t win_state[PRBS_WIN_BYTES];  // generator state before each byte
+    int      win_head, win_n;
+    uint32_t win_errors;
+
+    // Where lock was lost, for measuring the slip once relocked
+    bool     have_ref;
+    uint32_t ref_state;
+    uint32_t ref_byte;        // stats.bytes index of the byte at ref_state
+
+    bool     in_burst;
+    uint32_t burst_span;
+    uint32_t burst_gap;
+
+    prbs_stats_t stats;
+} prbs_check_t;
+
+// Starts a checker for PRBS-`order` (see prbs_order_valid()).
+//
+// @param c Checker
+// @param order 7, 15 or 23
+void prbs_check_init(prbs_check_t *c, int order);
+
+// Feeds one received byte.
+//
+// @param c Checker
+// @param byte Received byte (after any line inversion)
+void prbs_check_byte(prbs_check_t *c, uint8_t byte);
+
+// Commits the bytes still held for lock-loss detection and closes an open
+// burst; call once when the stream ends, before reading c->stats.
+//
+// @param c Checker
+void prbs_check_finish(prbs_check_t *c);
+
+#endif  // PRBS_H
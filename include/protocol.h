@@ -1,7 +1,7 @@
 #pragma once
 
 /* -------- Protocol identity -------- */
-#define PROTO_VERSION 1
+#define PROTO_VERSION 2
 
 /* -------- Framing -------- */
 /* New 4-byte preamble (1 in 4 billion false positive rate) */
@@ -21,6 +21,36 @@
 #define MSG_TYPE_SST_HS2     0x09  /* SST handshake step 2: Pico→Pi4 over LiFi */
 #define MSG_TYPE_SST_HS3     0x0A  /* SST handshake step 3: Pi4→Pico over UART (mutual auth) */
 #define MSG_TYPE_KEY         0x10  /* Key provisioning */
+#define MSG_TYPE_SUITES      0x11  /* AEAD suites the receiver accepts: Pi4→Pico over UART */
+
+/* Version 2 GCM frames: same payload as ENCRYPTED / FILE, but TYPE|LEN is
+ * passed to GCM as additional data and there is no CRC16 trailer. The tag
+ * already covers NONCE and CT, so with the header bound as well the CRC
+ * adds nothing but 2 bytes and a second pass over the frame. */
+#define MSG_TYPE_ENCRYPTED_V2 0x12
+#define MSG_TYPE_FILE_V2      0x16
+
+/* Version 2 frames sealed with ChaCha20-Poly1305 instead of AES-GCM, for
+ * senders without AES hardware (the RP2040). Same NONCE|CT|TAG layout and
+ * sizes, TYPE|LEN as additional data, no CRC16. Only sent once the
+ * receiver has listed SUITE_CHACHAPOLY in a MSG_TYPE_SUITES frame. */
+#define MSG_TYPE_ENCRYPTED_CC 0x32
+#define MSG_TYPE_FILE_CC      0x36
+
+/* MSG_TYPE_SUITES payload: one byte, a mask of these */
+#define SUITE_AES_GCM     0x01
+#define SUITE_CHACHAPOLY  0x02
+
+#define MSG_TYPE_IS_GCM(t)  ((t) == MSG_TYPE_ENCRYPTED || (t) == MSG_TYPE_FILE || \
+                             (t) == MSG_TYPE_ENCRYPTED_V2 || (t) == MSG_TYPE_FILE_V2)
+#define MSG_TYPE_IS_CHACHA(t) ((t) == MSG_TYPE_ENCRYPTED_CC || (t) == MSG_TYPE_FILE_CC)
+/* Any encrypted message frame, whichever AEAD sealed it */
+#define MSG_TYPE_IS_AEAD(t) (MSG_TYPE_IS_GCM(t) || MSG_TYPE_IS_CHACHA(t))
+#define MSG_TYPE_IS_FILE(t) ((t) == MSG_TYPE_FILE || (t) == MSG_TYPE_FILE_V2 || \
+                             (t) == MSG_TYPE_FILE_CC)
+/* TYPE|LEN is AEAD additional data and the frame has no CRC16 */
+#define MSG_TYPE_HAS_AAD(t) ((t) == MSG_TYPE_ENCRYPTED_V2 || (t) == MSG_TYPE_FILE_V2 || \
+                             MSG_TYPE_IS_CHACHA(t))
 
 /* Cooldown to avoid thrashing key updates */
 #define KEY_UPDATE_COOLDOWN_S 15
@@ -9,6 +9,14 @@
 #define SST_NONCE_SIZE 12
 #define SST_TAG_SIZE 16
 
+// Implementation is picked at build time: mbedTLS by default (the Pico),
+// OpenSSL EVP when SST_CRYPTO_BACKEND_OPENSSL is defined (the Linux
+// receivers, see SST_CRYPTO_BACKEND in CMakeLists.txt). Both give the same
+// results and return 0 on success.
+
+// @return "mbedtls" or "openssl"
+const char *sst_crypto_backend(void);
+
 // Encrypt using AES-GCM with provided key & nonce.
 // @param key AES-128 key (16 bytes)
 // @param nonce Nonce (12 bytes, must be unique per message)
@@ -33,6 +41,106 @@ int sst_decrypt_gcm(const uint8_t *key, const uint8_t *nonce,
                     const uint8_t *ciphertext, size_t ciphertext_len,
                     const uint8_t *tag, uint8_t *output);
 
+// sst_encrypt_gcm() with additional authenticated data. Version 2 frames
+// pass their TYPE|LEN header here so the tag covers it too.
+// @param aad Data authenticated but not encrypted (may be NULL if aad_len is 0)
+// @param aad_len Length of aad
+// @return 0 on success, non-zero on failure
+int sst_encrypt_gcm_aad(const uint8_t *key, const uint8_t *nonce,
+                        const uint8_t *aad, size_t aad_len,
+                        const uint8_t *input, size_t input_len,
+                        uint8_t *ciphertext, uint8_t *tag);
+
+// sst_decrypt_gcm() with additional authenticated data; fails unless aad
+// matches what the sender passed to sst_encrypt_gcm_aad().
+// @return 0 on success, non-zero if authentication fails
+int sst_decrypt_gcm_aad(const uint8_t *key, const uint8_t *nonce,
+                        const uint8_t *aad, size_t aad_len,
+                        const uint8_t *ciphertext, size_t ciphertext_len,
+                        const uint8_t *tag, uint8_t *output);
+
+// Incremental AES-GCM decryption, so a receiver can decrypt a frame while
+// the rest of it is still arriving. Plaintext is written to the caller's
+// buffer as ciphertext is fed in but must not be used until
+// sst_gcm_stream_finish() returns 0; on a tag mismatch it is wiped.
+// The backend cipher context is allocated by the first start and reused.
+typedef struct {
+    void *impl;    // backend GCM context
+    uint8_t *out;  // plaintext buffer given to sst_gcm_stream_start()
+    size_t done;   // ciphertext bytes decrypted so far
+} sst_gcm_stream_t;
+
+// @param s Stream to clear
+void sst_gcm_stream_init(sst_gcm_stream_t *s);
+
+// Starts (or restarts) decryption of one message.
+// @param s Stream from sst_gcm_stream_init()
+// @param key AES-128 key (16 bytes)
+// @param nonce Nonce (12 bytes)
+// @param aad Additional authenticated data (may be NULL if aad_len is 0)
+// @param aad_len Length of aad
+// @param output Plaintext buffer, as long as the whole ciphertext
+// @return 0 on success
+int sst_gcm_stream_start(sst_gcm_stream_t *s, const uint8_t *key,
+                         const uint8_t *nonce, const uint8_t *aad,
+                         size_t aad_len, uint8_t *output);
+
+// Decrypts the next `len` ciphertext bytes into output + s->done.
+// Any length is fine; there is no block alignment requirement.
+// @return 0 on success
+int sst_gcm_stream_update(sst_gcm_stream_t *s, const uint8_t *ciphertext,
+                          size_t len);
+
+// Checks the tag over everything fed since the start.
+// @param tag Authentication tag (16 bytes)
+// @return 0 if the tag matches, non-zero (and the plaintext wiped) if not
+int sst_gcm_stream_finish(sst_gcm_stream_t *s, const uint8_t *tag);
+
+// Frees the backend context.
+void sst_gcm_stream_free(sst_gcm_stream_t *s);
+
+// ChaCha20-Poly1305 (RFC 8439), the alternative to AES-GCM for senders
+// without AES hardware. Same 12-byte nonce and 16-byte tag, so frames keep
+// their layout; only the cipher and its 256-bit key differ.
+#define SST_CHACHAPOLY_KEY_SIZE 32
+
+// Derives the ChaCha20-Poly1305 key from an AES-128 session key:
+// HMAC-SHA256(session_key, "LiFi ChaCha20-Poly1305"). Both ends derive it,
+// so key provisioning is unchanged.
+// @param key AES-128 session key (16 bytes)
+// @param out Output buffer (SST_CHACHAPOLY_KEY_SIZE bytes)
+// @return 0 on success
+int sst_chachapoly_derive_key(const uint8_t *key, uint8_t *out);
+
+// Encrypt with ChaCha20-Poly1305.
+// @param key Key from sst_chachapoly_derive_key() (32 bytes)
+// @param nonce Nonce (12 bytes, must be unique per message and key)
+// @param aad Data authenticated but not encrypted (may be NULL if aad_len is 0)
+// @param aad_len Length of aad
+// @param input Plaintext input buffer
+// @param input_len Length of plaintext
+// @param ciphertext Output buffer for encrypted data
+// @param tag Output buffer for authentication tag (16 bytes)
+// @return 0 on success, non-zero on failure
+int sst_encrypt_chachapoly(const uint8_t *key, const uint8_t *nonce,
+                           const uint8_t *aad, size_t aad_len,
+                           const uint8_t *input, size_t input_len,
+                           uint8_t *ciphertext, uint8_t *tag);
+
+// Decrypt with ChaCha20-Poly1305; on a tag mismatch the output is wiped.
+// @return 0 on success, non-zero if authentication fails
+int sst_decrypt_chachapoly(const uint8_t *key, const uint8_t *nonce,
+                           const uint8_t *aad, size_t aad_len,
+                           const uint8_t *ciphertext, size_t ciphertext_len,
+                           const uint8_t *tag, uint8_t *output);
+
+// Compute SHA-256.
+// @param input Data to hash
+// @param input_len Length of input
+// @param output Output buffer (32 bytes)
+// @return 0 on success
+int sst_sha256(const uint8_t *input, size_t input_len, uint8_t *output);
+
 // Compute HMAC-SHA256 (uses SST_KEY_SIZE=16 as key length)
 // @param key Session key (16 bytes)
 // @param input Data to hash
@@ -53,6 +161,36 @@ int sst_hmac_sha256_ex(const uint8_t *key, size_t key_len,
                         const uint8_t *input, size_t input_len,
                         uint8_t *output);
 
+// HMAC-SHA256 keyed once per session key. sst_hmac_setkey() hashes the
+// key's ipad and opad blocks and keeps both SHA-256 states; every
+// sst_hmac_compute() starts from copies of them, so a message that fits one
+// block costs 2 SHA-256 compressions instead of the 4 of sst_hmac_sha256_ex().
+// The states live in backend memory allocated by sst_hmac_setkey().
+typedef struct {
+    void *inner;  // SHA-256 state after key ^ ipad
+    void *outer;  // SHA-256 state after key ^ opad
+} sst_hmac_ctx_t;
+
+// @param ctx Context to clear (no key; sst_hmac_compute() fails)
+void sst_hmac_init(sst_hmac_ctx_t *ctx);
+
+// Keys (or re-keys) the context.
+// @param ctx Context from sst_hmac_init()
+// @param key HMAC key (32 bytes for SST mac_keys)
+// @param key_len Key length in bytes
+// @return 0 on success
+int sst_hmac_setkey(sst_hmac_ctx_t *ctx, const uint8_t *key, size_t key_len);
+
+// Same result as sst_hmac_sha256_ex() with the key given to sst_hmac_setkey().
+// Doesn't modify ctx, so callers holding a lock may share one context.
+// @param output Output buffer (32 bytes)
+// @return 0 on success, non-zero if ctx has no key
+int sst_hmac_compute(const sst_hmac_ctx_t *ctx, const uint8_t *input,
+                     size_t input_len, uint8_t *output);
+
+// Wipes the key states and frees them.
+void sst_hmac_free(sst_hmac_ctx_t *ctx);
+
 // AES-128-CBC decrypt (no padding strip – caller validates padding).
 // input_len must be a multiple of 16.
 // @return 0 on success, non-zero on mbedTLS error
@@ -0,0 +1,105 @@
+#ifndef USB_RECORDS_H
+#define USB_RECORDS_H
+
+#include <stdint.h>
+
+// Binary USB output of lifi_pico2_rx (`out bin`). Each record is
+//
+//   0x00 COBS( TYPE | PAYLOAD | CRC16 ) 0x00
+//
+// CRC16 is CRC-16-CCITT (crc16.h) over TYPE|PAYLOAD, big-endian like the
+// LiFi frame CRC. Payload structs are packed and little-endian. The leading
+// 0x00 closes any text the firmware printed in between (command replies,
+// banner), so a reader can hand such chunks through as text; see
+// receiver/include/usb_reader.h.
+
+#define USBREC_TEXT    0x00  // host side only: bytes outside any record
+#define USBREC_FRAME   0x01  // usbrec_frame_t + data
+#define USBREC_RAW     0x02  // received line bytes, as-is (raw mode)
+#define USBREC_STATS   0x03  // usbrec_stats_t, replaces the [ALIVE] heartbeat
+#define USBREC_TEST    0x04  // usbrec_test_t, bench protocol events
+#define USBREC_KEY_ID  0x05  // usbrec_key_id_t
+#define USBREC_PRBS    0x06  // usbrec_prbs_t, one PRBS BER run
+
+// Largest data part of a record: an expanded FILE frame
+#define USBREC_MAX_DATA    32768
+#define USBREC_MAX_PAYLOAD (USBREC_MAX_DATA + 16)
+#define USBREC_CRC_SIZE    2
+
+// usbrec_frame_t.type for plaintext lines (`mode text`); otherwise the
+// MSG_TYPE_* of the authenticated frame
+#define USBREC_FRAME_PLAINTEXT 0x00
+
+typedef struct __attribute__((packed)) {
+    uint8_t  type;      // MSG_TYPE_ENCRYPTED, MSG_TYPE_FILE or USBREC_FRAME_PLAINTEXT
+    uint8_t  reserved[3];
+    uint32_t seq;       // [MSG #n] / [FILE #n] / [RX #n] counter
+    uint32_t wire_len;  // FILE: compressed length; otherwise the data length
+} usbrec_frame_t;       // followed by the plaintext / expanded data
+
+typedef struct __attribute__((packed)) {
+    uint32_t uptime_ms;
+    uint32_t baud;
+    uint8_t  vote;
+    uint8_t  mode;      // 0 = SST, 1 = TEXT, 2 = RAW
+    uint16_t dac_code;  // comparator threshold (MCP4725 code, 0 if no DAC)
+    uint32_t msgs;
+    uint32_t ring_overflows;
+    uint32_t fifo_stalls;
+    uint32_t frames_ok;
+    uint32_t crc_fail;
+    uint32_t dropped;
+    uint32_t decrypted;
+    uint32_t auth_fail;
+    uint32_t replays;
+    uint32_t no_key;
+    uint32_t files;
+} usbrec_stats_t;
+
+#define USBREC_TEST_START  1  // [TEST_START] baud vote
+#define USBREC_TEST_RESULT 2  // [TEST_RESULT] baud sent recv vote
+#define USBREC_TEST_BAUD   3  // [TEST] baud_switch
+#define USBREC_TEST_DONE   4  // [TEST_DONE]
+
+typedef struct __attribute__((packed)) {
+    uint8_t  event;
+    uint8_t  vote;
+    uint16_t reserved;
+    uint32_t baud;
+    uint32_t sent;
+    uint32_t recv;
+} usbrec_test_t;
+
+#define USBREC_KEY_NONE     0
+#define USBREC_KEY_MATCH    1
+#define USBREC_KEY_MISMATCH 2
+
+typedef struct __attribute__((packed)) {
+    uint8_t key_id[8];
+    uint8_t status;     // USBREC_KEY_*
+} usbrec_key_id_t;
+
+typedef struct __attribute__((packed)) {
+    uint32_t baud;
+    uint8_t  order;         // 7, 15 or 23
+    uint8_t  vote;
+    uint16_t reserved;
+    uint32_t sent;          // bytes, from __PRBS_END
+    uint32_t recv;          // bytes fed to the checker
+    uint64_t bits;          // bits compared
+    uint64_t errors;
+    uint64_t unchecked_bits;
+    uint32_t slips;
+    uint32_t bytes_lost;
+    uint32_t bytes_extra;
+    uint32_t resyncs;
+    uint32_t bursts[6];     // spans 1, 2, 3-4, 5-8, 9-16, 17+ bits
+    uint32_t max_burst;
+} usbrec_prbs_t;
+
+typedef char usbrec_frame_size_check[(sizeof(usbrec_frame_t) == 12) ? 1 : -1];
+typedef char usbrec_stats_size_check[(sizeof(usbrec_stats_t) == 56) ? 1 : -1];
+typedef char usbrec_test_size_check[(sizeof(usbrec_test_t) == 16) ? 1 : -1];
+typedef char usbrec_prbs_size_check[(sizeof(usbrec_prbs_t) == 84) ? 1 : -1];
+
+#endif  // USB_RECORDS_H
@@ -0,0 +1,137 @@
+// include/decrypt_pool.h
+#pragma once
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "../../include/frame_decrypt.h"
+#include "../../include/frame_parser.h"
+#include "../../include/protocol.h"
+
+// Decrypts AEAD frames (and heatshrink-expands FILE frames) on worker
+// threads, so the thread reading the UART only parses and hands off.
+//
+// The reader submits each CRC-checked frame together with the key it
+// should be opened with; results come back from decrypt_pool_next() in
+// nonce counter order (the last 4 nonce bytes, see pico_nonce_generate()),
+// whatever order the workers finished in. A result is held back only while
+// a frame with a lower counter is still being worked on, so a frame lost
+// on the link never stalls delivery. A new nonce salt (sender reboot or
+// key change) starts a new sequence after everything already submitted.
+//
+// With 0 workers every frame is decrypted inside decrypt_pool_submit() by
+// the caller, using frame_decrypt_poll()'s head start (decrypt_pool_poll()).
+
+#define DECRYPT_POOL_MAX_WORKERS 8
+#define DECRYPT_POOL_DEPTH 32           // frames in flight or not yet delivered
+#define DECRYPT_POOL_EXPAND_MAX 32768   // heatshrink output per FILE frame
+#define DECRYPT_POOL_EXPAND_FAILED (-2) // ret: the tag verified, but the FILE
+                                        // is corrupt or fills the buffer
+
+typedef enum {
+    DJOB_FREE = 0,
+    DJOB_QUEUED,     // waiting for a worker
+    DJOB_BUSY,       // a worker is on it
+    DJOB_DONE        // waiting for decrypt_pool_next()
+} decrypt_job_state_t;
+
+typedef struct {
+    decrypt_job_state_t state;
+    uint64_t order;  // (salt epoch << 32) | nonce counter
+
+    uint8_t type;
+    uint16_t len;                                 // payload length
+    uint8_t raw[FRAME_HDR_SIZE + MAX_MSG_LEN];    // TYPE|LEN|NONCE|CT|TAG
+    uint8_t key[SST_KEY_SIZE];
+
+    int ret;                                      // 0 if the tag verified
+                                                  // (and a FILE expanded)
+    uint8_t plain[MAX_MSG_LEN + 1];
+    uint8_t expanded[DECRYPT_POOL_EXPAND_MAX + 1];
+    size_t expanded_len;
+} decrypt_job_t;
+
+// A delivered frame; pointers stay valid until the next decrypt_pool_next().
+typedef struct {
+    uint8_t type;
+    int ret;                    // 0 if the tag verified and a FILE expanded
+                                // (else DECRYPT_POOL_EXPAND_FAILED); only
+                                // type, nonce and ciphertext are set otherwise
+    const uint8_t *nonce;
+    const uint8_t *ciphertext;
+    size_t ctext_len;
+    uint8_t *plain;             // ctext_len bytes plus a NUL
+    const uint8_t *expanded;    // FILE types: heatshrink output plus a NUL
+    size_t expanded_len;
+} decrypt_result_t;
+
+typedef struct {
+    int workers;
+    pthread_t threads[DECRYPT_POOL_MAX_WORKERS];
+    pthread_mutex_t mutex;
+    pthread_cond_t work_cond;   // a job was queued, or stop
+    pthread_cond_t done_cond;   // a job finished
+    bool stop;
+
+    decrypt_job_t *jobs;        // DECRYPT_POOL_DEPTH entries
+    decrypt_job_t *delivered;   // last job handed out by decrypt_pool_next()
+
+    uint8_t last_salt[NONCE_SIZE - 4];
+    uint32_t epoch;
+    bool have_salt;
+
+    frame_decrypt_t fdec;       // 0 workers: decrypts in the reader
+
+    // Counters, cumulative since decrypt_pool_start().
+    uint32_t submitted;
+    uint32_t out_of_order;      // finished before a lower counter
+    uint32_t stalls;            // submit found every slot taken
+} decrypt_pool_t;
+
+// Allocates the job slots and starts the workers.
+//
+// @param p Pool
+// @param workers Worker threads (0 to decrypt in the caller, clamped to
+//                DECRYPT_POOL_MAX_WORKERS)
+// @return 0 on success, -1 if allocation or pthread_create() failed
+int decrypt_pool_start(decrypt_pool_t *p, int workers);
+
+// Stops the workers and frees the slots. Undelivered results are dropped.
+void decrypt_pool_stop(decrypt_pool_t *p);
+
+// True if decrypt_pool_submit() has no free slot; the caller should deliver
+// results (decrypt_pool_next()) before pulling more frames from the parser.
+bool decrypt_pool_full(decrypt_pool_t *p);
+
+// Queues a FRAME_OK encrypted frame (MSG_TYPE_IS_AEAD). The frame is
+// copied, so the parser may move on immediately.
+//
+// @param p Pool
+// @param f Frame from frame_parser_next()
+// @param key AES-128 session key to open it with (copied; ChaCha20-Poly1305
+//            frames use the key derived from it)
+// @return 0 if queued; with 0 workers, the tag check result (non-zero
+//         frames are not queued, so a V2 frame can still be handed back
+//         with frame_parser_reject()); -1 if the pool is full
+int decrypt_pool_submit(decrypt_pool_t *p, const lifi_frame_t *f,
+                        const uint8_t *key);
+
+// With 0 workers, starts decrypting the frame the parser is waiting on
+// (frame_decrypt_poll()); with workers it does nothing.
+void decrypt_pool_poll(decrypt_pool_t *p, const frame_parser_t *parser,
+                       const uint8_t *key);
+
+// Hands out the next result in nonce counter order, if it is ready.
+//
+// @param p Pool
+// @param out Filled in on success
+// @return true if *out holds a result
+bool decrypt_pool_next(decrypt_pool_t *p, decrypt_result_t *out);
+
+// Waits up to timeout_ms for a result to become deliverable.
+//
+// @return true if decrypt_pool_next() will return a result
+bool decrypt_pool_wait(decrypt_pool_t *p, int timeout_ms);
+
+// Frames submitted but not yet delivered.
+size_t decrypt_pool_pending(decrypt_pool_t *p);
@@ -0,0 +1,72 @@
+// include/key_cache.h
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+#include "c_api.h"
+
+// Session keys the receiver already holds, keyed on the full 8-byte key ID.
+//
+// sst-c-api's find_session_key() takes an unsigned int and scans its list,
+// so two IDs that share their low 32 bits collide and every lookup is
+// O(keys). This table sits in front of it: open addressing with linear
+// probing on a 64-bit hash of the ID, entries copied in (no pointers into
+// a session_key_list_t that may be freed or reallocated).
+//
+// An entry stops being returned at the earlier of KEY_CACHE_TTL_S after it
+// was stored and KEY_CACHE_EXPIRY_MARGIN_S before the key's abs_validity,
+// so the caller goes back to Auth before the sender's key expires rather
+// than after. When KEY_CACHE_MAX keys are held, storing another evicts the
+// least recently used one.
+
+#define KEY_CACHE_SLOTS 64              // power of two
+#define KEY_CACHE_MAX 48                // live entries (75% load)
+#define KEY_CACHE_TTL_S 3600
+#define KEY_CACHE_EXPIRY_MARGIN_S 5
+
+typedef struct {
+    bool used;
+    uint64_t id;                        // big-endian key_id
+    uint64_t last_use;                  // key_cache_t.tick at last hit/store
+    time_t deadline;                    // wall clock, see above
+    session_key_t key;
+} key_cache_entry_t;
+
+typedef struct {
+    key_cache_entry_t slot[KEY_CACHE_SLOTS];
+    int count;
+    uint64_t tick;
+
+    // Counters, cumulative since key_cache_init().
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t expired;                   // found but past the deadline
+    uint32_t evictions;                 // LRU entries dropped for a new key
+} key_cache_t;
+
+// Full 64-bit value of a SESSION_KEY_ID_SIZE-byte key ID (big endian, as
+// Auth prints it).
+uint64_t key_cache_id(const unsigned char *key_id);
+
+void key_cache_init(key_cache_t *c);
+
+// Drops every entry and wipes the key material.
+void key_cache_clear(key_cache_t *c);
+
+// Copies the key with this ID into *out if it is cached and not expired.
+//
+// @param c Cache
+// @param key_id SESSION_KEY_ID_SIZE bytes
+// @param out Filled in on a hit (may be NULL to only test)
+// @return true on a hit
+bool key_cache_get(key_cache_t *c, const unsigned char *key_id,
+                   session_key_t *out);
+
+// Stores (or refreshes) a copy of *k, evicting the LRU entry if full.
+void key_cache_put(key_cache_t *c, const session_key_t *k);
+
+// key_cache_put() for every key in the list (NULL is ignored).
+void key_cache_put_list(key_cache_t *c, const session_key_list_t *l);
+
+// Forgets the key with this ID, e.g. after Auth revoked it.
+void key_cache_remove(key_cache_t *c, const unsigned char *key_id);
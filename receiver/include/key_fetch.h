@@ -0,0 +1,188 @@
+// include/key_fetch.h
+#pragma once
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+#include "c_api.h"
+#include "../../include/frame_parser.h"
+#include "../../include/protocol.h"
+
+// Session key requests to Auth on a worker thread, so a TCP round trip
+// never stops the thread that drains the UART.
+//
+// Three kinds of request can be outstanding at once, one of each: a key by
+// ID (a KEY_ID_ONLY beacon named a key the cache doesn't hold), a fresh
+// key for the configured purpose ("new key -f"), and a fresh key list to
+// replace one restored from the key store. The reader asks with
+// key_fetch_request_*() and picks the answer up later with key_fetch_poll().
+//
+// sst-c-api is not thread-safe. The worker holds the SST lock for each
+// call it makes; any other use of the same SST_ctx_t while the worker runs
+// must be bracketed by key_fetch_sst_lock()/key_fetch_sst_unlock().
+//
+// While a by-ID request is outstanding, encrypted frames are most likely
+// sealed under the key being fetched, so the reader parks them with
+// key_fetch_hold() instead of failing them with the old key, and feeds them
+// back to the decrypt pool with key_fetch_release() once the key is in.
+// The held frames belong to the reader thread alone.
+//
+// With key_fetch_prefetch(), the worker also keeps a few fresh keys ready
+// while it has nothing else to do, so a rotation ("new key -f", 'f') is a
+// local swap instead of a round trip to Auth: key_fetch_request_new() then
+// answers from the pool at once. The pool is refilled at most once per
+// KEY_UPDATE_COOLDOWN_S, and a pooled key with less than
+// KEY_FETCH_MIN_LIFE_S left before its abs_validity is thrown away.
+
+#define KEY_FETCH_MAX_HELD 32   // frames parked behind a by-ID request
+#define KEY_FETCH_POOL_MAX 8    // prefetched keys kept
+#define KEY_FETCH_PREFETCH_DEPTH 2  // what the receivers ask for
+#define KEY_FETCH_MIN_LIFE_S 60
+
+typedef enum {
+    KEY_FETCH_BY_ID = 0,        // get_session_key_by_ID()
+    KEY_FETCH_NEW,              // get_session_key() with a fresh list
+    KEY_FETCH_LIST,             // the same, never served from the pool
+    KEY_FETCH_KINDS
+} key_fetch_kind_t;
+
+typedef struct {
+    key_fetch_kind_t kind;
+    bool ok;
+    unsigned char key_id[SESSION_KEY_ID_SIZE];  // KEY_FETCH_BY_ID: as requested
+    bool refresh_dist;          // KEY_FETCH_BY_ID: as requested
+    session_key_t key;          // the key (KEY_FETCH_NEW/LIST: list->s_key[0])
+    session_key_list_t *list;   // KEY_FETCH_NEW/LIST: caller owns and frees it
+                                // (NULL when served from the prefetch pool)
+} key_fetch_result_t;
+
+typedef struct {
+    bool requested;             // waiting for or on the worker
+    bool done;                  // result waiting for key_fetch_poll()
+    key_fetch_result_t res;
+} key_fetch_job_t;
+
+typedef struct {
+    uint8_t type;
+    uint16_t len;
+    uint32_t seq;
+    uint8_t raw[FRAME_HDR_SIZE + MAX_MSG_LEN];  // TYPE|LEN|NONCE|CT|TAG
+} key_fetch_held_t;
+
+typedef struct {
+    SST_ctx_t *sst;
+    session_key_list_t *by_id_list;  // worker's own list for by-ID lookups
+
+    pthread_t thread;
+    bool running;
+    pthread_mutex_t mutex;      // jobs and stop
+    pthread_cond_t cond;        // a job was requested, or stop
+    pthread_mutex_t sst_mutex;  // held around every sst-c-api call
+    bool stop;
+    key_fetch_job_t job[KEY_FETCH_KINDS];
+
+    const char *store_path;     // key_fetch_store(), NULL = don't save
+    const char *store_key_path;
+
+    int prefetch_depth;         // pool target, 0 = no prefetching
+    session_key_t pool[KEY_FETCH_POOL_MAX];
+    int pool_count;
+    time_t last_prefetch;       // last pool refill from Auth
+
+    // Reader thread only.
+    key_fetch_held_t *held;     // KEY_FETCH_MAX_HELD entries
+    int held_head, held_count;
+
+    // Counters, cumulative since key_fetch_start().
+    uint32_t fetches;
+    uint32_t failures;
+    uint32_t held_total;        // frames parked
+    uint32_t held_dropped;      // parked frames lost (queue full or no key)
+    uint32_t pool_hits;         // KEY_FETCH_NEW answered from the pool
+    uint32_t pool_expired;      // pooled keys dropped near abs_validity
+} key_fetch_t;
+
+// Starts the worker.
+//
+// @param kf Fetcher
+// @param sst SST context shared with the caller (see key_fetch_sst_lock())
+// @return 0 on success, -1 if allocation or pthread_create() failed
+int key_fetch_start(key_fetch_t *kf, SST_ctx_t *sst);
+
+// Waits for a call in progress to return, then stops the worker. Results
+// not yet polled and held frames are dropped.
+void key_fetch_stop(key_fetch_t *kf);
+
+void key_fetch_sst_lock(key_fetch_t *kf);
+void key_fetch_sst_unlock(key_fetch_t *kf);
+
+// Asks Auth for the key with this ID.
+//
+// @param kf Fetcher
+// @param key_id SESSION_KEY_ID_SIZE bytes
+// @param refresh_dist Renew the distribution key with a group-purpose
+//        fetch first, in case another client on the same entity has
+//        handshaked with Auth since we last did
+// @return 0 if requested, 1 if this ID is already being fetched,
+//         -1 if a different ID is
+int key_fetch_request_id(key_fetch_t *kf, const unsigned char *key_id,
+                         bool refresh_dist);
+
+// Asks for a fresh key for the configured purpose: from the prefetch pool
+// if it has one (the result is ready for the next key_fetch_poll()),
+// otherwise from Auth.
+//
+// @return 0 if requested, 1 if one is already being fetched
+int key_fetch_request_new(key_fetch_t *kf);
+
+// Asks Auth for a fresh key list, always over the network: keys restored
+// from disk at startup are revalidated this way while the receiver runs on
+// them.
+//
+// @return 0 if requested, 1 if one is already being fetched
+int key_fetch_request_list(key_fetch_t *kf);
+
+// Has the worker save each fresh list it fetches for a KEY_FETCH_NEW or
+// KEY_FETCH_LIST request with key_store_save() before handing it out, so
+// the reader never waits on the disk.
+//
+// @param path, key_path As for key_store_save(); kept, not copied
+void key_fetch_store(key_fetch_t *kf, const char *path, const char *key_path);
+
+// Keeps up to `depth` fresh keys ready (clamped to KEY_FETCH_POOL_MAX;
+// 0 stops prefetching and wipes the pool).
+void key_fetch_prefetch(key_fetch_t *kf, int depth);
+
+// Keys in the prefetch pool right now.
+int key_fetch_pool_count(key_fetch_t *kf);
+
+// True from the request until key_fetch_poll() hands out its result.
+bool key_fetch_busy(key_fetch_t *kf, key_fetch_kind_t kind);
+
+// Hands out a finished request, by-ID first.
+//
+// @param kf Fetcher
+// @param out Filled in on success; the key material should be wiped after use
+// @return true if *out holds a result
+bool key_fetch_poll(key_fetch_t *kf, key_fetch_result_t *out);
+
+// True if encrypted frames should go to key_fetch_hold(): a by-ID request
+// is outstanding, or frames parked behind it are not all released yet.
+bool key_fetch_holding(key_fetch_t *kf);
+
+// Parks a FRAME_OK encrypted frame (copied).
+//
+// @return 0 if parked, -1 if the queue is full (the frame is dropped)
+int key_fetch_hold(key_fetch_t *kf, const lifi_frame_t *f);
+
+// Next parked frame, oldest first, once no by-ID request is outstanding.
+// The frame points into kf and stays valid until the next call.
+//
+// @return true if *out holds a frame
+bool key_fetch_release(key_fetch_t *kf, lifi_frame_t *out);
+
+// Wipes the parked frames (the key they needed never arrived).
+//
+// @return Frames dropped
+int key_fetch_drop_held(key_fetch_t *kf);
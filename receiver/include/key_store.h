@@ -0,0 +1,51 @@
+// include/key_store.h
+#pragma once
+#include <stdint.h>
+#include "c_api.h"
+#include "sst_crypto_embedded.h"
+
+// The receiver's session key list on disk, so a restart has keys at once
+// instead of waiting on init_SST() plus a get_session_key() round trip.
+//
+// The file is a fixed header followed by the still-valid session_key_t
+// records, AES-128-GCM encrypted as one block (the header is the AAD, so a
+// file from another build or a tampered count fails the tag). It is read
+// through mmap(), decrypted from the mapping into a temporary buffer, and
+// the records still fresh enough are copied into a new session_key_list_t.
+// The file key is 16 random bytes in KEY_STORE_KEY_PATH, created 0600 on
+// first save and refused if anyone but the owner can read it.
+//
+// Saves go to a temporary file that is renamed over the old one, so a
+// crash never leaves a half-written cache. Keys are only as fresh as the
+// last save: the caller should still ask Auth for a new list in the
+// background and save that.
+
+#define KEY_STORE_PATH "session_keys.cache"
+#define KEY_STORE_KEY_PATH "session_keys.key"
+#define KEY_STORE_MIN_LIFE_S 60   // keys closer to abs_validity are skipped
+
+typedef struct {
+    char magic[4];              // "LKS1"
+    uint16_t version;
+    uint16_t record_size;       // sizeof(session_key_t) of the writer
+    uint32_t count;
+    uint8_t nonce[SST_NONCE_SIZE];
+    uint8_t tag[SST_TAG_SIZE];
+} key_store_hdr_t;
+
+// Loads the cached keys that have at least KEY_STORE_MIN_LIFE_S left.
+//
+// @param path Cache file
+// @param key_path File key
+// @return A list for free_session_key_list_t(), or NULL if there is no
+//         usable cache (missing, foreign, tampered, or every key expired)
+session_key_list_t *key_store_load(const char *path, const char *key_path);
+
+// Writes the list's still-valid keys, replacing the previous cache.
+//
+// @param path Cache file
+// @param key_path File key (created if missing)
+// @param l Keys to save (NULL or empty removes the cache)
+// @return 0 on success, -1 on failure (errno set where it applies)
+int key_store_save(const char *path, const char *key_path,
+                   const session_key_list_t *l);
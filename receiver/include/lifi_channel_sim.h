@@ -0,0 +1,110 @@
+// include/lifi_channel_sim.h
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Host-side model of the optical link between the sender's UART bytes and
+// the receiver's PIO UART. Bytes go in, are serialized as 8N1 line levels at
+// `osr` samples per bit (the Pico 2 RX runs its PIO at 8x baud), impaired,
+// and re-sampled by a model of lifi_rx.pio: start bit on the first low
+// sample, data bits 1.5 bit times later and then every bit time, stop bit
+// by waiting for the line to go idle again. With `vote` = 3 or 5 the model
+// follows lifi_rx_mv3/mv5 instead: that many samples osr/8 apart around
+// each bit centre, majority wins (run those at osr=16, like the PIO).
+// What comes out is what the receiver would have read off the UART.
+//
+// Everything is driven by a seeded PRNG, so the same config and input give
+// the same output on every run.
+
+typedef struct {
+    double ber;            // independent bit-flip probability
+    double burst_rate;     // per-bit probability of entering a burst
+    double burst_len;      // mean burst length in bits
+    double burst_ber;      // flip probability inside a burst (e.g. 0.5)
+    double drop_rate;      // per-byte probability the byte never reaches the line
+    double insert_rate;    // per-byte probability a random byte is inserted before it
+    bool invert;           // comparator polarity inverted (TLV3501 wired backwards)
+    double jitter_ui;      // Gaussian edge jitter, std dev as a fraction of one bit
+    double drift_ppm;      // sender clock error relative to the receiver
+    double spike;          // per-sample flip probability (comparator chatter)
+    uint32_t idle_bits;    // idle (stop-level) bits between bytes
+    uint32_t osr;          // samples per bit; 0 selects 8
+    uint32_t vote;         // receiver samples per bit: 1, 3 or 5; 0 selects 1
+    uint64_t seed;         // PRNG seed; 0 selects a fixed default
+} lifi_channel_cfg_t;
+
+typedef struct {
+    uint64_t bytes_in;
+    uint64_t bytes_out;
+    uint64_t bytes_dropped;
+    uint64_t bytes_inserted;
+    uint64_t bits_flipped;      // random + burst flips on the line
+    uint64_t bursts;
+    uint64_t framing_errors;    // stop bit sampled low
+    uint64_t spikes;            // samples flipped by `spike`
+    uint64_t bytes_lost_output; // output buffer was full
+} lifi_channel_stats_t;
+
+typedef struct {
+    lifi_channel_cfg_t cfg;
+    lifi_channel_stats_t stats;
+    uint64_t rng;
+
+    // Transmitter side
+    double t_edge;        // ideal time of the next bit edge, in samples
+    uint64_t t_emitted;   // samples already put on the line
+    bool in_burst;
+
+    // Receiver model (lifi_rx.pio)
+    int rx_state;         // 0 = hunting, 1 = sampling, 2 = waiting for idle
+    uint32_t rx_count;    // samples since the start edge
+    uint8_t rx_byte;
+    uint8_t rx_bits;
+    uint8_t rx_sub;       // samples taken of the current bit
+    uint8_t rx_ones;      // of which idle-level
+
+    // Output buffer for the current call
+    uint8_t* out;
+    size_t out_len;
+    size_t out_cap;
+} lifi_channel_t;
+
+// Worst-case output for `n` input bytes (noise and insertions can create
+// extra start bits).
+#define LIFI_CHANNEL_OUT_MAX(n) (3 * (n) + 4)
+
+// Fills `cfg` with a clean channel: no impairments, 8 samples per bit.
+void lifi_channel_default_cfg(lifi_channel_cfg_t* cfg);
+
+// @param ch Channel state
+// @param cfg Impairment settings (copied)
+void lifi_channel_init(lifi_channel_t* ch, const lifi_channel_cfg_t* cfg);
+
+// Sends `len` bytes through the channel.
+//
+// @param ch Channel state
+// @param in Bytes as written by the sender
+// @param len Number of input bytes
+// @param out Receives the bytes the receiver UART decodes
+// @param out_cap Size of `out`; LIFI_CHANNEL_OUT_MAX(len) never overflows
+// @return Number of bytes written to `out`
+size_t lifi_channel_process(lifi_channel_t* ch, const uint8_t* in, size_t len,
+                            uint8_t* out, size_t out_cap);
+
+// Drives the line idle long enough for the receiver model to finish any
+// byte in progress (call at the end of a stream or a burst of traffic).
+//
+// @return Number of bytes written to `out`
+size_t lifi_channel_flush(lifi_channel_t* ch, uint8_t* out, size_t out_cap);
+
+// Parses "key=value,key=value" (ber, burst_rate, burst_len, burst_ber, drop,
+// insert, invert, jitter, drift_ppm, spike, idle_bits, osr, vote, seed)
+// into `cfg`.
+//
+// @return 0 on success, -1 on an unknown key or bad value
+int lifi_channel_parse_cfg(lifi_channel_cfg_t* cfg, const char* spec);
+
+// One-line summary of `cfg` for logs and benchmark output.
+void lifi_channel_describe(const lifi_channel_cfg_t* cfg, char* buf,
+                           size_t buflen);
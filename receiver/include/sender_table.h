@@ -0,0 +1,102 @@
+// include/sender_table.h
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include "c_api.h"
+#include "key_exchange.h"
+#include "replay_window.h"
+#include "../../include/frame_decrypt.h"
+#include "../../include/protocol.h"
+
+// Per-sender sessions, so one receiver can take frames from several Pico
+// senders at once without switching its key on every frame.
+//
+// A sender is known by the session key it announced (KEY_ID_ONLY beacon),
+// and once one of its frames has opened, by the nonce salt it seals with:
+// pico_nonce_generate() builds the nonce as salt || counter and draws a new
+// salt at boot and on every key change. Each session has its own key,
+// replay window, SST handshake state and counters.
+//
+// A frame whose salt no session holds yet is opened with each session's
+// key in turn (sender_table_route()); the session whose tag verifies takes
+// the salt. That is one trial decryption per session, once per sender boot
+// or key change; frames after it are routed by a salt compare.
+//
+// A sender never goes back to a salt it has left, so the last few salts a
+// session gave up are refused: a captured frame from before a reboot opens
+// under the same key, but may not pull the session back to its old salt.
+// The replay window is kept across salt changes for the same reason.
+//
+// GCM state stays in the decrypt pool, which is handed the session's key
+// with every frame.
+
+#define SENDER_TABLE_MAX 8
+#define SENDER_SALT_SIZE (NONCE_SIZE - 4)
+#define SENDER_RETIRED_SALTS 4
+
+typedef struct {
+    bool used;
+    session_key_t key;
+    bool have_salt;
+    uint8_t salt[SENDER_SALT_SIZE];
+    replay_window_t rwin;           // nonces seen, whatever their salt
+    uint8_t retired[SENDER_RETIRED_SALTS][SENDER_SALT_SIZE];
+    int retired_count, retired_next;
+
+    // SST 3-way handshake: STATE_IDLE or STATE_WAITING_FOR_SST_HS2
+    receiver_state_t hs_state;
+    struct timespec hs_deadline;    // CLOCK_MONOTONIC
+    uint8_t entity_nonce[SST_HS_NONCE_SIZE];
+
+    uint32_t last_used;             // table tick, for eviction
+
+    // Counters, cumulative since the session was added.
+    uint32_t frames;
+    uint32_t decrypt_ok;
+    uint32_t decrypt_fail;
+    uint32_t replay_blocked;
+} sender_session_t;
+
+typedef struct {
+    sender_session_t s[SENDER_TABLE_MAX];
+    frame_decrypt_t probe;          // trial decryptions for new salts
+    uint32_t tick;
+
+    // Counters, cumulative since sender_table_init().
+    uint32_t probes;                // frames routed by trial decryption
+    uint32_t unrouted;              // frames no session key opened
+    uint32_t retired_rejects;       // frames under a salt a session gave up
+    uint32_t evictions;
+} sender_table_t;
+
+void sender_table_init(sender_table_t *t);
+
+// Wipes every session key and frees the trial decryptor.
+void sender_table_free(sender_table_t *t);
+
+// @return The session for this key ID, or NULL
+sender_session_t *sender_table_find_id(sender_table_t *t, const unsigned char *key_id);
+
+// Finding a session counts as using it.
+//
+// @param nonce NONCE_SIZE bytes; only the salt is compared
+// @return The session whose frames carry this salt, or NULL
+sender_session_t *sender_table_find_salt(sender_table_t *t, const uint8_t *nonce);
+
+// Adds a session for this key, or refreshes the one with its ID. When the
+// table is full, the session used least recently is dropped.
+//
+// @return The session (never NULL)
+sender_session_t *sender_table_add(sender_table_t *t, const session_key_t *k);
+
+// Finds the session a FRAME_OK sealed frame belongs to: by its salt, or by
+// trial decryption if the salt is new.
+//
+// @return The session, or NULL if no session key opens the frame or the
+//         session that opens it has retired its salt
+sender_session_t *sender_table_route(sender_table_t *t, const lifi_frame_t *f);
+
+// Sessions in use.
+int sender_table_count(const sender_table_t *t);
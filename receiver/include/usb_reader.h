@@ -0,0 +1,39 @@
+// include/usb_reader.h
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include "../../include/cobs.h"
+#include "../../include/usb_records.h"
+
+// Decoder for the lifi_pico2_rx binary USB stream (`out bin`, see
+// include/usb_records.h). Feed it whatever read() returns; it calls back
+// once per verified record. Bytes between records that are not a valid
+// record (command replies, the boot banner) are passed on as USBREC_TEXT.
+
+#define USB_READER_MAX_ENCODED \
+    COBS_MAX_ENCODED(1 + USBREC_MAX_PAYLOAD + USBREC_CRC_SIZE)
+
+// @param type USBREC_*
+// @param payload Record payload without TYPE and CRC (valid during the call)
+// @param len Payload length
+// @param ctx User pointer given to usb_reader_feed()
+typedef void (*usb_record_cb)(uint8_t type, const uint8_t *payload, size_t len,
+                              void *ctx);
+
+typedef struct {
+    uint8_t  enc[USB_READER_MAX_ENCODED];
+    size_t   enc_len;
+    int      overflow;     // current chunk outgrew enc[]; skip to next 0x00
+    uint8_t  dec[1 + USBREC_MAX_PAYLOAD + USBREC_CRC_SIZE];
+    uint32_t records;
+    uint32_t bad_records;  // COBS-valid chunks whose CRC failed
+    uint32_t text_chunks;
+} usb_reader_t;
+
+void usb_reader_init(usb_reader_t *r);
+
+void usb_reader_feed(usb_reader_t *r, const uint8_t *data, size_t len,
+                     usb_record_cb cb, void *ctx);
+
+// Name of a USBREC_* type, for logs.
+const char *usb_record_name(uint8_t type);
@@ -15,3 +15,6 @@ static inline void secure_zero(void* p, size_t n) {
 void print_hex(const char* label, const uint8_t* data, size_t len);
 ssize_t read_exact(int fd, uint8_t* buf, size_t len);
 int rand_bytes(uint8_t* buf, size_t len);
+// Monotonic clock in milliseconds; wraps every ~49 days, so compare with
+// unsigned subtraction.
+uint32_t monotonic_ms(void);
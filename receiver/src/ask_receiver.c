@@ -21,13 +21,15 @@
 #include "c_api.h"
 #include "c_secure_comm.h"   // parse_handshake_1, check_handshake_2_send_handshake_3
 #include "config_handler.h"  // change_directory_to_config_path, get_config_path
+#include "key_cache.h"
 #include "key_exchange.h"
 #include "../../include/protocol.h"
 #include "replay_window.h"
 #include "serial_linux.h"
 #include "sst_crypto_embedded.h"  // brings in sst_decrypt_gcm prototype and sizes
 #include "heatshrink_decoder.h"
-#include "../../include/crc16.h"
+#include "../../include/frame_decrypt.h"
+#include "../../include/frame_parser.h"
 #include "utils.h"
 
 
@@ -325,49 +327,6 @@ static int write_all(int fd, const void* buf, size_t len) {
     return (sent == len) ? 0 : -1;
 }
 
-// Helper: Read exact bytes with timeout for non-blocking FD
-// timeout_ms: Max time to wait for the ENTIRE buffer to be filled
-static ssize_t read_exact_timeout(int fd, void *buf, size_t len, int timeout_ms) {
-    uint8_t *p = (uint8_t *)buf;
-    size_t received = 0;
-    struct timeval start, now;
-    gettimeofday(&start, NULL);
-    
-    while (received < len) {
-        // Check timeout
-        gettimeofday(&now, NULL);
-        long elapsed_ms = (now.tv_sec - start.tv_sec) * 1000 + (now.tv_usec - start.tv_usec) / 1000;
-        if (elapsed_ms >= timeout_ms) {
-            return -1; // Timeout
-        }
-        
-        // Wait for data
-        fd_set fds;
-        FD_ZERO(&fds);
-        FD_SET(fd, &fds);
-        struct timeval tv;
-        tv.tv_sec = 0;
-        tv.tv_usec = (timeout_ms - elapsed_ms) * 1000;
-        
-        int ret = select(fd + 1, &fds, NULL, NULL, &tv);
-        if (ret > 0) {
-            ssize_t n = read(fd, p + received, len - received);
-            if (n > 0) {
-                received += n;
-            } else if (n == 0) {
-                return -1; // EOF/Closed
-            } else {
-                if (errno != EAGAIN && errno != EWOULDBLOCK) return -1; // Error
-            }
-        } else if (ret == 0) {
-            return -1; // Timeout
-        } else {
-            return -1; // Error
-        }
-    }
-    return received;
-}
-
 // --- Session Statistics ---
 typedef struct {
     unsigned long total_pkts;
@@ -376,6 +335,7 @@ typedef struct {
     unsigned long replay_blocked;
     unsigned long timeouts;
     unsigned long bad_preamble;
+    unsigned long resyncs;
     unsigned long keys_consumed;
 } SessionStats;
 
@@ -386,73 +346,69 @@ extern session_key_list_t *send_session_key_req_via_TCP(SST_ctx_t *ctx);
 extern int find_session_key(unsigned int key_id, session_key_list_t* s_key_list);
 extern int add_session_key_to_list(session_key_t* s_key, session_key_list_t* existing_s_key_list);
 
-// Local replacement for get_session_key_by_ID that handles 64-bit IDs correctly
-static session_key_t *get_session_key_by_ID_fixed(unsigned char *target_session_key_id,
-                                           SST_ctx_t *ctx,
-                                           session_key_list_t *existing_s_key_list) {
-    session_key_t *s_key = NULL;
+// Local replacement for get_session_key_by_ID that handles 64-bit IDs correctly.
+// The cache is keyed on all 8 bytes; the sst-c-api list lookup only takes
+// the low 32 bits, so a key found there must match the full ID as well.
+static bool get_session_key_by_ID_fixed(unsigned char *target_session_key_id,
+                                        SST_ctx_t *ctx,
+                                        session_key_list_t *existing_s_key_list,
+                                        key_cache_t *cache,
+                                        session_key_t *out) {
+    if (key_cache_get(cache, target_session_key_id, out)) return true;
 
     // Correct 64-bit Big Endian read
-    unsigned long long target_id = 0;
-    for(int i = 0; i < SESSION_KEY_ID_SIZE; i++) {
-        target_id = (target_id << 8) | target_session_key_id[i];
-    }
+    unsigned long long target_id = key_cache_id(target_session_key_id);
 
     int session_key_idx = -1;
     if (existing_s_key_list == NULL) {
         cmd_printf("Error: Session key list is NULL.");
-        return NULL;
+        return false;
     }
     
     // Cast for local lookup (existing function expects uint)
     session_key_idx = find_session_key((unsigned int)target_id, existing_s_key_list);
+    if (session_key_idx >= 0 &&
+        memcmp(existing_s_key_list->s_key[session_key_idx].key_id,
+               target_session_key_id, SESSION_KEY_ID_SIZE) == 0) {
+        *out = existing_s_key_list->s_key[session_key_idx];
+        key_cache_put(cache, out);
+        return true;
+    }
+
+    // Correct 64-bit formatting for the request
+    // Reverting to standard JSON integer format
+    snprintf(ctx->config.purpose[ctx->config.purpose_index],
+             MAX_PURPOSE_LENGTH, 
+             "{\"keyId\":%llu}", target_id);
+
+    // DEBUG: Print what we are about to send
+    cmd_printf("[DEBUG] Requesting Purpose: %s", ctx->config.purpose[ctx->config.purpose_index]);
+    cmd_printf("[DEBUG] Target ID (llu): %llu (Hex: 0x%llX)", target_id, target_id);
     
-    if (session_key_idx >= 0) {
-        s_key = &existing_s_key_list->s_key[session_key_idx];
-    } else {
-        // Correct 64-bit formatting for the request
-        // Reverting to standard JSON integer format
-        snprintf(ctx->config.purpose[ctx->config.purpose_index],
-                 MAX_PURPOSE_LENGTH, 
-                 "{\"keyId\":%llu}", target_id);
-
-        // DEBUG: Print what we are about to send
-        cmd_printf("[DEBUG] Requesting Purpose: %s", ctx->config.purpose[ctx->config.purpose_index]);
-        cmd_printf("[DEBUG] Target ID (llu): %llu (Hex: 0x%llX)", target_id, target_id);
-        
-        cmd_print_partial("[DEBUG] Raw Bytes: ");
-        for(int k=0; k<SESSION_KEY_ID_SIZE; k++) {
-            cmd_print_partial("%02X ", target_session_key_id[k]);
-        }
-        cmd_printf("");
+    cmd_print_partial("[DEBUG] Raw Bytes: ");
+    for(int k=0; k<SESSION_KEY_ID_SIZE; k++) {
+        cmd_print_partial("%02X ", target_session_key_id[k]);
+    }
+    cmd_printf("");
 
-        session_key_list_t *s_key_list;
-        s_key_list = send_session_key_req_via_TCP(ctx);
+    session_key_list_t *s_key_list;
+    s_key_list = send_session_key_req_via_TCP(ctx);
 
-        if (s_key_list == NULL) {
-            cmd_printf("Error: Failed to fetch key from Auth.");
-            return NULL;
-        }
-        // s_key_list contains valid key. We copy it to existing list.
-        if (s_key_list->num_key > 0) {
-            s_key = &s_key_list->s_key[0];
-            add_session_key_to_list(s_key, existing_s_key_list);
-        } else {
-            s_key = NULL;
-        }
-        free(s_key_list);
-        
-        // Re-fetch the stable pointer from the main list so we don't return a dangling pointer
-        if (s_key) {
-             session_key_idx = find_session_key((unsigned int)target_id, existing_s_key_list);
-             if (session_key_idx >= 0) {
-                 s_key = &existing_s_key_list->s_key[session_key_idx];
-             } else {
-                 s_key = NULL; 
-             }
-        }
+    if (s_key_list == NULL) {
+        cmd_printf("Error: Failed to fetch key from Auth.");
+        return false;
+    }
+    // s_key_list contains valid key. Keep a copy in the list and the cache.
+    bool ok = s_key_list->num_key > 0 &&
+              memcmp(s_key_list->s_key[0].key_id, target_session_key_id,
+                     SESSION_KEY_ID_SIZE) == 0;
+    if (ok) {
+        *out = s_key_list->s_key[0];
+        add_session_key_to_list(&s_key_list->s_key[0], existing_s_key_list);
+        key_cache_put(cache, out);
     }
-    return s_key;
+    free(s_key_list);
+    return ok;
 }
 
 int main(int argc, char* argv[]) {
@@ -497,6 +453,8 @@ int main(int argc, char* argv[]) {
 
     printf("Initializing empty session key list (will fetch by ID later)...\n");
     session_key_list_t* key_list = init_empty_session_key_list();
+    static key_cache_t key_cache;
+    key_cache_init(&key_cache);
     
     // --- Serial Init (Before UI) ---
     // Initialize serial first so any perror/printf issues don't corrupt the ncurses window
@@ -539,8 +497,11 @@ int main(int argc, char* argv[]) {
 
 
     // UART framing state
-    uint8_t byte = 0;
-    int uart_state = 0;
+    static frame_parser_t fparser;
+    frame_parser_init(&fparser);
+    // Decrypts GCM frames while their bytes are still arriving
+    static frame_decrypt_t fdec;
+    frame_decrypt_init(&fdec);
 
     log_printf("Listening for LiFi messages...\n");
     if (fd >= 0) tcflush(fd, TCIFLUSH);
@@ -567,6 +528,7 @@ int main(int argc, char* argv[]) {
                     cmd_printf("Replays Blocked: %lu", stats.replay_blocked);
                     cmd_printf("Timeouts:        %lu", stats.timeouts);
                     cmd_printf("Bad Preambles:   %lu", stats.bad_preamble);
+                    cmd_printf("Resyncs:         %lu", stats.resyncs);
                     cmd_printf("Keys Consumed:   %lu", stats.keys_consumed);
                     cmd_printf("--------------------------");
                     break;
@@ -617,6 +579,7 @@ int main(int argc, char* argv[]) {
                         int flags = fcntl(fd, F_GETFL, 0);
                         if (flags >= 0) fcntl(fd, F_SETFL, flags | O_NONBLOCK);
                         tcflush(fd, TCIFLUSH);
+                        frame_parser_reset(&fparser);
                         cmd_printf("✓ Serial opened.");
                     } else {
                         cmd_printf("Still failed to open serial.");
@@ -659,9 +622,8 @@ int main(int argc, char* argv[]) {
                          lifi_id_seen = true;
                          
                          // Trigger logic
-                         session_key_t *found = get_session_key_by_ID_fixed(last_lifi_id, sst, key_list);
-                         if (found) {
-                             s_key = *found;
+                         if (get_session_key_by_ID_fixed(last_lifi_id, sst, key_list,
+                                                         &key_cache, &s_key)) {
                              key_valid = true;
                              cmd_printf("✓ Switched to Manual Key.");
                              mid_draw_keypanel(&s_key, key_valid, state, UART_DEVICE, (fd >= 0));
@@ -708,6 +670,7 @@ int main(int argc, char* argv[]) {
                 case 'Q': {
                     cmd_printf("Exiting...");
                     if (fd >= 0) close(fd);
+                    key_cache_clear(&key_cache);
                     free_session_key_list_t(key_list);
                     free_SST_ctx_t(sst);
                     return 0;
@@ -739,402 +702,271 @@ int main(int argc, char* argv[]) {
             state_deadline = (struct timespec){0, 0};
         }
 
-        if (fd >= 0 && read(fd, &byte, 1) == 1) {
-            // Activity Blink (Top Right)
-            static int act_ctr = 0;
-            if (++act_ctr % 10 == 0) {
-                mvwprintw(win_log_border, 0, getmaxx(win_log_border)-4, "%c", (act_ctr/10)%2 ? '*' : ' ');
+        bool rx_any = false;
+        if (fd >= 0) {
+            // Bulk read straight into the frame parser's buffer.
+            size_t rx_space = 0;
+            uint8_t *rx_dst = frame_parser_write_ptr(&fparser, &rx_space);
+            ssize_t rx_n = (rx_space > 0) ? read(fd, rx_dst, rx_space) : 0;
+            if (rx_n > 0) {
+                rx_any = true;
+                frame_parser_commit(&fparser, (size_t)rx_n);
+
+                // Activity Blink (Top Right)
+                static int act_ctr = 0;
+                act_ctr++;
+                mvwprintw(win_log_border, 0, getmaxx(win_log_border)-4, "%c", act_ctr % 2 ? '*' : ' ');
                 wrefresh(win_log_border);
             }
+        }
 
-            switch (uart_state) {
-                case 0:
-                    if (byte == PREAMBLE_BYTE_1) {
-                        uart_state = 1;
-                    }
-                    break;
-                case 1:
-                    if (byte == PREAMBLE_BYTE_2) {
-                        uart_state = 2;
-                    } else {
-                        uart_state = 0;
+        // Pull every complete frame out of the buffered bytes. A candidate
+        // that fails LEN, CRC or its deadline is rescanned from the byte after
+        // its preamble, so a real frame hidden inside the rejected bytes
+        // still comes out of a later iteration of this loop.
+        lifi_frame_t frame;
+        frame_result_t fres;
+        while ((fres = frame_parser_next(&fparser, monotonic_ms(), &frame)) != FRAME_NONE) {
+            if (fres == FRAME_DROPPED) {
+                stats.resyncs++;
+                if (frame.error == FRAME_ERR_TYPE) {
+                    stats.bad_preamble++;
+                } else {
+                    stats.total_pkts++;
+                    log_printf("Dropped frame (type 0x%02X, len %u): %s. Rescanning.\n",
+                               frame.type, frame.len, frame_error_str(frame.error));
+                    if (frame.error == FRAME_ERR_CRC &&
+                        (frame.type == MSG_TYPE_ENCRYPTED || frame.type == MSG_TYPE_FILE)) {
+                        stats.decrypt_fail++;
                     }
-                    break;
-                case 2:
-                    if (byte == PREAMBLE_BYTE_3) {
-                        uart_state = 3;
-                    } else {
-                        uart_state = 0;
-                    }
-                    break;
-                case 3:
-                    if (byte == PREAMBLE_BYTE_4) {
-                        uart_state = 4; // Preamble complete, next is TYPE
-                    } else {
-                        uart_state = 0;
-                    }
-                    break;
+                }
+                continue;
+            }
 
-                case 4:
-                    // TYPE byte received
-                    if (byte == MSG_TYPE_KEY_ID_ONLY) {
-                        uint8_t packet_type = byte; 
-                        stats.total_pkts++;
-                        
-                        // Read length (2 bytes)
-                        uint8_t len_bytes[2];
-                        if (read_exact_timeout(fd, len_bytes, 2, 100) != 2) {
-                            log_printf("Failed to read length (Key ID)\n");
-                            uart_state = 0;
-                            continue;
-                        }
-                        uint16_t payload_len = ((uint16_t)len_bytes[0] << 8) | len_bytes[1];
-                        
-                        if (payload_len > 64) { // Sanity check
-                             log_printf("Invalid Key ID len: %u\n", payload_len);
-                             uart_state = 0;
-                             continue;
-                        }
-                        
-                        uint8_t payload[payload_len];
-                        uint8_t crc_bytes[2];
-                        
-                        if (read_exact_timeout(fd, payload, payload_len, 100) != (ssize_t)payload_len ||
-                            read_exact_timeout(fd, crc_bytes, 2, 100) != 2) {
-                            log_printf("Failed to read payload/CRC (Key ID)\n");
-                            uart_state = 0;
-                            continue;
-                        }
-                        
-                        // Verify CRC
-                        uint8_t crc_buf[1 + 2 + 64]; // Max size
-                        size_t crc_idx = 0;
-                        crc_buf[crc_idx++] = packet_type;
-                        crc_buf[crc_idx++] = len_bytes[0];
-                        crc_buf[crc_idx++] = len_bytes[1];
-                        memcpy(&crc_buf[crc_idx], payload, payload_len);
-                        crc_idx += payload_len;
-                        
-                        uint16_t computed_crc = crc16_ccitt(crc_buf, crc_idx);
-                        uint16_t received_crc = ((uint16_t)crc_bytes[0] << 8) | crc_bytes[1];
-                        
-                        if (computed_crc != received_crc) {
-                            log_printf("CRC fail on Key ID pkt\n");
-                            uart_state = 0;
-                            continue;
-                        }
-                        
-                        log_printf("[KEY ID] Received: ");
-                        char hex_str[3 * payload_len + 1];
-                        hex_str[0] = '\0';
-                        for(int i=0; i<payload_len; i++) {
-                            char tmp[5];
-                            snprintf(tmp, sizeof(tmp), "%02X ", payload[i]);
-                            strcat(hex_str, tmp);
-                        }
-                        log_printf("[KEY ID] Peer ID: %s", hex_str);
-                        
-                        // --- AUTO-CONNECT LOGIC ---
-                        // 1. Store the ID
-                        memcpy(last_lifi_id, payload, SESSION_KEY_ID_SIZE);
-                        lifi_id_seen = true;
-
-                        unsigned int native_id = convert_skid_buf_to_int(last_lifi_id, SESSION_KEY_ID_SIZE);
-                        cmd_printf("[NATIVE] Received ID: %u", native_id);
-                        
-                        cmd_printf("Looking for Key ID...");
-                        
-                        // 2. Use C-API to find locally or fetch from Auth
-                        
-                        session_key_t *found_key = get_session_key_by_ID_fixed(last_lifi_id, sst, key_list);
-                        
-                        if (found_key) {
-                            s_key = *found_key;
-                            key_valid = true;
-                            cmd_printf("✓ Switched to LiFi Key.");
-                            mid_draw_keypanel(&s_key, key_valid, state, UART_DEVICE, (fd >= 0));
-
-                            // --- Trigger SST 3-way handshake ---
-                            if (fd >= 0) {
-                                uint32_t hs1_len = 0;
-                                uint8_t *hs1 = parse_handshake_1(&s_key, sst_entity_nonce, &hs1_len);
-                                if (hs1 && hs1_len == SST_HS1_PAYLOAD_SIZE) {
-                                    uint8_t hdr[7] = {
-                                        PREAMBLE_BYTE_1, PREAMBLE_BYTE_2,
-                                        PREAMBLE_BYTE_3, PREAMBLE_BYTE_4,
-                                        MSG_TYPE_SST_HS1,
-                                        (hs1_len >> 8) & 0xFF, hs1_len & 0xFF
-                                    };
-                                    if (write_all(fd, hdr, sizeof(hdr)) >= 0 &&
-                                        write_all(fd, hs1, hs1_len) >= 0) {
-                                        tcdrain(fd);
-                                        state = STATE_WAITING_FOR_SST_HS2;
-                                        clock_gettime(CLOCK_MONOTONIC, &state_deadline);
-                                        state_deadline.tv_sec += 5;
-                                        last_countdown = 5;
-                                        cmd_printf("[SST HS1] Sent. Waiting for HS2...");
-                                    } else {
-                                        cmd_printf("[SST HS1] UART write failed.");
-                                        explicit_bzero(sst_entity_nonce, sizeof(sst_entity_nonce));
-                                    }
-                                    free(hs1);
-                                } else {
-                                    cmd_printf("[SST HS1] Failed to generate handshake.");
-                                    if (hs1) free(hs1);
-                                }
-                            }
-                            // ------------------------------------
-                        } else {
-                            cmd_printf("✗ LiFi Key search failed.");
-                        }
-                        // ---------------------------------------------
-                    }
-                    else if (byte == MSG_TYPE_SST_HS2) {
-                        stats.total_pkts++;
-
-                        uint8_t len_bytes[2];
-                        if (read_exact_timeout(fd, len_bytes, 2, 100) != 2) {
-                            log_printf("[SST HS2] Length read timeout\n");
-                            uart_state = 0;
-                            continue;
-                        }
-                        uint16_t hs2_len = ((uint16_t)len_bytes[0] << 8) | len_bytes[1];
+            if (frame.type == MSG_TYPE_KEY_ID_ONLY) {
+                stats.total_pkts++;
 
-                        if (hs2_len != SST_HS2_PAYLOAD_SIZE) {
-                            log_printf("[SST HS2] Unexpected length: %u\n", hs2_len);
-                            uart_state = 0;
-                            continue;
-                        }
+                uint16_t payload_len = frame.len;
+                const uint8_t *payload = frame.payload;
 
-                        uint8_t hs2_payload[SST_HS2_PAYLOAD_SIZE];
-                        uint8_t crc_rx[2];
-                        if (read_exact_timeout(fd, hs2_payload, hs2_len, 200) != (ssize_t)hs2_len ||
-                            read_exact_timeout(fd, crc_rx, 2, 100) != 2) {
-                            log_printf("[SST HS2] Payload read timeout\n");
-                            uart_state = 0;
-                            continue;
-                        }
+                log_printf("[KEY ID] Received: ");
+                char hex_str[3 * payload_len + 1];
+                hex_str[0] = '\0';
+                for(int i=0; i<payload_len; i++) {
+                    char tmp[5];
+                    snprintf(tmp, sizeof(tmp), "%02X ", payload[i]);
+                    strcat(hex_str, tmp);
+                }
+                log_printf("[KEY ID] Peer ID: %s", hex_str);
 
-                        // Verify CRC
-                        uint8_t crc_check[1 + 2 + SST_HS2_PAYLOAD_SIZE];
-                        crc_check[0] = MSG_TYPE_SST_HS2;
-                        crc_check[1] = len_bytes[0];
-                        crc_check[2] = len_bytes[1];
-                        memcpy(&crc_check[3], hs2_payload, hs2_len);
-                        uint16_t computed_crc = crc16_ccitt(crc_check, sizeof(crc_check));
-                        uint16_t received_crc = ((uint16_t)crc_rx[0] << 8) | crc_rx[1];
-                        if (computed_crc != received_crc) {
-                            log_printf("[SST HS2] CRC fail\n");
-                            uart_state = 0;
-                            continue;
-                        }
+                // --- AUTO-CONNECT LOGIC ---
+                // 1. Store the ID
+                memcpy(last_lifi_id, payload, SESSION_KEY_ID_SIZE);
+                lifi_id_seen = true;
 
-                        if (state != STATE_WAITING_FOR_SST_HS2) {
-                            log_printf("[SST HS2] Received but not waiting for HS2\n");
-                            uart_state = 0;
-                            continue;
-                        }
+                unsigned int native_id = convert_skid_buf_to_int(last_lifi_id, SESSION_KEY_ID_SIZE);
+                cmd_printf("[NATIVE] Received ID: %u", native_id);
+
+                cmd_printf("Looking for Key ID...");
+
+                // 2. Use C-API to find locally or fetch from Auth
+
+                if (get_session_key_by_ID_fixed(last_lifi_id, sst, key_list,
+                                                &key_cache, &s_key)) {
+                    key_valid = true;
+                    cmd_printf("✓ Switched to LiFi Key.");
+                    mid_draw_keypanel(&s_key, key_valid, state, UART_DEVICE, (fd >= 0));
 
-                        uint32_t hs3_len = 0;
-                        uint8_t *hs3 = check_handshake_2_send_handshake_3(
-                            hs2_payload, hs2_len, sst_entity_nonce, &s_key, &hs3_len);
-
-                        if (hs3 != NULL) {
-                            cmd_printf("✓ SST HS2 VERIFIED: Pico holds SST key. Sending HS3 for mutual auth.");
-                            // Send HS3 over UART so Pico can verify Pi4 holds the same key from Auth
-                            if (hs3_len == SST_HS3_PAYLOAD_SIZE) {
-                                uint8_t hdr3[7] = {
-                                    PREAMBLE_BYTE_1, PREAMBLE_BYTE_2,
-                                    PREAMBLE_BYTE_3, PREAMBLE_BYTE_4,
-                                    MSG_TYPE_SST_HS3,
-                                    (hs3_len >> 8) & 0xFF, hs3_len & 0xFF
-                                };
-                                write_all(fd, hdr3, sizeof(hdr3));
-                                write_all(fd, hs3, hs3_len);
+                    // --- Trigger SST 3-way handshake ---
+                    if (fd >= 0) {
+                        uint32_t hs1_len = 0;
+                        uint8_t *hs1 = parse_handshake_1(&s_key, sst_entity_nonce, &hs1_len);
+                        if (hs1 && hs1_len == SST_HS1_PAYLOAD_SIZE) {
+                            uint8_t hdr[7] = {
+                                PREAMBLE_BYTE_1, PREAMBLE_BYTE_2,
+                                PREAMBLE_BYTE_3, PREAMBLE_BYTE_4,
+                                MSG_TYPE_SST_HS1,
+                                (hs1_len >> 8) & 0xFF, hs1_len & 0xFF
+                            };
+                            if (write_all(fd, hdr, sizeof(hdr)) >= 0 &&
+                                write_all(fd, hs1, hs1_len) >= 0) {
                                 tcdrain(fd);
+                                state = STATE_WAITING_FOR_SST_HS2;
+                                clock_gettime(CLOCK_MONOTONIC, &state_deadline);
+                                state_deadline.tv_sec += 5;
+                                last_countdown = 5;
+                                cmd_printf("[SST HS1] Sent. Waiting for HS2...");
                             } else {
-                                cmd_printf("✗ Unexpected HS3 length %u – not sending.", hs3_len);
+                                cmd_printf("[SST HS1] UART write failed.");
+                                explicit_bzero(sst_entity_nonce, sizeof(sst_entity_nonce));
                             }
-                            free(hs3);
+                            free(hs1);
                         } else {
-                            cmd_printf("✗ SST HS FAILED: Nonce mismatch – possible replay or wrong key.");
+                            cmd_printf("[SST HS1] Failed to generate handshake.");
+                            if (hs1) free(hs1);
                         }
+                    }
+                    // ------------------------------------
+                } else {
+                    cmd_printf("✗ LiFi Key search failed.");
+                }
+                // ---------------------------------------------
+            }
+            else if (frame.type == MSG_TYPE_SST_HS2) {
+                stats.total_pkts++;
+
+                uint16_t hs2_len = frame.len;
+                uint8_t hs2_payload[SST_HS2_PAYLOAD_SIZE];
+                memcpy(hs2_payload, frame.payload, hs2_len);
 
-                        explicit_bzero(sst_entity_nonce, sizeof(sst_entity_nonce));
-                        state = STATE_IDLE;
-                        state_deadline = (struct timespec){0, 0};
-                        mid_draw_keypanel(&s_key, key_valid, state, UART_DEVICE, (fd >= 0));
-                        uart_state = 0;
-                        continue;
+                if (state != STATE_WAITING_FOR_SST_HS2) {
+                    log_printf("[SST HS2] Received but not waiting for HS2\n");
+                    continue;
+                }
+
+                uint32_t hs3_len = 0;
+                uint8_t *hs3 = check_handshake_2_send_handshake_3(
+                    hs2_payload, hs2_len, sst_entity_nonce, &s_key, &hs3_len);
+
+                if (hs3 != NULL) {
+                    cmd_printf("✓ SST HS2 VERIFIED: Pico holds SST key. Sending HS3 for mutual auth.");
+                    // Send HS3 over UART so Pico can verify Pi4 holds the same key from Auth
+                    if (hs3_len == SST_HS3_PAYLOAD_SIZE) {
+                        uint8_t hdr3[7] = {
+                            PREAMBLE_BYTE_1, PREAMBLE_BYTE_2,
+                            PREAMBLE_BYTE_3, PREAMBLE_BYTE_4,
+                            MSG_TYPE_SST_HS3,
+                            (hs3_len >> 8) & 0xFF, hs3_len & 0xFF
+                        };
+                        write_all(fd, hdr3, sizeof(hdr3));
+                        write_all(fd, hs3, hs3_len);
+                        tcdrain(fd);
+                    } else {
+                        cmd_printf("✗ Unexpected HS3 length %u – not sending.", hs3_len);
                     }
-                    else if (byte == MSG_TYPE_ENCRYPTED || byte == MSG_TYPE_FILE) {
-                        uint8_t packet_type = byte; 
-                        stats.total_pkts++;
-                        
-                        // Read length (2 bytes)
-                        uint8_t len_bytes[2];
-                        if (read_exact_timeout(fd, len_bytes, 2, 100) != 2) {
-                            log_printf("Failed to read length\n");
-                            uart_state = 0;
-                            continue;
-                        }
-                        
-                        // Length = NONCE + CIPHERTEXT + TAG
-                        uint16_t payload_len = ((uint16_t)len_bytes[0] << 8) | len_bytes[1];
-                        if (payload_len < NONCE_SIZE + TAG_SIZE || payload_len > MAX_MSG_LEN) {
-                            log_printf("Invalid payload length: %u bytes\n", payload_len);
-                            uart_state = 0;
-                            continue;
-                        }
-                        
-                        // Calculate ciphertext length
-                        uint16_t ctext_len = payload_len - NONCE_SIZE - TAG_SIZE;
-                        
-                        uint8_t nonce[NONCE_SIZE];
-                        uint8_t ciphertext[ctext_len];
-                        uint8_t tag[TAG_SIZE];
-                        uint8_t crc_bytes[2];
-                        
-                        // Read all payload components with timeout (give enough time for full payload)
-                        int chunk_timeout = 200; // ms
-                        ssize_t nonce_read = read_exact_timeout(fd, nonce, NONCE_SIZE, chunk_timeout);
-                        ssize_t cipher_read = read_exact_timeout(fd, ciphertext, ctext_len, chunk_timeout + (ctext_len/10)); // Scaling timeout for size
-                        ssize_t tag_read = read_exact_timeout(fd, tag, TAG_SIZE, chunk_timeout);
-                        ssize_t crc_read = read_exact_timeout(fd, crc_bytes, 2, chunk_timeout);
-                        
-                        if (nonce_read != NONCE_SIZE || cipher_read != (ssize_t)ctext_len ||
-                            tag_read != TAG_SIZE || crc_read != 2) {
-                            log_printf("Read fail: nonce=%zd/%d, cipher=%zd/%u, tag=%zd/%d, crc=%zd/2\n",
-                                       nonce_read, NONCE_SIZE, cipher_read, ctext_len, 
-                                       tag_read, TAG_SIZE, crc_read);
-                            uart_state = 0;
-                            continue;
-                        }
-                                                
-                        // Validate CRC16
-                        uint8_t crc_buf[1 + 2 + NONCE_SIZE + MAX_MSG_LEN + TAG_SIZE];
-                        size_t crc_idx = 0;
-                        crc_buf[crc_idx++] = packet_type;
-                        crc_buf[crc_idx++] = len_bytes[0];
-                        crc_buf[crc_idx++] = len_bytes[1];
-                        memcpy(&crc_buf[crc_idx], nonce, NONCE_SIZE); crc_idx += NONCE_SIZE;
-                        memcpy(&crc_buf[crc_idx], ciphertext, ctext_len); crc_idx += ctext_len;
-                        memcpy(&crc_buf[crc_idx], tag, TAG_SIZE); crc_idx += TAG_SIZE;
-                        
-                        uint16_t computed_crc = crc16_ccitt(crc_buf, crc_idx);
-                        uint16_t received_crc = ((uint16_t)crc_bytes[0] << 8) | crc_bytes[1];
-                        
-                        if (computed_crc != received_crc) {
-                            log_printf("CRC16 mismatch! computed=0x%04X received=0x%04X\n", 
-                                       computed_crc, received_crc);
-                            
-                            stats.decrypt_fail++;
-                            uart_state = 0;
-                            continue;
-                        }
-                        
-                        // --- Nonce Replay Check ---
-                        if (replay_window_seen(&rwin, nonce)) {
-                            log_printf("Nonce replayed! Rejecting message.\\n");
-                            stats.replay_blocked++;
-                            uart_state = 0;
-                            continue;
-                        }
-                        replay_window_add(&rwin, nonce);
-                        
-                        uint8_t decrypted[ctext_len + 1];  // for null-terminator
-
-                        if (!key_valid) {  // Skip decryption if key was
-                                           // cleared and not yet rotated
-                            log_printf(
-                                "No valid session key. Rejecting encrypted "
-                                "message.\\n");
-                            uart_state = 0;
-                            continue;
-                        }
+                    free(hs3);
+                } else {
+                    cmd_printf("✗ SST HS FAILED: Nonce mismatch – possible replay or wrong key.");
+                }
 
-                        int ret = sst_decrypt_gcm(s_key.cipher_key, nonce,
-                                                  ciphertext, ctext_len, tag,
-                                                  decrypted);
-
-                        if (ret == 0) {  // Successful decryption
-                            decrypted[ctext_len] = '\0';  // Null-terminate
-
-                                // Handle File Transfer
-                                if (packet_type == MSG_TYPE_FILE) {
-                                    heatshrink_decoder *hsd = heatshrink_decoder_alloc(256, 8, 4);
-                                    if (hsd) {
-                                        size_t sunk = 0;
-                                        heatshrink_decoder_sink(hsd, decrypted, ctext_len, &sunk);
-                                        
-                                        // Increased buffer for large files
-                                        uint8_t decompressed[16384];
-                                        size_t total_decomp = 0;
-                                        HSD_poll_res pres;
-                                        
-                                        // First poll to get initial output
-                                        do {
-                                            size_t p = 0;
-                                            pres = heatshrink_decoder_poll(hsd, &decompressed[total_decomp], 
-                                                                           sizeof(decompressed) - total_decomp, &p);
-                                            total_decomp += p;
-                                        } while (pres == HSDR_POLL_MORE && total_decomp < sizeof(decompressed));
-                                        
-                                        // Finish decoder and poll remaining output
-                                        heatshrink_decoder_finish(hsd);
-                                        do {
-                                            size_t p = 0;
-                                            pres = heatshrink_decoder_poll(hsd, &decompressed[total_decomp], 
-                                                                           sizeof(decompressed) - total_decomp, &p);
-                                            total_decomp += p;
-                                        } while (pres == HSDR_POLL_MORE && total_decomp < sizeof(decompressed));
-                                        
-                                        heatshrink_decoder_free(hsd);
-                                        
-                                        // Null terminate for safer printing (if text)
-                                        if (total_decomp < sizeof(decompressed)) decompressed[total_decomp] = '\0';
-                                        
-                                        log_printf("[FILE] Decompressed %u -> %zu bytes\n", ctext_len, total_decomp);
-                                        log_printf("[FILE] Content: %s\n", decompressed);
-
-                                        FILE *f_out = fopen("received_file.txt", "a");
-                                        if (f_out) {
-                                            if (total_decomp > 0) {
-                                                fwrite(decompressed, 1, total_decomp, f_out);
-                                                fprintf(f_out, "\n");
-                                            }
-                                            fclose(f_out);
-                                        } else {
-                                            log_printf(" (Save failed)\n");
-                                        }
-                                    } else {
-                                        log_printf("[FILE] Decompression alloc failed.\n");
-                                    }
-                                } 
-                                // Handle Normal Chat / Commands
-                                else {
-                                    log_printf("%s\n", decrypted);
-                                }
-                                
-                                stats.decrypt_success++;
+                explicit_bzero(sst_entity_nonce, sizeof(sst_entity_nonce));
+                state = STATE_IDLE;
+                state_deadline = (struct timespec){0, 0};
+                mid_draw_keypanel(&s_key, key_valid, state, UART_DEVICE, (fd >= 0));
+            }
+            else if (MSG_TYPE_IS_AEAD(frame.type)) {
+                uint8_t packet_type = frame.type;
+                stats.total_pkts++;
+
+                // Length = NONCE + CIPHERTEXT + TAG, already bounds-checked by
+                // the frame parser (and CRC-verified for version 1 types).
+                uint16_t payload_len = frame.len;
+                uint16_t ctext_len = payload_len - NONCE_SIZE - TAG_SIZE;
+                const uint8_t *nonce = frame.payload;
+
+                // --- Nonce Replay Check ---
+                if (replay_window_seen(&rwin, nonce)) {
+                    log_printf("Nonce replayed! Rejecting message.\\n");
+                    stats.replay_blocked++;
+                    continue;
+                }
+                replay_window_add(&rwin, nonce);
+
+                // ctext_len + 1 bytes, for null-terminator
+                uint8_t *decrypted = fdec.plain;
+
+                if (!key_valid) {  // Skip decryption if key was
+                                   // cleared and not yet rotated
+                    log_printf(
+                        "No valid session key. Rejecting encrypted "
+                        "message.\\n");
+                    continue;
+                }
 
+                // V2 frames bind TYPE|LEN as GCM additional data. Most
+                // of the payload was already decrypted by
+                // frame_decrypt_poll() while it arrived.
+                size_t aad_len = MSG_TYPE_HAS_AAD(packet_type) ? FRAME_HDR_SIZE : 0;
+                int ret = frame_decrypt_finish(&fdec, &frame, s_key.cipher_key);
+
+                if (ret == 0) {  // Successful decryption
+                    decrypted[ctext_len] = '\0';  // Null-terminate
+
+                    // Handle File Transfer
+                    if (MSG_TYPE_IS_FILE(packet_type)) {
+                        heatshrink_decoder *hsd = heatshrink_decoder_alloc(256, 8, 4);
+                        if (hsd) {
+                            size_t sunk = 0;
+                            heatshrink_decoder_sink(hsd, decrypted, ctext_len, &sunk);
+
+                            // Increased buffer for large files
+                            uint8_t decompressed[16384];
+                            size_t total_decomp = 0;
+                            HSD_poll_res pres;
+
+                            // First poll to get initial output
+                            do {
+                                size_t p = 0;
+                                pres = heatshrink_decoder_poll(hsd, &decompressed[total_decomp], 
+                                                               sizeof(decompressed) - total_decomp, &p);
+                                total_decomp += p;
+                            } while (pres == HSDR_POLL_MORE && total_decomp < sizeof(decompressed));
+
+                            // Finish decoder and poll remaining output
+                            heatshrink_decoder_finish(hsd);
+                            do {
+                                size_t p = 0;
+                                pres = heatshrink_decoder_poll(hsd, &decompressed[total_decomp], 
+                                                               sizeof(decompressed) - total_decomp, &p);
+                                total_decomp += p;
+                            } while (pres == HSDR_POLL_MORE && total_decomp < sizeof(decompressed));
+
+                            heatshrink_decoder_free(hsd);
+
+                            // Null terminate for safer printing (if text)
+                            if (total_decomp < sizeof(decompressed)) decompressed[total_decomp] = '\0';
+
+                            log_printf("[FILE] Decompressed %u -> %zu bytes\n", ctext_len, total_decomp);
+                            log_printf("[FILE] Content: %s\n", decompressed);
+
+                            FILE *f_out = fopen("received_file.txt", "a");
+                            if (f_out) {
+                                if (total_decomp > 0) {
+                                    fwrite(decompressed, 1, total_decomp, f_out);
+                                    fprintf(f_out, "\n");
+                                }
+                                fclose(f_out);
                             } else {
-                                // AES-GCM decryption failed
-                                log_printf("Decryption failed: %d\n", ret);
-                                stats.decrypt_fail++;
+                                log_printf(" (Save failed)\n");
                             }
-
-                        uart_state = 0;  // Reset uart_state machine
+                        } else {
+                            log_printf("[FILE] Decompression alloc failed.\n");
+                        }
+                    } 
+                    // Handle Normal Chat / Commands
+                    else {
+                        log_printf("%s\n", decrypted);
                     }
-                    break;
-                default:
-                    uart_state = 0;
+
+                    stats.decrypt_success++;
+
+                } else {
+                    // AES-GCM decryption failed
+                    log_printf("Decryption failed: %d\n", ret);
+                    stats.decrypt_fail++;
+                    // No CRC vouched for a V2 frame's LEN; rescan
+                    // its bytes in case a real frame hides inside
+                    if (aad_len) frame_parser_reject(&fparser);
+                }
             }
         }
-        usleep(1000); // 1ms
+        // Start on the ciphertext of a frame that is still arriving
+        frame_decrypt_poll(&fdec, &fparser, key_valid ? s_key.cipher_key : NULL);
+        if (!rx_any) usleep(1000); // 1ms
     }
 
     close(fd);
+    key_cache_clear(&key_cache);
     free_session_key_list_t(key_list);
     free_SST_ctx_t(sst);
     return 0;
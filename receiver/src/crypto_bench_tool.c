@@ -0,0 +1,96 @@
+// src/crypto_bench_tool.c
+//
+// Host side of the crypto microbenchmarks (src/crypto_bench.c): times every
+// sst_crypto_embedded.c primitive from 16 B to 8 KB and prints CSV rows.
+// Built once per backend (crypto_bench_mbedtls, crypto_bench_openssl) so
+// both can be run on the same machine and diffed; the Pico firmware
+// (sender/src/pico_crypto_bench.c) prints the same rows.
+//
+//   crypto_bench [-t MS] [-o OP] [-f MHZ] [-H]
+//       -t  time spent on each row in ms (default 500)
+//       -o  only primitives whose name starts with OP
+//       -f  CPU clock for cycles/byte when the cycle counter is unavailable
+//       -H  no header row (to append to an existing CSV)
+//
+// Cycles come from the kernel's per-thread hardware cycle counter
+// (perf_event_open); if that is blocked (perf_event_paranoid, containers)
+// and no -f is given, cycles_per_byte is left empty.
+
+#define _GNU_SOURCE
+
+#include <linux/perf_event.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <sys/utsname.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../../include/crypto_bench.h"
+#include "../../include/sst_crypto_embedded.h"
+
+static int cycles_fd = -1;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static uint64_t read_cycles(void) {
+    uint64_t v = 0;
+    if (read(cycles_fd, &v, sizeof(v)) != (ssize_t)sizeof(v)) return 0;
+    return v;
+}
+
+static int open_cycles(void) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = PERF_COUNT_HW_CPU_CYCLES;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+int main(int argc, char **argv) {
+    crypto_bench_cfg_t cfg = {.now_ns = now_ns, .min_ms = 500};
+    const char *only = NULL;
+    int header = 1, opt;
+    while ((opt = getopt(argc, argv, "t:o:f:H")) != -1) {
+        switch (opt) {
+            case 't': cfg.min_ms = (uint32_t)atoi(optarg); break;
+            case 'o': only = optarg; break;
+            case 'f': cfg.cpu_hz = (uint32_t)(atof(optarg) * 1e6); break;
+            case 'H': header = 0; break;
+            default:
+                fprintf(stderr, "Usage: %s [-t MS] [-o OP] [-f MHZ] [-H]\n"
+                                "  OP: %s\n", argv[0], crypto_bench_ops());
+                return 2;
+        }
+    }
+    if (cfg.min_ms == 0) cfg.min_ms = 500;
+
+    struct utsname u;
+    cfg.platform = (uname(&u) == 0) ? u.machine : "linux";
+
+    cycles_fd = open_cycles();
+    if (cycles_fd >= 0) cfg.cycles = read_cycles;
+
+    printf("# crypto_bench backend=%s platform=%s cycles=%s\n",
+           sst_crypto_backend(), cfg.platform,
+           cfg.cycles ? "perf" : cfg.cpu_hz ? "clock" : "none");
+    if (header) crypto_bench_header();
+    fflush(stdout);
+
+    int rows = crypto_bench_run(&cfg, only);
+    if (cycles_fd >= 0) close(cycles_fd);
+    if (rows < 0) return 1;
+    if (rows == 0) {
+        fprintf(stderr, "No primitive matches '%s' (%s)\n", only, crypto_bench_ops());
+        return 2;
+    }
+    return 0;
+}
@@ -25,16 +25,24 @@
 #include "c_api.h"
 #include "c_secure_comm.h"   // parse_handshake_1, check_handshake_2_send_handshake_3
 #include "config_handler.h"  // change_directory_to_config_path, get_config_path
+#include "key_cache.h"
+#include "key_fetch.h"
+#include "key_store.h"
 #include "key_exchange.h"
 #include "../../include/protocol.h"
+#include "decrypt_pool.h"
 #include "replay_window.h"
+#include "sender_table.h"
 #include "serial_linux.h"
 #include "sst_crypto_embedded.h"  // brings in sst_decrypt_gcm prototype and sizes
 #include "heatshrink_decoder.h"
-#include "../../include/crc16.h"
+#include "../../include/frame_parser.h"
 #include "utils.h"
 
 
+// Per-sender sessions; main() owns them, the key panel reads them
+static sender_table_t g_senders;
+
 static WINDOW *win_log = NULL;
 static WINDOW *win_mid = NULL;
 static WINDOW *win_cmd = NULL;
@@ -212,7 +220,11 @@ static void mid_draw_keypanel(const session_key_t* s_key,
         wprintw(win_mid, "CLOSED");
         wattroff(win_mid, A_BOLD | COLOR_PAIR(2));
     }
-    wprintw(win_mid, "   Dev: %s   State: %d", uart_dev, (int)state);
+    // SST handshakes are per sender; show the one for this key
+    const sender_session_t *ss = s_key ? sender_table_find_id(&g_senders, s_key->key_id) : NULL;
+    if (state == STATE_IDLE && ss) state = ss->hs_state;
+    wprintw(win_mid, "   Dev: %s   State: %d   Senders: %d", uart_dev, (int)state,
+            sender_table_count(&g_senders));
 
     // Key Valid Status
     mvwprintw(win_mid, 3, 2, "Key valid: ");
@@ -325,47 +337,18 @@ static int write_all(int fd, const void* buf, size_t len) {
     return (sent == len) ? 0 : -1;
 }
 
-// Helper: Read exact bytes with timeout for non-blocking FD
-// timeout_ms: Max time to wait for the ENTIRE buffer to be filled
-static ssize_t read_exact_timeout(int fd, void *buf, size_t len, int timeout_ms) {
-    uint8_t *p = (uint8_t *)buf;
-    size_t received = 0;
-    struct timeval start, now;
-    gettimeofday(&start, NULL);
-    
-    while (received < len) {
-        // Check timeout
-        gettimeofday(&now, NULL);
-        long elapsed_ms = (now.tv_sec - start.tv_sec) * 1000 + (now.tv_usec - start.tv_usec) / 1000;
-        if (elapsed_ms >= timeout_ms) {
-            return -1; // Timeout
-        }
-        
-        // Wait for data
-        fd_set fds;
-        FD_ZERO(&fds);
-        FD_SET(fd, &fds);
-        struct timeval tv;
-        tv.tv_sec = 0;
-        tv.tv_usec = (timeout_ms - elapsed_ms) * 1000;
-        
-        int ret = select(fd + 1, &fds, NULL, NULL, &tv);
-        if (ret > 0) {
-            ssize_t n = read(fd, p + received, len - received);
-            if (n > 0) {
-                received += n;
-            } else if (n == 0) {
-                return -1; // EOF/Closed
-            } else {
-                if (errno != EAGAIN && errno != EWOULDBLOCK) return -1; // Error
-            }
-        } else if (ret == 0) {
-            return -1; // Timeout
-        } else {
-            return -1; // Error
-        }
-    }
-    return received;
+// Tells the sender which AEADs this receiver opens, so an RP2040 without
+// AES hardware can switch to ChaCha20-Poly1305.
+// Frame: [PREAMBLE:4][TYPE:1][LEN:2][SUITE mask:1]
+static int send_suites(int fd) {
+    const uint8_t frame[] = {
+        PREAMBLE_BYTE_1, PREAMBLE_BYTE_2, PREAMBLE_BYTE_3, PREAMBLE_BYTE_4,
+        MSG_TYPE_SUITES, 0x00, 0x01,
+        SUITE_AES_GCM | SUITE_CHACHAPOLY
+    };
+    if (write_all(fd, frame, sizeof(frame)) < 0) return -1;
+    tcdrain(fd);
+    return 0;
 }
 
 // --- Session Statistics ---
@@ -376,6 +359,7 @@ typedef struct {
     unsigned long replay_blocked;
     unsigned long timeouts;
     unsigned long bad_preamble;
+    unsigned long resyncs;
     unsigned long keys_consumed;
 } SessionStats;
 
@@ -399,12 +383,19 @@ typedef struct {
 
 static ReporterEvent    g_rep_event;
 static bool             g_rep_pending = false;
-static uint8_t          g_rep_mac_key[32];
+// HMAC state for the session mac_key, keyed once per key (see
+// set_rep_mac_key()) so each signature skips rehashing the key pads.
+static sst_hmac_ctx_t   g_rep_hmac;
 static bool             g_rep_key_valid = false;
 static pthread_mutex_t  g_rep_mutex = PTHREAD_MUTEX_INITIALIZER;
 static pthread_cond_t   g_rep_cond  = PTHREAD_COND_INITIALIZER;
 
-// The hex ID of whatever key g_rep_mac_key currently holds — kept separate
+// Caller holds g_rep_mutex.
+static void set_rep_mac_key(const uint8_t *mac_key) {
+    sst_hmac_setkey(&g_rep_hmac, mac_key, 32);
+}
+
+// The hex ID of whatever key g_rep_hmac is currently keyed with — kept separate
 // from g_rep_event.key_id_hex, which only gets written when a real LiFi
 // frame is decrypted (reporter_signal()) and stays empty otherwise. /status
 // and /challenge need to always report the CURRENT key, not "the last frame
@@ -422,7 +413,9 @@ static void set_current_key_id(const uint8_t *key_id) {
 // key-loaded status ping below.
 static void dashboard_http_post(const char *path, const char *json, int jlen) {
     uint8_t hmac_out[32];
-    sst_hmac_sha256_ex(g_rep_mac_key, 32, (const uint8_t*)json, (size_t)jlen, hmac_out);
+    pthread_mutex_lock(&g_rep_mutex);
+    sst_hmac_compute(&g_rep_hmac, (const uint8_t*)json, (size_t)jlen, hmac_out);
+    pthread_mutex_unlock(&g_rep_mutex);
     char hmac_hex[65];
     for (int i = 0; i < 32; i++) sprintf(hmac_hex + i * 2, "%02x", hmac_out[i]);
     hmac_hex[64] = '\0';
@@ -835,20 +828,18 @@ static bool verify_signed_request(const char *buf, const char *path,
     }
     if (replay_window_seen(&g_req_replay_window, nonce_bytes)) return false;
 
-    pthread_mutex_lock(&g_rep_mutex);
-    bool key_ready = g_rep_key_valid;
-    uint8_t mac_key_copy[32];
-    if (key_ready) memcpy(mac_key_copy, g_rep_mac_key, 32);
-    pthread_mutex_unlock(&g_rep_mutex);
-    if (!key_ready) return false;
-
     char signed_str[1024];
     int slen = snprintf(signed_str, sizeof(signed_str), "%s|%s|%s|%.*s",
                          ts_str, nonce_hex, path, (int)body_len, body);
     if (slen < 0 || (size_t)slen >= sizeof(signed_str)) return false;
 
     uint8_t expected_hmac[32];
-    sst_hmac_sha256_ex(mac_key_copy, 32, (const uint8_t*)signed_str, (size_t)slen, expected_hmac);
+    pthread_mutex_lock(&g_rep_mutex);
+    bool key_ready = g_rep_key_valid;
+    if (key_ready)
+        sst_hmac_compute(&g_rep_hmac, (const uint8_t*)signed_str, (size_t)slen, expected_hmac);
+    pthread_mutex_unlock(&g_rep_mutex);
+    if (!key_ready) return false;
 
     uint8_t received_hmac[32];
     for (int i = 0; i < 32; i++) {
@@ -942,10 +933,10 @@ static void challenge_handle(int client) {
     // Compute HMAC-SHA256(mac_key, nonce)
     pthread_mutex_lock(&g_rep_mutex);
     bool key_ready = g_rep_key_valid;
-    uint8_t mac_key_copy[32];
+    uint8_t hmac_out[32];
     uint8_t key_id_copy[SESSION_KEY_ID_SIZE];
     if (key_ready) {
-        memcpy(mac_key_copy, g_rep_mac_key, 32);
+        sst_hmac_compute(&g_rep_hmac, nonce_bytes, 32, hmac_out);
         memcpy(key_id_copy,  g_rep_event.key_id_hex, SESSION_KEY_ID_SIZE);
     }
     pthread_mutex_unlock(&g_rep_mutex);
@@ -960,9 +951,6 @@ static void challenge_handle(int client) {
         return;
     }
 
-    uint8_t hmac_out[32];
-    sst_hmac_sha256_ex(mac_key_copy, 32, nonce_bytes, 32, hmac_out);
-
     char hmac_hex[65];
     for (int j = 0; j < 32; j++) sprintf(hmac_hex + j * 2, "%02x", hmac_out[j]);
     hmac_hex[64] = '\0';
@@ -1026,18 +1014,106 @@ static void *challenge_server_thread(void *arg) {
     return NULL;
 }
 
+// Key to start on the frame the parser is waiting on with: its sender's,
+// once the nonce is in and its salt is known, else the current key.
+static const uint8_t *pending_frame_key(const frame_parser_t *parser,
+                                        sender_table_t *senders,
+                                        const session_key_t *s_key) {
+    lifi_frame_t f;
+    if (frame_parser_peek(parser, &f) && f.raw_len >= FRAME_HDR_SIZE + NONCE_SIZE) {
+        sender_session_t *ss = sender_table_find_salt(senders, f.raw + FRAME_HDR_SIZE);
+        if (ss) return ss->key.cipher_key;
+    }
+    return s_key->cipher_key;
+}
+
+// Starts the SST 3-way handshake with the sender holding ss->key: sends
+// HS1 and leaves the session waiting 5 s for its HS2.
+//
+// @return true if HS1 went out
+static bool send_hs1(int fd, sender_session_t *ss) {
+    bool sent = false;
+    uint32_t hs1_len = 0;
+    uint8_t *hs1 = parse_handshake_1(&ss->key, ss->entity_nonce, &hs1_len);
+    if (hs1 && hs1_len == SST_HS1_PAYLOAD_SIZE) {
+        uint8_t hdr[7] = {
+            PREAMBLE_BYTE_1, PREAMBLE_BYTE_2,
+            PREAMBLE_BYTE_3, PREAMBLE_BYTE_4,
+            MSG_TYPE_SST_HS1,
+            (hs1_len >> 8) & 0xFF, hs1_len & 0xFF
+        };
+        if (write_all(fd, hdr, sizeof(hdr)) >= 0 &&
+            write_all(fd, hs1, hs1_len) >= 0) {
+            tcdrain(fd);
+            sent = true;
+            ss->hs_state = STATE_WAITING_FOR_SST_HS2;
+            clock_gettime(CLOCK_MONOTONIC, &ss->hs_deadline);
+            ss->hs_deadline.tv_sec += 5;
+            cmd_printf("[SST HS1] Sent. Waiting for HS2...");
+        } else {
+            cmd_printf("[SST HS1] UART write failed.");
+            explicit_bzero(ss->entity_nonce, sizeof(ss->entity_nonce));
+        }
+    } else {
+        cmd_printf("[SST HS1] parse_handshake_1 failed.");
+    }
+    free(hs1);
+    return sent;
+}
+
+// Switches to the key the sender announced with KEY_ID_ONLY (from the key
+// cache or a by-ID fetch), gives that sender a session, and if idle and
+// not already mid-handshake with it, sends SST HS1 so the Pico proves it holds the key.
+// Returns true if HS1 went out; the session then waits for HS2.
+static bool adopt_sender_key(int fd, sender_table_t *senders, const session_key_t *k,
+                             bool idle, session_key_t *s_key, bool *key_valid) {
+    unsigned int found_native = convert_skid_buf_to_int((unsigned char *)k->key_id,
+                                                        SESSION_KEY_ID_SIZE);
+    cmd_printf("[NATIVE] Found Key ID: %u", found_native);
+    *s_key = *k;
+    *key_valid = true;
+    // This key matches the provisioner's key — sync reporter mac_key
+    pthread_mutex_lock(&g_rep_mutex);
+    set_rep_mac_key(k->mac_key);
+    g_rep_key_valid = true;
+    set_current_key_id(k->key_id);
+    pthread_mutex_unlock(&g_rep_mutex);
+    reporter_post_key_loaded(k->key_id);
+    cmd_printf("✓ Key ready. Initiating SST handshake.");
+
+    // Trigger SST 3-way handshake immediately, unless this sender is
+    // already in one
+    sender_session_t *ss = sender_table_add(senders, k);
+    if (fd < 0 || !idle || ss->hs_state != STATE_IDLE) return false;
+    return send_hs1(fd, ss);
+}
+
 int main(int argc, char* argv[]) {
     SessionStats stats = {0};
 
+    // Reports are signed with an all-zero key until a session key loads
+    static const uint8_t zero_mac_key[32];
+    sst_hmac_init(&g_rep_hmac);
+    set_rep_mac_key(zero_mac_key);
+
     const char* config_path = NULL;
 
-    if (argc > 2) {
+    // Decrypt workers: one per core the reader doesn't need (3 on a Pi 4)
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    int workers = (ncpu > 1) ? (int)ncpu - 1 : 0;
+    int argi = 1;
+    if (argc > 2 && strcmp(argv[1], "-j") == 0) {
+        workers = atoi(argv[2]);
+        argi = 3;
+    }
+
+    if (argc - argi > 1) {
         fprintf(stderr, "Error: Too many arguments.\n");
-        fprintf(stderr, "Usage: %s [<path/to/receiver.config>]\n",
+        fprintf(stderr, "Usage: %s [-j WORKERS] [<path/to/receiver.config>]\n",
                 argv[0]);
         return 1;
-    } else if (argc == 2) {
-        config_path = argv[1];
+    } else if (argc - argi == 1) {
+        config_path = argv[argi];
     } else {
 #ifdef DEFAULT_SST_CONFIG_PATH
         config_path = DEFAULT_SST_CONFIG_PATH;
@@ -1073,23 +1149,37 @@ int main(int argc, char* argv[]) {
     }
     printf("Dashboard host: %s:%d\n", g_dashboard_host, DASHBOARD_PORT);
 
-    printf("Fetching initial session key to establish Auth connection...\n");
-    session_key_list_t* key_list = get_session_key(sst, NULL);
-    
+    // Keys saved by the last run let us start without waiting on Auth; a
+    // fresh list is fetched in the background once the worker is up.
+    session_key_list_t* key_list = key_store_load(KEY_STORE_PATH, KEY_STORE_KEY_PATH);
+    bool from_store = (key_list != NULL);
+    if (from_store) {
+         printf("Restored %d session keys from %s (revalidating with Auth in the background).\n",
+                key_list->num_key, KEY_STORE_PATH);
+    } else {
+         printf("Fetching initial session key to establish Auth connection...\n");
+         key_list = get_session_key(sst, NULL);
+    }
+
     if (!key_list) {
          printf("Failed to get initial session key. Auth connection might be down or config invalid.\n");
          printf("Attempting to continue with empty list (Reactive Mode)...\n");
          key_list = init_empty_session_key_list();
 
-    } else {
+    } else if (!from_store) {
          if (key_list->num_key > 0) {
              printf("Success! Initial Session Key ID: ");
              for(int i=0; i<SESSION_KEY_ID_SIZE; i++) printf("%02X", key_list->s_key[0].key_id[i]);
              printf("\n");
+             if (key_store_save(KEY_STORE_PATH, KEY_STORE_KEY_PATH, key_list) != 0)
+                 printf("Warning: could not save session keys to %s\n", KEY_STORE_PATH);
          } else {
              printf("Connected to Auth, but received 0 keys.\n");
          }
     }
+    static key_cache_t key_cache;
+    key_cache_init(&key_cache);
+    key_cache_put_list(&key_cache, key_list);
 
     // --- Start Dashboard Reporter + Challenge Server Threads ---
     {
@@ -1141,7 +1231,7 @@ int main(int argc, char* argv[]) {
         s_key = key_list->s_key[current_key_idx];
         // Seed reporter mac key
         pthread_mutex_lock(&g_rep_mutex);
-        memcpy(g_rep_mac_key, s_key.mac_key, 32);
+        set_rep_mac_key(s_key.mac_key);
         g_rep_key_valid = true;
         set_current_key_id(s_key.key_id);
         pthread_mutex_unlock(&g_rep_mutex);
@@ -1165,12 +1255,10 @@ int main(int argc, char* argv[]) {
     struct timespec state_deadline = (struct timespec){0, 0};
     time_t last_key_req_time = 0;
 
-    // nonce setup
-    replay_window_t rwin;
-    replay_window_init(&rwin, NONCE_SIZE, NONCE_HISTORY_SIZE);
-
-    // SST handshake entity nonce (Pi4's challenge nonce, generated per HS1)
-    uint8_t sst_entity_nonce[SST_HS_NONCE_SIZE] = {0};
+    // One session per sender heard (g_senders): its key, replay window,
+    // SST handshake (entity nonce generated per HS1) and counters. s_key
+    // stays the key the UI and the shortcuts act on.
+    sender_table_init(&g_senders);
 
     // Initial key push retry machinery
     struct timespec next_send = {0};
@@ -1199,6 +1287,7 @@ int main(int argc, char* argv[]) {
              } else {
                  tcdrain(fd);
                  log_printf("Sent session key over UART (ID + Cipher + MAC).\n");
+                 if (send_suites(fd) < 0) log_printf("Error: Failed to send AEAD suites.\n");
                  log_printf("[DEBUG] Sent Cipher: %02X %02X... MAC: %02X %02X...\n", 
                      s_key.cipher_key[0], s_key.cipher_key[1], 
                      s_key.mac_key[0], s_key.mac_key[1]);
@@ -1207,17 +1296,36 @@ int main(int argc, char* argv[]) {
     }
 
     // UART framing state
-    uint8_t byte = 0;
-    int uart_state = 0;
+    static frame_parser_t fparser;
+    frame_parser_init(&fparser);
+    // GCM decrypt + heatshrink expansion, off this thread unless -j 0
+    static decrypt_pool_t dpool;
+    if (decrypt_pool_start(&dpool, workers) != 0) {
+        fprintf(stderr, "Failed to start %d decrypt workers\n", workers);
+        return 1;
+    }
+    // Auth requests from here on run on their own thread
+    static key_fetch_t kfetch;
+    if (key_fetch_start(&kfetch, sst) != 0) {
+        fprintf(stderr, "Failed to start the key fetch worker\n");
+        return 1;
+    }
+    // Keep keys ready so "new key -f" doesn't wait for Auth
+    key_fetch_prefetch(&kfetch, KEY_FETCH_PREFETCH_DEPTH);
+    key_fetch_store(&kfetch, KEY_STORE_PATH, KEY_STORE_KEY_PATH);
+    if (from_store) key_fetch_request_list(&kfetch);
 
     log_printf("Listening for encrypted message...\n");
     if (fd >= 0) tcflush(fd, TCIFLUSH);
 
-    uint8_t pending_key[SESSION_KEY_SIZE] = {0};
+    // Key sent to the Pico, active once it ACKs
+    session_key_t pending_s_key = {0};
+    // A remote /force_key by-ID fetch is on the worker
+    bool remote_force_fetching = false;
     int last_countdown = -1;
 
     // Raw physical-layer diagnostic: counts every byte read off the UART
-    // fd, completely independent of preamble hunting / uart_state. If the
+    // fd, completely independent of the frame parser. If the
     // wiring/baud/analog-frontend is broken, bytes never even reach the
     // point of forming a valid preamble, so the existing preamble-based
     // debug tap (below) would stay silent too. This reports on a fixed
@@ -1378,6 +1486,7 @@ int main(int argc, char* argv[]) {
                              cmd_printf("Error: Failed to send MAC key.");
                         } else {
                              tcdrain(fd);
+                             send_suites(fd);
                              cmd_printf("✓ Session key sent (Cipher + MAC).");
                              log_printf("[DEBUG] Sent Cipher: %02X %02X... MAC: %02X %02X...\n", 
                                  s_key.cipher_key[0], s_key.cipher_key[1], 
@@ -1419,7 +1528,7 @@ int main(int argc, char* argv[]) {
                         key_valid = true;
                         stats.keys_consumed++;
                         pthread_mutex_lock(&g_rep_mutex);
-                        memcpy(g_rep_mac_key, s_key.mac_key, 32);
+                        set_rep_mac_key(s_key.mac_key);
                         g_rep_key_valid = true;
                         set_current_key_id(s_key.key_id);
                         pthread_mutex_unlock(&g_rep_mutex);
@@ -1468,177 +1577,35 @@ int main(int argc, char* argv[]) {
                         // against Auth's CommunicationPolicyChecker when
                         // the requester already owns the target key (see
                         // the has_material branch above for why).
-                        {
-                            char req_hex[SESSION_KEY_ID_SIZE * 2 + 1];
-                            for (int j = 0; j < SESSION_KEY_ID_SIZE; j++)
-                                sprintf(req_hex + j * 2, "%02x", remote_force_target_id[j]);
-                            req_hex[SESSION_KEY_ID_SIZE * 2] = '\0';
-                            fprintf(stderr, "[FORCE_KEY] Calling get_session_key_by_ID(%s)...\n", req_hex);
-                        }
+                        char req_hex[SESSION_KEY_ID_SIZE * 2 + 1];
+                        for (int j = 0; j < SESSION_KEY_ID_SIZE; j++)
+                            sprintf(req_hex + j * 2, "%02x", remote_force_target_id[j]);
+                        req_hex[SESSION_KEY_ID_SIZE * 2] = '\0';
+                        fprintf(stderr, "[FORCE_KEY] Requesting key by ID %s...\n", req_hex);
                         // Our cached distribution key can be stale: this
                         // entity identity (net1.client) is shared with the
                         // dashboard's pico_provisioner, which may have
-                        // re-handshaked with Auth since our last one,
-                        // invalidating Auth's view of *our* cached dist key
-                        // even though it hasn't locally "expired" yet.
-                        // Reusing it then fails server-side with
-                        // InvalidMacException.
-                        //
-                        // Forcing get_session_key_by_ID() itself to
-                        // re-handshake (by expiring dist_key right before
-                        // it) does NOT work: Auth's public-key/first-contact
-                        // path apparently can't handle a "{\"keyId\":...}"
-                        // purpose — it fails with a generic RSA padding
-                        // error before ever parsing the request, even though
-                        // the same key/entity works fine there for a normal
-                        // group-purpose request. The distribution-key path
-                        // *does* support keyId purposes correctly (it got as
-                        // far as a real MAC comparison above). So: refresh
-                        // the distribution key first via a normal (group-
-                        // purpose, public-key) fetch — proven to work — then
-                        // do the by-ID fetch over the now-fresh, Auth-synced
-                        // distribution key.
-                        sst->dist_key.abs_validity = 0;
-                        cmd_printf("[Remote] Refreshing dist key...");
-                        reporter_post_status_message("1/2 refresh dist key...");
-                        session_key_list_t* refresh_list = get_session_key(sst, NULL);
-                        if (!refresh_list) {
-                            fprintf(stderr, "[FORCE_KEY] Distribution-key refresh failed; "
-                                            "by-ID fetch would likely fail too.\n");
-                            cmd_printf("Error: dist key refresh failed.");
-                            reporter_post_status_message("1/2 refresh FAILED");
+                        // re-handshaked with Auth since our last one. The
+                        // worker renews it with a normal fetch before the
+                        // by-ID one (see run_job() in key_fetch.c).
+                        int rq = key_fetch_request_id(&kfetch, remote_force_target_id, true);
+                        if (rq < 0) {
+                            cmd_printf("Error: another key is being fetched. Try again.");
+                            reporter_post_status_message("by-ID busy, try again");
                         } else {
-                            free_session_key_list_t(refresh_list);
-                            reporter_post_status_message("1/2 refresh OK");
+                            cmd_printf("[Remote] Fetching key by ID...");
+                            reporter_post_status_message("refresh dist key, then by-ID...");
+                            remote_force_fetching = true;
                         }
-                        cmd_printf("[Remote] Fetching key by ID...");
-                        // get_session_key_by_ID() permanently overwrites
-                        // sst->config.purpose[...] with "{\"keyId\":...}"
-                        // and never restores it — left as-is, the NEXT
-                        // verify's refresh step above would silently send
-                        // that stale keyId purpose instead of our real
-                        // group purpose, recreating the same padding bug.
-                        // Save/restore around the call so it doesn't leak.
-                        char saved_purpose[MAX_PURPOSE_LENGTH + 1];
-                        strncpy(saved_purpose,
-                                sst->config.purpose[sst->config.purpose_index],
-                                sizeof(saved_purpose));
-                        session_key_t* found = get_session_key_by_ID(remote_force_target_id, sst, key_list);
-                        strncpy(sst->config.purpose[sst->config.purpose_index],
-                                saved_purpose, sizeof(saved_purpose));
-                        if (!found) {
-                            fprintf(stderr, "[FORCE_KEY] get_session_key_by_ID() returned NULL.\n");
-                            cmd_printf("Error: by-ID fetch failed.");
-                            cmd_printf("See receiver_debug.log for the real reason.");
-                            cmd_printf("Keeping current session key.");
-                            reporter_post_status_message("2/2 by-ID FAILED (Auth rejected)");
-                        } else {
-                            s_key = *found;
-                            key_valid = true;
-                            stats.keys_consumed++;
-                            pthread_mutex_lock(&g_rep_mutex);
-                            memcpy(g_rep_mac_key, s_key.mac_key, 32);
-                            g_rep_key_valid = true;
-                            set_current_key_id(s_key.key_id);
-                            pthread_mutex_unlock(&g_rep_mutex);
-                            reporter_post_key_loaded(s_key.key_id);
-                            {
-                                char got_hex[SESSION_KEY_ID_SIZE * 2 + 1];
-                                for (int j = 0; j < SESSION_KEY_ID_SIZE; j++)
-                                    sprintf(got_hex + j * 2, "%02x", s_key.key_id[j]);
-                                got_hex[SESSION_KEY_ID_SIZE * 2] = '\0';
-                                bool matches = memcmp(s_key.key_id, remote_force_target_id, SESSION_KEY_ID_SIZE) == 0;
-                                fprintf(stderr, "[FORCE_KEY] get_session_key_by_ID() returned key_id=%s "
-                                                "(matches request: %s)\n",
-                                        got_hex, matches ? "YES" : "NO");
-                                char msg[64];
-                                snprintf(msg, sizeof(msg), "2/2 by-ID OK, ...%.8s (match: %s)",
-                                    got_hex + strlen(got_hex) - 8, matches ? "Y" : "N");
-                                reporter_post_status_message(msg);
-                            }
-                            cmd_printf("✓ Fetched requested key — now matches sender.");
-
-                            if (fd >= 0) {
-                                uint16_t klen = SESSION_KEY_ID_SIZE + SST_KEY_SIZE + 32;
-                                uint8_t hdr[] = {
-                                    PREAMBLE_BYTE_1, PREAMBLE_BYTE_2, PREAMBLE_BYTE_3, PREAMBLE_BYTE_4,
-                                    MSG_TYPE_KEY,
-                                    (klen >> 8) & 0xFF,
-                                    klen & 0xFF
-                                };
-                                if (write_all(fd, hdr, sizeof(hdr)) < 0 ||
-                                    write_all(fd, s_key.key_id, SESSION_KEY_ID_SIZE) < 0 ||
-                                    write_all(fd, s_key.cipher_key, SST_KEY_SIZE) < 0) {
-                                    cmd_printf("Error: Failed to send new key to Pico.");
-                                } else {
-                                    usleep(5000);
-                                    write_all(fd, s_key.mac_key, 32);
-                                    tcdrain(fd);
-                                    cmd_printf("✓ Session key sent to Pico.");
-                                }
-                            } else {
-                                cmd_printf("Warning: Serial closed. Key updated locally but not sent.");
-                            }
-                        }
-                        mid_draw_keypanel(&s_key, key_valid, state, UART_DEVICE, (fd >= 0));
                         break;
                     }
 
                     cmd_printf("[Shortcut] Force Fetch New Key from SST...");
-                    // Try fetch new list first without freeing old one.
-                    session_key_list_t* new_key_list = get_session_key(sst, NULL);
-
-                    if (!new_key_list || new_key_list->num_key == 0) {
-                         // Failed. errno here is unreliable (the UART poll's
-                         // non-blocking read() sets it constantly regardless
-                         // of this call) — the real reason is whatever
-                         // Auth/SST logged to receiver_debug.log just now.
-                         cmd_printf("Error: Failed to fetch new key from SST.");
-                         cmd_printf("See receiver_debug.log for the real reason.");
-                         cmd_printf("Keeping current session key.");
-                         if (new_key_list) free_session_key_list_t(new_key_list);
-                    } else {
-                        // Success, replace old list
-                        if (key_list) free_session_key_list_t(key_list);
-                        key_list = new_key_list;
-                        
-                        s_key = key_list->s_key[0];
-                        key_valid = true;
-                        stats.keys_consumed++;
-                        pthread_mutex_lock(&g_rep_mutex);
-                        memcpy(g_rep_mac_key, s_key.mac_key, 32);
-                        g_rep_key_valid = true;
-                        set_current_key_id(s_key.key_id);
-                        pthread_mutex_unlock(&g_rep_mutex);
-                        reporter_post_key_loaded(s_key.key_id);
-                        cmd_printf("✓ New key fetched from SST.");
-                        
-                        if (fd >= 0) {
-                            uint16_t klen = SESSION_KEY_ID_SIZE + SST_KEY_SIZE + 32;
-                            uint8_t hdr[] = {
-                                PREAMBLE_BYTE_1, PREAMBLE_BYTE_2, PREAMBLE_BYTE_3, PREAMBLE_BYTE_4,
-                                MSG_TYPE_KEY,
-                                (klen >> 8) & 0xFF,
-                                klen & 0xFF
-                            };
-                            if (write_all(fd, hdr, sizeof(hdr)) < 0 ||
-                                write_all(fd, s_key.key_id, SESSION_KEY_ID_SIZE) < 0 ||
-                                write_all(fd, s_key.cipher_key, SST_KEY_SIZE) < 0) {
-                                cmd_printf("Error: Failed to send new key to Pico.");
-                            } else {
-                                usleep(5000);
-                                write_all(fd, s_key.mac_key, 32);
-                                tcdrain(fd);
-                                cmd_printf("✓ New session key sent to Pico.");
-                                log_printf("[DEBUG] Sent Cipher: %02X %02X... MAC: %02X %02X...\n", 
-                                    s_key.cipher_key[0], s_key.cipher_key[1], 
-                                    s_key.mac_key[0], s_key.mac_key[1]);
-                            }
-                        } else {
-                            cmd_printf("Warning: Serial closed. Key updated locally but not sent.");
-                        }
-                    }
-                    mid_draw_keypanel(&s_key, key_valid, state, UART_DEVICE, (fd >= 0));
+                    // Answered from the prefetch pool at once, or by Auth
+                    // on the key fetch worker; either way the key goes to
+                    // the Pico from the "new key -f" completion below.
+                    if (key_fetch_request_new(&kfetch) != 0)
+                        cmd_printf("A new key is already being fetched.");
                     break;
                 }
 
@@ -1647,31 +1614,7 @@ int main(int argc, char* argv[]) {
                     if (fd < 0) { cmd_printf("Serial not open. Press 'r' to retry."); break; }
                     if (!key_valid) { cmd_printf("No valid session key loaded."); break; }
 
-                    uint32_t hs1_len = 0;
-                    uint8_t *hs1 = parse_handshake_1(&s_key, sst_entity_nonce, &hs1_len);
-                    if (!hs1 || hs1_len != SST_HS1_PAYLOAD_SIZE) {
-                        cmd_printf("Error: parse_handshake_1 failed.");
-                        free(hs1);
-                        break;
-                    }
-                    uint8_t hdr[7] = {
-                        PREAMBLE_BYTE_1, PREAMBLE_BYTE_2, PREAMBLE_BYTE_3, PREAMBLE_BYTE_4,
-                        MSG_TYPE_SST_HS1,
-                        (hs1_len >> 8) & 0xFF, hs1_len & 0xFF
-                    };
-                    if (write_all(fd, hdr, sizeof(hdr)) < 0 ||
-                        write_all(fd, hs1, hs1_len) < 0) {
-                        cmd_printf("Error: Failed to send HS1.");
-                        explicit_bzero(sst_entity_nonce, sizeof(sst_entity_nonce));
-                    } else {
-                        tcdrain(fd);
-                        state = STATE_WAITING_FOR_SST_HS2;
-                        clock_gettime(CLOCK_MONOTONIC, &state_deadline);
-                        state_deadline.tv_sec += 5;
-                        last_countdown = 5;
-                        cmd_printf("[SST HS1] Sent. Waiting for HS2...");
-                    }
-                    free(hs1);
+                    if (send_hs1(fd, sender_table_add(&g_senders, &s_key))) last_countdown = 5;
                     mid_draw_keypanel(&s_key, key_valid, state, UART_DEVICE, (fd >= 0));
                     break;
                 }
@@ -1685,7 +1628,21 @@ int main(int argc, char* argv[]) {
                     cmd_printf("Replays Blocked: %lu", stats.replay_blocked);
                     cmd_printf("Timeouts:        %lu", stats.timeouts);
                     cmd_printf("Bad Preambles:   %lu", stats.bad_preamble);
+                    cmd_printf("Resyncs:         %lu", stats.resyncs);
                     cmd_printf("Keys Consumed:   %lu", stats.keys_consumed);
+                    cmd_printf("Senders:         %d (%u probed, %u unrouted, %u old salt)",
+                               sender_table_count(&g_senders), g_senders.probes,
+                               g_senders.unrouted, g_senders.retired_rejects);
+                    for (int i = 0; i < SENDER_TABLE_MAX; i++) {
+                        const sender_session_t *ss = &g_senders.s[i];
+                        if (!ss->used) continue;
+                        char id_hex[2 * SESSION_KEY_ID_SIZE + 1];
+                        for (int b = 0; b < SESSION_KEY_ID_SIZE; b++)
+                            snprintf(id_hex + 2 * b, 3, "%02X", ss->key.key_id[b]);
+                        cmd_printf("  %s: %u frames, %u ok, %u fail, %u replays",
+                                   id_hex, ss->frames, ss->decrypt_ok,
+                                   ss->decrypt_fail, ss->replay_blocked);
+                    }
                     cmd_printf("--------------------------");
                     break;
                 }
@@ -1720,6 +1677,7 @@ int main(int argc, char* argv[]) {
                         fprintf(f, "Replays Blocked: %lu\n", stats.replay_blocked);
                         fprintf(f, "Timeouts:        %lu\n", stats.timeouts);
                         fprintf(f, "Bad Preambles:   %lu\n", stats.bad_preamble);
+                        fprintf(f, "Resyncs:         %lu\n", stats.resyncs);
                         fprintf(f, "Keys Consumed:   %lu\n", stats.keys_consumed);
                         fprintf(f, "--------------------------\n");
                         fclose(f);
@@ -1742,6 +1700,7 @@ int main(int argc, char* argv[]) {
                         int flags = fcntl(fd, F_GETFL, 0);
                         if (flags >= 0) fcntl(fd, F_SETFL, flags | O_NONBLOCK);
                         tcflush(fd, TCIFLUSH);
+                        frame_parser_reset(&fparser);
                         cmd_printf("✓ Serial opened at %d baud.", g_current_baud_int);
                         char msg[48];
                         snprintf(msg, sizeof(msg), "UART reopened at %d baud", g_current_baud_int);
@@ -1758,6 +1717,9 @@ int main(int argc, char* argv[]) {
                 case 'Q': {
                     cmd_printf("Exiting...");
                     if (fd >= 0) close(fd);
+                    key_fetch_stop(&kfetch);
+                    key_cache_clear(&key_cache);
+                    sender_table_free(&g_senders);
                     free_session_key_list_t(key_list);
                     free_SST_ctx_t(sst);
                     return 0;
@@ -1768,9 +1730,10 @@ int main(int argc, char* argv[]) {
             }
         }
 
-        // --- Handle Countdown Display ---
-        if (state == STATE_WAITING_FOR_SST_HS2) {
-            int remaining = (int)(state_deadline.tv_sec - now_ts.tv_sec);
+        // --- Handle Countdown Display (handshake of the key shown) ---
+        sender_session_t *shown = key_valid ? sender_table_find_id(&g_senders, s_key.key_id) : NULL;
+        if (shown && shown->hs_state == STATE_WAITING_FOR_SST_HS2) {
+            int remaining = (int)(shown->hs_deadline.tv_sec - now_ts.tv_sec);
             if (remaining < 0) remaining = 0;
             if (remaining != last_countdown) {
                 cmd_print_partial("%d.. ", remaining);
@@ -1789,630 +1752,546 @@ int main(int argc, char* argv[]) {
                 cmd_printf(
                     "Timeout waiting for key update ACK. Discarding new "
                     "key.\n");
-                explicit_bzero(pending_key, sizeof pending_key);
+                explicit_bzero(&pending_s_key, sizeof pending_s_key);
                 // keep old key; key_valid stays true
-            } else if (state == STATE_WAITING_FOR_SST_HS2) {
-                cmd_printf("\nSST HS2 timed out – Pico did not respond.\n");
-                stats.timeouts++;
-                explicit_bzero(sst_entity_nonce, sizeof(sst_entity_nonce));
             }
             state = STATE_IDLE;
             state_deadline = (struct timespec){0, 0};
         }
+        for (int i = 0; i < SENDER_TABLE_MAX; i++) {
+            sender_session_t *ss = &g_senders.s[i];
+            if (!ss->used || ss->hs_state != STATE_WAITING_FOR_SST_HS2 ||
+                !timespec_passed(&ss->hs_deadline))
+                continue;
+            cmd_printf("\nSST HS2 timed out – Pico did not respond.\n");
+            stats.timeouts++;
+            explicit_bzero(ss->entity_nonce, sizeof(ss->entity_nonce));
+            ss->hs_state = STATE_IDLE;
+        }
 
-        if (fd >= 0 && read(fd, &byte, 1) == 1) {
-            raw_byte_count++;
-            if (raw_sample_len < sizeof(raw_sample)) {
-                raw_sample[raw_sample_len++] = byte;
-            }
+        bool rx_any = false;
+        if (fd >= 0) {
+            // Bulk read straight into the frame parser's buffer.
+            size_t rx_space = 0;
+            uint8_t *rx_dst = frame_parser_write_ptr(&fparser, &rx_space);
+            ssize_t rx_n = (rx_space > 0) ? read(fd, rx_dst, rx_space) : 0;
+            if (rx_n > 0) {
+                rx_any = true;
+                raw_byte_count += (uint32_t)rx_n;
+                for (ssize_t i = 0; i < rx_n && raw_sample_len < sizeof(raw_sample); i++) {
+                    raw_sample[raw_sample_len++] = rx_dst[i];
+                }
+                frame_parser_commit(&fparser, (size_t)rx_n);
 
-            // Activity Blink (Top Right)
-            static int act_ctr = 0;
-            if (++act_ctr % 10 == 0) {
-                mvwprintw(win_log_border, 0, getmaxx(win_log_border)-4, "%c", (act_ctr/10)%2 ? '*' : ' ');
+                // Activity Blink (Top Right)
+                static int act_ctr = 0;
+                act_ctr++;
+                mvwprintw(win_log_border, 0, getmaxx(win_log_border)-4, "%c", act_ctr % 2 ? '*' : ' ');
                 wrefresh(win_log_border);
             }
+        }
 
-            switch (uart_state) {
-                case 0:
-                    if (byte == PREAMBLE_BYTE_1) {
-                        uart_state = 1;
+        // Answers from the key fetch worker
+        key_fetch_result_t kres;
+        while (key_fetch_poll(&kfetch, &kres)) {
+            if (kres.kind == KEY_FETCH_BY_ID) {
+                if (kres.ok) {
+                    key_cache_put(&key_cache, &kres.key);
+                    if (adopt_sender_key(fd, &g_senders, &kres.key, state == STATE_IDLE,
+                                         &s_key, &key_valid))
+                        last_countdown = 5;
+                    if (remote_force_fetching) {
+                        stats.keys_consumed++;
+                        reporter_post_status_message("by-ID OK");
                     }
-                    break;
-                case 1:
-                    if (byte == PREAMBLE_BYTE_2) {
-                        uart_state = 2;
-                    } else {
-                        char m[96];
-                        snprintf(m, sizeof(m),
-                                 "[LIFI] Preamble broke at byte 2/4: expected 0x%02X, got 0x%02X'%c'",
-                                 PREAMBLE_BYTE_2, byte, printable_char(byte));
-                        reporter_post_status_message(m);
-                        uart_state = (byte == PREAMBLE_BYTE_1) ? 1 : 0;
+                } else {
+                    cmd_printf("Error: Key ID not found (Local or Auth).");
+                    if (remote_force_fetching) {
+                        cmd_printf("See receiver_debug.log for the real reason.");
+                        reporter_post_status_message("by-ID FAILED (Auth rejected)");
                     }
-                    break;
-                case 2:
-                    if (byte == PREAMBLE_BYTE_3) {
-                        uart_state = 3;
-                    } else {
-                        char m[96];
-                        snprintf(m, sizeof(m),
-                                 "[LIFI] Preamble broke at byte 3/4: expected 0x%02X, got 0x%02X'%c'",
-                                 PREAMBLE_BYTE_3, byte, printable_char(byte));
-                        reporter_post_status_message(m);
-                        uart_state = (byte == PREAMBLE_BYTE_1) ? 1 : 0;
+                    int dropped = key_fetch_drop_held(&kfetch);
+                    if (dropped > 0) {
+                        log_printf("Dropped %d frames held for that key.\n", dropped);
+                        stats.decrypt_fail += (unsigned long)dropped;
                     }
-                    break;
-                case 3:
-                    if (byte == PREAMBLE_BYTE_4) {
-                        uart_state = 4; // Preamble complete, next is TYPE
-                        reporter_post_status_message(
-                            "[LIFI] Preamble OK (AB CD EF 12) - reading TYPE next");
+                }
+                remote_force_fetching = false;
+                mid_draw_keypanel(&s_key, key_valid, state, UART_DEVICE, (fd >= 0));
+            } else if (kres.kind == KEY_FETCH_LIST) {
+                // Revalidation of the keys restored at startup. The key in
+                // use stays; the sender is still on it.
+                if (kres.ok) {
+                    if (key_list) free_session_key_list_t(key_list);
+                    key_list = kres.list;
+                    current_key_idx = 0;
+                    key_cache_put_list(&key_cache, key_list);
+                    log_printf("Auth reachable: replaced the restored keys with %d fresh ones.\n",
+                               key_list->num_key);
+                } else {
+                    log_printf("Auth unreachable: keeping the %d keys restored from %s.\n",
+                               key_list ? key_list->num_key : 0, KEY_STORE_PATH);
+                }
+            } else {
+                // "new key -f", answered from the prefetch pool (no list)
+                // or by Auth
+                if (!kres.ok) {
+                    cmd_printf("Failed to fetch new session key.\n");
+                } else {
+                    if (kres.list) {
+                        if (key_list) free_session_key_list_t(key_list);
+                        key_list = kres.list;
+                        key_cache_put_list(&key_cache, key_list);
                     } else {
-                        char m[96];
-                        snprintf(m, sizeof(m),
-                                 "[LIFI] Preamble broke at byte 4/4: expected 0x%02X, got 0x%02X'%c'",
-                                 PREAMBLE_BYTE_4, byte, printable_char(byte));
-                        reporter_post_status_message(m);
-                        uart_state = (byte == PREAMBLE_BYTE_1) ? 1 : 0;
+                        key_cache_put(&key_cache, &kres.key);
+                        cmd_printf("Using a prefetched key (%d left).",
+                                   key_fetch_pool_count(&kfetch));
                     }
-                    break;
+                    pending_s_key = kres.key;
+                    stats.keys_consumed++;
+                    cmd_hex("New Session Key (pending ACK): ", pending_s_key.cipher_key, SESSION_KEY_SIZE);
+                    key_valid = true;
 
-                case 4:
-                    // TYPE byte received
-                    if (byte == MSG_TYPE_KEY_ID_ONLY) {
-                        uint8_t packet_type = byte; 
-                        stats.total_pkts++;
-                        
-                        // Read length (2 bytes)
-                        uint8_t len_bytes[2];
-                        if (read_exact_timeout(fd, len_bytes, 2, 100) != 2) {
-                            log_printf("Failed to read length (Key ID)\n");
-                            uart_state = 0;
-                            continue;
-                        }
-                        uint16_t payload_len = ((uint16_t)len_bytes[0] << 8) | len_bytes[1];
-                        
-                        if (payload_len > 64) { // Sanity check
-                             log_printf("Invalid Key ID len: %u\n", payload_len);
-                             uart_state = 0;
-                             continue;
-                        }
-                        
-                        uint8_t payload[payload_len];
-                        uint8_t crc_bytes[2];
-                        
-                        if (read_exact_timeout(fd, payload, payload_len, 100) != (ssize_t)payload_len ||
-                            read_exact_timeout(fd, crc_bytes, 2, 100) != 2) {
-                            log_printf("Failed to read payload/CRC (Key ID)\n");
-                            uart_state = 0;
-                            continue;
-                        }
-                        
-                        // Verify CRC
-                        uint8_t crc_buf[1 + 2 + 64]; // Max size
-                        size_t crc_idx = 0;
-                        crc_buf[crc_idx++] = packet_type;
-                        crc_buf[crc_idx++] = len_bytes[0];
-                        crc_buf[crc_idx++] = len_bytes[1];
-                        memcpy(&crc_buf[crc_idx], payload, payload_len);
-                        crc_idx += payload_len;
-                        
-                        uint16_t computed_crc = crc16_ccitt(crc_buf, crc_idx);
-                        uint16_t received_crc = ((uint16_t)crc_bytes[0] << 8) | crc_bytes[1];
-                        
-                        if (computed_crc != received_crc) {
-                            log_printf("CRC fail on Key ID pkt\n");
-                            uart_state = 0;
-                            continue;
-                        }
-                        
-                        log_printf("[KEY ID] Received: ");
-                        for(int i=0; i<payload_len; i++) {
-                            // Using private internal method of log_printf to stay on same line? 
-                            // iterating log_printf calls creates newlines usually.
-                            // Let's just format it into a string first.
-                        }
-                        char hex_str[3 * payload_len + 1];
-                        hex_str[0] = '\0';
-                        for(int i=0; i<payload_len; i++) {
-                            char tmp[5];
-                            snprintf(tmp, sizeof(tmp), "%02X ", payload[i]);
-                            strcat(hex_str, tmp);
-                        }
-                        log_printf("[KEY ID] Peer ID: %s", hex_str);
-                        
-                        // --- AUTO-CONNECT LOGIC ---
-                        // 1. Store the ID
-                        memcpy(last_lifi_id, payload, SESSION_KEY_ID_SIZE);
-                        lifi_id_seen = true;
+                    // Send using MSG_TYPE_KEY with MAC
+                    uint16_t klen = SESSION_KEY_ID_SIZE + SST_KEY_SIZE + 32;
+                    uint8_t hdr[] = {
+                        PREAMBLE_BYTE_1, PREAMBLE_BYTE_2, PREAMBLE_BYTE_3, PREAMBLE_BYTE_4,
+                        MSG_TYPE_KEY,
+                        (klen >> 8) & 0xFF,
+                        klen & 0xFF
+                    };
+                    write_all(fd, hdr, sizeof(hdr));
+                    write_all(fd, pending_s_key.key_id, SESSION_KEY_ID_SIZE);
+                    write_all(fd, pending_s_key.cipher_key, SST_KEY_SIZE);
+                    usleep(5000); // Delay for MAC key
+                    write_all(fd, pending_s_key.mac_key, 32);
+
+                    log_printf("[DEBUG] Sent Cipher: %02X %02X... MAC: %02X %02X...\n", 
+                        pending_s_key.cipher_key[0], pending_s_key.cipher_key[1], 
+                        kres.key.mac_key[0], kres.key.mac_key[1]);
+
+                    // 5ms sleep to let transmission complete
+                    usleep(5000);  
+
+                    cmd_printf("Sent new session key to Pico. Waiting 5s for ACK...\n");
+                    state = STATE_WAITING_FOR_ACK;
+                    clock_gettime(CLOCK_MONOTONIC, &state_deadline);
+                    state_deadline.tv_sec += 5;
+                }
+            }
+            explicit_bzero(&kres.key, sizeof(kres.key));
+        }
 
-                        unsigned int native_id = convert_skid_buf_to_int(last_lifi_id, SESSION_KEY_ID_SIZE);
-                        cmd_printf("[NATIVE] Received ID: %u", native_id);
-                        
-                        cmd_printf("Looking for Key ID...");
-                        char debug_key_id[3 * SESSION_KEY_ID_SIZE + 1];
-                        debug_key_id[0] = '\0';
-                        for (int i = 0; i < SESSION_KEY_ID_SIZE; i++) {
-                            char buf[4];
-                            snprintf(buf, sizeof(buf), "%02X ", last_lifi_id[i]);
-                            strcat(debug_key_id, buf);
-                        }
-                        cmd_printf("Passing ID to SST: %s", debug_key_id);
-                        
-                        // 2. Use C-API to find locally or fetch from Auth
-                        // This handles checking existing_s_key_list first, then queries Auth if needed.
-                        session_key_t *found_key = get_session_key_by_ID(last_lifi_id, sst, key_list);
-                        
-                        if (found_key) {
-                            unsigned int found_native = convert_skid_buf_to_int(found_key->key_id, SESSION_KEY_ID_SIZE);
-                            cmd_printf("[NATIVE] Found Key ID: %u", found_native);
-                            s_key = *found_key;
-                            key_valid = true;
-                            // This key matches the provisioner's key — sync reporter mac_key
-                            pthread_mutex_lock(&g_rep_mutex);
-                            memcpy(g_rep_mac_key, found_key->mac_key, 32);
-                            g_rep_key_valid = true;
-                            set_current_key_id(found_key->key_id);
-                            pthread_mutex_unlock(&g_rep_mutex);
-                            reporter_post_key_loaded(found_key->key_id);
-                            cmd_printf("✓ Key ready. Initiating SST handshake.");
-                            mid_draw_keypanel(&s_key, key_valid, state, UART_DEVICE, (fd >= 0));
-
-                            // Trigger SST 3-way handshake immediately
-                            if (fd >= 0 && state == STATE_IDLE) {
-                                uint32_t hs1_len = 0;
-                                uint8_t *hs1 = parse_handshake_1(&s_key, sst_entity_nonce, &hs1_len);
-                                if (hs1 && hs1_len == SST_HS1_PAYLOAD_SIZE) {
-                                    uint8_t hdr[7] = {
-                                        PREAMBLE_BYTE_1, PREAMBLE_BYTE_2,
-                                        PREAMBLE_BYTE_3, PREAMBLE_BYTE_4,
-                                        MSG_TYPE_SST_HS1,
-                                        (hs1_len >> 8) & 0xFF, hs1_len & 0xFF
-                                    };
-                                    if (write_all(fd, hdr, sizeof(hdr)) >= 0 &&
-                                        write_all(fd, hs1, hs1_len) >= 0) {
-                                        tcdrain(fd);
-                                        state = STATE_WAITING_FOR_SST_HS2;
-                                        clock_gettime(CLOCK_MONOTONIC, &state_deadline);
-                                        state_deadline.tv_sec += 5;
-                                        last_countdown = 5;
-                                        cmd_printf("[SST HS1] Sent. Waiting for HS2...");
-                                    } else {
-                                        cmd_printf("[SST HS1] UART write failed.");
-                                        explicit_bzero(sst_entity_nonce, sizeof(sst_entity_nonce));
-                                    }
-                                    free(hs1);
-                                } else {
-                                    cmd_printf("[SST HS1] parse_handshake_1 failed.");
-                                    free(hs1);
-                                }
-                            }
-                        } else {
-                            cmd_printf("Error: Key ID not found (Local or Auth).");
-                        }
+        // Frames held while the key above was being fetched, routed and
+        // replay-checked like frames straight from the parser. They are
+        // submitted before anything still in the parser. The pool orders
+        // by (salt epoch << 32) | counter and starts a new epoch on every
+        // salt change, so across senders it delivers in submission order:
+        // frames other senders got through during the fetch come out
+        // before these.
+        lifi_frame_t held;
+        while (!decrypt_pool_full(&dpool) && key_fetch_release(&kfetch, &held)) {
+            sender_session_t *hss = sender_table_route(&g_senders, &held);
+            int ret = -1;
+            if (hss && replay_window_seen(&hss->rwin, held.payload)) {
+                log_printf("Nonce replayed! Rejecting message.\n");
+                stats.replay_blocked++;
+                hss->replay_blocked++;
+                continue;
+            }
+            if (hss) {
+                replay_window_add(&hss->rwin, held.payload);
+                hss->frames++;
+                ret = decrypt_pool_submit(&dpool, &held, hss->key.cipher_key);
+                if (ret != 0) hss->decrypt_fail++;
+            }
+            if (ret != 0) {
+                log_printf("Decryption failed: %d\n", ret);
+                stats.decrypt_fail++;
+            }
+        }
 
-                        mid_draw_keypanel(&s_key, key_valid, state, UART_DEVICE, (fd >= 0));
-                        uart_state = 0;
+        // Pull every complete frame out of the buffered bytes. A candidate
+        // that fails LEN, CRC or its deadline is rescanned from the byte after
+        // its preamble, so a real frame hidden inside the rejected bytes
+        // still comes out of a later iteration of this loop. With every
+        // decrypt slot taken, frames wait in the parser until results below
+        // free some.
+        lifi_frame_t frame;
+        frame_result_t fres;
+        while (!decrypt_pool_full(&dpool) &&
+               (fres = frame_parser_next(&fparser, monotonic_ms(), &frame)) != FRAME_NONE) {
+            if (fres == FRAME_DROPPED) {
+                stats.resyncs++;
+                if (frame.error == FRAME_ERR_TYPE) {
+                    // Debug tap: preamble matched (AB CD EF 12) but this
+                    // TYPE byte matches none of the real protocol
+                    // messages. Hex-dump exactly what arrived next to
+                    // the real message types, so a framing/bit-error
+                    // problem is visible instead of just "something
+                    // happened".
+                    stats.bad_preamble++;
+                    // Same style as the Pico's own "raw on" mode:
+                    // 0x%02X '%c' per byte, '.' for non-printable.
+                    char hex[16 * 8 + 1];
+                    size_t hlen = 0;
+                    for (size_t i = 0; i < frame.raw_len && hlen + 8 < sizeof(hex); i++) {
+                        hlen += (size_t)snprintf(hex + hlen, sizeof(hex) - hlen,
+                                                  "%02X'%c' ", frame.raw[i], printable_char(frame.raw[i]));
                     }
-                    else if (byte == MSG_TYPE_SST_HS2) {
-                        stats.total_pkts++;
-                        uint8_t len_bytes[2];
-                        if (read_exact_timeout(fd, len_bytes, 2, 100) != 2) {
-                            log_printf("[SST HS2] Length read timeout\n");
-                            uart_state = 0;
-                            continue;
-                        }
-                        uint16_t hs2_len = ((uint16_t)len_bytes[0] << 8) | len_bytes[1];
-                        if (hs2_len != SST_HS2_PAYLOAD_SIZE) {
-                            log_printf("[SST HS2] Unexpected length: %u\n", hs2_len);
-                            uart_state = 0;
-                            continue;
-                        }
-                        uint8_t hs2_payload[SST_HS2_PAYLOAD_SIZE];
-                        uint8_t crc_rx[2];
-                        if (read_exact_timeout(fd, hs2_payload, hs2_len, 200) != (ssize_t)hs2_len ||
-                            read_exact_timeout(fd, crc_rx, 2, 100) != 2) {
-                            log_printf("[SST HS2] Payload read timeout\n");
-                            uart_state = 0;
-                            continue;
-                        }
-                        uint8_t crc_check[1 + 2 + SST_HS2_PAYLOAD_SIZE];
-                        crc_check[0] = MSG_TYPE_SST_HS2;
-                        crc_check[1] = len_bytes[0];
-                        crc_check[2] = len_bytes[1];
-                        memcpy(&crc_check[3], hs2_payload, hs2_len);
-                        uint16_t computed_crc = crc16_ccitt(crc_check, sizeof(crc_check));
-                        uint16_t received_crc = ((uint16_t)crc_rx[0] << 8) | crc_rx[1];
-                        if (computed_crc != received_crc) {
-                            log_printf("[SST HS2] CRC fail\n");
-                            uart_state = 0;
-                            continue;
-                        }
-                        if (state != STATE_WAITING_FOR_SST_HS2) {
-                            log_printf("[SST HS2] Received but not waiting for HS2\n");
-                            uart_state = 0;
-                            continue;
+                    char dbg_msg[400];
+                    snprintf(dbg_msg, sizeof(dbg_msg),
+                             "[LIFI DEBUG] Unknown TYPE 0x%02X after valid preamble "
+                             "(valid: 0x02/0x12/0x32=ENCRYPTED 0x06/0x16/0x36=FILE 0x07=KEY_ID_ONLY "
+                             "0x09=SST_HS2). Bytes: %s",
+                             frame.type, hex);
+                    reporter_post_status_message(dbg_msg);
+                } else {
+                    stats.total_pkts++;
+                    log_printf("Dropped frame (type 0x%02X, len %u): %s. Rescanning.\n",
+                               frame.type, frame.len, frame_error_str(frame.error));
+                    // The parser hunts for the preamble itself, so a broken
+                    // preamble never surfaces; a frame that got past it and
+                    // was then dropped is the nearest thing to report.
+                    char drop_msg[128];
+                    snprintf(drop_msg, sizeof(drop_msg),
+                             "[LIFI] Frame dropped after preamble (TYPE 0x%02X, LEN %u): %s",
+                             frame.type, frame.len, frame_error_str(frame.error));
+                    reporter_post_status_message(drop_msg);
+                    if (frame.error == FRAME_ERR_CRC &&
+                        (frame.type == MSG_TYPE_ENCRYPTED || frame.type == MSG_TYPE_FILE)) {
+                        log_printf("CRC16 mismatch! computed=0x%04X received=0x%04X\n",
+                                   frame.crc_calc, frame.crc_rx);
+
+                        // Dump failed packet to debug log for analysis
+                        FILE *f = fopen("receiver_debug.log", "a");
+                        if (f) {
+                            fprintf(f, "CRC FAIL: Comp:0x%04X Recv:0x%04X Len:%u\nPayload: ",
+                                    frame.crc_calc, frame.crc_rx, frame.len);
+                            for (size_t i = 0; i + CRC16_SIZE < frame.raw_len; i++) fprintf(f, "%02X ", frame.raw[i]);
+                            fprintf(f, "\n");
+                            fclose(f);
                         }
+                        stats.decrypt_fail++;
+                    }
+                }
+                continue;
+            }
 
-                        uint32_t hs3_len = 0;
-                        uint8_t *hs3 = check_handshake_2_send_handshake_3(
-                            hs2_payload, hs2_len, sst_entity_nonce, &s_key, &hs3_len);
-
-                        if (hs3 != NULL) {
-                            cmd_printf("✓ SST HS2 VERIFIED: Pico holds SST key. Sending HS3.");
-                            if (hs3_len == SST_HS3_PAYLOAD_SIZE) {
-                                uint8_t hdr3[7] = {
-                                    PREAMBLE_BYTE_1, PREAMBLE_BYTE_2,
-                                    PREAMBLE_BYTE_3, PREAMBLE_BYTE_4,
-                                    MSG_TYPE_SST_HS3,
-                                    (hs3_len >> 8) & 0xFF, hs3_len & 0xFF
-                                };
-                                write_all(fd, hdr3, sizeof(hdr3));
-                                write_all(fd, hs3, hs3_len);
-                                tcdrain(fd);
-                            } else {
-                                cmd_printf("✗ Unexpected HS3 length %u.", hs3_len);
-                            }
-                            free(hs3);
-                        } else {
-                            cmd_printf("✗ SST HS FAILED: Nonce mismatch – possible replay or wrong key.");
-                        }
+            if (frame.type == MSG_TYPE_KEY_ID_ONLY) {
+                stats.total_pkts++;
 
-                        explicit_bzero(sst_entity_nonce, sizeof(sst_entity_nonce));
-                        state = STATE_IDLE;
-                        state_deadline = (struct timespec){0, 0};
-                        mid_draw_keypanel(&s_key, key_valid, state, UART_DEVICE, (fd >= 0));
-                        uart_state = 0;
+                uint16_t payload_len = frame.len;
+                const uint8_t *payload = frame.payload;
+
+                log_printf("[KEY ID] Received: ");
+                for(int i=0; i<payload_len; i++) {
+                    // Using private internal method of log_printf to stay on same line? 
+                    // iterating log_printf calls creates newlines usually.
+                    // Let's just format it into a string first.
+                }
+                char hex_str[3 * payload_len + 1];
+                hex_str[0] = '\0';
+                for(int i=0; i<payload_len; i++) {
+                    char tmp[5];
+                    snprintf(tmp, sizeof(tmp), "%02X ", payload[i]);
+                    strcat(hex_str, tmp);
+                }
+                log_printf("[KEY ID] Peer ID: %s", hex_str);
+
+                // --- AUTO-CONNECT LOGIC ---
+                // 1. Store the ID
+                memcpy(last_lifi_id, payload, SESSION_KEY_ID_SIZE);
+                lifi_id_seen = true;
+
+                unsigned int native_id = convert_skid_buf_to_int(last_lifi_id, SESSION_KEY_ID_SIZE);
+                cmd_printf("[NATIVE] Received ID: %u", native_id);
+
+                cmd_printf("Looking for Key ID...");
+                char debug_key_id[3 * SESSION_KEY_ID_SIZE + 1];
+                debug_key_id[0] = '\0';
+                for (int i = 0; i < SESSION_KEY_ID_SIZE; i++) {
+                    char buf[4];
+                    snprintf(buf, sizeof(buf), "%02X ", last_lifi_id[i]);
+                    strcat(debug_key_id, buf);
+                }
+                cmd_printf("Passing ID to SST: %s", debug_key_id);
+
+                // 2. Key cache first. Otherwise Auth is asked on the key
+                // fetch worker, and encrypted frames are held until the
+                // answer is in, so the UART keeps draining meanwhile.
+                session_key_t cached;
+                if (key_cache_get(&key_cache, last_lifi_id, &cached)) {
+                    if (adopt_sender_key(fd, &g_senders, &cached, state == STATE_IDLE,
+                                         &s_key, &key_valid))
+                        last_countdown = 5;
+                    explicit_bzero(&cached, sizeof(cached));
+                } else {
+                    int rq = key_fetch_request_id(&kfetch, last_lifi_id, false);
+                    if (rq == 0)
+                        cmd_printf("Not cached. Asking Auth; holding frames until it answers.");
+                    else if (rq < 0)
+                        cmd_printf("Error: Auth is still fetching another key ID. Ignoring.");
+                }
+
+                mid_draw_keypanel(&s_key, key_valid, state, UART_DEVICE, (fd >= 0));
+            }
+            else if (frame.type == MSG_TYPE_SST_HS2) {
+                stats.total_pkts++;
+                uint16_t hs2_len = frame.len;
+                uint8_t hs2_payload[SST_HS2_PAYLOAD_SIZE];
+
+                // HS2 names no key: it answers whichever waiting sender's
+                // key and entity nonce it verifies under
+                uint32_t hs3_len = 0;
+                uint8_t *hs3 = NULL;
+                sender_session_t *hs_ss = NULL;
+                int waiting = 0;
+                for (int i = 0; i < SENDER_TABLE_MAX && !hs3; i++) {
+                    sender_session_t *ss = &g_senders.s[i];
+                    if (!ss->used || ss->hs_state != STATE_WAITING_FOR_SST_HS2) continue;
+                    waiting++;
+                    hs_ss = ss;
+                    memcpy(hs2_payload, frame.payload, hs2_len);
+                    hs3 = check_handshake_2_send_handshake_3(
+                        hs2_payload, hs2_len, ss->entity_nonce, &ss->key, &hs3_len);
+                }
+                if (waiting == 0) {
+                    log_printf("[SST HS2] Received but not waiting for HS2\n");
+                    continue;
+                }
+
+                if (hs3 != NULL) {
+                    cmd_printf("✓ SST HS2 VERIFIED: Pico holds SST key. Sending HS3.");
+                    if (hs3_len == SST_HS3_PAYLOAD_SIZE) {
+                        uint8_t hdr3[7] = {
+                            PREAMBLE_BYTE_1, PREAMBLE_BYTE_2,
+                            PREAMBLE_BYTE_3, PREAMBLE_BYTE_4,
+                            MSG_TYPE_SST_HS3,
+                            (hs3_len >> 8) & 0xFF, hs3_len & 0xFF
+                        };
+                        write_all(fd, hdr3, sizeof(hdr3));
+                        write_all(fd, hs3, hs3_len);
+                        tcdrain(fd);
+                    } else {
+                        cmd_printf("✗ Unexpected HS3 length %u.", hs3_len);
                     }
-                    else if (byte == MSG_TYPE_ENCRYPTED || byte == MSG_TYPE_FILE) {
-                        uint8_t packet_type = byte; 
-                        stats.total_pkts++;
-                        
-                        // Read length (2 bytes)
-                        uint8_t len_bytes[2];
-                        if (read_exact_timeout(fd, len_bytes, 2, 100) != 2) {
-                            log_printf("Failed to read length\n");
-                            uart_state = 0;
-                            continue;
-                        }
-                        
-                        // Length = NONCE + CIPHERTEXT + TAG
-                        uint16_t payload_len = ((uint16_t)len_bytes[0] << 8) | len_bytes[1];
-                        if (payload_len < NONCE_SIZE + TAG_SIZE || payload_len > MAX_MSG_LEN) {
-                            log_printf("Invalid payload length: %u bytes\n", payload_len);
-                            uart_state = 0;
-                            continue;
-                        }
-                        
-                        // Calculate ciphertext length
-                        uint16_t ctext_len = payload_len - NONCE_SIZE - TAG_SIZE;
-                        
-                        uint8_t nonce[NONCE_SIZE];
-                        uint8_t ciphertext[ctext_len];
-                        uint8_t tag[TAG_SIZE];
-                        uint8_t crc_bytes[2];
-                        
-                        // Read all payload components with timeout (give enough time for full payload)
-                        int chunk_timeout = 200; // ms
-                        ssize_t nonce_read = read_exact_timeout(fd, nonce, NONCE_SIZE, chunk_timeout);
-                        ssize_t cipher_read = read_exact_timeout(fd, ciphertext, ctext_len, chunk_timeout + (ctext_len/10)); // Scaling timeout for size
-                        ssize_t tag_read = read_exact_timeout(fd, tag, TAG_SIZE, chunk_timeout);
-                        ssize_t crc_read = read_exact_timeout(fd, crc_bytes, 2, chunk_timeout);
-                        
-                        if (nonce_read != NONCE_SIZE || cipher_read != (ssize_t)ctext_len ||
-                            tag_read != TAG_SIZE || crc_read != 2) {
-                            log_printf("Read fail: nonce=%zd/%d, cipher=%zd/%u, tag=%zd/%d, crc=%zd/2\n",
-                                       nonce_read, NONCE_SIZE, cipher_read, ctext_len, 
-                                       tag_read, TAG_SIZE, crc_read);
-                            uart_state = 0;
-                            continue;
-                        }
-                                                
-                        // Validate CRC16
-                        uint8_t crc_buf[1 + 2 + NONCE_SIZE + MAX_MSG_LEN + TAG_SIZE];
-                        size_t crc_idx = 0;
-                        crc_buf[crc_idx++] = packet_type;
-                        crc_buf[crc_idx++] = len_bytes[0];
-                        crc_buf[crc_idx++] = len_bytes[1];
-                        memcpy(&crc_buf[crc_idx], nonce, NONCE_SIZE); crc_idx += NONCE_SIZE;
-                        memcpy(&crc_buf[crc_idx], ciphertext, ctext_len); crc_idx += ctext_len;
-                        memcpy(&crc_buf[crc_idx], tag, TAG_SIZE); crc_idx += TAG_SIZE;
-                        
-                        uint16_t computed_crc = crc16_ccitt(crc_buf, crc_idx);
-                        uint16_t received_crc = ((uint16_t)crc_bytes[0] << 8) | crc_bytes[1];
-                        
-                        if (computed_crc != received_crc) {
-                            log_printf("CRC16 mismatch! computed=0x%04X received=0x%04X\n", 
-                                       computed_crc, received_crc);
-                            
-                            // Dump failed packet to debug log for analysis
-                            FILE *f = fopen("receiver_debug.log", "a");
-                            if (f) {
-                                fprintf(f, "CRC FAIL: Comp:0x%04X Recv:0x%04X Len:%u\nPayload: ", 
-                                        computed_crc, received_crc, payload_len);
-                                for(size_t i=0; i<crc_idx; i++) fprintf(f, "%02X ", crc_buf[i]);
-                                fprintf(f, "\n");
-                                fclose(f);
-                            }
-                            
+                    free(hs3);
+                } else {
+                    cmd_printf("✗ SST HS FAILED: Nonce mismatch – possible replay or wrong key.");
+                    // With several senders waiting, the others may still answer
+                    if (waiting > 1) hs_ss = NULL;
+                }
+
+                if (hs_ss) {
+                    explicit_bzero(hs_ss->entity_nonce, sizeof(hs_ss->entity_nonce));
+                    hs_ss->hs_state = STATE_IDLE;
+                }
+                mid_draw_keypanel(&s_key, key_valid, state, UART_DEVICE, (fd >= 0));
+            }
+            else if (MSG_TYPE_IS_AEAD(frame.type)) {
+                stats.total_pkts++;
+
+                // Length = NONCE + CIPHERTEXT + TAG, already bounds-checked by
+                // the frame parser (and CRC-verified for version 1 types).
+                const uint8_t *nonce = frame.payload;
+
+                // A sender already known by its nonce salt keeps flowing
+                // while another sender's key is fetched
+                sender_session_t *ss = sender_table_find_salt(&g_senders, nonce);
+                if (!ss) {
+                    // Probably sealed under the key Auth is still fetching
+                    if (key_fetch_holding(&kfetch)) {
+                        if (key_fetch_hold(&kfetch, &frame) != 0) {
+                            log_printf("Too many frames held for a key fetch. Dropping message.\n");
                             stats.decrypt_fail++;
-                            uart_state = 0;
-                            continue;
-                        }
-                        
-                        // --- Nonce Replay Check ---
-                        if (replay_window_seen(&rwin, nonce)) {
-                            log_printf("Nonce replayed! Rejecting message.\\n");
-                            stats.replay_blocked++;
-                            uart_state = 0;
-                            continue;
-                        }
-                        replay_window_add(&rwin, nonce);
-                        
-                        uint8_t decrypted[ctext_len + 1];  // for null-terminator
-
-                        if (!key_valid) {  // Skip decryption if key was
-                                           // cleared and not yet rotated
-                            log_printf(
-                                "No valid session key. Rejecting encrypted "
-                                "message.\\n");
-                            uart_state = 0;
-                            continue;
                         }
+                        continue;
+                    }
 
-                        int ret = sst_decrypt_gcm(s_key.cipher_key, nonce,
-                                                  ciphertext, ctext_len, tag,
-                                                  decrypted);
-
-                        if (ret == 0) {  // Successful decryption
-                            decrypted[ctext_len] = '\0';  // Null-terminate
-
-                                // Handle File Transfer
-                                if (packet_type == MSG_TYPE_FILE) {
-                                    log_printf("[FILE] Rx Compressed: %u bytes. Expanding...\n", ctext_len);
-                                    
-                                    heatshrink_decoder *hsd = heatshrink_decoder_alloc(512, 8, 4);
-                                    if (hsd) {
-                                        size_t total_sunk = 0;
-                                        size_t total_decomp = 0;
-                                        static uint8_t decompressed[32768]; 
-                                        
-                                        // Loop until all input is sunk
-                                        while (total_sunk < ctext_len) {
-                                            size_t sunk = 0;
-                                            HSD_sink_res sres = heatshrink_decoder_sink(hsd, &decrypted[total_sunk], 
-                                                                                      ctext_len - total_sunk, &sunk);
-                                            total_sunk += sunk;
-                                            
-                                            // Poll immediately after sinking some data
-                                            HSD_poll_res pres;
-                                            do {
-                                                size_t p = 0;
-                                                pres = heatshrink_decoder_poll(hsd, &decompressed[total_decomp], 
-                                                                               sizeof(decompressed) - total_decomp, &p);
-                                                total_decomp += p;
-                                            } while (pres == HSDR_POLL_MORE && total_decomp < sizeof(decompressed));
-                                            
-                                            if (sres < 0) {
-                                                log_printf("[Error] Sink failed err=%d\n", sres);
-                                                break;
-                                            }
-                                        }
-                                        
-                                        // Finish and flush remaining
-                                        heatshrink_decoder_finish(hsd);
-                                        HSD_poll_res pres;
-                                        do {
-                                            size_t p = 0;
-                                            pres = heatshrink_decoder_poll(hsd, &decompressed[total_decomp], 
-                                                                           sizeof(decompressed) - total_decomp, &p);
-                                            total_decomp += p;
-                                        } while (pres == HSDR_POLL_MORE && total_decomp < sizeof(decompressed));
-                                        
-                                        heatshrink_decoder_free(hsd);
-                                        
-                                        // Null terminate
-                                        if (total_decomp < sizeof(decompressed)) {
-                                            decompressed[total_decomp] = '\0';
-                                        } else {
-                                            decompressed[sizeof(decompressed)-1] = '\0';
-                                        }
-                                        
-                                        log_printf("[FILE] Result: %zu -> %zu bytes\n", ctext_len, total_decomp);
-                                        // log_printf("[FILE] Data:\n%s\n", decompressed); // removing huge spam
-                                        
-                                        // Write to file
-                                        FILE *f_out = fopen("received_file.txt", "a");
-                                        if (f_out) {
-                                            if (total_decomp > 0) {
-                                                fwrite(decompressed, 1, total_decomp, f_out);
-                                                fprintf(f_out, "\n");
-                                            }
-                                            fclose(f_out);
-                                            log_printf("[FILE] Saved to received_file.txt\n");
-                                        }
-                                        
-                                        // If small enough, print some head/tail
-                                        if (total_decomp > 0 && total_decomp < 500) {
-                                            log_printf("Content:\n%s", decompressed);
-                                        } else if (total_decomp >= 500) {
-                                            log_printf("Content (Head 100):\n%.100s...\n", decompressed);
-                                        }
-
-                                    } else {
-                                        log_printf("[FILE] Decompression alloc failed.\n");
-                                    }
-                                } 
-                                // Handle Normal Chat / Commands
-                                else {
-                                    log_printf("%s\n", decrypted);
-
-                                    // ... Other commands ...
-                                    if (strcmp((char*)decrypted, "I have the key") == 0) {
-                                         log_printf("Pico has confirmed receiving the key.\n");
-                                    }
-                                    
-                                    // Handle "new key -f" (Force Update)
-                                    else if (strcmp((char*)decrypted, "new key -f") == 0) {
-                                        cmd_printf("Received 'new key -f' command. Requesting new key...\n");
-
-                                        free_session_key_list_t(key_list);
-                                        key_list = get_session_key(sst, init_empty_session_key_list());
-                                        
-                                        if (!key_list || key_list->num_key == 0) {
-                                            cmd_printf("Failed to fetch new session key.\n");
-                                        } else {
-                                            memcpy(pending_key, key_list->s_key[0].cipher_key, SESSION_KEY_SIZE);
-                                            stats.keys_consumed++;
-                                            cmd_hex("New Session Key (pending ACK): ", pending_key, SESSION_KEY_SIZE);
-                                            key_valid = true;
-
-                                            // Send using MSG_TYPE_KEY with MAC
-                                            uint16_t klen = SESSION_KEY_ID_SIZE + SST_KEY_SIZE + 32;
-                                            uint8_t hdr[] = {
-                                                PREAMBLE_BYTE_1, PREAMBLE_BYTE_2, PREAMBLE_BYTE_3, PREAMBLE_BYTE_4,
-                                                MSG_TYPE_KEY,
-                                                (klen >> 8) & 0xFF,
-                                                klen & 0xFF
-                                            };
-                                            write_all(fd, hdr, sizeof(hdr));
-                                            write_all(fd, key_list->s_key[0].key_id, SESSION_KEY_ID_SIZE);
-                                            write_all(fd, pending_key, SST_KEY_SIZE);
-                                            usleep(5000); // Delay for MAC key
-                                            // Assume we can get Mac Key from list too
-                                            write_all(fd, key_list->s_key[0].mac_key, 32);
-                                            
-                                            log_printf("[DEBUG] Sent Cipher: %02X %02X... MAC: %02X %02X...\n", 
-                                                pending_key[0], pending_key[1], 
-                                                key_list->s_key[0].mac_key[0], key_list->s_key[0].mac_key[1]);
-                                            
-                                            // 5ms sleep to let transmission complete
-                                            usleep(5000);  
-                                            
-                                            cmd_printf("Sent new session key to Pico. Waiting 5s for ACK...\n");
-                                            state = STATE_WAITING_FOR_ACK;
-                                            clock_gettime(CLOCK_MONOTONIC, &state_deadline);
-                                            state_deadline.tv_sec += 5;
-                                        }
-                                    }
-                                    
-                                    // Handle "new key" (Rate Limited Request)
-                                    else if (strcmp((char*)decrypted, "new key") == 0) {
-                                        time_t now = time(NULL);    
-                                        if (now - last_key_req_time < KEY_UPDATE_COOLDOWN_S) {
-                                            cmd_printf("Rate limit: another new key request too soon. Ignoring.\n");
-                                        } else {
-                                            last_key_req_time = now;
-                                            cmd_printf("Received 'new key' command. Waiting 5s for 'yes' confirmation...\n");
-                                            state = STATE_WAITING_FOR_YES;
-                                            clock_gettime(CLOCK_MONOTONIC, &state_deadline);
-                                            state_deadline.tv_sec += 5;
-                                        }
-                                    }
-                                    
-                                    // Handle key confirmation ACK
-                                    else if (state == STATE_WAITING_FOR_ACK && strcmp((char*)decrypted, "ACK") == 0) {
-                                        cmd_printf("ACK received. Finalizing key update.\n");
-                                        memcpy(s_key.cipher_key, pending_key, SESSION_KEY_SIZE);
-                                        // Also copy ID if we tracked pending ID, but for now assuming list[0] is source of truth
-                                        if (key_list && key_list->num_key > 0) {
-                                            memcpy(s_key.key_id, key_list->s_key[0].key_id, SESSION_KEY_ID_SIZE);
-                                        }
-                                        
-                                        explicit_bzero(pending_key, sizeof(pending_key));
-                                        cmd_hex("New key is now active: ", s_key.cipher_key, SESSION_KEY_SIZE);
-                                        
-                                        state = STATE_IDLE;
-                                        mid_draw_keypanel(&s_key, key_valid, state, UART_DEVICE, (fd >= 0));
-                                    }
-
-                                    // Handle "verify key" command - initiate SST handshake
-                                    else if (strcmp((char*)decrypted, "verify key") == 0) {
-                                        cmd_printf("Initiating SST handshake to verify Pico holds SST key...\n");
-                                        if (fd >= 0 && key_valid && state == STATE_IDLE) {
-                                            uint32_t hs1_len = 0;
-                                            uint8_t *hs1 = parse_handshake_1(&s_key, sst_entity_nonce, &hs1_len);
-                                            if (hs1 && hs1_len == SST_HS1_PAYLOAD_SIZE) {
-                                                uint8_t hdr[7] = {
-                                                    PREAMBLE_BYTE_1, PREAMBLE_BYTE_2,
-                                                    PREAMBLE_BYTE_3, PREAMBLE_BYTE_4,
-                                                    MSG_TYPE_SST_HS1,
-                                                    (hs1_len >> 8) & 0xFF, hs1_len & 0xFF
-                                                };
-                                                if (write_all(fd, hdr, sizeof(hdr)) >= 0 &&
-                                                    write_all(fd, hs1, hs1_len) >= 0) {
-                                                    tcdrain(fd);
-                                                    state = STATE_WAITING_FOR_SST_HS2;
-                                                    clock_gettime(CLOCK_MONOTONIC, &state_deadline);
-                                                    state_deadline.tv_sec += 5;
-                                                    last_countdown = 5;
-                                                    cmd_printf("[SST HS1] Sent. Waiting for HS2...");
-                                                } else {
-                                                    cmd_printf("[SST HS1] UART write failed.");
-                                                    explicit_bzero(sst_entity_nonce, sizeof(sst_entity_nonce));
-                                                }
-                                            } else {
-                                                cmd_printf("[SST HS1] parse_handshake_1 failed.");
-                                            }
-                                            free(hs1);
-                                        }
-                                    }
-                                }
-                                
-                                stats.decrypt_success++;
-                                reporter_signal(s_key.key_id, decrypted,
-                                                ctext_len, &stats,
-                                                ciphertext, ctext_len);
+                    if (!key_valid && sender_table_count(&g_senders) == 0) {
+                        // Skip decryption if key was cleared and not yet rotated
+                        log_printf(
+                            "No valid session key. Rejecting encrypted "
+                            "message.\\n");
+                        continue;
+                    }
 
-                            } else {
-                                // AES-GCM decryption failed
-                                log_printf("Decryption failed: %d\n", ret);
-                                stats.decrypt_fail++;
-                            }
+                    // A new salt: a sender rebooted or changed keys. The
+                    // key set with the shortcuts counts as a sender too.
+                    if (key_valid) sender_table_add(&g_senders, &s_key);
+                    ss = sender_table_route(&g_senders, &frame);
+                    if (!ss) {
+                        log_printf("No sender session accepts this message (unknown key or old salt).\n");
+                        stats.decrypt_fail++;
+                        if (MSG_TYPE_HAS_AAD(frame.type)) frame_parser_reject(&fparser);
+                        continue;
+                    }
+                }
 
-                        uart_state = 0;  // Reset uart_state machine
+                // --- Nonce Replay Check (per sender) ---
+                if (replay_window_seen(&ss->rwin, nonce)) {
+                    log_printf("Nonce replayed! Rejecting message.\\n");
+                    stats.replay_blocked++;
+                    ss->replay_blocked++;
+                    continue;
+                }
+                replay_window_add(&ss->rwin, nonce);
+                ss->frames++;
+
+                // Handed to the decrypt workers with the sender's key, or
+                // with -j 0 decrypted right here (mostly already done by
+                // decrypt_pool_poll() while the frame arrived). Either way
+                // the plaintext comes out of decrypt_pool_next() below.
+                int ret = decrypt_pool_submit(&dpool, &frame, ss->key.cipher_key);
+                if (ret != 0) {
+                    // AES-GCM decryption failed
+                    log_printf("Decryption failed: %d\n", ret);
+                    stats.decrypt_fail++;
+                    ss->decrypt_fail++;
+                    // No CRC vouched for a V2 frame's LEN; rescan
+                    // its bytes in case a real frame hides inside
+                    if (MSG_TYPE_HAS_AAD(frame.type)) frame_parser_reject(&fparser);
+                }
+            }
+        }
+
+        // Start on the ciphertext of a frame that is still arriving, with
+        // the key of the sender it comes from
+        decrypt_pool_poll(&dpool, &fparser,
+                          (key_valid && !key_fetch_holding(&kfetch))
+                              ? pending_frame_key(&fparser, &g_senders, &s_key) : NULL);
+
+        // Decrypted frames, in nonce counter order. Workers may finish out
+        // of order; decrypt_pool_next() holds a frame back until every
+        // earlier one submitted has been handed out.
+        decrypt_result_t res;
+        while (decrypt_pool_next(&dpool, &res)) {
+            uint8_t packet_type = res.type;
+            uint16_t ctext_len = (uint16_t)res.ctext_len;
+            // The sender it came from (NULL if evicted since)
+            sender_session_t *rss = sender_table_find_salt(&g_senders, res.nonce);
+            if (res.ret == DECRYPT_POOL_EXPAND_FAILED) {
+                // Authentic, but it doesn't expand into
+                // DECRYPT_POOL_EXPAND_MAX; nothing is written
+                log_printf("[FILE] Decompression failed (corrupt or over %d bytes); dropped.\n",
+                           DECRYPT_POOL_EXPAND_MAX);
+                stats.decrypt_fail++;
+                if (rss) rss->decrypt_fail++;
+                continue;
+            }
+            if (res.ret != 0) {
+                // A worker's tag check failed. The parser is past these
+                // bytes by now, so unlike -j 0 there is no rescan.
+                log_printf("Decryption failed: %d\n", res.ret);
+                stats.decrypt_fail++;
+                if (rss) rss->decrypt_fail++;
+                continue;
+            }
+            if (rss) rss->decrypt_ok++;
+            uint8_t *decrypted = res.plain;  // null-terminated
+
+            // Handle File Transfer (expanded by the pool)
+            if (MSG_TYPE_IS_FILE(packet_type)) {
+                const char *decompressed = (const char *)res.expanded;
+                size_t total_decomp = res.expanded_len;
+                log_printf("[FILE] Result: %u -> %zu bytes\n", ctext_len, total_decomp);
+
+                // Write to file
+                FILE *f_out = fopen("received_file.txt", "a");
+                if (f_out) {
+                    if (total_decomp > 0) {
+                        fwrite(decompressed, 1, total_decomp, f_out);
+                        fprintf(f_out, "\n");
                     }
-                    else {
-                        // Debug tap: preamble matched (AB CD EF 12) but this
-                        // TYPE byte matches none of the real protocol
-                        // messages. Hex-dump exactly what arrived next to
-                        // the real message types, so a framing/bit-error
-                        // problem is visible instead of just "something
-                        // happened".
-                        uint8_t dbg[16];
-                        size_t dlen = 0;
-                        dbg[dlen++] = byte;
-                        while (dlen < sizeof(dbg) &&
-                               read_exact_timeout(fd, &dbg[dlen], 1, 20) == 1) {
-                            dlen++;
-                        }
-                        // Same style as the Pico's own "raw on" mode:
-                        // 0x%02X '%c' per byte, '.' for non-printable.
-                        char hex[sizeof(dbg) * 8 + 1];
-                        size_t hlen = 0;
-                        for (size_t i = 0; i < dlen && hlen + 8 < sizeof(hex); i++) {
-                            hlen += (size_t)snprintf(hex + hlen, sizeof(hex) - hlen,
-                                                      "%02X'%c' ", dbg[i], printable_char(dbg[i]));
-                        }
-                        char dbg_msg[400];
-                        snprintf(dbg_msg, sizeof(dbg_msg),
-                                 "[LIFI DEBUG] Unknown TYPE 0x%02X after valid preamble "
-                                 "(valid: 0x02=ENCRYPTED 0x06=FILE 0x07=KEY_ID_ONLY "
-                                 "0x09=SST_HS2). Bytes: %s",
-                                 byte, hex);
-                        reporter_post_status_message(dbg_msg);
-                        uart_state = 0;
+                    fclose(f_out);
+                    log_printf("[FILE] Saved to received_file.txt\n");
+                }
+
+                // If small enough, print some head/tail
+                if (total_decomp > 0 && total_decomp < 500) {
+                    log_printf("Content:\n%s", decompressed);
+                } else if (total_decomp >= 500) {
+                    log_printf("Content (Head 100):\n%.100s...\n", decompressed);
+                }
+            }
+            // Handle Normal Chat / Commands
+            else {
+                log_printf("%s\n", decrypted);
+
+                // ... Other commands ...
+                if (strcmp((char*)decrypted, "I have the key") == 0) {
+                     log_printf("Pico has confirmed receiving the key.\n");
+                }
+
+                // Handle "new key -f" (Force Update)
+                else if (strcmp((char*)decrypted, "new key -f") == 0) {
+                    cmd_printf("Received 'new key -f' command. Requesting new key...\n");
+                    if (key_fetch_request_new(&kfetch) != 0)
+                        cmd_printf("A new key is already being fetched.\n");
+                }
+
+                // Handle "new key" (Rate Limited Request)
+                else if (strcmp((char*)decrypted, "new key") == 0) {
+                    time_t now = time(NULL);    
+                    if (now - last_key_req_time < KEY_UPDATE_COOLDOWN_S) {
+                        cmd_printf("Rate limit: another new key request too soon. Ignoring.\n");
+                    } else {
+                        last_key_req_time = now;
+                        cmd_printf("Received 'new key' command. Waiting 5s for 'yes' confirmation...\n");
+                        state = STATE_WAITING_FOR_YES;
+                        clock_gettime(CLOCK_MONOTONIC, &state_deadline);
+                        state_deadline.tv_sec += 5;
                     }
-                    break;
-                default:
-                    uart_state = 0;
+                }
+
+                // Handle key confirmation ACK
+                else if (state == STATE_WAITING_FOR_ACK && strcmp((char*)decrypted, "ACK") == 0) {
+                    cmd_printf("ACK received. Finalizing key update.\n");
+                    // The whole key: the reporter HMAC and SST handshakes
+                    // need its mac_key, not the old one
+                    s_key = pending_s_key;
+                    explicit_bzero(&pending_s_key, sizeof(pending_s_key));
+                    pthread_mutex_lock(&g_rep_mutex);
+                    set_rep_mac_key(s_key.mac_key);
+                    g_rep_key_valid = true;
+                    set_current_key_id(s_key.key_id);
+                    pthread_mutex_unlock(&g_rep_mutex);
+                    sender_table_add(&g_senders, &s_key);
+                    cmd_hex("New key is now active: ", s_key.cipher_key, SESSION_KEY_SIZE);
+
+                    state = STATE_IDLE;
+                    mid_draw_keypanel(&s_key, key_valid, state, UART_DEVICE, (fd >= 0));
+                }
+
+                // Handle "verify key" command - initiate SST handshake
+                else if (strcmp((char*)decrypted, "verify key") == 0) {
+                    cmd_printf("Initiating SST handshake to verify Pico holds SST key...\n");
+                    // With the key of the sender that asked
+                    if (fd >= 0 && rss && state == STATE_IDLE &&
+                        rss->hs_state == STATE_IDLE && send_hs1(fd, rss))
+                        last_countdown = 5;
+                }
             }
+
+            stats.decrypt_success++;
+            reporter_signal(rss ? rss->key.key_id : s_key.key_id, decrypted,
+                            ctext_len, &stats,
+                            res.ciphertext, ctext_len);
+        }
+
+        if (!rx_any) {
+            // Sleep until a worker finishes instead of a fixed 1ms tick
+            if (decrypt_pool_pending(&dpool) > 0) decrypt_pool_wait(&dpool, 1);
+            else usleep(1000); // 1ms
         }
-        usleep(1000); // 1ms
     }
 
+    key_fetch_stop(&kfetch);
+    decrypt_pool_stop(&dpool);
     close(fd);
+    key_cache_clear(&key_cache);
+    sender_table_free(&g_senders);
     free_session_key_list_t(key_list);
     free_SST_ctx_t(sst);
     return 0;
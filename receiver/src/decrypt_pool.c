@@ -0,0 +1,303 @@
+// src/decrypt_pool.c
+#include "decrypt_pool.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "heatshrink_decoder.h"
+
+#define SALT_SIZE (NONCE_SIZE - 4)
+
+static uint64_t nonce_order(decrypt_pool_t *p, const uint8_t *nonce) {
+    if (!p->have_salt || memcmp(p->last_salt, nonce, SALT_SIZE) != 0) {
+        if (p->have_salt) p->epoch++;
+        memcpy(p->last_salt, nonce, SALT_SIZE);
+        p->have_salt = true;
+    }
+    const uint8_t *c = nonce + SALT_SIZE;
+    uint32_t ctr = ((uint32_t)c[0] << 24) | ((uint32_t)c[1] << 16) |
+                   ((uint32_t)c[2] << 8) | c[3];
+    return ((uint64_t)p->epoch << 32) | ctr;
+}
+
+// Same decoder parameters as the sender's encoder (window 8, lookahead 4).
+// The decoder stops taking input once `out` is full, so a file that fills
+// it is refused rather than truncated.
+//
+// @param out_len Expanded length
+// @return 0 on success, -1 if the file is corrupt or too large
+static int expand(const uint8_t *in, size_t in_len, uint8_t *out,
+                  size_t cap, size_t *out_len) {
+    heatshrink_decoder *hsd = heatshrink_decoder_alloc(512, 8, 4);
+    if (!hsd) return -1;
+
+    int ret = -1;
+    size_t sunk_total = 0, out_total = 0;
+    while (sunk_total < in_len) {
+        if (out_total == cap) goto out;
+        size_t sunk = 0;
+        if (heatshrink_decoder_sink(hsd, (uint8_t *)&in[sunk_total],
+                                    in_len - sunk_total, &sunk) < 0 ||
+            sunk == 0)
+            goto out;
+        sunk_total += sunk;
+        HSD_poll_res pres;
+        do {
+            size_t n = 0;
+            pres = heatshrink_decoder_poll(hsd, &out[out_total],
+                                           cap - out_total, &n);
+            out_total += n;
+        } while (pres == HSDR_POLL_MORE && out_total < cap);
+    }
+    heatshrink_decoder_finish(hsd);
+    HSD_poll_res pres;
+    do {
+        size_t n = 0;
+        pres = heatshrink_decoder_poll(hsd, &out[out_total], cap - out_total, &n);
+        out_total += n;
+    } while (pres == HSDR_POLL_MORE && out_total < cap);
+    if (pres != HSDR_POLL_EMPTY) goto out;
+    *out_len = out_total;
+    ret = 0;
+
+out:
+    heatshrink_decoder_free(hsd);
+    return ret;
+}
+
+// Post-decrypt work shared by both modes: NUL-terminate, expand FILE frames.
+static void finish_job(decrypt_job_t *j) {
+    size_t ctext_len = (size_t)j->len - NONCE_SIZE - TAG_SIZE;
+    j->plain[ctext_len] = '\0';
+    j->expanded_len = 0;
+    if (MSG_TYPE_IS_FILE(j->type) &&
+        expand(j->plain, ctext_len, j->expanded, DECRYPT_POOL_EXPAND_MAX,
+               &j->expanded_len) != 0) {
+        j->expanded_len = 0;
+        j->ret = DECRYPT_POOL_EXPAND_FAILED;
+    }
+    j->expanded[j->expanded_len] = '\0';
+}
+
+static void run_job(decrypt_job_t *j) {
+    size_t ctext_len = (size_t)j->len - NONCE_SIZE - TAG_SIZE;
+    const uint8_t *nonce = j->raw + FRAME_HDR_SIZE;
+    const uint8_t *ciphertext = nonce + NONCE_SIZE;
+    size_t aad_len = MSG_TYPE_HAS_AAD(j->type) ? FRAME_HDR_SIZE : 0;
+    if (MSG_TYPE_IS_CHACHA(j->type)) {
+        uint8_t cc_key[SST_CHACHAPOLY_KEY_SIZE];
+        j->ret = sst_chachapoly_derive_key(j->key, cc_key);
+        if (j->ret == 0)
+            j->ret = sst_decrypt_chachapoly(cc_key, nonce, j->raw, aad_len,
+                                            ciphertext, ctext_len,
+                                            ciphertext + ctext_len, j->plain);
+        explicit_bzero(cc_key, sizeof(cc_key));
+    } else {
+        j->ret = sst_decrypt_gcm_aad(j->key, nonce, j->raw, aad_len, ciphertext,
+                                     ctext_len, ciphertext + ctext_len, j->plain);
+    }
+    if (j->ret == 0) finish_job(j);
+}
+
+// Lowest-order job still owned by the pool (queued, busy or done), or
+// only the queued ones. Caller holds the mutex.
+static decrypt_job_t *lowest(decrypt_pool_t *p, bool queued_only) {
+    decrypt_job_t *best = NULL;
+    for (int i = 0; i < DECRYPT_POOL_DEPTH; i++) {
+        decrypt_job_t *j = &p->jobs[i];
+        if (j->state == DJOB_FREE || j == p->delivered) continue;
+        if (queued_only && j->state != DJOB_QUEUED) continue;
+        if (!best || j->order < best->order) best = j;
+    }
+    return best;
+}
+
+// The next job to deliver: the lowest pending one, once it is done.
+static decrypt_job_t *ready(decrypt_pool_t *p) {
+    decrypt_job_t *j = lowest(p, false);
+    return (j && j->state == DJOB_DONE) ? j : NULL;
+}
+
+static void *worker(void *arg) {
+    decrypt_pool_t *p = arg;
+    pthread_mutex_lock(&p->mutex);
+    while (!p->stop) {
+        decrypt_job_t *j = lowest(p, true);
+        if (!j) {
+            pthread_cond_wait(&p->work_cond, &p->mutex);
+            continue;
+        }
+        j->state = DJOB_BUSY;
+        pthread_mutex_unlock(&p->mutex);
+
+        run_job(j);
+
+        pthread_mutex_lock(&p->mutex);
+        j->state = DJOB_DONE;
+        for (int i = 0; i < DECRYPT_POOL_DEPTH; i++) {
+            const decrypt_job_t *k = &p->jobs[i];
+            if ((k->state == DJOB_QUEUED || k->state == DJOB_BUSY) &&
+                k->order < j->order) {
+                p->out_of_order++;
+                break;
+            }
+        }
+        pthread_cond_broadcast(&p->done_cond);
+    }
+    pthread_mutex_unlock(&p->mutex);
+    return NULL;
+}
+
+int decrypt_pool_start(decrypt_pool_t *p, int workers) {
+    memset(p, 0, sizeof(*p));
+    if (workers < 0) workers = 0;
+    if (workers > DECRYPT_POOL_MAX_WORKERS) workers = DECRYPT_POOL_MAX_WORKERS;
+
+    p->jobs = calloc(DECRYPT_POOL_DEPTH, sizeof(*p->jobs));
+    if (!p->jobs) return -1;
+    pthread_mutex_init(&p->mutex, NULL);
+    pthread_cond_init(&p->work_cond, NULL);
+    pthread_cond_init(&p->done_cond, NULL);
+    frame_decrypt_init(&p->fdec);
+
+    for (int i = 0; i < workers; i++) {
+        if (pthread_create(&p->threads[i], NULL, worker, p) != 0) {
+            decrypt_pool_stop(p);
+            return -1;
+        }
+        p->workers++;
+    }
+    return 0;
+}
+
+void decrypt_pool_stop(decrypt_pool_t *p) {
+    pthread_mutex_lock(&p->mutex);
+    p->stop = true;
+    pthread_cond_broadcast(&p->work_cond);
+    pthread_mutex_unlock(&p->mutex);
+    for (int i = 0; i < p->workers; i++) pthread_join(p->threads[i], NULL);
+    p->workers = 0;
+
+    if (p->jobs) {
+        // Plaintext and session keys should not outlive the pool
+        explicit_bzero(p->jobs, DECRYPT_POOL_DEPTH * sizeof(*p->jobs));
+        free(p->jobs);
+        p->jobs = NULL;
+    }
+    frame_decrypt_free(&p->fdec);
+    pthread_cond_destroy(&p->done_cond);
+    pthread_cond_destroy(&p->work_cond);
+    pthread_mutex_destroy(&p->mutex);
+}
+
+bool decrypt_pool_full(decrypt_pool_t *p) {
+    pthread_mutex_lock(&p->mutex);
+    bool full = true;
+    for (int i = 0; i < DECRYPT_POOL_DEPTH && full; i++)
+        full = p->jobs[i].state != DJOB_FREE;
+    pthread_mutex_unlock(&p->mutex);
+    return full;
+}
+
+int decrypt_pool_submit(decrypt_pool_t *p, const lifi_frame_t *f,
+                        const uint8_t *key) {
+    pthread_mutex_lock(&p->mutex);
+    decrypt_job_t *j = NULL;
+    for (int i = 0; i < DECRYPT_POOL_DEPTH && !j; i++)
+        if (p->jobs[i].state == DJOB_FREE) j = &p->jobs[i];
+    if (!j) {
+        p->stalls++;
+        pthread_mutex_unlock(&p->mutex);
+        return -1;
+    }
+
+    j->type = f->type;
+    j->len = f->len;
+    j->order = nonce_order(p, f->payload);
+    j->ret = 0;
+
+    if (p->workers == 0) {
+        // Single-threaded: the reader decrypts, mostly ahead of time
+        int ret = frame_decrypt_finish(&p->fdec, f, key);
+        if (ret == 0) {
+            size_t ctext_len = (size_t)f->len - NONCE_SIZE - TAG_SIZE;
+            memcpy(j->raw, f->raw, FRAME_HDR_SIZE + (size_t)f->len);
+            memcpy(j->plain, p->fdec.plain, ctext_len);
+            finish_job(j);
+            j->state = DJOB_DONE;
+            p->submitted++;
+        }
+        pthread_mutex_unlock(&p->mutex);
+        return ret;
+    }
+
+    memcpy(j->raw, f->raw, FRAME_HDR_SIZE + (size_t)f->len);
+    memcpy(j->key, key, sizeof(j->key));
+    j->state = DJOB_QUEUED;
+    p->submitted++;
+    pthread_cond_signal(&p->work_cond);
+    pthread_mutex_unlock(&p->mutex);
+    return 0;
+}
+
+void decrypt_pool_poll(decrypt_pool_t *p, const frame_parser_t *parser,
+                       const uint8_t *key) {
+    if (p->workers == 0) frame_decrypt_poll(&p->fdec, parser, key);
+}
+
+bool decrypt_pool_next(decrypt_pool_t *p, decrypt_result_t *out) {
+    pthread_mutex_lock(&p->mutex);
+    if (p->delivered) {
+        explicit_bzero(p->delivered->key, sizeof(p->delivered->key));
+        p->delivered->state = DJOB_FREE;
+        p->delivered = NULL;
+    }
+    decrypt_job_t *j = ready(p);
+    if (j) p->delivered = j;
+    pthread_mutex_unlock(&p->mutex);
+    if (!j) return false;
+
+    memset(out, 0, sizeof(*out));
+    out->type = j->type;
+    out->ret = j->ret;
+    out->nonce = j->raw + FRAME_HDR_SIZE;
+    out->ciphertext = out->nonce + NONCE_SIZE;
+    out->ctext_len = (size_t)j->len - NONCE_SIZE - TAG_SIZE;
+    if (j->ret == 0) {
+        out->plain = j->plain;
+        out->expanded = j->expanded;
+        out->expanded_len = j->expanded_len;
+    }
+    return true;
+}
+
+bool decrypt_pool_wait(decrypt_pool_t *p, int timeout_ms) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    ts.tv_nsec += (long)timeout_ms * 1000000L;
+    ts.tv_sec += ts.tv_nsec / 1000000000L;
+    ts.tv_nsec %= 1000000000L;
+
+    pthread_mutex_lock(&p->mutex);
+    bool ok = ready(p) != NULL;
+    while (!ok && p->workers > 0) {
+        if (pthread_cond_timedwait(&p->done_cond, &p->mutex, &ts) == ETIMEDOUT) {
+            ok = ready(p) != NULL;
+            break;
+        }
+        ok = ready(p) != NULL;
+    }
+    pthread_mutex_unlock(&p->mutex);
+    return ok;
+}
+
+size_t decrypt_pool_pending(decrypt_pool_t *p) {
+    pthread_mutex_lock(&p->mutex);
+    size_t n = 0;
+    for (int i = 0; i < DECRYPT_POOL_DEPTH; i++)
+        if (p->jobs[i].state != DJOB_FREE && &p->jobs[i] != p->delivered) n++;
+    pthread_mutex_unlock(&p->mutex);
+    return n;
+}
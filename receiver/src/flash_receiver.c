@@ -23,13 +23,15 @@
 #include "c_api.h"
 #include "c_secure_comm.h"   // parse_handshake_1, check_handshake_2_send_handshake_3
 #include "config_handler.h"  // change_directory_to_config_path, get_config_path
+#include "key_cache.h"
 #include "key_exchange.h"
 #include "../../include/protocol.h"
 #include "replay_window.h"
 #include "serial_linux.h"
 #include "sst_crypto_embedded.h"  // brings in sst_decrypt_gcm prototype and sizes
 #include "heatshrink_decoder.h"
-#include "../../include/crc16.h"
+#include "../../include/frame_decrypt.h"
+#include "../../include/frame_parser.h"
 #include "utils.h"
 
 
@@ -323,47 +325,33 @@ static int write_all(int fd, const void* buf, size_t len) {
     return (sent == len) ? 0 : -1;
 }
 
-// Helper: Read exact bytes with timeout for non-blocking FD
-// timeout_ms: Max time to wait for the ENTIRE buffer to be filled
-static ssize_t read_exact_timeout(int fd, void *buf, size_t len, int timeout_ms) {
-    uint8_t *p = (uint8_t *)buf;
-    size_t received = 0;
-    struct timeval start, now;
-    gettimeofday(&start, NULL);
-    
-    while (received < len) {
-        // Check timeout
-        gettimeofday(&now, NULL);
-        long elapsed_ms = (now.tv_sec - start.tv_sec) * 1000 + (now.tv_usec - start.tv_usec) / 1000;
-        if (elapsed_ms >= timeout_ms) {
-            return -1; // Timeout
-        }
-        
-        // Wait for data
-        fd_set fds;
-        FD_ZERO(&fds);
-        FD_SET(fd, &fds);
-        struct timeval tv;
-        tv.tv_sec = 0;
-        tv.tv_usec = (timeout_ms - elapsed_ms) * 1000;
-        
-        int ret = select(fd + 1, &fds, NULL, NULL, &tv);
-        if (ret > 0) {
-            ssize_t n = read(fd, p + received, len - received);
-            if (n > 0) {
-                received += n;
-            } else if (n == 0) {
-                return -1; // EOF/Closed
-            } else {
-                if (errno != EAGAIN && errno != EWOULDBLOCK) return -1; // Error
-            }
-        } else if (ret == 0) {
-            return -1; // Timeout
-        } else {
-            return -1; // Error
-        }
-    }
-    return received;
+// Tells the sender which AEADs this receiver opens, so an RP2040 without
+// AES hardware can switch to ChaCha20-Poly1305.
+// Frame: [PREAMBLE:4][TYPE:1][LEN:2][SUITE mask:1]
+static int send_suites(int fd) {
+    const uint8_t frame[] = {
+        PREAMBLE_BYTE_1, PREAMBLE_BYTE_2, PREAMBLE_BYTE_3, PREAMBLE_BYTE_4,
+        MSG_TYPE_SUITES, 0x00, 0x01,
+        SUITE_AES_GCM | SUITE_CHACHAPOLY
+    };
+    if (write_all(fd, frame, sizeof(frame)) < 0) return -1;
+    tcdrain(fd);
+    return 0;
+}
+
+// get_session_key_by_ID() behind the key cache: a key seen before is found
+// by its full 8-byte ID without the sst-c-api list scan (32-bit IDs) or a
+// round trip to Auth. sst-c-api matches only the low 32 bits of the ID,
+// so a key it returns under a different full ID is refused.
+static bool lookup_session_key(key_cache_t *cache, unsigned char *key_id,
+                               SST_ctx_t *sst, session_key_list_t *key_list,
+                               session_key_t *out) {
+    if (key_cache_get(cache, key_id, out)) return true;
+    session_key_t *k = get_session_key_by_ID(key_id, sst, key_list);
+    if (!k || memcmp(k->key_id, key_id, SESSION_KEY_ID_SIZE) != 0) return false;
+    *out = *k;
+    key_cache_put(cache, k);
+    return true;
 }
 
 // --- Session Statistics ---
@@ -374,6 +362,7 @@ typedef struct {
     unsigned long replay_blocked;
     unsigned long timeouts;
     unsigned long bad_preamble;
+    unsigned long resyncs;
     unsigned long keys_consumed;
 } SessionStats;
 
@@ -392,11 +381,18 @@ typedef struct {
 
 static ReporterEvent    g_rep_event;
 static bool             g_rep_pending = false;
-static uint8_t          g_rep_mac_key[32];
+// HMAC state for the session mac_key, keyed once per key (see
+// set_rep_mac_key()) so each signature skips rehashing the key pads.
+static sst_hmac_ctx_t   g_rep_hmac;
 static bool             g_rep_key_valid = false;
 static pthread_mutex_t  g_rep_mutex = PTHREAD_MUTEX_INITIALIZER;
 static pthread_cond_t   g_rep_cond  = PTHREAD_COND_INITIALIZER;
 
+// Caller holds g_rep_mutex.
+static void set_rep_mac_key(const uint8_t *mac_key) {
+    sst_hmac_setkey(&g_rep_hmac, mac_key, 32);
+}
+
 static void reporter_post(const ReporterEvent *ev) {
     char json[512];
     int jlen = snprintf(json, sizeof(json),
@@ -409,7 +405,9 @@ static void reporter_post(const ReporterEvent *ev) {
 
     // HMAC-SHA256 sign the JSON body
     uint8_t hmac_out[32];
-    sst_hmac_sha256_ex(g_rep_mac_key, 32, (const uint8_t*)json, (size_t)jlen, hmac_out);
+    pthread_mutex_lock(&g_rep_mutex);
+    sst_hmac_compute(&g_rep_hmac, (const uint8_t*)json, (size_t)jlen, hmac_out);
+    pthread_mutex_unlock(&g_rep_mutex);
     char hmac_hex[65];
     for (int i = 0; i < 32; i++) sprintf(hmac_hex + i * 2, "%02x", hmac_out[i]);
     hmac_hex[64] = '\0';
@@ -528,10 +526,10 @@ static void challenge_handle(int client) {
     // Compute HMAC-SHA256(mac_key, nonce)
     pthread_mutex_lock(&g_rep_mutex);
     bool key_ready = g_rep_key_valid;
-    uint8_t mac_key_copy[32];
+    uint8_t hmac_out[32];
     uint8_t key_id_copy[SESSION_KEY_ID_SIZE];
     if (key_ready) {
-        memcpy(mac_key_copy, g_rep_mac_key, 32);
+        sst_hmac_compute(&g_rep_hmac, nonce_bytes, 32, hmac_out);
         memcpy(key_id_copy,  g_rep_event.key_id_hex, SESSION_KEY_ID_SIZE);
     }
     pthread_mutex_unlock(&g_rep_mutex);
@@ -545,9 +543,6 @@ static void challenge_handle(int client) {
         return;
     }
 
-    uint8_t hmac_out[32];
-    sst_hmac_sha256_ex(mac_key_copy, 32, nonce_bytes, 32, hmac_out);
-
     char hmac_hex[65];
     for (int j = 0; j < 32; j++) sprintf(hmac_hex + j * 2, "%02x", hmac_out[j]);
     hmac_hex[64] = '\0';
@@ -603,6 +598,11 @@ static void *challenge_server_thread(void *arg) {
 int main(int argc, char* argv[]) {
     SessionStats stats = {0};
 
+    // Reports are signed with an all-zero key until a session key loads
+    static const uint8_t zero_mac_key[32];
+    sst_hmac_init(&g_rep_hmac);
+    set_rep_mac_key(zero_mac_key);
+
     const char* config_path = NULL;
 
     if (argc > 2) {
@@ -654,6 +654,9 @@ int main(int argc, char* argv[]) {
              printf("Connected to Auth, but received 0 keys.\n");
          }
     }
+    static key_cache_t key_cache;
+    key_cache_init(&key_cache);
+    key_cache_put_list(&key_cache, key_list);
 
     // --- Start Dashboard Reporter + Challenge Server Threads ---
     {
@@ -696,7 +699,7 @@ int main(int argc, char* argv[]) {
         s_key = key_list->s_key[current_key_idx];
         // Seed reporter mac key
         pthread_mutex_lock(&g_rep_mutex);
-        memcpy(g_rep_mac_key, s_key.mac_key, 32);
+        set_rep_mac_key(s_key.mac_key);
         g_rep_key_valid = true;
         pthread_mutex_unlock(&g_rep_mutex);
     }
@@ -744,6 +747,7 @@ int main(int argc, char* argv[]) {
              } else {
                  tcdrain(fd);
                  log_printf("Sent session key over UART (ID + Cipher + MAC).\n");
+                 if (send_suites(fd) < 0) log_printf("Error: Failed to send AEAD suites.\n");
                  log_printf("[DEBUG] Sent Cipher: %02X %02X... MAC: %02X %02X...\n", 
                      s_key.cipher_key[0], s_key.cipher_key[1], 
                      s_key.mac_key[0], s_key.mac_key[1]);
@@ -752,8 +756,11 @@ int main(int argc, char* argv[]) {
     }
 
     // UART framing state
-    uint8_t byte = 0;
-    int uart_state = 0;
+    static frame_parser_t fparser;
+    frame_parser_init(&fparser);
+    // Decrypts GCM frames while their bytes are still arriving
+    static frame_decrypt_t fdec;
+    frame_decrypt_init(&fdec);
 
     log_printf("Listening for encrypted message...\n");
     if (fd >= 0) tcflush(fd, TCIFLUSH);
@@ -813,6 +820,7 @@ int main(int argc, char* argv[]) {
                              cmd_printf("Error: Failed to send MAC key.");
                         } else {
                              tcdrain(fd);
+                             send_suites(fd);
                              cmd_printf("✓ Session key sent (Cipher + MAC).");
                              log_printf("[DEBUG] Sent Cipher: %02X %02X... MAC: %02X %02X...\n", 
                                  s_key.cipher_key[0], s_key.cipher_key[1], 
@@ -844,12 +852,13 @@ int main(int argc, char* argv[]) {
                         // Success, replace old list
                         if (key_list) free_session_key_list_t(key_list);
                         key_list = new_key_list;
+                        key_cache_put_list(&key_cache, key_list);
                         
                         s_key = key_list->s_key[0];
                         key_valid = true;
                         stats.keys_consumed++;
                         pthread_mutex_lock(&g_rep_mutex);
-                        memcpy(g_rep_mac_key, s_key.mac_key, 32);
+                        set_rep_mac_key(s_key.mac_key);
                         g_rep_key_valid = true;
                         pthread_mutex_unlock(&g_rep_mutex);
                         cmd_printf("✓ New key fetched from SST.");
@@ -926,6 +935,7 @@ int main(int argc, char* argv[]) {
                     cmd_printf("Replays Blocked: %lu", stats.replay_blocked);
                     cmd_printf("Timeouts:        %lu", stats.timeouts);
                     cmd_printf("Bad Preambles:   %lu", stats.bad_preamble);
+                    cmd_printf("Resyncs:         %lu", stats.resyncs);
                     cmd_printf("Keys Consumed:   %lu", stats.keys_consumed);
                     cmd_printf("--------------------------");
                     break;
@@ -961,6 +971,7 @@ int main(int argc, char* argv[]) {
                         fprintf(f, "Replays Blocked: %lu\n", stats.replay_blocked);
                         fprintf(f, "Timeouts:        %lu\n", stats.timeouts);
                         fprintf(f, "Bad Preambles:   %lu\n", stats.bad_preamble);
+                        fprintf(f, "Resyncs:         %lu\n", stats.resyncs);
                         fprintf(f, "Keys Consumed:   %lu\n", stats.keys_consumed);
                         fprintf(f, "--------------------------\n");
                         fclose(f);
@@ -983,6 +994,7 @@ int main(int argc, char* argv[]) {
                         int flags = fcntl(fd, F_GETFL, 0);
                         if (flags >= 0) fcntl(fd, F_SETFL, flags | O_NONBLOCK);
                         tcflush(fd, TCIFLUSH);
+                        frame_parser_reset(&fparser);
                         cmd_printf("✓ Serial opened.");
                     } else {
                         cmd_printf("Still failed to open serial.");
@@ -995,6 +1007,7 @@ int main(int argc, char* argv[]) {
                 case 'Q': {
                     cmd_printf("Exiting...");
                     if (fd >= 0) close(fd);
+                    key_cache_clear(&key_cache);
                     free_session_key_list_t(key_list);
                     free_SST_ctx_t(sst);
                     return 0;
@@ -1037,563 +1050,432 @@ int main(int argc, char* argv[]) {
             state_deadline = (struct timespec){0, 0};
         }
 
-        if (fd >= 0 && read(fd, &byte, 1) == 1) {
-            // Activity Blink (Top Right)
-            static int act_ctr = 0;
-            if (++act_ctr % 10 == 0) {
-                mvwprintw(win_log_border, 0, getmaxx(win_log_border)-4, "%c", (act_ctr/10)%2 ? '*' : ' ');
+        bool rx_any = false;
+        if (fd >= 0) {
+            // Bulk read straight into the frame parser's buffer.
+            size_t rx_space = 0;
+            uint8_t *rx_dst = frame_parser_write_ptr(&fparser, &rx_space);
+            ssize_t rx_n = (rx_space > 0) ? read(fd, rx_dst, rx_space) : 0;
+            if (rx_n > 0) {
+                rx_any = true;
+                frame_parser_commit(&fparser, (size_t)rx_n);
+
+                // Activity Blink (Top Right)
+                static int act_ctr = 0;
+                act_ctr++;
+                mvwprintw(win_log_border, 0, getmaxx(win_log_border)-4, "%c", act_ctr % 2 ? '*' : ' ');
                 wrefresh(win_log_border);
             }
+        }
 
-            switch (uart_state) {
-                case 0:
-                    if (byte == PREAMBLE_BYTE_1) {
-                        uart_state = 1;
+        // Pull every complete frame out of the buffered bytes. A candidate
+        // that fails LEN, CRC or its deadline is rescanned from the byte after
+        // its preamble, so a real frame hidden inside the rejected bytes
+        // still comes out of a later iteration of this loop.
+        lifi_frame_t frame;
+        frame_result_t fres;
+        while ((fres = frame_parser_next(&fparser, monotonic_ms(), &frame)) != FRAME_NONE) {
+            if (fres == FRAME_DROPPED) {
+                stats.resyncs++;
+                if (frame.error == FRAME_ERR_TYPE) {
+                    stats.bad_preamble++;
+                } else {
+                    stats.total_pkts++;
+                    log_printf("Dropped frame (type 0x%02X, len %u): %s. Rescanning.\n",
+                               frame.type, frame.len, frame_error_str(frame.error));
+                    if (frame.error == FRAME_ERR_CRC &&
+                        (frame.type == MSG_TYPE_ENCRYPTED || frame.type == MSG_TYPE_FILE)) {
+                        stats.decrypt_fail++;
                     }
-                    break;
-                case 1:
-                    if (byte == PREAMBLE_BYTE_2) {
-                        uart_state = 2;
-                    } else {
-                        uart_state = 0;
-                    }
-                    break;
-                case 2:
-                    if (byte == PREAMBLE_BYTE_3) {
-                        uart_state = 3;
-                    } else {
-                        uart_state = 0;
+                }
+                continue;
+            }
+
+            if (frame.type == MSG_TYPE_KEY_ID_ONLY) {
+                stats.total_pkts++;
+
+                uint16_t payload_len = frame.len;
+                const uint8_t *payload = frame.payload;
+
+                log_printf("[KEY ID] Received: ");
+                for(int i=0; i<payload_len; i++) {
+                    // Using private internal method of log_printf to stay on same line? 
+                    // iterating log_printf calls creates newlines usually.
+                    // Let's just format it into a string first.
+                }
+                char hex_str[3 * payload_len + 1];
+                hex_str[0] = '\0';
+                for(int i=0; i<payload_len; i++) {
+                    char tmp[5];
+                    snprintf(tmp, sizeof(tmp), "%02X ", payload[i]);
+                    strcat(hex_str, tmp);
+                }
+                log_printf("[KEY ID] Peer ID: %s", hex_str);
+
+                // --- AUTO-CONNECT LOGIC ---
+                // 1. Store the ID
+                memcpy(last_lifi_id, payload, SESSION_KEY_ID_SIZE);
+                lifi_id_seen = true;
+
+                unsigned int native_id = convert_skid_buf_to_int(last_lifi_id, SESSION_KEY_ID_SIZE);
+                cmd_printf("[NATIVE] Received ID: %u", native_id);
+
+                cmd_printf("Looking for Key ID...");
+                char debug_key_id[3 * SESSION_KEY_ID_SIZE + 1];
+                debug_key_id[0] = '\0';
+                for (int i = 0; i < SESSION_KEY_ID_SIZE; i++) {
+                    char buf[4];
+                    snprintf(buf, sizeof(buf), "%02X ", last_lifi_id[i]);
+                    strcat(debug_key_id, buf);
+                }
+                cmd_printf("Passing ID to SST: %s", debug_key_id);
+
+                // 2. Key cache first, then the C-API (existing_s_key_list,
+                // then a query to Auth if needed).
+                session_key_t cached;
+                session_key_t *found_key =
+                    lookup_session_key(&key_cache, last_lifi_id, sst, key_list, &cached)
+                        ? &cached : NULL;
+
+                if (found_key) {
+                    unsigned int found_native = convert_skid_buf_to_int(found_key->key_id, SESSION_KEY_ID_SIZE);
+                    cmd_printf("[NATIVE] Found Key ID: %u", found_native);
+                    s_key = *found_key;
+                    key_valid = true;
+                    // This key matches the provisioner's key — sync reporter mac_key
+                    pthread_mutex_lock(&g_rep_mutex);
+                    set_rep_mac_key(found_key->mac_key);
+                    g_rep_key_valid = true;
+                    pthread_mutex_unlock(&g_rep_mutex);
+                    cmd_printf("✓ Key ready. Initiating SST handshake.");
+                    mid_draw_keypanel(&s_key, key_valid, state, UART_DEVICE, (fd >= 0));
+
+                    // Trigger SST 3-way handshake immediately
+                    if (fd >= 0 && state == STATE_IDLE) {
+                        uint32_t hs1_len = 0;
+                        uint8_t *hs1 = parse_handshake_1(&s_key, sst_entity_nonce, &hs1_len);
+                        if (hs1 && hs1_len == SST_HS1_PAYLOAD_SIZE) {
+                            uint8_t hdr[7] = {
+                                PREAMBLE_BYTE_1, PREAMBLE_BYTE_2,
+                                PREAMBLE_BYTE_3, PREAMBLE_BYTE_4,
+                                MSG_TYPE_SST_HS1,
+                                (hs1_len >> 8) & 0xFF, hs1_len & 0xFF
+                            };
+                            if (write_all(fd, hdr, sizeof(hdr)) >= 0 &&
+                                write_all(fd, hs1, hs1_len) >= 0) {
+                                tcdrain(fd);
+                                state = STATE_WAITING_FOR_SST_HS2;
+                                clock_gettime(CLOCK_MONOTONIC, &state_deadline);
+                                state_deadline.tv_sec += 5;
+                                last_countdown = 5;
+                                cmd_printf("[SST HS1] Sent. Waiting for HS2...");
+                            } else {
+                                cmd_printf("[SST HS1] UART write failed.");
+                                explicit_bzero(sst_entity_nonce, sizeof(sst_entity_nonce));
+                            }
+                            free(hs1);
+                        } else {
+                            cmd_printf("[SST HS1] parse_handshake_1 failed.");
+                            free(hs1);
+                        }
                     }
-                    break;
-                case 3:
-                    if (byte == PREAMBLE_BYTE_4) {
-                        uart_state = 4; // Preamble complete, next is TYPE
+                } else {
+                    cmd_printf("Error: Key ID not found (Local or Auth).");
+                }
+
+                mid_draw_keypanel(&s_key, key_valid, state, UART_DEVICE, (fd >= 0));
+            }
+            else if (frame.type == MSG_TYPE_SST_HS2) {
+                stats.total_pkts++;
+                uint16_t hs2_len = frame.len;
+                uint8_t hs2_payload[SST_HS2_PAYLOAD_SIZE];
+                memcpy(hs2_payload, frame.payload, hs2_len);
+                if (state != STATE_WAITING_FOR_SST_HS2) {
+                    log_printf("[SST HS2] Received but not waiting for HS2\n");
+                    continue;
+                }
+
+                uint32_t hs3_len = 0;
+                uint8_t *hs3 = check_handshake_2_send_handshake_3(
+                    hs2_payload, hs2_len, sst_entity_nonce, &s_key, &hs3_len);
+
+                if (hs3 != NULL) {
+                    cmd_printf("✓ SST HS2 VERIFIED: Pico holds SST key. Sending HS3.");
+                    if (hs3_len == SST_HS3_PAYLOAD_SIZE) {
+                        uint8_t hdr3[7] = {
+                            PREAMBLE_BYTE_1, PREAMBLE_BYTE_2,
+                            PREAMBLE_BYTE_3, PREAMBLE_BYTE_4,
+                            MSG_TYPE_SST_HS3,
+                            (hs3_len >> 8) & 0xFF, hs3_len & 0xFF
+                        };
+                        write_all(fd, hdr3, sizeof(hdr3));
+                        write_all(fd, hs3, hs3_len);
+                        tcdrain(fd);
                     } else {
-                        uart_state = 0;
+                        cmd_printf("✗ Unexpected HS3 length %u.", hs3_len);
                     }
-                    break;
+                    free(hs3);
+                } else {
+                    cmd_printf("✗ SST HS FAILED: Nonce mismatch – possible replay or wrong key.");
+                }
 
-                case 4:
-                    // TYPE byte received
-                    if (byte == MSG_TYPE_KEY_ID_ONLY) {
-                        uint8_t packet_type = byte; 
-                        stats.total_pkts++;
-                        
-                        // Read length (2 bytes)
-                        uint8_t len_bytes[2];
-                        if (read_exact_timeout(fd, len_bytes, 2, 100) != 2) {
-                            log_printf("Failed to read length (Key ID)\n");
-                            uart_state = 0;
-                            continue;
-                        }
-                        uint16_t payload_len = ((uint16_t)len_bytes[0] << 8) | len_bytes[1];
-                        
-                        if (payload_len > 64) { // Sanity check
-                             log_printf("Invalid Key ID len: %u\n", payload_len);
-                             uart_state = 0;
-                             continue;
-                        }
-                        
-                        uint8_t payload[payload_len];
-                        uint8_t crc_bytes[2];
-                        
-                        if (read_exact_timeout(fd, payload, payload_len, 100) != (ssize_t)payload_len ||
-                            read_exact_timeout(fd, crc_bytes, 2, 100) != 2) {
-                            log_printf("Failed to read payload/CRC (Key ID)\n");
-                            uart_state = 0;
-                            continue;
-                        }
-                        
-                        // Verify CRC
-                        uint8_t crc_buf[1 + 2 + 64]; // Max size
-                        size_t crc_idx = 0;
-                        crc_buf[crc_idx++] = packet_type;
-                        crc_buf[crc_idx++] = len_bytes[0];
-                        crc_buf[crc_idx++] = len_bytes[1];
-                        memcpy(&crc_buf[crc_idx], payload, payload_len);
-                        crc_idx += payload_len;
-                        
-                        uint16_t computed_crc = crc16_ccitt(crc_buf, crc_idx);
-                        uint16_t received_crc = ((uint16_t)crc_bytes[0] << 8) | crc_bytes[1];
-                        
-                        if (computed_crc != received_crc) {
-                            log_printf("CRC fail on Key ID pkt\n");
-                            uart_state = 0;
-                            continue;
-                        }
-                        
-                        log_printf("[KEY ID] Received: ");
-                        for(int i=0; i<payload_len; i++) {
-                            // Using private internal method of log_printf to stay on same line? 
-                            // iterating log_printf calls creates newlines usually.
-                            // Let's just format it into a string first.
-                        }
-                        char hex_str[3 * payload_len + 1];
-                        hex_str[0] = '\0';
-                        for(int i=0; i<payload_len; i++) {
-                            char tmp[5];
-                            snprintf(tmp, sizeof(tmp), "%02X ", payload[i]);
-                            strcat(hex_str, tmp);
-                        }
-                        log_printf("[KEY ID] Peer ID: %s", hex_str);
-                        
-                        // --- AUTO-CONNECT LOGIC ---
-                        // 1. Store the ID
-                        memcpy(last_lifi_id, payload, SESSION_KEY_ID_SIZE);
-                        lifi_id_seen = true;
+                explicit_bzero(sst_entity_nonce, sizeof(sst_entity_nonce));
+                state = STATE_IDLE;
+                state_deadline = (struct timespec){0, 0};
+                mid_draw_keypanel(&s_key, key_valid, state, UART_DEVICE, (fd >= 0));
+            }
+            else if (MSG_TYPE_IS_AEAD(frame.type)) {
+                uint8_t packet_type = frame.type;
+                stats.total_pkts++;
+
+                // Length = NONCE + CIPHERTEXT + TAG, already bounds-checked by
+                // the frame parser (and CRC-verified for version 1 types).
+                uint16_t payload_len = frame.len;
+                uint16_t ctext_len = payload_len - NONCE_SIZE - TAG_SIZE;
+                const uint8_t *nonce = frame.payload;
+
+                // --- Nonce Replay Check ---
+                if (replay_window_seen(&rwin, nonce)) {
+                    log_printf("Nonce replayed! Rejecting message.\\n");
+                    stats.replay_blocked++;
+                    continue;
+                }
+                replay_window_add(&rwin, nonce);
 
-                        unsigned int native_id = convert_skid_buf_to_int(last_lifi_id, SESSION_KEY_ID_SIZE);
-                        cmd_printf("[NATIVE] Received ID: %u", native_id);
-                        
-                        cmd_printf("Looking for Key ID...");
-                        char debug_key_id[3 * SESSION_KEY_ID_SIZE + 1];
-                        debug_key_id[0] = '\0';
-                        for (int i = 0; i < SESSION_KEY_ID_SIZE; i++) {
-                            char buf[4];
-                            snprintf(buf, sizeof(buf), "%02X ", last_lifi_id[i]);
-                            strcat(debug_key_id, buf);
-                        }
-                        cmd_printf("Passing ID to SST: %s", debug_key_id);
-                        
-                        // 2. Use C-API to find locally or fetch from Auth
-                        // This handles checking existing_s_key_list first, then queries Auth if needed.
-                        session_key_t *found_key = get_session_key_by_ID(last_lifi_id, sst, key_list);
-                        
-                        if (found_key) {
-                            unsigned int found_native = convert_skid_buf_to_int(found_key->key_id, SESSION_KEY_ID_SIZE);
-                            cmd_printf("[NATIVE] Found Key ID: %u", found_native);
-                            s_key = *found_key;
-                            key_valid = true;
-                            // This key matches the provisioner's key — sync reporter mac_key
-                            pthread_mutex_lock(&g_rep_mutex);
-                            memcpy(g_rep_mac_key, found_key->mac_key, 32);
-                            g_rep_key_valid = true;
-                            pthread_mutex_unlock(&g_rep_mutex);
-                            cmd_printf("✓ Key ready. Initiating SST handshake.");
-                            mid_draw_keypanel(&s_key, key_valid, state, UART_DEVICE, (fd >= 0));
-
-                            // Trigger SST 3-way handshake immediately
-                            if (fd >= 0 && state == STATE_IDLE) {
-                                uint32_t hs1_len = 0;
-                                uint8_t *hs1 = parse_handshake_1(&s_key, sst_entity_nonce, &hs1_len);
-                                if (hs1 && hs1_len == SST_HS1_PAYLOAD_SIZE) {
-                                    uint8_t hdr[7] = {
-                                        PREAMBLE_BYTE_1, PREAMBLE_BYTE_2,
-                                        PREAMBLE_BYTE_3, PREAMBLE_BYTE_4,
-                                        MSG_TYPE_SST_HS1,
-                                        (hs1_len >> 8) & 0xFF, hs1_len & 0xFF
-                                    };
-                                    if (write_all(fd, hdr, sizeof(hdr)) >= 0 &&
-                                        write_all(fd, hs1, hs1_len) >= 0) {
-                                        tcdrain(fd);
-                                        state = STATE_WAITING_FOR_SST_HS2;
-                                        clock_gettime(CLOCK_MONOTONIC, &state_deadline);
-                                        state_deadline.tv_sec += 5;
-                                        last_countdown = 5;
-                                        cmd_printf("[SST HS1] Sent. Waiting for HS2...");
-                                    } else {
-                                        cmd_printf("[SST HS1] UART write failed.");
-                                        explicit_bzero(sst_entity_nonce, sizeof(sst_entity_nonce));
+                // ctext_len + 1 bytes, for null-terminator
+                uint8_t *decrypted = fdec.plain;
+
+                if (!key_valid) {  // Skip decryption if key was
+                                   // cleared and not yet rotated
+                    log_printf(
+                        "No valid session key. Rejecting encrypted "
+                        "message.\\n");
+                    continue;
+                }
+
+                // V2 frames bind TYPE|LEN as GCM additional data. Most
+                // of the payload was already decrypted by
+                // frame_decrypt_poll() while it arrived.
+                size_t aad_len = MSG_TYPE_HAS_AAD(packet_type) ? FRAME_HDR_SIZE : 0;
+                int ret = frame_decrypt_finish(&fdec, &frame, s_key.cipher_key);
+
+                if (ret == 0) {  // Successful decryption
+                    decrypted[ctext_len] = '\0';  // Null-terminate
+
+                        // Handle File Transfer
+                        if (MSG_TYPE_IS_FILE(packet_type)) {
+                            log_printf("[FILE] Rx Compressed: %u bytes. Expanding...\n", ctext_len);
+
+                            heatshrink_decoder *hsd = heatshrink_decoder_alloc(512, 8, 4);
+                            if (hsd) {
+                                size_t total_sunk = 0;
+                                size_t total_decomp = 0;
+                                static uint8_t decompressed[32768]; 
+
+                                // Loop until all input is sunk
+                                while (total_sunk < ctext_len) {
+                                    size_t sunk = 0;
+                                    HSD_sink_res sres = heatshrink_decoder_sink(hsd, &decrypted[total_sunk], 
+                                                                              ctext_len - total_sunk, &sunk);
+                                    total_sunk += sunk;
+
+                                    // Poll immediately after sinking some data
+                                    HSD_poll_res pres;
+                                    do {
+                                        size_t p = 0;
+                                        pres = heatshrink_decoder_poll(hsd, &decompressed[total_decomp], 
+                                                                       sizeof(decompressed) - total_decomp, &p);
+                                        total_decomp += p;
+                                    } while (pres == HSDR_POLL_MORE && total_decomp < sizeof(decompressed));
+
+                                    if (sres < 0) {
+                                        log_printf("[Error] Sink failed err=%d\n", sres);
+                                        break;
                                     }
-                                    free(hs1);
+                                }
+
+                                // Finish and flush remaining
+                                heatshrink_decoder_finish(hsd);
+                                HSD_poll_res pres;
+                                do {
+                                    size_t p = 0;
+                                    pres = heatshrink_decoder_poll(hsd, &decompressed[total_decomp], 
+                                                                   sizeof(decompressed) - total_decomp, &p);
+                                    total_decomp += p;
+                                } while (pres == HSDR_POLL_MORE && total_decomp < sizeof(decompressed));
+
+                                heatshrink_decoder_free(hsd);
+
+                                // Null terminate
+                                if (total_decomp < sizeof(decompressed)) {
+                                    decompressed[total_decomp] = '\0';
                                 } else {
-                                    cmd_printf("[SST HS1] parse_handshake_1 failed.");
-                                    free(hs1);
+                                    decompressed[sizeof(decompressed)-1] = '\0';
                                 }
-                            }
-                        } else {
-                            cmd_printf("Error: Key ID not found (Local or Auth).");
-                        }
 
-                        mid_draw_keypanel(&s_key, key_valid, state, UART_DEVICE, (fd >= 0));
-                        uart_state = 0;
-                    }
-                    else if (byte == MSG_TYPE_SST_HS2) {
-                        stats.total_pkts++;
-                        uint8_t len_bytes[2];
-                        if (read_exact_timeout(fd, len_bytes, 2, 100) != 2) {
-                            log_printf("[SST HS2] Length read timeout\n");
-                            uart_state = 0;
-                            continue;
-                        }
-                        uint16_t hs2_len = ((uint16_t)len_bytes[0] << 8) | len_bytes[1];
-                        if (hs2_len != SST_HS2_PAYLOAD_SIZE) {
-                            log_printf("[SST HS2] Unexpected length: %u\n", hs2_len);
-                            uart_state = 0;
-                            continue;
-                        }
-                        uint8_t hs2_payload[SST_HS2_PAYLOAD_SIZE];
-                        uint8_t crc_rx[2];
-                        if (read_exact_timeout(fd, hs2_payload, hs2_len, 200) != (ssize_t)hs2_len ||
-                            read_exact_timeout(fd, crc_rx, 2, 100) != 2) {
-                            log_printf("[SST HS2] Payload read timeout\n");
-                            uart_state = 0;
-                            continue;
-                        }
-                        uint8_t crc_check[1 + 2 + SST_HS2_PAYLOAD_SIZE];
-                        crc_check[0] = MSG_TYPE_SST_HS2;
-                        crc_check[1] = len_bytes[0];
-                        crc_check[2] = len_bytes[1];
-                        memcpy(&crc_check[3], hs2_payload, hs2_len);
-                        uint16_t computed_crc = crc16_ccitt(crc_check, sizeof(crc_check));
-                        uint16_t received_crc = ((uint16_t)crc_rx[0] << 8) | crc_rx[1];
-                        if (computed_crc != received_crc) {
-                            log_printf("[SST HS2] CRC fail\n");
-                            uart_state = 0;
-                            continue;
-                        }
-                        if (state != STATE_WAITING_FOR_SST_HS2) {
-                            log_printf("[SST HS2] Received but not waiting for HS2\n");
-                            uart_state = 0;
-                            continue;
-                        }
+                                log_printf("[FILE] Result: %zu -> %zu bytes\n", ctext_len, total_decomp);
+                                // log_printf("[FILE] Data:\n%s\n", decompressed); // removing huge spam
+
+                                // Write to file
+                                FILE *f_out = fopen("received_file.txt", "a");
+                                if (f_out) {
+                                    if (total_decomp > 0) {
+                                        fwrite(decompressed, 1, total_decomp, f_out);
+                                        fprintf(f_out, "\n");
+                                    }
+                                    fclose(f_out);
+                                    log_printf("[FILE] Saved to received_file.txt\n");
+                                }
+
+                                // If small enough, print some head/tail
+                                if (total_decomp > 0 && total_decomp < 500) {
+                                    log_printf("Content:\n%s", decompressed);
+                                } else if (total_decomp >= 500) {
+                                    log_printf("Content (Head 100):\n%.100s...\n", decompressed);
+                                }
 
-                        uint32_t hs3_len = 0;
-                        uint8_t *hs3 = check_handshake_2_send_handshake_3(
-                            hs2_payload, hs2_len, sst_entity_nonce, &s_key, &hs3_len);
-
-                        if (hs3 != NULL) {
-                            cmd_printf("✓ SST HS2 VERIFIED: Pico holds SST key. Sending HS3.");
-                            if (hs3_len == SST_HS3_PAYLOAD_SIZE) {
-                                uint8_t hdr3[7] = {
-                                    PREAMBLE_BYTE_1, PREAMBLE_BYTE_2,
-                                    PREAMBLE_BYTE_3, PREAMBLE_BYTE_4,
-                                    MSG_TYPE_SST_HS3,
-                                    (hs3_len >> 8) & 0xFF, hs3_len & 0xFF
-                                };
-                                write_all(fd, hdr3, sizeof(hdr3));
-                                write_all(fd, hs3, hs3_len);
-                                tcdrain(fd);
                             } else {
-                                cmd_printf("✗ Unexpected HS3 length %u.", hs3_len);
+                                log_printf("[FILE] Decompression alloc failed.\n");
+                            }
+                        } 
+                        // Handle Normal Chat / Commands
+                        else {
+                            log_printf("%s\n", decrypted);
+
+                            // ... Other commands ...
+                            if (strcmp((char*)decrypted, "I have the key") == 0) {
+                                 log_printf("Pico has confirmed receiving the key.\n");
                             }
-                            free(hs3);
-                        } else {
-                            cmd_printf("✗ SST HS FAILED: Nonce mismatch – possible replay or wrong key.");
-                        }
 
-                        explicit_bzero(sst_entity_nonce, sizeof(sst_entity_nonce));
-                        state = STATE_IDLE;
-                        state_deadline = (struct timespec){0, 0};
-                        mid_draw_keypanel(&s_key, key_valid, state, UART_DEVICE, (fd >= 0));
-                        uart_state = 0;
-                    }
-                    else if (byte == MSG_TYPE_ENCRYPTED || byte == MSG_TYPE_FILE) {
-                        uint8_t packet_type = byte; 
-                        stats.total_pkts++;
-                        
-                        // Read length (2 bytes)
-                        uint8_t len_bytes[2];
-                        if (read_exact_timeout(fd, len_bytes, 2, 100) != 2) {
-                            log_printf("Failed to read length\n");
-                            uart_state = 0;
-                            continue;
-                        }
-                        
-                        // Length = NONCE + CIPHERTEXT + TAG
-                        uint16_t payload_len = ((uint16_t)len_bytes[0] << 8) | len_bytes[1];
-                        if (payload_len < NONCE_SIZE + TAG_SIZE || payload_len > MAX_MSG_LEN) {
-                            log_printf("Invalid payload length: %u bytes\n", payload_len);
-                            uart_state = 0;
-                            continue;
-                        }
-                        
-                        // Calculate ciphertext length
-                        uint16_t ctext_len = payload_len - NONCE_SIZE - TAG_SIZE;
-                        
-                        uint8_t nonce[NONCE_SIZE];
-                        uint8_t ciphertext[ctext_len];
-                        uint8_t tag[TAG_SIZE];
-                        uint8_t crc_bytes[2];
-                        
-                        // Read all payload components with timeout (give enough time for full payload)
-                        int chunk_timeout = 200; // ms
-                        ssize_t nonce_read = read_exact_timeout(fd, nonce, NONCE_SIZE, chunk_timeout);
-                        ssize_t cipher_read = read_exact_timeout(fd, ciphertext, ctext_len, chunk_timeout + (ctext_len/10)); // Scaling timeout for size
-                        ssize_t tag_read = read_exact_timeout(fd, tag, TAG_SIZE, chunk_timeout);
-                        ssize_t crc_read = read_exact_timeout(fd, crc_bytes, 2, chunk_timeout);
-                        
-                        if (nonce_read != NONCE_SIZE || cipher_read != (ssize_t)ctext_len ||
-                            tag_read != TAG_SIZE || crc_read != 2) {
-                            log_printf("Read fail: nonce=%zd/%d, cipher=%zd/%u, tag=%zd/%d, crc=%zd/2\n",
-                                       nonce_read, NONCE_SIZE, cipher_read, ctext_len, 
-                                       tag_read, TAG_SIZE, crc_read);
-                            uart_state = 0;
-                            continue;
-                        }
-                                                
-                        // Validate CRC16
-                        uint8_t crc_buf[1 + 2 + NONCE_SIZE + MAX_MSG_LEN + TAG_SIZE];
-                        size_t crc_idx = 0;
-                        crc_buf[crc_idx++] = packet_type;
-                        crc_buf[crc_idx++] = len_bytes[0];
-                        crc_buf[crc_idx++] = len_bytes[1];
-                        memcpy(&crc_buf[crc_idx], nonce, NONCE_SIZE); crc_idx += NONCE_SIZE;
-                        memcpy(&crc_buf[crc_idx], ciphertext, ctext_len); crc_idx += ctext_len;
-                        memcpy(&crc_buf[crc_idx], tag, TAG_SIZE); crc_idx += TAG_SIZE;
-                        
-                        uint16_t computed_crc = crc16_ccitt(crc_buf, crc_idx);
-                        uint16_t received_crc = ((uint16_t)crc_bytes[0] << 8) | crc_bytes[1];
-                        
-                        if (computed_crc != received_crc) {
-                            log_printf("CRC16 mismatch! computed=0x%04X received=0x%04X\n", 
-                                       computed_crc, received_crc);
-                            
-                            // Dump failed packet to debug log for analysis
-                            FILE *f = fopen("receiver_debug.log", "a");
-                            if (f) {
-                                fprintf(f, "CRC FAIL: Comp:0x%04X Recv:0x%04X Len:%u\nPayload: ", 
-                                        computed_crc, received_crc, payload_len);
-                                for(size_t i=0; i<crc_idx; i++) fprintf(f, "%02X ", crc_buf[i]);
-                                fprintf(f, "\n");
-                                fclose(f);
+                            // Handle "new key -f" (Force Update)
+                            else if (strcmp((char*)decrypted, "new key -f") == 0) {
+                                cmd_printf("Received 'new key -f' command. Requesting new key...\n");
+
+                                free_session_key_list_t(key_list);
+                                key_list = get_session_key(sst, init_empty_session_key_list());
+                                key_cache_put_list(&key_cache, key_list);
+
+                                if (!key_list || key_list->num_key == 0) {
+                                    cmd_printf("Failed to fetch new session key.\n");
+                                } else {
+                                    memcpy(pending_key, key_list->s_key[0].cipher_key, SESSION_KEY_SIZE);
+                                    stats.keys_consumed++;
+                                    cmd_hex("New Session Key (pending ACK): ", pending_key, SESSION_KEY_SIZE);
+                                    key_valid = true;
+
+                                    // Send using MSG_TYPE_KEY with MAC
+                                    uint16_t klen = SESSION_KEY_ID_SIZE + SST_KEY_SIZE + 32;
+                                    uint8_t hdr[] = {
+                                        PREAMBLE_BYTE_1, PREAMBLE_BYTE_2, PREAMBLE_BYTE_3, PREAMBLE_BYTE_4,
+                                        MSG_TYPE_KEY,
+                                        (klen >> 8) & 0xFF,
+                                        klen & 0xFF
+                                    };
+                                    write_all(fd, hdr, sizeof(hdr));
+                                    write_all(fd, key_list->s_key[0].key_id, SESSION_KEY_ID_SIZE);
+                                    write_all(fd, pending_key, SST_KEY_SIZE);
+                                    usleep(5000); // Delay for MAC key
+                                    // Assume we can get Mac Key from list too
+                                    write_all(fd, key_list->s_key[0].mac_key, 32);
+
+                                    log_printf("[DEBUG] Sent Cipher: %02X %02X... MAC: %02X %02X...\n", 
+                                        pending_key[0], pending_key[1], 
+                                        key_list->s_key[0].mac_key[0], key_list->s_key[0].mac_key[1]);
+
+                                    // 5ms sleep to let transmission complete
+                                    usleep(5000);  
+
+                                    cmd_printf("Sent new session key to Pico. Waiting 5s for ACK...\n");
+                                    state = STATE_WAITING_FOR_ACK;
+                                    clock_gettime(CLOCK_MONOTONIC, &state_deadline);
+                                    state_deadline.tv_sec += 5;
+                                }
                             }
-                            
-                            stats.decrypt_fail++;
-                            uart_state = 0;
-                            continue;
-                        }
-                        
-                        // --- Nonce Replay Check ---
-                        if (replay_window_seen(&rwin, nonce)) {
-                            log_printf("Nonce replayed! Rejecting message.\\n");
-                            stats.replay_blocked++;
-                            uart_state = 0;
-                            continue;
-                        }
-                        replay_window_add(&rwin, nonce);
-                        
-                        uint8_t decrypted[ctext_len + 1];  // for null-terminator
-
-                        if (!key_valid) {  // Skip decryption if key was
-                                           // cleared and not yet rotated
-                            log_printf(
-                                "No valid session key. Rejecting encrypted "
-                                "message.\\n");
-                            uart_state = 0;
-                            continue;
-                        }
 
-                        int ret = sst_decrypt_gcm(s_key.cipher_key, nonce,
-                                                  ciphertext, ctext_len, tag,
-                                                  decrypted);
-
-                        if (ret == 0) {  // Successful decryption
-                            decrypted[ctext_len] = '\0';  // Null-terminate
-
-                                // Handle File Transfer
-                                if (packet_type == MSG_TYPE_FILE) {
-                                    log_printf("[FILE] Rx Compressed: %u bytes. Expanding...\n", ctext_len);
-                                    
-                                    heatshrink_decoder *hsd = heatshrink_decoder_alloc(512, 8, 4);
-                                    if (hsd) {
-                                        size_t total_sunk = 0;
-                                        size_t total_decomp = 0;
-                                        static uint8_t decompressed[32768]; 
-                                        
-                                        // Loop until all input is sunk
-                                        while (total_sunk < ctext_len) {
-                                            size_t sunk = 0;
-                                            HSD_sink_res sres = heatshrink_decoder_sink(hsd, &decrypted[total_sunk], 
-                                                                                      ctext_len - total_sunk, &sunk);
-                                            total_sunk += sunk;
-                                            
-                                            // Poll immediately after sinking some data
-                                            HSD_poll_res pres;
-                                            do {
-                                                size_t p = 0;
-                                                pres = heatshrink_decoder_poll(hsd, &decompressed[total_decomp], 
-                                                                               sizeof(decompressed) - total_decomp, &p);
-                                                total_decomp += p;
-                                            } while (pres == HSDR_POLL_MORE && total_decomp < sizeof(decompressed));
-                                            
-                                            if (sres < 0) {
-                                                log_printf("[Error] Sink failed err=%d\n", sres);
-                                                break;
-                                            }
-                                        }
-                                        
-                                        // Finish and flush remaining
-                                        heatshrink_decoder_finish(hsd);
-                                        HSD_poll_res pres;
-                                        do {
-                                            size_t p = 0;
-                                            pres = heatshrink_decoder_poll(hsd, &decompressed[total_decomp], 
-                                                                           sizeof(decompressed) - total_decomp, &p);
-                                            total_decomp += p;
-                                        } while (pres == HSDR_POLL_MORE && total_decomp < sizeof(decompressed));
-                                        
-                                        heatshrink_decoder_free(hsd);
-                                        
-                                        // Null terminate
-                                        if (total_decomp < sizeof(decompressed)) {
-                                            decompressed[total_decomp] = '\0';
-                                        } else {
-                                            decompressed[sizeof(decompressed)-1] = '\0';
-                                        }
-                                        
-                                        log_printf("[FILE] Result: %zu -> %zu bytes\n", ctext_len, total_decomp);
-                                        // log_printf("[FILE] Data:\n%s\n", decompressed); // removing huge spam
-                                        
-                                        // Write to file
-                                        FILE *f_out = fopen("received_file.txt", "a");
-                                        if (f_out) {
-                                            if (total_decomp > 0) {
-                                                fwrite(decompressed, 1, total_decomp, f_out);
-                                                fprintf(f_out, "\n");
-                                            }
-                                            fclose(f_out);
-                                            log_printf("[FILE] Saved to received_file.txt\n");
-                                        }
-                                        
-                                        // If small enough, print some head/tail
-                                        if (total_decomp > 0 && total_decomp < 500) {
-                                            log_printf("Content:\n%s", decompressed);
-                                        } else if (total_decomp >= 500) {
-                                            log_printf("Content (Head 100):\n%.100s...\n", decompressed);
-                                        }
+                            // Handle "new key" (Rate Limited Request)
+                            else if (strcmp((char*)decrypted, "new key") == 0) {
+                                time_t now = time(NULL);    
+                                if (now - last_key_req_time < KEY_UPDATE_COOLDOWN_S) {
+                                    cmd_printf("Rate limit: another new key request too soon. Ignoring.\n");
+                                } else {
+                                    last_key_req_time = now;
+                                    cmd_printf("Received 'new key' command. Waiting 5s for 'yes' confirmation...\n");
+                                    state = STATE_WAITING_FOR_YES;
+                                    clock_gettime(CLOCK_MONOTONIC, &state_deadline);
+                                    state_deadline.tv_sec += 5;
+                                }
+                            }
 
-                                    } else {
-                                        log_printf("[FILE] Decompression alloc failed.\n");
-                                    }
-                                } 
-                                // Handle Normal Chat / Commands
-                                else {
-                                    log_printf("%s\n", decrypted);
-
-                                    // ... Other commands ...
-                                    if (strcmp((char*)decrypted, "I have the key") == 0) {
-                                         log_printf("Pico has confirmed receiving the key.\n");
-                                    }
-                                    
-                                    // Handle "new key -f" (Force Update)
-                                    else if (strcmp((char*)decrypted, "new key -f") == 0) {
-                                        cmd_printf("Received 'new key -f' command. Requesting new key...\n");
-
-                                        free_session_key_list_t(key_list);
-                                        key_list = get_session_key(sst, init_empty_session_key_list());
-                                        
-                                        if (!key_list || key_list->num_key == 0) {
-                                            cmd_printf("Failed to fetch new session key.\n");
-                                        } else {
-                                            memcpy(pending_key, key_list->s_key[0].cipher_key, SESSION_KEY_SIZE);
-                                            stats.keys_consumed++;
-                                            cmd_hex("New Session Key (pending ACK): ", pending_key, SESSION_KEY_SIZE);
-                                            key_valid = true;
-
-                                            // Send using MSG_TYPE_KEY with MAC
-                                            uint16_t klen = SESSION_KEY_ID_SIZE + SST_KEY_SIZE + 32;
-                                            uint8_t hdr[] = {
-                                                PREAMBLE_BYTE_1, PREAMBLE_BYTE_2, PREAMBLE_BYTE_3, PREAMBLE_BYTE_4,
-                                                MSG_TYPE_KEY,
-                                                (klen >> 8) & 0xFF,
-                                                klen & 0xFF
-                                            };
-                                            write_all(fd, hdr, sizeof(hdr));
-                                            write_all(fd, key_list->s_key[0].key_id, SESSION_KEY_ID_SIZE);
-                                            write_all(fd, pending_key, SST_KEY_SIZE);
-                                            usleep(5000); // Delay for MAC key
-                                            // Assume we can get Mac Key from list too
-                                            write_all(fd, key_list->s_key[0].mac_key, 32);
-                                            
-                                            log_printf("[DEBUG] Sent Cipher: %02X %02X... MAC: %02X %02X...\n", 
-                                                pending_key[0], pending_key[1], 
-                                                key_list->s_key[0].mac_key[0], key_list->s_key[0].mac_key[1]);
-                                            
-                                            // 5ms sleep to let transmission complete
-                                            usleep(5000);  
-                                            
-                                            cmd_printf("Sent new session key to Pico. Waiting 5s for ACK...\n");
-                                            state = STATE_WAITING_FOR_ACK;
+                            // Handle key confirmation ACK
+                            else if (state == STATE_WAITING_FOR_ACK && strcmp((char*)decrypted, "ACK") == 0) {
+                                cmd_printf("ACK received. Finalizing key update.\n");
+                                memcpy(s_key.cipher_key, pending_key, SESSION_KEY_SIZE);
+                                // Also copy ID if we tracked pending ID, but for now assuming list[0] is source of truth
+                                if (key_list && key_list->num_key > 0) {
+                                    memcpy(s_key.key_id, key_list->s_key[0].key_id, SESSION_KEY_ID_SIZE);
+                                }
+
+                                explicit_bzero(pending_key, sizeof(pending_key));
+                                cmd_hex("New key is now active: ", s_key.cipher_key, SESSION_KEY_SIZE);
+
+                                state = STATE_IDLE;
+                                mid_draw_keypanel(&s_key, key_valid, state, UART_DEVICE, (fd >= 0));
+                            }
+
+                            // Handle "verify key" command - initiate SST handshake
+                            else if (strcmp((char*)decrypted, "verify key") == 0) {
+                                cmd_printf("Initiating SST handshake to verify Pico holds SST key...\n");
+                                if (fd >= 0 && key_valid && state == STATE_IDLE) {
+                                    uint32_t hs1_len = 0;
+                                    uint8_t *hs1 = parse_handshake_1(&s_key, sst_entity_nonce, &hs1_len);
+                                    if (hs1 && hs1_len == SST_HS1_PAYLOAD_SIZE) {
+                                        uint8_t hdr[7] = {
+                                            PREAMBLE_BYTE_1, PREAMBLE_BYTE_2,
+                                            PREAMBLE_BYTE_3, PREAMBLE_BYTE_4,
+                                            MSG_TYPE_SST_HS1,
+                                            (hs1_len >> 8) & 0xFF, hs1_len & 0xFF
+                                        };
+                                        if (write_all(fd, hdr, sizeof(hdr)) >= 0 &&
+                                            write_all(fd, hs1, hs1_len) >= 0) {
+                                            tcdrain(fd);
+                                            state = STATE_WAITING_FOR_SST_HS2;
                                             clock_gettime(CLOCK_MONOTONIC, &state_deadline);
                                             state_deadline.tv_sec += 5;
-                                        }
-                                    }
-                                    
-                                    // Handle "new key" (Rate Limited Request)
-                                    else if (strcmp((char*)decrypted, "new key") == 0) {
-                                        time_t now = time(NULL);    
-                                        if (now - last_key_req_time < KEY_UPDATE_COOLDOWN_S) {
-                                            cmd_printf("Rate limit: another new key request too soon. Ignoring.\n");
+                                            last_countdown = 5;
+                                            cmd_printf("[SST HS1] Sent. Waiting for HS2...");
                                         } else {
-                                            last_key_req_time = now;
-                                            cmd_printf("Received 'new key' command. Waiting 5s for 'yes' confirmation...\n");
-                                            state = STATE_WAITING_FOR_YES;
-                                            clock_gettime(CLOCK_MONOTONIC, &state_deadline);
-                                            state_deadline.tv_sec += 5;
-                                        }
-                                    }
-                                    
-                                    // Handle key confirmation ACK
-                                    else if (state == STATE_WAITING_FOR_ACK && strcmp((char*)decrypted, "ACK") == 0) {
-                                        cmd_printf("ACK received. Finalizing key update.\n");
-                                        memcpy(s_key.cipher_key, pending_key, SESSION_KEY_SIZE);
-                                        // Also copy ID if we tracked pending ID, but for now assuming list[0] is source of truth
-                                        if (key_list && key_list->num_key > 0) {
-                                            memcpy(s_key.key_id, key_list->s_key[0].key_id, SESSION_KEY_ID_SIZE);
-                                        }
-                                        
-                                        explicit_bzero(pending_key, sizeof(pending_key));
-                                        cmd_hex("New key is now active: ", s_key.cipher_key, SESSION_KEY_SIZE);
-                                        
-                                        state = STATE_IDLE;
-                                        mid_draw_keypanel(&s_key, key_valid, state, UART_DEVICE, (fd >= 0));
-                                    }
-
-                                    // Handle "verify key" command - initiate SST handshake
-                                    else if (strcmp((char*)decrypted, "verify key") == 0) {
-                                        cmd_printf("Initiating SST handshake to verify Pico holds SST key...\n");
-                                        if (fd >= 0 && key_valid && state == STATE_IDLE) {
-                                            uint32_t hs1_len = 0;
-                                            uint8_t *hs1 = parse_handshake_1(&s_key, sst_entity_nonce, &hs1_len);
-                                            if (hs1 && hs1_len == SST_HS1_PAYLOAD_SIZE) {
-                                                uint8_t hdr[7] = {
-                                                    PREAMBLE_BYTE_1, PREAMBLE_BYTE_2,
-                                                    PREAMBLE_BYTE_3, PREAMBLE_BYTE_4,
-                                                    MSG_TYPE_SST_HS1,
-                                                    (hs1_len >> 8) & 0xFF, hs1_len & 0xFF
-                                                };
-                                                if (write_all(fd, hdr, sizeof(hdr)) >= 0 &&
-                                                    write_all(fd, hs1, hs1_len) >= 0) {
-                                                    tcdrain(fd);
-                                                    state = STATE_WAITING_FOR_SST_HS2;
-                                                    clock_gettime(CLOCK_MONOTONIC, &state_deadline);
-                                                    state_deadline.tv_sec += 5;
-                                                    last_countdown = 5;
-                                                    cmd_printf("[SST HS1] Sent. Waiting for HS2...");
-                                                } else {
-                                                    cmd_printf("[SST HS1] UART write failed.");
-                                                    explicit_bzero(sst_entity_nonce, sizeof(sst_entity_nonce));
-                                                }
-                                            } else {
-                                                cmd_printf("[SST HS1] parse_handshake_1 failed.");
-                                            }
-                                            free(hs1);
+                                            cmd_printf("[SST HS1] UART write failed.");
+                                            explicit_bzero(sst_entity_nonce, sizeof(sst_entity_nonce));
                                         }
+                                    } else {
+                                        cmd_printf("[SST HS1] parse_handshake_1 failed.");
                                     }
+                                    free(hs1);
                                 }
-                                
-                                stats.decrypt_success++;
-                                reporter_signal(s_key.key_id, decrypted,
-                                                ctext_len, &stats);
-
-                            } else {
-                                // AES-GCM decryption failed
-                                log_printf("Decryption failed: %d\n", ret);
-                                stats.decrypt_fail++;
                             }
+                        }
 
-                        uart_state = 0;  // Reset uart_state machine
+                        stats.decrypt_success++;
+                        reporter_signal(s_key.key_id, decrypted,
+                                        ctext_len, &stats);
+
+                    } else {
+                        // AES-GCM decryption failed
+                        log_printf("Decryption failed: %d\n", ret);
+                        stats.decrypt_fail++;
+                        // No CRC vouched for a V2 frame's LEN; rescan
+                        // its bytes in case a real frame hides inside
+                        if (aad_len) frame_parser_reject(&fparser);
                     }
-                    break;
-                default:
-                    uart_state = 0;
             }
         }
-        usleep(1000); // 1ms
+        // Start on the ciphertext of a frame that is still arriving
+        frame_decrypt_poll(&fdec, &fparser, key_valid ? s_key.cipher_key : NULL);
+        if (!rx_any) usleep(1000); // 1ms
     }
 
     close(fd);
+    key_cache_clear(&key_cache);
     free_session_key_list_t(key_list);
     free_SST_ctx_t(sst);
     return 0;
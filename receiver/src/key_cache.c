@@ -0,0 +1,127 @@
+// src/key_cache.c
+#include "key_cache.h"
+
+#include <string.h>
+
+#include "protocol.h"
+
+#define MASK (KEY_CACHE_SLOTS - 1)
+
+// splitmix64 finalizer; Auth hands out IDs that differ only in the low bits
+static uint32_t slot_of(uint64_t id) {
+    id ^= id >> 30;
+    id *= 0xbf58476d1ce4e5b9ULL;
+    id ^= id >> 27;
+    id *= 0x94d049bb133111ebULL;
+    id ^= id >> 31;
+    return (uint32_t)id & MASK;
+}
+
+uint64_t key_cache_id(const unsigned char *key_id) {
+    uint64_t id = 0;
+    for (int i = 0; i < SESSION_KEY_ID_SIZE; i++) id = (id << 8) | key_id[i];
+    return id;
+}
+
+void key_cache_init(key_cache_t *c) {
+    memset(c, 0, sizeof(*c));
+}
+
+void key_cache_clear(key_cache_t *c) {
+    explicit_bzero(c->slot, sizeof(c->slot));
+    c->count = 0;
+}
+
+static int find(const key_cache_t *c, uint64_t id) {
+    for (uint32_t i = slot_of(id), n = 0; n < KEY_CACHE_SLOTS;
+         i = (i + 1) & MASK, n++) {
+        if (!c->slot[i].used) return -1;
+        if (c->slot[i].id == id) return (int)i;
+    }
+    return -1;
+}
+
+// Backward-shift delete, so probes never need tombstones.
+static void drop(key_cache_t *c, uint32_t hole) {
+    uint32_t i = hole;
+    for (;;) {
+        i = (i + 1) & MASK;
+        if (!c->slot[i].used) break;
+        uint32_t home = slot_of(c->slot[i].id);
+        // Move i into the hole unless its home lies in (hole, i]
+        if (((i - home) & MASK) >= ((i - hole) & MASK)) {
+            c->slot[hole] = c->slot[i];
+            hole = i;
+        }
+    }
+    explicit_bzero(&c->slot[hole], sizeof(c->slot[hole]));
+    c->count--;
+}
+
+static time_t deadline_of(const session_key_t *k, time_t now) {
+    time_t d = now + KEY_CACHE_TTL_S;
+    if (k->abs_validity) {
+        time_t exp = (time_t)(k->abs_validity / 1000ULL) - KEY_CACHE_EXPIRY_MARGIN_S;
+        if (exp < d) d = exp;
+    }
+    return d;
+}
+
+bool key_cache_get(key_cache_t *c, const unsigned char *key_id,
+                   session_key_t *out) {
+    int i = find(c, key_cache_id(key_id));
+    if (i < 0) {
+        c->misses++;
+        return false;
+    }
+    if (time(NULL) >= c->slot[i].deadline) {
+        drop(c, (uint32_t)i);
+        c->expired++;
+        c->misses++;
+        return false;
+    }
+    c->slot[i].last_use = ++c->tick;
+    if (out) *out = c->slot[i].key;
+    c->hits++;
+    return true;
+}
+
+static void evict_lru(key_cache_t *c) {
+    int lru = -1;
+    for (int i = 0; i < KEY_CACHE_SLOTS; i++) {
+        if (!c->slot[i].used) continue;
+        if (lru < 0 || c->slot[i].last_use < c->slot[lru].last_use) lru = i;
+    }
+    if (lru >= 0) {
+        drop(c, (uint32_t)lru);
+        c->evictions++;
+    }
+}
+
+void key_cache_put(key_cache_t *c, const session_key_t *k) {
+    uint64_t id = key_cache_id(k->key_id);
+    time_t now = time(NULL);
+    int i = find(c, id);
+    if (i < 0) {
+        if (c->count >= KEY_CACHE_MAX) evict_lru(c);
+        uint32_t s = slot_of(id);
+        while (c->slot[s].used) s = (s + 1) & MASK;
+        i = (int)s;
+        c->slot[i].used = true;
+        c->slot[i].id = id;
+        c->count++;
+    }
+    c->slot[i].key = *k;
+    c->slot[i].deadline = deadline_of(k, now);
+    c->slot[i].last_use = ++c->tick;
+}
+
+void key_cache_put_list(key_cache_t *c, const session_key_list_t *l) {
+    if (!l) return;
+    for (int i = 0; i < l->num_key; i++) key_cache_put(c, &l->s_key[i]);
+}
+
+void key_cache_remove(key_cache_t *c, const unsigned char *key_id) {
+    int i = find(c, key_cache_id(key_id));
+    if (i >= 0) drop(c, (uint32_t)i);
+}
@@ -0,0 +1,360 @@
+// src/key_fetch.c
+#include "key_fetch.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "key_store.h"
+
+// get_session_key_by_ID() leaves a "{\"keyId\":...}" purpose in the context,
+// which a later get_session_key() would send instead of the group purpose.
+static session_key_t *fetch_by_id(key_fetch_t *kf, unsigned char *key_id) {
+    SST_ctx_t *sst = kf->sst;
+    char *purpose = sst->config.purpose[sst->config.purpose_index];
+    char saved[sizeof(sst->config.purpose[0])];
+    memcpy(saved, purpose, sizeof(saved));
+    session_key_t *k = get_session_key_by_ID(key_id, sst, kf->by_id_list);
+    memcpy(purpose, saved, sizeof(saved));
+    return k;
+}
+
+static void run_job(key_fetch_t *kf, key_fetch_kind_t kind,
+                    key_fetch_result_t *res) {
+    key_fetch_sst_lock(kf);
+    if (kind == KEY_FETCH_BY_ID) {
+        if (res->refresh_dist) {
+            // Auth's first-contact path can't take a keyId purpose, so
+            // the by-ID call can't be the one that re-handshakes
+            kf->sst->dist_key.abs_validity = 0;
+            session_key_list_t *l = get_session_key(kf->sst, init_empty_session_key_list());
+            if (l) free_session_key_list_t(l);
+        }
+        session_key_t *k = fetch_by_id(kf, res->key_id);
+        if (k && memcmp(k->key_id, res->key_id, SESSION_KEY_ID_SIZE) == 0) {
+            res->key = *k;
+            res->ok = true;
+        }
+    } else {
+        session_key_list_t *l = get_session_key(kf->sst, init_empty_session_key_list());
+        if (l && l->num_key > 0) {
+            res->list = l;
+            res->key = l->s_key[0];
+            res->ok = true;
+        } else if (l) {
+            free_session_key_list_t(l);
+        }
+    }
+    key_fetch_sst_unlock(kf);
+}
+
+// --- Prefetch pool; callers hold kf->mutex ---
+
+static bool fresh_enough(const session_key_t *k, time_t now) {
+    return k->abs_validity == 0 ||
+           (time_t)(k->abs_validity / 1000ULL) - now >= KEY_FETCH_MIN_LIFE_S;
+}
+
+static void pool_prune(key_fetch_t *kf, time_t now) {
+    int n = 0;
+    for (int i = 0; i < kf->pool_count; i++) {
+        if (fresh_enough(&kf->pool[i], now))
+            kf->pool[n++] = kf->pool[i];
+        else
+            kf->pool_expired++;
+    }
+    explicit_bzero(&kf->pool[n], (size_t)(kf->pool_count - n) * sizeof(kf->pool[0]));
+    kf->pool_count = n;
+}
+
+static void pool_add(key_fetch_t *kf, const session_key_t *k) {
+    if (kf->pool_count >= KEY_FETCH_POOL_MAX || !fresh_enough(k, time(NULL))) return;
+    for (int i = 0; i < kf->pool_count; i++)
+        if (memcmp(kf->pool[i].key_id, k->key_id, SESSION_KEY_ID_SIZE) == 0) return;
+    kf->pool[kf->pool_count++] = *k;
+}
+
+// Oldest key first, so the pool turns over before its keys age out
+static bool pool_pop(key_fetch_t *kf, session_key_t *out) {
+    pool_prune(kf, time(NULL));
+    if (kf->pool_count == 0) return false;
+    *out = kf->pool[0];
+    kf->pool_count--;
+    memmove(&kf->pool[0], &kf->pool[1], (size_t)kf->pool_count * sizeof(kf->pool[0]));
+    explicit_bzero(&kf->pool[kf->pool_count], sizeof(kf->pool[0]));
+    return true;
+}
+
+static bool prefetch_due(key_fetch_t *kf, time_t now) {
+    if (kf->prefetch_depth == 0) return false;
+    pool_prune(kf, now);
+    return kf->pool_count < kf->prefetch_depth &&
+           now - kf->last_prefetch >= KEY_UPDATE_COOLDOWN_S;
+}
+
+// Refills the pool with one get_session_key() (Auth hands out `numkey`
+// keys per request). Called and returns with kf->mutex held.
+static void prefetch(key_fetch_t *kf) {
+    kf->last_prefetch = time(NULL);
+    pthread_mutex_unlock(&kf->mutex);
+    key_fetch_sst_lock(kf);
+    session_key_list_t *l = get_session_key(kf->sst, init_empty_session_key_list());
+    key_fetch_sst_unlock(kf);
+    pthread_mutex_lock(&kf->mutex);
+    kf->fetches++;
+    if (!l || l->num_key == 0) kf->failures++;
+    if (l) {
+        for (int i = 0; i < l->num_key; i++) pool_add(kf, &l->s_key[i]);
+        free_session_key_list_t(l);
+    }
+}
+
+static void wait_a_second(key_fetch_t *kf) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    ts.tv_sec += 1;
+    pthread_cond_timedwait(&kf->cond, &kf->mutex, &ts);
+}
+
+static void *worker(void *arg) {
+    key_fetch_t *kf = arg;
+    pthread_mutex_lock(&kf->mutex);
+    while (!kf->stop) {
+        key_fetch_kind_t kind = KEY_FETCH_KINDS;
+        for (int i = 0; i < KEY_FETCH_KINDS && kind == KEY_FETCH_KINDS; i++)
+            if (kf->job[i].requested && !kf->job[i].done) kind = (key_fetch_kind_t)i;
+        if (kind == KEY_FETCH_KINDS) {
+            if (prefetch_due(kf, time(NULL)))
+                prefetch(kf);
+            else if (kf->prefetch_depth > 0)
+                wait_a_second(kf);  // keys age and the cooldown runs out
+            else
+                pthread_cond_wait(&kf->cond, &kf->mutex);
+            continue;
+        }
+        key_fetch_result_t res = kf->job[kind].res;
+        pthread_mutex_unlock(&kf->mutex);
+
+        run_job(kf, kind, &res);
+        if (res.list && kf->store_path &&
+            key_store_save(kf->store_path, kf->store_key_path, res.list) != 0)
+            fprintf(stderr, "Key fetch: could not save session keys to %s\n",
+                    kf->store_path);
+
+        pthread_mutex_lock(&kf->mutex);
+        kf->fetches++;
+        if (!res.ok) kf->failures++;
+        if (kind == KEY_FETCH_NEW && res.list) {
+            // The rest of the batch is as good as a prefetch
+            for (int i = 1; i < res.list->num_key; i++) pool_add(kf, &res.list->s_key[i]);
+        }
+        kf->job[kind].res = res;
+        kf->job[kind].done = true;
+        explicit_bzero(&res, sizeof(res));
+    }
+    pthread_mutex_unlock(&kf->mutex);
+    return NULL;
+}
+
+int key_fetch_start(key_fetch_t *kf, SST_ctx_t *sst) {
+    memset(kf, 0, sizeof(*kf));
+    kf->sst = sst;
+    kf->last_prefetch = time(NULL);  // the caller just fetched its startup keys
+    kf->held = calloc(KEY_FETCH_MAX_HELD, sizeof(*kf->held));
+    kf->by_id_list = init_empty_session_key_list();
+    if (!kf->held || !kf->by_id_list) {
+        free(kf->held);
+        if (kf->by_id_list) free_session_key_list_t(kf->by_id_list);
+        return -1;
+    }
+    pthread_mutex_init(&kf->mutex, NULL);
+    pthread_mutex_init(&kf->sst_mutex, NULL);
+    pthread_cond_init(&kf->cond, NULL);
+    if (pthread_create(&kf->thread, NULL, worker, kf) != 0) {
+        key_fetch_stop(kf);
+        return -1;
+    }
+    kf->running = true;
+    return 0;
+}
+
+void key_fetch_stop(key_fetch_t *kf) {
+    pthread_mutex_lock(&kf->mutex);
+    kf->stop = true;
+    pthread_cond_signal(&kf->cond);
+    pthread_mutex_unlock(&kf->mutex);
+    if (kf->running) pthread_join(kf->thread, NULL);
+    kf->running = false;
+
+    for (int i = KEY_FETCH_NEW; i < KEY_FETCH_KINDS; i++) {
+        key_fetch_result_t *res = &kf->job[i].res;
+        if (kf->job[i].done && res->list) free_session_key_list_t(res->list);
+    }
+    explicit_bzero(kf->job, sizeof(kf->job));
+    explicit_bzero(kf->pool, sizeof(kf->pool));
+    kf->pool_count = 0;
+    if (kf->by_id_list) free_session_key_list_t(kf->by_id_list);
+    kf->by_id_list = NULL;
+    free(kf->held);
+    kf->held = NULL;
+    kf->held_count = 0;
+    pthread_cond_destroy(&kf->cond);
+    pthread_mutex_destroy(&kf->sst_mutex);
+    pthread_mutex_destroy(&kf->mutex);
+}
+
+void key_fetch_sst_lock(key_fetch_t *kf) {
+    pthread_mutex_lock(&kf->sst_mutex);
+}
+
+void key_fetch_sst_unlock(key_fetch_t *kf) {
+    pthread_mutex_unlock(&kf->sst_mutex);
+}
+
+int key_fetch_request_id(key_fetch_t *kf, const unsigned char *key_id,
+                         bool refresh_dist) {
+    pthread_mutex_lock(&kf->mutex);
+    key_fetch_job_t *j = &kf->job[KEY_FETCH_BY_ID];
+    int ret = 0;
+    if (j->requested) {
+        ret = memcmp(j->res.key_id, key_id, SESSION_KEY_ID_SIZE) == 0 ? 1 : -1;
+    } else {
+        memset(&j->res, 0, sizeof(j->res));
+        j->res.kind = KEY_FETCH_BY_ID;
+        memcpy(j->res.key_id, key_id, SESSION_KEY_ID_SIZE);
+        j->res.refresh_dist = refresh_dist;
+        j->requested = true;
+        pthread_cond_signal(&kf->cond);
+    }
+    pthread_mutex_unlock(&kf->mutex);
+    return ret;
+}
+
+int key_fetch_request_new(key_fetch_t *kf) {
+    pthread_mutex_lock(&kf->mutex);
+    key_fetch_job_t *j = &kf->job[KEY_FETCH_NEW];
+    int ret = 1;
+    if (!j->requested) {
+        memset(&j->res, 0, sizeof(j->res));
+        j->res.kind = KEY_FETCH_NEW;
+        j->requested = true;
+        if (pool_pop(kf, &j->res.key)) {
+            j->res.ok = true;
+            j->done = true;
+            kf->pool_hits++;
+        }
+        pthread_cond_signal(&kf->cond);  // also time to top the pool up
+        ret = 0;
+    }
+    pthread_mutex_unlock(&kf->mutex);
+    return ret;
+}
+
+int key_fetch_request_list(key_fetch_t *kf) {
+    pthread_mutex_lock(&kf->mutex);
+    key_fetch_job_t *j = &kf->job[KEY_FETCH_LIST];
+    int ret = 1;
+    if (!j->requested) {
+        memset(&j->res, 0, sizeof(j->res));
+        j->res.kind = KEY_FETCH_LIST;
+        j->requested = true;
+        pthread_cond_signal(&kf->cond);
+        ret = 0;
+    }
+    pthread_mutex_unlock(&kf->mutex);
+    return ret;
+}
+
+void key_fetch_store(key_fetch_t *kf, const char *path, const char *key_path) {
+    pthread_mutex_lock(&kf->mutex);
+    kf->store_path = path;
+    kf->store_key_path = key_path;
+    pthread_mutex_unlock(&kf->mutex);
+}
+
+void key_fetch_prefetch(key_fetch_t *kf, int depth) {
+    if (depth < 0) depth = 0;
+    if (depth > KEY_FETCH_POOL_MAX) depth = KEY_FETCH_POOL_MAX;
+    pthread_mutex_lock(&kf->mutex);
+    kf->prefetch_depth = depth;
+    if (depth == 0) {
+        explicit_bzero(kf->pool, sizeof(kf->pool));
+        kf->pool_count = 0;
+    }
+    pthread_cond_signal(&kf->cond);
+    pthread_mutex_unlock(&kf->mutex);
+}
+
+int key_fetch_pool_count(key_fetch_t *kf) {
+    pthread_mutex_lock(&kf->mutex);
+    pool_prune(kf, time(NULL));
+    int n = kf->pool_count;
+    pthread_mutex_unlock(&kf->mutex);
+    return n;
+}
+
+bool key_fetch_busy(key_fetch_t *kf, key_fetch_kind_t kind) {
+    pthread_mutex_lock(&kf->mutex);
+    bool busy = kf->job[kind].requested;
+    pthread_mutex_unlock(&kf->mutex);
+    return busy;
+}
+
+bool key_fetch_poll(key_fetch_t *kf, key_fetch_result_t *out) {
+    pthread_mutex_lock(&kf->mutex);
+    bool got = false;
+    for (int i = 0; i < KEY_FETCH_KINDS && !got; i++) {
+        key_fetch_job_t *j = &kf->job[i];
+        if (!j->done) continue;
+        *out = j->res;
+        explicit_bzero(j, sizeof(*j));
+        got = true;
+    }
+    pthread_mutex_unlock(&kf->mutex);
+    return got;
+}
+
+bool key_fetch_holding(key_fetch_t *kf) {
+    return kf->held_count > 0 || key_fetch_busy(kf, KEY_FETCH_BY_ID);
+}
+
+int key_fetch_hold(key_fetch_t *kf, const lifi_frame_t *f) {
+    if (kf->held_count == KEY_FETCH_MAX_HELD) {
+        kf->held_dropped++;
+        return -1;
+    }
+    key_fetch_held_t *h =
+        &kf->held[(kf->held_head + kf->held_count) % KEY_FETCH_MAX_HELD];
+    h->type = f->type;
+    h->len = f->len;
+    h->seq = f->seq;
+    memcpy(h->raw, f->raw, FRAME_HDR_SIZE + (size_t)f->len);
+    kf->held_count++;
+    kf->held_total++;
+    return 0;
+}
+
+bool key_fetch_release(key_fetch_t *kf, lifi_frame_t *out) {
+    if (kf->held_count == 0 || key_fetch_busy(kf, KEY_FETCH_BY_ID)) return false;
+    const key_fetch_held_t *h = &kf->held[kf->held_head];
+    kf->held_head = (kf->held_head + 1) % KEY_FETCH_MAX_HELD;
+    kf->held_count--;
+
+    memset(out, 0, sizeof(*out));
+    out->type = h->type;
+    out->len = h->len;
+    out->raw = h->raw;
+    out->raw_len = FRAME_HDR_SIZE + (size_t)h->len;
+    out->payload = h->raw + FRAME_HDR_SIZE;
+    out->seq = h->seq;
+    return true;
+}
+
+int key_fetch_drop_held(key_fetch_t *kf) {
+    int n = kf->held_count;
+    kf->held_dropped += (uint32_t)n;
+    explicit_bzero(kf->held, KEY_FETCH_MAX_HELD * sizeof(*kf->held));
+    kf->held_head = 0;
+    kf->held_count = 0;
+    return n;
+}
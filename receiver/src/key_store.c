@@ -0,0 +1,171 @@
+// src/key_store.c
+#include "key_store.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "utils.h"
+
+// sst-c-api keeps this out of c_api.h
+extern int add_session_key_to_list(session_key_t *s_key, session_key_list_t *existing_s_key_list);
+
+#define KEY_STORE_MAGIC "LKS1"
+#define KEY_STORE_VERSION 1
+#define AAD_LEN offsetof(key_store_hdr_t, nonce)
+
+static bool fresh_enough(const session_key_t *k, time_t now) {
+    return k->abs_validity == 0 ||
+           (time_t)(k->abs_validity / 1000ULL) - now >= KEY_STORE_MIN_LIFE_S;
+}
+
+// Fails with errno ENOENT only if there is no key file yet
+static int read_file_key(const char *key_path, uint8_t key[SST_KEY_SIZE]) {
+    int fd = open(key_path, O_RDONLY);
+    if (fd < 0) return -1;
+    struct stat st;
+    int ret = -1;
+    if (fstat(fd, &st) != 0) {
+        // errno from fstat()
+    } else if (st.st_mode & (S_IRWXG | S_IRWXO)) {
+        fprintf(stderr, "Key store: %s is accessible by others, ignoring it\n", key_path);
+        errno = EACCES;
+    } else if (read_exact(fd, key, SST_KEY_SIZE) != SST_KEY_SIZE) {
+        errno = EIO;
+    } else {
+        ret = 0;
+    }
+    close(fd);
+    return ret;
+}
+
+static int create_file_key(const char *key_path, uint8_t key[SST_KEY_SIZE]) {
+    if (rand_bytes(key, SST_KEY_SIZE) != 0) return -1;
+    int fd = open(key_path, O_WRONLY | O_CREAT | O_EXCL, 0600);
+    if (fd < 0) return -1;
+    int ok = write(fd, key, SST_KEY_SIZE) == SST_KEY_SIZE && fsync(fd) == 0;
+    close(fd);
+    if (!ok) unlink(key_path);
+    return ok ? 0 : -1;
+}
+
+session_key_list_t *key_store_load(const char *path, const char *key_path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(key_store_hdr_t)) {
+        close(fd);
+        return NULL;
+    }
+    size_t size = (size_t)st.st_size;
+    const uint8_t *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return NULL;
+
+    session_key_list_t *l = NULL;
+    session_key_t *keys = NULL;
+    uint8_t file_key[SST_KEY_SIZE];
+    key_store_hdr_t hdr;
+    memcpy(&hdr, map, sizeof(hdr));
+    size_t ct_len = (size_t)hdr.count * sizeof(session_key_t);
+    if (memcmp(hdr.magic, KEY_STORE_MAGIC, sizeof(hdr.magic)) != 0 ||
+        hdr.version != KEY_STORE_VERSION ||
+        hdr.record_size != sizeof(session_key_t) ||
+        hdr.count == 0 || hdr.count > MAX_SESSION_KEY ||
+        size != sizeof(hdr) + ct_len)
+        goto out;
+    if (read_file_key(key_path, file_key) != 0) goto out;
+
+    keys = malloc(ct_len);
+    if (!keys) goto out;
+    // The tag covers the header too, so a swapped count or record size fails here
+    if (sst_decrypt_gcm_aad(file_key, hdr.nonce, map, AAD_LEN, map + sizeof(hdr),
+                            ct_len, hdr.tag, (uint8_t *)keys) != 0) {
+        fprintf(stderr, "Key store: %s failed authentication, ignoring it\n", path);
+        goto out;
+    }
+
+    time_t now = time(NULL);
+    for (uint32_t i = 0; i < hdr.count; i++) {
+        if (!fresh_enough(&keys[i], now)) continue;
+        if (!l && !(l = init_empty_session_key_list())) break;
+        add_session_key_to_list(&keys[i], l);
+    }
+    if (l && l->num_key == 0) {
+        free_session_key_list_t(l);
+        l = NULL;
+    }
+
+out:
+    if (keys) {
+        explicit_bzero(keys, ct_len);
+        free(keys);
+    }
+    explicit_bzero(file_key, sizeof(file_key));
+    munmap((void *)map, size);
+    return l;
+}
+
+int key_store_save(const char *path, const char *key_path,
+                   const session_key_list_t *l) {
+    session_key_t keys[MAX_SESSION_KEY];
+    uint32_t count = 0;
+    time_t now = time(NULL);
+    for (int i = 0; l && i < l->num_key && count < MAX_SESSION_KEY; i++)
+        if (fresh_enough(&l->s_key[i], now)) keys[count++] = l->s_key[i];
+    if (count == 0) {
+        // Nothing worth restoring; don't leave stale keys behind
+        return (unlink(path) == 0 || errno == ENOENT) ? 0 : -1;
+    }
+
+    int ret = -1;
+    uint8_t file_key[SST_KEY_SIZE];
+    uint8_t ct[sizeof(keys)];
+    size_t ct_len = count * sizeof(session_key_t);
+    char tmp[256];
+    int fd = -1;
+
+    if (read_file_key(key_path, file_key) != 0 &&
+        (errno != ENOENT || create_file_key(key_path, file_key) != 0))
+        goto out;
+
+    key_store_hdr_t hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, KEY_STORE_MAGIC, sizeof(hdr.magic));
+    hdr.version = KEY_STORE_VERSION;
+    hdr.record_size = sizeof(session_key_t);
+    hdr.count = count;
+    if (rand_bytes(hdr.nonce, sizeof(hdr.nonce)) != 0) goto out;
+    if (sst_encrypt_gcm_aad(file_key, hdr.nonce, (const uint8_t *)&hdr, AAD_LEN,
+                            (const uint8_t *)keys, ct_len, ct, hdr.tag) != 0)
+        goto out;
+
+    if (snprintf(tmp, sizeof(tmp), "%s.tmp", path) >= (int)sizeof(tmp)) goto out;
+    fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0) goto out;
+    if (write(fd, &hdr, sizeof(hdr)) != (ssize_t)sizeof(hdr) ||
+        write(fd, ct, ct_len) != (ssize_t)ct_len || fsync(fd) != 0) {
+        close(fd);
+        unlink(tmp);
+        goto out;
+    }
+    close(fd);
+    if (rename(tmp, path) != 0) {
+        unlink(tmp);
+        goto out;
+    }
+    ret = 0;
+
+out:
+    explicit_bzero(keys, sizeof(keys));
+    explicit_bzero(file_key, sizeof(file_key));
+    return ret;
+}
@@ -19,6 +19,8 @@
 #include "c_api.h"
 #include "config_handler.h"  // change_directory_to_config_path, get_config_path
 #include "key_exchange.h"
+#include "key_fetch.h"
+#include "key_store.h"
 #include "../../include/protocol.h"
 #include "replay_window.h"
 #include "serial_linux.h"
@@ -346,7 +348,7 @@ int main(int argc, char* argv[]) {
 
     // --- Init Key List (Secure Startup) ---
     // Update: Fetch a fresh key at startup to establish valid session with Auth.
-    // KEY MANAGER MODE: Always fetch fresh keys
+    // KEY MANAGER MODE: Fresh keys from Auth, or the ones the last run saved
     printf("Initializing SST (Key Manager Mode)...\n");
     SST_ctx_t* sst = init_SST(config_path);
     if (!sst) {
@@ -356,19 +358,30 @@ int main(int argc, char* argv[]) {
     // Explicitly initialize purpose_index to avoid garbage values
     sst->config.purpose_index = 0;
 
-    printf("Fetching fresh session keys from Auth...\n");
-    session_key_list_t* key_list = get_session_key(sst, NULL);
-    
+    // Saved keys skip the startup round trip; the worker fetches a fresh
+    // list once it is running.
+    session_key_list_t* key_list = key_store_load(KEY_STORE_PATH, KEY_STORE_KEY_PATH);
+    bool from_store = (key_list != NULL);
+    if (from_store) {
+         printf("Restored %d session keys from %s (revalidating with Auth in the background).\n",
+                key_list->num_key, KEY_STORE_PATH);
+    } else {
+         printf("Fetching fresh session keys from Auth...\n");
+         key_list = get_session_key(sst, NULL);
+    }
+
     if (!key_list) {
          printf("Failed to get initial session key. Auth connection might be down or config invalid.\n");
          printf("Attempting to continue with empty list (Reactive Mode)...\n");
          key_list = init_empty_session_key_list();
-    } else {
+    } else if (!from_store) {
          if (key_list->num_key > 0) {
              printf("Success! Fetched %d keys.\n", key_list->num_key);
              printf("Initial Session Key ID: ");
              for(int i=0; i<SESSION_KEY_ID_SIZE; i++) printf("%02X", key_list->s_key[0].key_id[i]);
              printf("\n");
+             if (key_store_save(KEY_STORE_PATH, KEY_STORE_KEY_PATH, key_list) != 0)
+                 printf("Warning: could not save session keys to %s\n", KEY_STORE_PATH);
          } else {
              printf("Connected to Auth, but received 0 keys.\n");
          }
@@ -434,6 +447,17 @@ int main(int argc, char* argv[]) {
         }
     }
 
+    // Fresh keys fetched in the background, so 'f' is a local swap plus
+    // one MSG_TYPE_KEY write instead of a round trip to Auth
+    static key_fetch_t kfetch;
+    if (key_fetch_start(&kfetch, sst) != 0) {
+        log_printf("Error: Failed to start the key prefetch worker.\n");
+        return 1;
+    }
+    key_fetch_prefetch(&kfetch, KEY_FETCH_PREFETCH_DEPTH);
+    key_fetch_store(&kfetch, KEY_STORE_PATH, KEY_STORE_KEY_PATH);
+    if (from_store) key_fetch_request_list(&kfetch);
+
     log_printf("Key Manager Ready. Waiting for commands...\n");
     if (fd >= 0) tcflush(fd, TCIFLUSH);
 
@@ -442,6 +466,71 @@ int main(int argc, char* argv[]) {
         struct timespec now_ts;
         clock_gettime(CLOCK_MONOTONIC, &now_ts);
 
+        // Answers from the key fetch worker. The worker has already saved
+        // any fresh list to the key store.
+        key_fetch_result_t kres;
+        while (key_fetch_poll(&kfetch, &kres)) {
+            if (kres.kind == KEY_FETCH_NEW) {
+                // 'f': a prefetched key (no list) or a fresh list from Auth
+                if (!kres.ok) {
+                    cmd_printf("Error: Failed to fetch new key from SST.");
+                    cmd_printf("Keeping current session key.");
+                } else {
+                    if (kres.list) {
+                        if (key_list) free_session_key_list_t(key_list);
+                        key_list = kres.list;
+                        current_key_idx = 0;
+                    } else {
+                        cmd_printf("Using a prefetched key (%d left).",
+                                   key_fetch_pool_count(&kfetch));
+                    }
+                    s_key = kres.key;
+                    key_valid = true;
+                    stats.keys_consumed++;
+                    cmd_printf("✓ New key fetched from SST.");
+
+                    // Auto-send like '1'
+                    if (fd >= 0) {
+                        // [ID:8][CIPHER:16][MAC:32]
+                        uint16_t klen = SESSION_KEY_ID_SIZE + SESSION_KEY_SIZE + 32;
+                        uint8_t hdr[] = {
+                            PREAMBLE_BYTE_1, PREAMBLE_BYTE_2, PREAMBLE_BYTE_3, PREAMBLE_BYTE_4,
+                            MSG_TYPE_KEY,
+                            (klen >> 8) & 0xFF,
+                            klen & 0xFF 
+                        };
+
+                        if (write_all(fd, hdr, sizeof(hdr)) < 0 ||
+                            write_all(fd, s_key.key_id, SESSION_KEY_ID_SIZE) < 0 ||
+                            write_all(fd, s_key.cipher_key, SESSION_KEY_SIZE) < 0 ||
+                            write_all(fd, s_key.mac_key, 32) < 0) {
+                            cmd_printf("Error: Failed to send new key to Pico.");
+                        } else {
+                            tcdrain(fd);
+                            cmd_printf("✓ New session key sent to Pico.");
+                        }
+                    } else {
+                        cmd_printf("Warning: Serial closed. Key updated locally but not sent.");
+                    }
+                }
+                mid_draw_keypanel(&s_key, key_valid, state, UART_DEVICE, (fd >= 0));
+            } else if (kres.kind != KEY_FETCH_LIST) {
+                if (kres.list) free_session_key_list_t(kres.list);
+            } else if (kres.ok) {
+                // Fresh list replacing the restored one; s_key is already
+                // with the sender and stays until the next rotation
+                if (key_list) free_session_key_list_t(key_list);
+                key_list = kres.list;
+                current_key_idx = 0;
+                log_printf("Auth reachable: replaced the restored keys with %d fresh ones.\n",
+                           key_list->num_key);
+            } else {
+                log_printf("Auth unreachable: keeping the %d keys restored from %s.\n",
+                           key_list ? key_list->num_key : 0, KEY_STORE_PATH);
+            }
+            explicit_bzero(&kres, sizeof(kres));
+        }
+
         // --- Handle Keyboard Shortcuts ---
         int key = getch();
         if (key == ERR) key = -1;
@@ -496,55 +585,11 @@ int main(int argc, char* argv[]) {
                 case 'f':
                 case 'F': {
                     cmd_printf("[Shortcut] Force Fetch New Key from SST...");
-                    // Try fetch new list first without freeing old one
-                    session_key_list_t* new_key_list = get_session_key(sst, NULL);
-                    
-                    if (!new_key_list || new_key_list->num_key == 0) {
-                         // Failed.
-                         cmd_printf("Error: Failed to fetch new key from SST.");
-                         
-                         if (errno == EAGAIN || errno == EWOULDBLOCK) {
-                             cmd_printf("Error detail: Resource temporary unavailable (EAGAIN).");
-                             cmd_printf("Try again in a moment.");
-                         }
-                         
-                         cmd_printf("Keeping current session key.");
-                         if (new_key_list) free_session_key_list_t(new_key_list);
-                    } else {
-                        // Success, replace old list
-                        if (key_list) free_session_key_list_t(key_list);
-                        key_list = new_key_list;
-                        
-                        s_key = key_list->s_key[0];
-                        key_valid = true;
-                        stats.keys_consumed++;
-                        cmd_printf("✓ New key fetched from SST.");
-                        
-                        // Auto-send like '1'
-                        if (fd >= 0) {
-                            // [ID:8][CIPHER:16][MAC:32]
-                            uint16_t klen = SESSION_KEY_ID_SIZE + SESSION_KEY_SIZE + 32;
-                            uint8_t hdr[] = {
-                                PREAMBLE_BYTE_1, PREAMBLE_BYTE_2, PREAMBLE_BYTE_3, PREAMBLE_BYTE_4,
-                                MSG_TYPE_KEY,
-                                (klen >> 8) & 0xFF,
-                                klen & 0xFF 
-                            };
-
-                            if (write_all(fd, hdr, sizeof(hdr)) < 0 ||
-                                write_all(fd, s_key.key_id, SESSION_KEY_ID_SIZE) < 0 ||
-                                write_all(fd, s_key.cipher_key, SESSION_KEY_SIZE) < 0 ||
-                                write_all(fd, s_key.mac_key, 32) < 0) {
-                                cmd_printf("Error: Failed to send new key to Pico.");
-                            } else {
-                                tcdrain(fd);
-                                cmd_printf("✓ New session key sent to Pico.");
-                            }
-                        } else {
-                            cmd_printf("Warning: Serial closed. Key updated locally but not sent.");
-                        }
-                    }
-                    mid_draw_keypanel(&s_key, key_valid, state, UART_DEVICE, (fd >= 0));
+                    // Answered from the prefetch pool at once, or by Auth
+                    // on the worker; the key is adopted and sent when the
+                    // result is polled above.
+                    if (key_fetch_request_new(&kfetch) != 0)
+                        cmd_printf("A new key is already being fetched.");
                     break;
                 }
 
@@ -553,6 +598,8 @@ int main(int argc, char* argv[]) {
                     cmd_printf("--- Session Statistics ---");
                     cmd_printf("Packets RX:      %lu", stats.total_pkts);
                     cmd_printf("Keys Consumed:   %lu", stats.keys_consumed);
+                    cmd_printf("Keys Prefetched: %d (pool hits %u)",
+                               key_fetch_pool_count(&kfetch), kfetch.pool_hits);
                     cmd_printf("--------------------------");
                     break;
                 }
@@ -611,6 +658,7 @@ int main(int argc, char* argv[]) {
                 case 'Q': {
                     cmd_printf("Exiting...");
                     if (fd >= 0) close(fd);
+                    key_fetch_stop(&kfetch);
                     free_session_key_list_t(key_list);
                     free_SST_ctx_t(sst);
                     return 0;
@@ -623,6 +671,7 @@ int main(int argc, char* argv[]) {
         usleep(1000); // 1ms
     }
 
+    key_fetch_stop(&kfetch);
     close(fd);
     free_session_key_list_t(key_list);
     free_SST_ctx_t(sst);
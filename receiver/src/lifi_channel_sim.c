@@ -0,0 +1,262 @@
+// src/lifi_channel_sim.c
+#include "lifi_channel_sim.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CHANNEL_DEFAULT_SEED 0x4C694669u  // "LiFi"
+
+// ---- PRNG (xorshift64*, seeded through splitmix64) ----
+
+static uint64_t splitmix64(uint64_t x) {
+    x += 0x9E3779B97F4A7C15ull;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+static uint64_t rng_next(lifi_channel_t* ch) {
+    uint64_t x = ch->rng;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    ch->rng = x;
+    return x * 0x2545F4914F6CDD1Dull;
+}
+
+// Uniform in [0, 1)
+static double rng_unit(lifi_channel_t* ch) {
+    return (double)(rng_next(ch) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static bool rng_chance(lifi_channel_t* ch, double p) {
+    return p > 0.0 && rng_unit(ch) < p;
+}
+
+// Standard normal via Box-Muller
+static double rng_gauss(lifi_channel_t* ch) {
+    double u1 = rng_unit(ch);
+    double u2 = rng_unit(ch);
+    if (u1 < 1e-300) u1 = 1e-300;
+    return sqrt(-2.0 * log(u1)) * cos(6.283185307179586 * u2);
+}
+
+// ---- Receiver model (lifi_rx.pio) ----
+
+static void rx_emit(lifi_channel_t* ch, uint8_t b) {
+    if (ch->out_len < ch->out_cap) {
+        ch->out[ch->out_len++] = b;
+        ch->stats.bytes_out++;
+    } else {
+        ch->stats.bytes_lost_output++;
+    }
+}
+
+// One line sample at the receiver's comparator output; 1 = idle (LED on).
+static void rx_sample(lifi_channel_t* ch, int level) {
+    const uint32_t osr = ch->cfg.osr;
+    switch (ch->rx_state) {
+        case 0:  // wait for start bit
+            if (level == 0) {
+                ch->rx_state = 1;
+                ch->rx_count = 0;
+                ch->rx_bits = 0;
+                ch->rx_byte = 0;
+                ch->rx_sub = 0;
+                ch->rx_ones = 0;
+            }
+            break;
+        case 1: {  // data bits, centred 1.5 bits after the start edge
+            const uint32_t vote = ch->cfg.vote;
+            const uint32_t step = (osr / 8) ? osr / 8 : 1;
+            ch->rx_count++;
+            uint32_t at = osr + osr / 2 + (uint32_t)ch->rx_bits * osr +
+                          ch->rx_sub * step - (vote / 2) * step;
+            if (ch->rx_count == at) {
+                ch->rx_ones += (uint8_t)(level & 1);
+                if (++ch->rx_sub < vote) break;
+                int bit = 2u * ch->rx_ones > vote;
+                ch->rx_sub = 0;
+                ch->rx_ones = 0;
+                ch->rx_byte |= (uint8_t)(bit << ch->rx_bits);
+                if (++ch->rx_bits == 8) {
+                    rx_emit(ch, ch->rx_byte);
+                    ch->rx_state = 2;
+                }
+            }
+            break;
+        }
+        case 2:  // wait for the line to return idle (stop bit)
+            ch->rx_count++;
+            if (level == 1) {
+                ch->rx_state = 0;
+            } else if (ch->rx_count == 9 * osr + osr / 2) {
+                ch->stats.framing_errors++;
+            }
+            break;
+    }
+}
+
+static void line_emit(lifi_channel_t* ch, int level, uint64_t n) {
+    int seen = level ^ (ch->cfg.invert ? 1 : 0);
+    for (uint64_t i = 0; i < n; i++) {
+        if (rng_chance(ch, ch->cfg.spike)) {
+            ch->stats.spikes++;
+            rx_sample(ch, seen ^ 1);
+        } else {
+            rx_sample(ch, seen);
+        }
+    }
+}
+
+// ---- Transmitter ----
+
+static void tx_bit(lifi_channel_t* ch, int level) {
+    const lifi_channel_cfg_t* c = &ch->cfg;
+
+    // Gilbert-Elliott burst state
+    if (ch->in_burst) {
+        if (c->burst_len <= 1.0 || rng_chance(ch, 1.0 / c->burst_len))
+            ch->in_burst = false;
+    } else if (rng_chance(ch, c->burst_rate)) {
+        ch->in_burst = true;
+        ch->stats.bursts++;
+    }
+    if (rng_chance(ch, ch->in_burst ? c->burst_ber : c->ber)) {
+        level ^= 1;
+        ch->stats.bits_flipped++;
+    }
+
+    ch->t_edge += (double)c->osr * (1.0 + c->drift_ppm * 1e-6);
+    double edge = ch->t_edge;
+    if (c->jitter_ui > 0.0) edge += rng_gauss(ch) * c->jitter_ui * c->osr;
+    if (edge > (double)ch->t_emitted) {
+        uint64_t end = (uint64_t)llround(edge);
+        if (end > ch->t_emitted) {
+            line_emit(ch, level, end - ch->t_emitted);
+            ch->t_emitted = end;
+        }
+    }
+}
+
+static void tx_byte(lifi_channel_t* ch, uint8_t b) {
+    tx_bit(ch, 0);  // start
+    for (int i = 0; i < 8; i++) tx_bit(ch, (b >> i) & 1);
+    tx_bit(ch, 1);  // stop
+    for (uint32_t i = 0; i < ch->cfg.idle_bits; i++) tx_bit(ch, 1);
+}
+
+// ---- Public API ----
+
+void lifi_channel_default_cfg(lifi_channel_cfg_t* cfg) {
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->burst_len = 8.0;
+    cfg->burst_ber = 0.5;
+    cfg->osr = 8;
+}
+
+void lifi_channel_init(lifi_channel_t* ch, const lifi_channel_cfg_t* cfg) {
+    memset(ch, 0, sizeof(*ch));
+    ch->cfg = *cfg;
+    if (ch->cfg.osr == 0) ch->cfg.osr = 8;
+    if (ch->cfg.vote == 0) ch->cfg.vote = 1;
+    uint64_t seed = ch->cfg.seed ? ch->cfg.seed : CHANNEL_DEFAULT_SEED;
+    ch->rng = splitmix64(seed);
+    if (ch->rng == 0) ch->rng = 1;
+}
+
+size_t lifi_channel_process(lifi_channel_t* ch, const uint8_t* in, size_t len,
+                            uint8_t* out, size_t out_cap) {
+    ch->out = out;
+    ch->out_len = 0;
+    ch->out_cap = out_cap;
+
+    for (size_t i = 0; i < len; i++) {
+        ch->stats.bytes_in++;
+        if (rng_chance(ch, ch->cfg.insert_rate)) {
+            tx_byte(ch, (uint8_t)rng_next(ch));
+            ch->stats.bytes_inserted++;
+        }
+        if (rng_chance(ch, ch->cfg.drop_rate)) {
+            ch->stats.bytes_dropped++;
+            continue;
+        }
+        tx_byte(ch, in[i]);
+    }
+
+    ch->out = NULL;
+    return ch->out_len;
+}
+
+size_t lifi_channel_flush(lifi_channel_t* ch, uint8_t* out, size_t out_cap) {
+    ch->out = out;
+    ch->out_len = 0;
+    ch->out_cap = out_cap;
+
+    // Two character times of clean idle finish any byte in flight.
+    uint64_t n = 20ull * ch->cfg.osr;
+    line_emit(ch, 1, n);
+    ch->t_emitted += n;
+    ch->t_edge = (double)ch->t_emitted;
+
+    ch->out = NULL;
+    return ch->out_len;
+}
+
+int lifi_channel_parse_cfg(lifi_channel_cfg_t* cfg, const char* spec) {
+    char buf[512];
+    if (!spec) return 0;
+    if (strlen(spec) >= sizeof(buf)) return -1;
+    strcpy(buf, spec);
+
+    char* save = NULL;
+    for (char* tok = strtok_r(buf, ",", &save); tok;
+         tok = strtok_r(NULL, ",", &save)) {
+        char* eq = strchr(tok, '=');
+        if (!eq) return -1;
+        *eq = '\0';
+        const char* key = tok;
+        char* end = NULL;
+        if (strcmp(key, "seed") == 0) {
+            cfg->seed = strtoull(eq + 1, &end, 0);
+            if (end == eq + 1 || *end != '\0') return -1;
+            continue;
+        }
+        double v = strtod(eq + 1, &end);
+        if (end == eq + 1 || *end != '\0') return -1;
+        if (v < 0 && strcmp(key, "drift_ppm") != 0) return -1;
+
+        if (strcmp(key, "ber") == 0) cfg->ber = v;
+        else if (strcmp(key, "burst_rate") == 0) cfg->burst_rate = v;
+        else if (strcmp(key, "burst_len") == 0) cfg->burst_len = v;
+        else if (strcmp(key, "burst_ber") == 0) cfg->burst_ber = v;
+        else if (strcmp(key, "drop") == 0) cfg->drop_rate = v;
+        else if (strcmp(key, "insert") == 0) cfg->insert_rate = v;
+        else if (strcmp(key, "invert") == 0) cfg->invert = (v != 0);
+        else if (strcmp(key, "jitter") == 0) cfg->jitter_ui = v;
+        else if (strcmp(key, "drift_ppm") == 0) cfg->drift_ppm = v;
+        else if (strcmp(key, "spike") == 0) cfg->spike = v;
+        else if (strcmp(key, "idle_bits") == 0) cfg->idle_bits = (uint32_t)v;
+        else if (strcmp(key, "osr") == 0) cfg->osr = (uint32_t)v;
+        else if (strcmp(key, "vote") == 0) {
+            if (v != 1 && v != 3 && v != 5) return -1;
+            cfg->vote = (uint32_t)v;
+        } else return -1;
+    }
+    return 0;
+}
+
+void lifi_channel_describe(const lifi_channel_cfg_t* cfg, char* buf,
+                           size_t buflen) {
+    snprintf(buf, buflen,
+             "ber=%g burst_rate=%g burst_len=%g burst_ber=%g drop=%g "
+             "insert=%g invert=%d jitter=%g drift_ppm=%g spike=%g idle_bits=%u "
+             "osr=%u vote=%u seed=%llu",
+             cfg->ber, cfg->burst_rate, cfg->burst_len, cfg->burst_ber,
+             cfg->drop_rate, cfg->insert_rate, cfg->invert ? 1 : 0,
+             cfg->jitter_ui, cfg->drift_ppm, cfg->spike, cfg->idle_bits,
+             cfg->osr ? cfg->osr : 8, cfg->vote ? cfg->vote : 1,
+             (unsigned long long)cfg->seed);
+}
@@ -0,0 +1,339 @@
+// src/lifi_channel_sim_tool.c
+//
+// Command-line front end for the optical channel simulator.
+//
+//   lifi_channel_sim pipe  [-c SPEC]
+//       stdin -> channel -> stdout, for replaying captured byte streams.
+//
+//   lifi_channel_sim pty   [-c SPEC] [-i DEVICE] [-b BAUD] [-l LINK]
+//       Creates a pseudo-terminal that behaves like the receiver's UART.
+//       Bytes from DEVICE (or stdin) are impaired on the way in; anything
+//       written to the pty goes back to DEVICE untouched (the Pi4 -> Pico
+//       UART path is wired, not optical). Point speed_test_receiver at the
+//       printed slave path or at LINK.
+//
+//   lifi_channel_sim bench [-c SPEC] [-n FRAMES] [-s LEN] [-b BAUD]
+//       Sends FRAMES CRC-valid frames of LEN payload bytes through the
+//       channel into the shared frame parser and prints a [CHANNEL_RESULT]
+//       line, so FEC/resync/ARQ changes can be compared on identical input.
+//
+// SPEC is "key=value,..." as accepted by lifi_channel_parse_cfg(), e.g.
+//   -c ber=1e-4,burst_rate=1e-5,burst_len=12,jitter=0.08,seed=7
+
+#define _GNU_SOURCE  // posix_openpt, ptsname
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "../../include/crc16.h"
+#include "../../include/frame_parser.h"
+#include "../../include/protocol.h"
+#include "lifi_channel_sim.h"
+#include "serial_linux.h"
+
+static volatile sig_atomic_t g_stop = 0;
+
+static void on_signal(int sig) {
+    (void)sig;
+    g_stop = 1;
+}
+
+static void print_usage(const char* prog) {
+    printf("Usage:\n");
+    printf("  %s pipe  [-c SPEC]\n", prog);
+    printf("  %s pty   [-c SPEC] [-i DEVICE] [-b BAUD] [-l LINK]\n", prog);
+    printf("  %s bench [-c SPEC] [-n FRAMES] [-s LEN] [-b BAUD]\n", prog);
+    printf("\nSPEC keys (comma separated key=value):\n");
+    printf("  ber, burst_rate, burst_len, burst_ber, drop, insert, invert,\n");
+    printf("  jitter (std dev in bit times), drift_ppm, spike (per-sample flip),\n");
+    printf("  idle_bits, osr, vote (1|3|5 receiver samples per bit), seed\n");
+    printf("\nExample:\n");
+    printf("  %s bench -n 1000 -s 256 -c ber=1e-5,jitter=0.1,seed=42\n", prog);
+}
+
+static int write_all(int fd, const uint8_t* buf, size_t len) {
+    size_t sent = 0;
+    while (sent < len) {
+        ssize_t n = write(fd, buf + sent, len - sent);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        sent += (size_t)n;
+    }
+    return 0;
+}
+
+// ---- pipe ----
+
+static int run_pipe(lifi_channel_t* ch) {
+    static uint8_t in[4096];
+    static uint8_t out[LIFI_CHANNEL_OUT_MAX(sizeof(in))];
+    ssize_t n;
+    while ((n = read(STDIN_FILENO, in, sizeof(in))) > 0) {
+        size_t m = lifi_channel_process(ch, in, (size_t)n, out, sizeof(out));
+        if (write_all(STDOUT_FILENO, out, m) < 0) return 1;
+    }
+    size_t m = lifi_channel_flush(ch, out, sizeof(out));
+    return write_all(STDOUT_FILENO, out, m) < 0 ? 1 : 0;
+}
+
+// ---- pty ----
+
+static int run_pty(lifi_channel_t* ch, const char* device, int baud,
+                   const char* link_path) {
+    int in_fd = STDIN_FILENO;
+    if (device) {
+        in_fd = init_serial_baud(device, baud);
+        if (in_fd < 0) return 1;
+    }
+
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) {
+        perror("posix_openpt");
+        return 1;
+    }
+    const char* slave_name = ptsname(master);
+    if (!slave_name) {
+        perror("ptsname");
+        return 1;
+    }
+
+    // Keep our own handle on the slave so the pty survives the receiver
+    // closing and reopening it ([r] Reopen), and make it raw.
+    int slave = open(slave_name, O_RDWR | O_NOCTTY);
+    if (slave >= 0) {
+        struct termios t;
+        if (tcgetattr(slave, &t) == 0) {
+            cfmakeraw(&t);
+            tcsetattr(slave, TCSANOW, &t);
+        }
+    }
+
+    if (link_path) {
+        unlink(link_path);
+        if (symlink(slave_name, link_path) != 0) {
+            perror("symlink");
+            link_path = NULL;
+        }
+    }
+    fprintf(stderr, "[CHANNEL] pty ready: %s%s%s\n", slave_name,
+            link_path ? " -> " : "", link_path ? link_path : "");
+
+    static uint8_t in[4096];
+    static uint8_t out[LIFI_CHANNEL_OUT_MAX(sizeof(in))];
+    struct pollfd fds[2] = {
+        {.fd = in_fd, .events = POLLIN},
+        {.fd = master, .events = POLLIN},
+    };
+    bool dirty = false;
+
+    while (!g_stop) {
+        int r = poll(fds, 2, 5);
+        if (r < 0) {
+            if (errno == EINTR) continue;
+            perror("poll");
+            break;
+        }
+        if (r == 0) {
+            // Line went quiet: let the receiver model finish its last byte.
+            if (dirty) {
+                size_t m = lifi_channel_flush(ch, out, sizeof(out));
+                write_all(master, out, m);
+                dirty = false;
+            }
+            continue;
+        }
+        if (fds[0].revents & POLLIN) {
+            ssize_t n = read(in_fd, in, sizeof(in));
+            if (n <= 0) break;
+            size_t m = lifi_channel_process(ch, in, (size_t)n, out, sizeof(out));
+            write_all(master, out, m);
+            dirty = true;
+        }
+        if ((fds[1].revents & POLLIN) && device) {
+            ssize_t n = read(master, in, sizeof(in));
+            if (n > 0) write_all(in_fd, in, (size_t)n);
+        }
+    }
+
+    if (link_path) unlink(link_path);
+    if (slave >= 0) close(slave);
+    close(master);
+    if (device) close(in_fd);
+    return 0;
+}
+
+// ---- bench ----
+
+static uint64_t bench_rng = 0x9E3779B97F4A7C15ull;
+
+static uint8_t bench_byte(void) {
+    bench_rng ^= bench_rng << 13;
+    bench_rng ^= bench_rng >> 7;
+    bench_rng ^= bench_rng << 17;
+    return (uint8_t)bench_rng;
+}
+
+static int run_bench(lifi_channel_t* ch, unsigned frames, unsigned len,
+                     int baud) {
+    static frame_parser_t fp;
+    static uint8_t frame[FRAME_MAX_SIZE];
+    static uint8_t out[LIFI_CHANNEL_OUT_MAX(FRAME_MAX_SIZE)];
+    frame_parser_init(&fp);
+
+    bool* got = calloc(frames ? frames : 1, sizeof(bool));
+    if (!got) return 1;
+    unsigned recovered = 0;
+    unsigned corrupt = 0;  // CRC-valid frames that do not match what was sent
+
+    for (unsigned seq = 0; seq <= frames; seq++) {
+        size_t m;
+        if (seq < frames) {
+            // Payload starts with the sequence number; the rest is derived
+            // from it, so received frames can be checked byte for byte.
+            size_t n = 0;
+            frame[n++] = PREAMBLE_BYTE_1;
+            frame[n++] = PREAMBLE_BYTE_2;
+            frame[n++] = PREAMBLE_BYTE_3;
+            frame[n++] = PREAMBLE_BYTE_4;
+            frame[n++] = MSG_TYPE_ENCRYPTED;
+            frame[n++] = (uint8_t)(len >> 8);
+            frame[n++] = (uint8_t)len;
+            bench_rng = 0x9E3779B97F4A7C15ull ^ seq;
+            for (unsigned i = 0; i < len; i++)
+                frame[n + i] = (i < 4) ? (uint8_t)(seq >> (24 - 8 * i)) : bench_byte();
+            n += len;
+            crc16_append(frame + PREAMBLE_SIZE, n - PREAMBLE_SIZE);
+            n += CRC16_SIZE;
+            m = lifi_channel_process(ch, frame, n, out, sizeof(out));
+        } else {
+            m = lifi_channel_flush(ch, out, sizeof(out));
+        }
+        frame_parser_push(&fp, out, m);
+
+        // Virtual clock: line time so far at the configured baud, plus a
+        // generous tail after the last frame so pending candidates expire.
+        uint32_t now_ms = (uint32_t)((double)ch->t_emitted / ch->cfg.osr /
+                                     baud * 1000.0);
+        if (seq == frames) now_ms += 10000;
+
+        lifi_frame_t f;
+        frame_result_t r;
+        while ((r = frame_parser_next(&fp, now_ms, &f)) != FRAME_NONE) {
+            if (r != FRAME_OK || f.len != len) continue;
+            uint32_t rseq = ((uint32_t)f.payload[0] << 24) |
+                            ((uint32_t)f.payload[1] << 16) |
+                            ((uint32_t)f.payload[2] << 8) | f.payload[3];
+            bool match = rseq < frames;
+            if (match) {
+                bench_rng = 0x9E3779B97F4A7C15ull ^ rseq;
+                for (unsigned i = 4; i < len && match; i++)
+                    match = (f.payload[i] == bench_byte());
+            }
+            if (!match) {
+                corrupt++;
+            } else if (!got[rseq]) {
+                got[rseq] = true;
+                recovered++;
+            }
+        }
+    }
+
+    char desc[256];
+    lifi_channel_describe(&ch->cfg, desc, sizeof(desc));
+    printf("[CHANNEL_RESULT] frames=%u len=%u baud=%d recovered=%u lost=%u "
+           "corrupt=%u resyncs=%u crc_fail=%u len_fail=%u type_fail=%u "
+           "timeouts=%u bits_flipped=%llu bursts=%llu dropped=%llu "
+           "inserted=%llu framing_errors=%llu\n",
+           frames, len, baud, recovered, frames - recovered, corrupt,
+           fp.resyncs, fp.crc_fail, fp.len_fail, fp.type_fail, fp.timeouts,
+           (unsigned long long)ch->stats.bits_flipped,
+           (unsigned long long)ch->stats.bursts,
+           (unsigned long long)ch->stats.bytes_dropped,
+           (unsigned long long)ch->stats.bytes_inserted,
+           (unsigned long long)ch->stats.framing_errors);
+    printf("[CHANNEL_CFG] %s\n", desc);
+    free(got);
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    const char* mode = argv[1];
+
+    lifi_channel_cfg_t cfg;
+    lifi_channel_default_cfg(&cfg);
+    const char* device = NULL;
+    const char* link_path = NULL;
+    int baud = 1000000;
+    unsigned frames = 1000;
+    unsigned len = 128;
+
+    for (int i = 2; i < argc; i++) {
+        const char* a = argv[i];
+        const char* v = (i + 1 < argc) ? argv[i + 1] : NULL;
+        if (!v) {
+            fprintf(stderr, "Missing value for %s\n", a);
+            return 1;
+        }
+        if (strcmp(a, "-c") == 0) {
+            if (lifi_channel_parse_cfg(&cfg, v) != 0) {
+                fprintf(stderr, "Bad channel spec: %s\n", v);
+                return 1;
+            }
+        } else if (strcmp(a, "-i") == 0) {
+            device = v;
+        } else if (strcmp(a, "-b") == 0) {
+            baud = atoi(v);
+        } else if (strcmp(a, "-l") == 0) {
+            link_path = v;
+        } else if (strcmp(a, "-n") == 0) {
+            frames = (unsigned)strtoul(v, NULL, 0);
+        } else if (strcmp(a, "-s") == 0) {
+            len = (unsigned)strtoul(v, NULL, 0);
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+        i++;
+    }
+    if (baud <= 0) {
+        fprintf(stderr, "Bad baud rate\n");
+        return 1;
+    }
+
+    static lifi_channel_t ch;
+    lifi_channel_init(&ch, &cfg);
+
+    if (strcmp(mode, "pipe") == 0) return run_pipe(&ch);
+
+    if (strcmp(mode, "pty") == 0) {
+        signal(SIGINT, on_signal);
+        signal(SIGTERM, on_signal);
+        return run_pty(&ch, device, baud, link_path);
+    }
+
+    if (strcmp(mode, "bench") == 0) {
+        if (len < NONCE_SIZE + TAG_SIZE || len > MAX_MSG_LEN) {
+            fprintf(stderr, "LEN must be %d..%d\n", NONCE_SIZE + TAG_SIZE,
+                    MAX_MSG_LEN);
+            return 1;
+        }
+        return run_bench(&ch, frames, len, baud);
+    }
+
+    print_usage(argv[0]);
+    return 1;
+}
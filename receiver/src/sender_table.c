@@ -0,0 +1,103 @@
+// src/sender_table.c
+#include "sender_table.h"
+
+#include "utils.h"
+
+void sender_table_init(sender_table_t *t) {
+    memset(t, 0, sizeof(*t));
+    frame_decrypt_init(&t->probe);
+}
+
+void sender_table_free(sender_table_t *t) {
+    explicit_bzero(t->s, sizeof(t->s));
+    frame_decrypt_free(&t->probe);
+}
+
+sender_session_t *sender_table_find_id(sender_table_t *t, const unsigned char *key_id) {
+    for (int i = 0; i < SENDER_TABLE_MAX; i++)
+        if (t->s[i].used &&
+            memcmp(t->s[i].key.key_id, key_id, SESSION_KEY_ID_SIZE) == 0)
+            return &t->s[i];
+    return NULL;
+}
+
+sender_session_t *sender_table_find_salt(sender_table_t *t, const uint8_t *nonce) {
+    for (int i = 0; i < SENDER_TABLE_MAX; i++) {
+        if (t->s[i].used && t->s[i].have_salt &&
+            memcmp(t->s[i].salt, nonce, SENDER_SALT_SIZE) == 0) {
+            t->s[i].last_used = ++t->tick;
+            return &t->s[i];
+        }
+    }
+    return NULL;
+}
+
+sender_session_t *sender_table_add(sender_table_t *t, const session_key_t *k) {
+    sender_session_t *s = sender_table_find_id(t, k->key_id);
+    if (s) {
+        s->key = *k;
+        s->last_used = ++t->tick;
+        return s;
+    }
+    s = &t->s[0];
+    for (int i = 0; i < SENDER_TABLE_MAX && s->used; i++)
+        if (!t->s[i].used || t->s[i].last_used < s->last_used) s = &t->s[i];
+    if (s->used) t->evictions++;
+
+    explicit_bzero(s, sizeof(*s));
+    s->used = true;
+    s->key = *k;
+    s->hs_state = STATE_IDLE;
+    s->last_used = ++t->tick;
+    replay_window_init(&s->rwin, NONCE_SIZE, NONCE_HISTORY_SIZE);
+    return s;
+}
+
+static bool salt_retired(const sender_session_t *s, const uint8_t *nonce) {
+    for (int i = 0; i < s->retired_count; i++)
+        if (memcmp(s->retired[i], nonce, SENDER_SALT_SIZE) == 0) return true;
+    return false;
+}
+
+// The salt is the sender's, whichever session had it before. The replay
+// window is left as it is; it holds full nonces, salt included.
+static void bind_salt(sender_table_t *t, sender_session_t *s, const uint8_t *nonce) {
+    sender_session_t *old = sender_table_find_salt(t, nonce);
+    if (old) old->have_salt = false;
+    if (s->have_salt) {
+        memcpy(s->retired[s->retired_next], s->salt, SENDER_SALT_SIZE);
+        s->retired_next = (s->retired_next + 1) % SENDER_RETIRED_SALTS;
+        if (s->retired_count < SENDER_RETIRED_SALTS) s->retired_count++;
+    }
+    memcpy(s->salt, nonce, SENDER_SALT_SIZE);
+    s->have_salt = true;
+    s->last_used = ++t->tick;
+}
+
+sender_session_t *sender_table_route(sender_table_t *t, const lifi_frame_t *f) {
+    const uint8_t *nonce = f->payload;
+    sender_session_t *s = sender_table_find_salt(t, nonce);
+    if (s) return s;
+
+    t->probes++;
+    for (int i = 0; i < SENDER_TABLE_MAX; i++) {
+        if (!t->s[i].used) continue;
+        if (frame_decrypt_finish(&t->probe, f, t->s[i].key.cipher_key) == 0) {
+            explicit_bzero(t->probe.plain, sizeof(t->probe.plain));
+            if (salt_retired(&t->s[i], nonce)) {
+                t->retired_rejects++;
+                return NULL;
+            }
+            bind_salt(t, &t->s[i], nonce);
+            return &t->s[i];
+        }
+    }
+    t->unrouted++;
+    return NULL;
+}
+
+int sender_table_count(const sender_table_t *t) {
+    int n = 0;
+    for (int i = 0; i < SENDER_TABLE_MAX; i++) n += t->s[i].used;
+    return n;
+}
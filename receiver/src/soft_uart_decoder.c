@@ -0,0 +1,513 @@
+// src/soft_uart_decoder.c
+//
+// Offline 8N1 decoder for oversampled line captures from the Pico 2
+// `capture` command (format in include/capture_format.h).
+//
+//   soft_uart_decoder grab   -i DEVICE [-r OSR] [-t MS] -o FILE
+//       Asks lifi_pico2_rx for a capture at its current baud and saves it.
+//
+//   soft_uart_decoder decode [options] FILE
+//       Decodes once with the given sample rule and prints a [DECODE] line;
+//       -o writes the decoded bytes.
+//
+//   soft_uart_decoder sweep  [options] FILE
+//       Decodes with every sample point / majority window / threshold /
+//       glitch filter combination and prints one [DECODE] line each, then
+//       the [BEST] one.
+//
+// Decode options:
+//   -p PHASE   sample point inside each bit, 0..1 of a bit time (0.5)
+//   -w N       majority window in samples around the sample point (1)
+//   -k K       samples in the window that must be idle-level for a 1
+//              (majority: N/2+1)
+//   -g N       start-bit glitch filter: consecutive start-level samples
+//              needed before a start bit is accepted (1)
+//   -b BAUD    decode at this rate instead of the capture's (clock error)
+//   -I 0|1     override polarity; 1 = idle reads low
+//
+// With -p 0.5 -w 1 -k 1 -g 1 the decoder follows lifi_rx.pio at 8x:
+// trigger on the first start-level sample, sample once per bit, then wait
+// for the line to return idle. Decoded bytes go through the shared frame
+// parser and the speed-test preamble/line matcher, so settings are ranked by
+// what the receivers would actually have accepted.
+
+#include <errno.h>
+#include <math.h>
+#include <poll.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../../include/capture_format.h"
+#include "../../include/frame_parser.h"
+#include "../../include/protocol.h"
+#include "serial_linux.h"
+
+typedef struct {
+    lifi_capture_hdr_t hdr;
+    uint32_t* words;
+    uint64_t nsamples;
+    int inverted;
+} capture_t;
+
+typedef struct {
+    double phase;
+    int window;
+    int k;
+    int glitch;
+    double baud;
+} decode_cfg_t;
+
+typedef struct {
+    uint64_t bytes;
+    uint64_t framing_errors;  // stop bit sampled at start level
+    uint64_t glitches;        // start edges rejected by the glitch filter
+    uint32_t frames_ok;
+    uint32_t crc_fail;
+    uint32_t lines;           // preamble + text + newline (speed test)
+    uint32_t pkts;            // of which "PKTnnnn" test packets
+    long test_sent;           // last __TEST_END:n seen, -1 if none
+} decode_stats_t;
+
+static void print_usage(const char* prog) {
+    printf("Usage:\n");
+    printf("  %s grab   -i DEVICE [-r OSR] [-t MS] -o FILE\n", prog);
+    printf("  %s decode [-p PHASE] [-w N] [-k K] [-g N] [-b BAUD] [-I 0|1] "
+           "[-o OUT] FILE\n", prog);
+    printf("  %s sweep  [-b BAUD] [-I 0|1] FILE\n", prog);
+}
+
+// ---- Capture file ----
+
+static int capture_load(const char* path, capture_t* c) {
+    memset(c, 0, sizeof(*c));
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        perror(path);
+        return -1;
+    }
+    if (fread(&c->hdr, 1, sizeof(c->hdr), f) != sizeof(c->hdr) ||
+        memcmp(c->hdr.magic, CAPTURE_MAGIC, CAPTURE_MAGIC_SIZE) != 0) {
+        fprintf(stderr, "%s: not a LiFi capture\n", path);
+        fclose(f);
+        return -1;
+    }
+    if (c->hdr.version != CAPTURE_VERSION || c->hdr.sample_hz == 0 ||
+        c->hdr.baud == 0) {
+        fprintf(stderr, "%s: unsupported capture (version %u)\n", path,
+                c->hdr.version);
+        fclose(f);
+        return -1;
+    }
+    c->words = malloc((size_t)c->hdr.words * sizeof(uint32_t) + 1);
+    if (!c->words) {
+        fclose(f);
+        return -1;
+    }
+    size_t got = fread(c->words, sizeof(uint32_t), c->hdr.words, f);
+    fclose(f);
+    if (got < c->hdr.words) {
+        fprintf(stderr, "%s: truncated, %zu of %u words\n", path, got,
+                c->hdr.words);
+    }
+    c->nsamples = (uint64_t)got * 32;
+    c->inverted = c->hdr.inverted;
+    return 0;
+}
+
+// Line level at sample i: 1 = idle/stop, 0 = start.
+static inline int level_at(const capture_t* c, uint64_t i) {
+    return (int)((c->words[i >> 5] >> (i & 31)) & 1) ^ c->inverted;
+}
+
+static int vote(const capture_t* c, double center, int window, int k) {
+    int64_t mid = (int64_t)llround(center);
+    int ones = 0;
+    for (int j = -(window / 2); j <= window / 2 - (window % 2 == 0); j++) {
+        int64_t i = mid + j;
+        if (i < 0) i = 0;
+        if ((uint64_t)i >= c->nsamples) i = (int64_t)c->nsamples - 1;
+        ones += level_at(c, (uint64_t)i);
+    }
+    return ones >= k;
+}
+
+// ---- Byte consumers ----
+
+typedef struct {
+    frame_parser_t parser;
+    int state;  // 0..3 = preamble bytes matched, 4 = in a text line
+    char line[512];
+    size_t line_len;
+} sink_t;
+
+static const uint8_t k_preamble[PREAMBLE_SIZE] = {
+    PREAMBLE_BYTE_1, PREAMBLE_BYTE_2, PREAMBLE_BYTE_3, PREAMBLE_BYTE_4};
+
+// Mirrors the preamble state machine in receiver_pico/src/main.c.
+static void sink_text(sink_t* s, decode_stats_t* st, uint8_t b) {
+    if (s->state < PREAMBLE_SIZE) {
+        if (b == k_preamble[s->state]) {
+            s->state++;
+            s->line_len = 0;
+        } else {
+            s->state = (b == k_preamble[0]) ? 1 : 0;
+        }
+        return;
+    }
+    if (b == '\n' || b == '\r') {
+        s->line[s->line_len] = '\0';
+        st->lines++;
+        if (strncmp(s->line, "PKT", 3) == 0) st->pkts++;
+        if (strncmp(s->line, "__TEST_END:", 11) == 0)
+            st->test_sent = strtol(s->line + 11, NULL, 10);
+        s->state = 0;
+    } else if (s->line_len < sizeof(s->line) - 1) {
+        s->line[s->line_len++] = (char)b;
+    } else {
+        s->state = 0;
+    }
+}
+
+static void sink_frames(sink_t* s, decode_stats_t* st, uint32_t now_ms) {
+    lifi_frame_t frame;
+    frame_result_t r;
+    while ((r = frame_parser_next(&s->parser, now_ms, &frame)) != FRAME_NONE) {
+        if (r == FRAME_OK) st->frames_ok++;
+        else if (frame.error == FRAME_ERR_CRC) st->crc_fail++;
+    }
+}
+
+// ---- Decoder ----
+
+static void decode(const capture_t* c, const decode_cfg_t* cfg,
+                   decode_stats_t* st, FILE* out) {
+    static sink_t sink;
+    memset(st, 0, sizeof(*st));
+    st->test_sent = -1;
+    frame_parser_init(&sink.parser);
+    sink.state = 0;
+    sink.line_len = 0;
+
+    const double spb = (double)c->hdr.sample_hz / cfg->baud;
+    const uint64_t n = c->nsamples;
+    uint64_t i = 0;
+
+    while (i < n) {
+        if (level_at(c, i) != 0) {
+            i++;
+            continue;
+        }
+        int g = 1;
+        while (g < cfg->glitch && i + (uint64_t)g < n && level_at(c, i + (uint64_t)g) == 0)
+            g++;
+        if (g < cfg->glitch) {
+            st->glitches++;
+            i += (uint64_t)g;
+            continue;
+        }
+
+        // The edge fell between the last idle sample and this one.
+        double edge = (double)i - 0.5;
+        if (edge + 10.0 * spb >= (double)n) break;
+
+        uint8_t b = 0;
+        for (int bit = 0; bit < 8; bit++) {
+            double center = edge + (1.0 + bit + cfg->phase) * spb;
+            b |= (uint8_t)(vote(c, center, cfg->window, cfg->k) << bit);
+        }
+        if (!vote(c, edge + (9.0 + cfg->phase) * spb, cfg->window, cfg->k))
+            st->framing_errors++;
+
+        st->bytes++;
+        if (out) fputc(b, out);
+        sink_text(&sink, st, b);
+        frame_parser_push(&sink.parser, &b, 1);
+        uint32_t now_ms = (uint32_t)((double)i * 1000.0 / c->hdr.sample_hz);
+        sink_frames(&sink, st, now_ms);
+
+        // Resume after the last data sample and wait for idle, as the PIO
+        // program does with `wait 0 pin 0`.
+        i = (uint64_t)llround(edge + (8.0 + cfg->phase) * spb) + 1;
+        while (i < n && level_at(c, i) == 0) i++;
+    }
+    // Flush any frame still waiting on its deadline.
+    sink_frames(&sink, st, (uint32_t)((double)n * 1000.0 / c->hdr.sample_hz) +
+                               60000u);
+}
+
+static void print_decode(const char* tag, const decode_cfg_t* cfg,
+                         const decode_stats_t* st) {
+    printf("[%s] phase=%.2f window=%d k=%d glitch=%d baud=%.0f bytes=%llu "
+           "ferr=%llu glitches=%llu frames=%u crc_fail=%u lines=%u pkts=%u",
+           tag, cfg->phase, cfg->window, cfg->k, cfg->glitch, cfg->baud,
+           (unsigned long long)st->bytes,
+           (unsigned long long)st->framing_errors,
+           (unsigned long long)st->glitches, st->frames_ok, st->crc_fail,
+           st->lines, st->pkts);
+    if (st->test_sent >= 0) printf(" sent=%ld", st->test_sent);
+    printf("\n");
+}
+
+// Higher is better: CRC-valid frames plus intact test packets first, then
+// fewer framing errors as the tie-break. Plain `lines` is not scored, since
+// a preamble inside binary data also ends in a "line".
+static bool better(const decode_stats_t* a, const decode_stats_t* b) {
+    uint64_t ga = (uint64_t)a->frames_ok + a->pkts;
+    uint64_t gb = (uint64_t)b->frames_ok + b->pkts;
+    if (ga != gb) return ga > gb;
+    return a->framing_errors < b->framing_errors;
+}
+
+static int run_sweep(const capture_t* c, double baud) {
+    static const int windows[][2] = {{1, 1}, {3, 1}, {3, 2}, {3, 3},
+                                     {5, 2}, {5, 3}, {5, 4}};
+    const double spb = (double)c->hdr.sample_hz / baud;
+    decode_cfg_t best_cfg = {0};
+    decode_stats_t best = {0};
+    bool have_best = false;
+
+    for (int gl = 1; gl <= 2; gl++) {
+        for (size_t w = 0; w < sizeof(windows) / sizeof(windows[0]); w++) {
+            if (windows[w][0] > spb) continue;  // window wider than a bit
+            for (int p = 20; p <= 80; p += 5) {
+                decode_cfg_t cfg = {
+                    .phase = p / 100.0,
+                    .window = windows[w][0],
+                    .k = windows[w][1],
+                    .glitch = gl,
+                    .baud = baud,
+                };
+                decode_stats_t st;
+                decode(c, &cfg, &st, NULL);
+                print_decode("DECODE", &cfg, &st);
+                if (!have_best || better(&st, &best)) {
+                    best = st;
+                    best_cfg = cfg;
+                    have_best = true;
+                }
+            }
+        }
+    }
+    if (have_best) print_decode("BEST", &best_cfg, &best);
+    return 0;
+}
+
+// ---- grab ----
+
+// Reads one '\n'-terminated line, giving up after timeout_ms of silence.
+static int read_line(int fd, char* buf, size_t cap, int timeout_ms) {
+    size_t n = 0;
+    for (;;) {
+        struct pollfd pfd = {.fd = fd, .events = POLLIN};
+        if (poll(&pfd, 1, timeout_ms) <= 0) return -1;
+        char ch;
+        ssize_t r = read(fd, &ch, 1);
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) return -1;
+        if (ch == '\n') break;
+        if (ch != '\r' && n < cap - 1) buf[n++] = ch;
+    }
+    buf[n] = '\0';
+    return (int)n;
+}
+
+static int read_exact(int fd, void* dst, size_t len, int timeout_ms) {
+    uint8_t* p = dst;
+    size_t got = 0;
+    while (got < len) {
+        struct pollfd pfd = {.fd = fd, .events = POLLIN};
+        if (poll(&pfd, 1, timeout_ms) <= 0) return -1;
+        ssize_t r = read(fd, p + got, len - got);
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) return -1;
+        got += (size_t)r;
+    }
+    return 0;
+}
+
+static int run_grab(const char* device, unsigned osr, unsigned ms,
+                    const char* path) {
+    int fd = init_serial_baud(device, 115200);  // USB CDC ignores the rate
+    if (fd < 0) return 1;
+
+    char cmd[64];
+    int n = snprintf(cmd, sizeof(cmd), "capture %u %u\n", osr, ms);
+    if (write(fd, cmd, (size_t)n) != n) {
+        perror("write");
+        close(fd);
+        return 1;
+    }
+
+    // Skip heartbeats and RX output until the capture starts.
+    char line[256];
+    unsigned long words = 0;
+    for (;;) {
+        if (read_line(fd, line, sizeof(line), 5000) < 0) {
+            fprintf(stderr, "No [CAPTURE] start from %s\n", device);
+            close(fd);
+            return 1;
+        }
+        if (strstr(line, "[CAPTURE] error")) {
+            fprintf(stderr, "%s\n", line);
+            close(fd);
+            return 1;
+        }
+        if (sscanf(line, "[CAPTURE] start words=%lu", &words) == 1) break;
+    }
+
+    lifi_capture_hdr_t hdr;
+    if (read_exact(fd, &hdr, sizeof(hdr), 2000) != 0 ||
+        memcmp(hdr.magic, CAPTURE_MAGIC, CAPTURE_MAGIC_SIZE) != 0 ||
+        hdr.words != words) {
+        fprintf(stderr, "Bad capture header\n");
+        close(fd);
+        return 1;
+    }
+
+    FILE* f = fopen(path, "wb");
+    if (!f) {
+        perror(path);
+        close(fd);
+        return 1;
+    }
+    fwrite(&hdr, 1, sizeof(hdr), f);
+
+    static uint32_t chunk[4096];
+    uint32_t left = hdr.words;
+    while (left) {
+        uint32_t m = left < 4096 ? left : 4096;
+        if (read_exact(fd, chunk, m * sizeof(uint32_t), 2000) != 0) {
+            fprintf(stderr, "Capture stream stalled with %u words left\n", left);
+            fclose(f);
+            close(fd);
+            return 1;
+        }
+        fwrite(chunk, sizeof(uint32_t), m, f);
+        left -= m;
+    }
+    fclose(f);
+
+    unsigned long overruns = 0;
+    while (read_line(fd, line, sizeof(line), 2000) >= 0) {
+        const char* o = strstr(line, "[CAPTURE] done");
+        if (o && (o = strstr(o, "overruns=")) != NULL) {
+            overruns = strtoul(o + 9, NULL, 10);
+            break;
+        }
+    }
+    close(fd);
+
+    printf("[CAPTURE] %s: baud=%u osr=%u sample_hz=%u words=%u (%.1f ms) "
+           "overruns=%lu\n", path, hdr.baud, hdr.osr, hdr.sample_hz, hdr.words,
+           hdr.words * 32.0 * 1000.0 / hdr.sample_hz, overruns);
+    if (overruns)
+        fprintf(stderr, "Warning: USB fell behind; parts of the capture are "
+                        "overwritten. Lower the osr or the baud.\n");
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    const char* mode = argv[1];
+
+    decode_cfg_t cfg = {.phase = 0.5, .window = 1, .k = 0, .glitch = 1};
+    const char* device = NULL;
+    const char* out_path = NULL;
+    const char* in_path = NULL;
+    unsigned osr = CAPTURE_OSR_MAX;
+    unsigned ms = 1000;
+    int invert = -1;
+
+    for (int i = 2; i < argc; i++) {
+        const char* a = argv[i];
+        if (a[0] != '-') {
+            in_path = a;
+            continue;
+        }
+        const char* v = (i + 1 < argc) ? argv[i + 1] : NULL;
+        if (!v) {
+            fprintf(stderr, "Missing value for %s\n", a);
+            return 1;
+        }
+        if (strcmp(a, "-p") == 0) cfg.phase = atof(v);
+        else if (strcmp(a, "-w") == 0) cfg.window = atoi(v);
+        else if (strcmp(a, "-k") == 0) cfg.k = atoi(v);
+        else if (strcmp(a, "-g") == 0) cfg.glitch = atoi(v);
+        else if (strcmp(a, "-b") == 0) cfg.baud = atof(v);
+        else if (strcmp(a, "-I") == 0) invert = atoi(v) ? 1 : 0;
+        else if (strcmp(a, "-i") == 0) device = v;
+        else if (strcmp(a, "-o") == 0) out_path = v;
+        else if (strcmp(a, "-r") == 0) osr = (unsigned)strtoul(v, NULL, 0);
+        else if (strcmp(a, "-t") == 0) ms = (unsigned)strtoul(v, NULL, 0);
+        else {
+            print_usage(argv[0]);
+            return 1;
+        }
+        i++;
+    }
+
+    if (strcmp(mode, "grab") == 0) {
+        if (!device || !out_path) {
+            print_usage(argv[0]);
+            return 1;
+        }
+        if (osr < CAPTURE_OSR_MIN || osr > CAPTURE_OSR_MAX) {
+            fprintf(stderr, "OSR must be %d..%d\n", CAPTURE_OSR_MIN,
+                    CAPTURE_OSR_MAX);
+            return 1;
+        }
+        return run_grab(device, osr, ms, out_path);
+    }
+
+    if (!in_path) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    if (cfg.phase < 0.0 || cfg.phase > 1.0 || cfg.window < 1 ||
+        cfg.window > 9 || cfg.glitch < 1) {
+        fprintf(stderr, "Bad decode settings\n");
+        return 1;
+    }
+    if (cfg.k <= 0) cfg.k = cfg.window / 2 + 1;
+    if (cfg.k > cfg.window) cfg.k = cfg.window;
+
+    capture_t cap;
+    if (capture_load(in_path, &cap) != 0) return 1;
+    if (invert >= 0) cap.inverted = invert;
+    if (cfg.baud <= 0) cfg.baud = cap.hdr.baud;
+
+    printf("[CAPTURE] %s: baud=%u osr=%u sample_hz=%u samples=%llu "
+           "(%.2f samples/bit at %.0f baud)\n", in_path, cap.hdr.baud,
+           cap.hdr.osr, cap.hdr.sample_hz, (unsigned long long)cap.nsamples,
+           cap.hdr.sample_hz / cfg.baud, cfg.baud);
+
+    int rc = 0;
+    if (strcmp(mode, "decode") == 0) {
+        FILE* out = NULL;
+        if (out_path) {
+            out = fopen(out_path, "wb");
+            if (!out) {
+                perror(out_path);
+                free(cap.words);
+                return 1;
+            }
+        }
+        decode_stats_t st;
+        decode(&cap, &cfg, &st, out);
+        if (out) fclose(out);
+        print_decode("DECODE", &cfg, &st);
+    } else if (strcmp(mode, "sweep") == 0) {
+        rc = run_sweep(&cap, cfg.baud);
+    } else {
+        print_usage(argv[0]);
+        rc = 1;
+    }
+    free(cap.words);
+    return rc;
+}
@@ -0,0 +1,69 @@
+// src/usb_reader.c
+#include "usb_reader.h"
+
+#include <string.h>
+
+#include "../../include/crc16.h"
+
+void usb_reader_init(usb_reader_t *r) {
+    memset(r, 0, sizeof(*r));
+}
+
+// A chunk is a record only if it decodes, is long enough and its CRC
+// matches; anything else (typically a text line) is handed on as text.
+static void chunk_done(usb_reader_t *r, usb_record_cb cb, void *ctx) {
+    size_t n = cobs_decode(r->enc, r->enc_len, r->dec, sizeof(r->dec));
+    if (n != (size_t)-1 && n >= 1 + USBREC_CRC_SIZE) {
+        if (crc16_validate(r->dec, n)) {
+            r->records++;
+            cb(r->dec[0], r->dec + 1, n - 1 - USBREC_CRC_SIZE, ctx);
+            return;
+        }
+        // Printable text almost never fails only the CRC; count it as a
+        // damaged record only if it does not look like text
+        int text = 1;
+        for (size_t i = 0; i < r->enc_len && text; i++)
+            if ((r->enc[i] < 0x20 || r->enc[i] > 0x7E) &&
+                r->enc[i] != '\n' && r->enc[i] != '\r' && r->enc[i] != '\t')
+                text = 0;
+        if (!text) {
+            r->bad_records++;
+            return;
+        }
+    }
+    r->text_chunks++;
+    cb(USBREC_TEXT, r->enc, r->enc_len, ctx);
+}
+
+void usb_reader_feed(usb_reader_t *r, const uint8_t *data, size_t len,
+                     usb_record_cb cb, void *ctx) {
+    for (size_t i = 0; i < len; i++) {
+        uint8_t b = data[i];
+        if (b == 0) {
+            if (!r->overflow && r->enc_len) chunk_done(r, cb, ctx);
+            r->enc_len  = 0;
+            r->overflow = 0;
+            continue;
+        }
+        if (r->overflow) continue;
+        if (r->enc_len == sizeof(r->enc)) {
+            r->overflow = 1;
+            r->bad_records++;
+            continue;
+        }
+        r->enc[r->enc_len++] = b;
+    }
+}
+
+const char *usb_record_name(uint8_t type) {
+    switch (type) {
+        case USBREC_TEXT:   return "TEXT";
+        case USBREC_FRAME:  return "FRAME";
+        case USBREC_RAW:    return "RAW";
+        case USBREC_STATS:  return "STATS";
+        case USBREC_TEST:   return "TEST";
+        case USBREC_KEY_ID: return "KEY_ID";
+        case USBREC_PRBS:   return "PRBS";
+        default:            return "UNKNOWN";
+    }
+}
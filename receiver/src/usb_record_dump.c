@@ -0,0 +1,174 @@
+// src/usb_record_dump.c
+//
+// Reads the lifi_pico2_rx binary USB stream (`out bin`) and prints each
+// record as the line text mode would have printed, so rx_monitor.py and
+// log greps keep working while the Pico ships compact records.
+//
+//   usb_record_dump [-i DEVICE] [-n]
+//       -i  serial device (default /dev/ttyACM0), or "-" for stdin
+//       -n  don't send "out bin" to the Pico first
+
+#define _DEFAULT_SOURCE
+
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../../include/protocol.h"
+#include "serial_linux.h"
+#include "usb_reader.h"
+
+static volatile sig_atomic_t g_stop = 0;
+
+static void on_signal(int sig) {
+    (void)sig;
+    g_stop = 1;
+}
+
+static const char* const mode_names[] = {"SST", "TEXT", "RAW"};
+
+static void print_record(uint8_t type, const uint8_t* p, size_t len,
+                         void* ctx) {
+    (void)ctx;
+    switch (type) {
+        case USBREC_TEXT:
+            fwrite(p, 1, len, stdout);
+            break;
+        case USBREC_FRAME: {
+            usbrec_frame_t h;
+            if (len < sizeof(h)) break;
+            memcpy(&h, p, sizeof(h));
+            const uint8_t* data = p + sizeof(h);
+            size_t n = len - sizeof(h);
+            if (h.type == MSG_TYPE_FILE) {
+                printf("[FILE #%u] %u -> %zu bytes\n", h.seq, h.wire_len, n);
+                fwrite(data, 1, n, stdout);
+                printf("\n");
+            } else {
+                printf("[%s #%u] %.*s\n",
+                       h.type == USBREC_FRAME_PLAINTEXT ? "RX" : "MSG", h.seq,
+                       (int)n, (const char*)data);
+            }
+            break;
+        }
+        case USBREC_RAW:
+            for (size_t i = 0; i < len; i++)
+                printf("[RAW] 0x%02X '%c'\n", p[i],
+                       (p[i] >= 32 && p[i] < 127) ? p[i] : '.');
+            break;
+        case USBREC_STATS: {
+            usbrec_stats_t s;
+            if (len < sizeof(s)) break;
+            memcpy(&s, p, sizeof(s));
+            printf("[ALIVE] %s | baud=%u | vote=%u | msgs=%u | ring_ovf=%u | "
+                   "ok=%u crc=%u auth_fail=%u replay=%u | dac=0x%03X\n",
+                   s.mode < 3 ? mode_names[s.mode] : "?", s.baud, s.vote,
+                   s.msgs, s.ring_overflows, s.frames_ok, s.crc_fail,
+                   s.auth_fail, s.replays, s.dac_code);
+            break;
+        }
+        case USBREC_TEST: {
+            usbrec_test_t t;
+            if (len < sizeof(t)) break;
+            memcpy(&t, p, sizeof(t));
+            switch (t.event) {
+                case USBREC_TEST_START:
+                    printf("[TEST_START] baud=%u vote=%u\n", t.baud, t.vote);
+                    break;
+                case USBREC_TEST_RESULT:
+                    printf("[TEST_RESULT] baud=%u sent=%u recv=%u vote=%u\n",
+                           t.baud, t.sent, t.recv, t.vote);
+                    break;
+                case USBREC_TEST_BAUD:
+                    printf("[TEST] baud_switch=%u\n", t.baud);
+                    break;
+                case USBREC_TEST_DONE:
+                    printf("[TEST_DONE]\n");
+                    break;
+            }
+            break;
+        }
+        case USBREC_KEY_ID: {
+            usbrec_key_id_t k;
+            if (len < sizeof(k)) break;
+            memcpy(&k, p, sizeof(k));
+            printf("[KEY_ID] ");
+            for (int i = 0; i < 8; i++) printf("%02X", k.key_id[i]);
+            printf(" %s\n", k.status == USBREC_KEY_MATCH      ? "match"
+                            : k.status == USBREC_KEY_MISMATCH ? "mismatch"
+                                                              : "no key");
+            break;
+        }
+        case USBREC_PRBS: {
+            usbrec_prbs_t r;
+            if (len < sizeof(r)) break;
+            memcpy(&r, p, sizeof(r));
+            double ber = r.bits ? (double)r.errors / (double)r.bits : 0.0;
+            printf("[PRBS_RESULT] baud=%u order=%u sent=%u recv=%u bits=%llu "
+                   "errors=%llu ber=%.3e unchecked=%llu slips=%u lost=%u "
+                   "extra=%u resyncs=%u bursts=%u,%u,%u,%u,%u,%u max_burst=%u "
+                   "vote=%u\n",
+                   r.baud, r.order, r.sent, r.recv, (unsigned long long)r.bits,
+                   (unsigned long long)r.errors, ber,
+                   (unsigned long long)r.unchecked_bits, r.slips, r.bytes_lost,
+                   r.bytes_extra, r.resyncs, r.bursts[0], r.bursts[1],
+                   r.bursts[2], r.bursts[3], r.bursts[4], r.bursts[5],
+                   r.max_burst, r.vote);
+            break;
+        }
+        default:
+            printf("[%s] type=0x%02X len=%zu\n", usb_record_name(type), type,
+                   len);
+            break;
+    }
+    fflush(stdout);
+}
+
+int main(int argc, char* argv[]) {
+    const char* device = "/dev/ttyACM0";
+    int send_cmd = 1;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-i") == 0 && i + 1 < argc) {
+            device = argv[++i];
+        } else if (strcmp(argv[i], "-n") == 0) {
+            send_cmd = 0;
+        } else {
+            printf("Usage: %s [-i DEVICE|-] [-n]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    int fd = STDIN_FILENO;
+    if (strcmp(device, "-") != 0) {
+        fd = init_serial_baud(device, 115200);  // USB CDC ignores the rate
+        if (fd < 0) return 1;
+        if (send_cmd && write(fd, "out bin\n", 8) != 8) {
+            perror("write");
+            close(fd);
+            return 1;
+        }
+    }
+
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+
+    static usb_reader_t reader;
+    usb_reader_init(&reader);
+
+    uint8_t buf[4096];
+    while (!g_stop) {
+        ssize_t n = read(fd, buf, sizeof(buf));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        usb_reader_feed(&reader, buf, (size_t)n, print_record, NULL);
+    }
+
+    fprintf(stderr, "[USB_DUMP] records=%u bad=%u text_chunks=%u\n",
+            reader.records, reader.bad_records, reader.text_chunks);
+    if (fd != STDIN_FILENO) close(fd);
+    return 0;
+}
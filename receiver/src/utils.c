@@ -3,6 +3,7 @@
 
 #include <errno.h>
 #include <stdio.h>
+#include <time.h>
 #include <unistd.h>
 
 void print_hex(const char* label, const uint8_t* data, size_t len) {
@@ -32,3 +33,9 @@ int rand_bytes(uint8_t* buf, size_t len) {
     fclose(f);
     return (n == len) ? 0 : -1;
 }
+
+uint32_t monotonic_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)((uint64_t)ts.tv_sec * 1000u + ts.tv_nsec / 1000000);
+}
@@ -0,0 +1,191 @@
+// autobaud.c
+#include "autobaud.h"
+
+#include <math.h>
+#include <string.h>
+#include "hardware/clocks.h"
+#include "hardware/dma.h"
+#include "hardware/pio.h"
+#include "lifi_edge.pio.h"
+#include "../../include/protocol.h"
+
+#define AB_PIO       pio1
+#define MAX_RUNS     40     // 4 bytes x 10 bits can't give more runs
+#define MIN_BAUD_HZ  1000.0f
+#define MAX_BAUD_HZ  4000000.0f
+
+static uint32_t runs[AUTOBAUD_WORDS];
+static int      ab_sm  = -1;
+static int      dma_ch = -1;
+static bool     enabled;
+static float    pending_hz;   // unconfirmed coarse estimate
+static autobaud_stats_t st;
+
+// Preamble as line runs, starting with the first start bit (pin HIGH)
+static uint8_t  pat_bits[MAX_RUNS];
+static bool     pat_stop[MAX_RUNS];   // holds a stop bit: idle may stretch it
+static int      pat_n;
+
+static void build_pattern(void) {
+    static const uint8_t pre[4] = {
+        PREAMBLE_BYTE_1, PREAMBLE_BYTE_2, PREAMBLE_BYTE_3, PREAMBLE_BYTE_4
+    };
+    int prev = -1;
+    pat_n = 0;
+    for (int b = 0; b < 4; b++) {
+        for (int i = 0; i < 10; i++) {
+            // UART level: start 0, data LSB first, stop 1
+            int level = i == 0 ? 0 : i == 9 ? 1 : (pre[b] >> (i - 1)) & 1;
+            if (level != prev) {
+                pat_bits[pat_n] = 0;
+                pat_stop[pat_n] = false;
+                pat_n++;
+                prev = level;
+            }
+            pat_bits[pat_n - 1]++;
+            if (i == 9) pat_stop[pat_n - 1] = true;
+        }
+    }
+}
+
+static inline bool run_low(uint32_t w) { return w & 1u; }
+
+static inline uint32_t run_cycles(uint32_t w) {
+    uint32_t count = ~(w >> 1) & 0x7FFFFFFFu;
+    return 2u * count + (run_low(w) ? 5u : 4u);
+}
+
+// Checks for the preamble at runs[i]; on a match returns the bit time in
+// clk_sys cycles.
+static bool match(int i, float *bit) {
+    if (i < 1 || i + pat_n > AUTOBAUD_WORDS) return false;
+    if (!run_low(runs[i - 1])) return false;  // idle or a stop bit before it
+
+    // Sum each byte from its start bit's rising edge to the rising edge of
+    // its last HIGH run: both ends are the same kind of edge.
+    uint32_t span = 0, span_bits = 0, grp = 0, grp_bits = 0;
+    for (int j = 0; j < pat_n; j++) {
+        uint32_t w = runs[i + j];
+        if (run_low(w) != (j & 1)) return false;  // a dropped run
+        if (pat_stop[j]) {
+            span      += grp - run_cycles(runs[i + j - 1]);
+            span_bits += grp_bits - pat_bits[j - 1];
+            grp = grp_bits = 0;
+        } else {
+            grp      += run_cycles(w);
+            grp_bits += pat_bits[j];
+        }
+    }
+    if (span_bits == 0) return false;
+    float u = (float)span / (float)span_bits;
+
+    float tol = AUTOBAUD_TOL * u;
+    if ((float)run_cycles(runs[i - 1]) < u - tol) return false;
+    for (int j = 0; j < pat_n; j++) {
+        float want = pat_bits[j] * u;
+        float got  = (float)run_cycles(runs[i + j]);
+        if (got < want - tol) return false;
+        if (!pat_stop[j] && got > want + tol) return false;
+    }
+    *bit = u;
+    return true;
+}
+
+static autobaud_action_t update(float hz, float cur_hz, float *new_hz) {
+    if (hz < MIN_BAUD_HZ || hz > MAX_BAUD_HZ) return AUTOBAUD_NONE;
+    st.matches++;
+    st.last_hz = hz;
+
+    if (fabsf(hz / cur_hz - 1.0f) > AUTOBAUD_COARSE) {
+        // One preamble might be a lookalike in the data; wait for a second
+        if (pending_hz > 0.0f && fabsf(hz / pending_hz - 1.0f) <= AUTOBAUD_AGREE) {
+            pending_hz = 0.0f;
+            st.filt_hz = hz;
+            st.retunes++;
+            *new_hz = hz;
+            return AUTOBAUD_RETUNE;
+        }
+        pending_hz = hz;
+        return AUTOBAUD_NONE;
+    }
+
+    pending_hz = 0.0f;
+    st.filt_hz = st.filt_hz > 0.0f ? st.filt_hz + (hz - st.filt_hz) / AUTOBAUD_FILTER
+                                   : hz;
+    if (fabsf(st.filt_hz / cur_hz - 1.0f) <= AUTOBAUD_FINE) return AUTOBAUD_NONE;
+    st.trims++;
+    *new_hz = st.filt_hz;
+    return AUTOBAUD_TRIM;
+}
+
+static void arm(void) {
+    // Start from fresh runs, not the ones queued while nobody was reading
+    pio_sm_clear_fifos(AB_PIO, (uint)ab_sm);
+    dma_channel_transfer_to_buffer_now(dma_ch, runs, AUTOBAUD_WORDS);
+}
+
+bool autobaud_init(uint pin) {
+    build_pattern();
+    ab_sm = pio_claim_unused_sm(AB_PIO, false);
+    if (ab_sm < 0) return false;
+    if (!pio_can_add_program(AB_PIO, &lifi_edge_program)) {
+        pio_sm_unclaim(AB_PIO, (uint)ab_sm);
+        ab_sm = -1;
+        return false;
+    }
+    dma_ch = dma_claim_unused_channel(false);
+    if (dma_ch < 0) {
+        pio_sm_unclaim(AB_PIO, (uint)ab_sm);
+        ab_sm = -1;
+        return false;
+    }
+
+    uint offset = pio_add_program(AB_PIO, &lifi_edge_program);
+    lifi_edge_program_init(AB_PIO, (uint)ab_sm, offset, pin);
+
+    dma_channel_config c = dma_channel_get_default_config(dma_ch);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+    channel_config_set_read_increment(&c, false);
+    channel_config_set_write_increment(&c, true);
+    channel_config_set_dreq(&c, pio_get_dreq(AB_PIO, (uint)ab_sm, false));
+    dma_channel_configure(dma_ch, &c, runs, &AB_PIO->rxf[ab_sm], AUTOBAUD_WORDS, false);
+    return true;
+}
+
+void autobaud_enable(bool on) {
+    if (dma_ch < 0 || on == enabled) return;
+    enabled = on;
+    if (on) {
+        autobaud_reset();
+        arm();
+    } else {
+        dma_channel_abort(dma_ch);
+    }
+}
+
+bool autobaud_enabled(void) { return enabled; }
+
+void autobaud_reset(void) {
+    pending_hz = 0.0f;
+    st.filt_hz = 0.0f;
+}
+
+autobaud_action_t autobaud_poll(float cur_hz, float *new_hz) {
+    if (!enabled || dma_channel_is_busy(dma_ch)) return AUTOBAUD_NONE;
+    st.snapshots++;
+
+    float sys_hz = (float)clock_get_hz(clk_sys);
+    autobaud_action_t act = AUTOBAUD_NONE;
+    for (int i = 1; i + pat_n <= AUTOBAUD_WORDS; i++) {
+        float bit;
+        if (run_low(runs[i]) || !match(i, &bit)) continue;
+        autobaud_action_t a = update(sys_hz / bit, cur_hz, new_hz);
+        if (a != AUTOBAUD_NONE) cur_hz = *new_hz;
+        if (a > act) act = a;
+        i += pat_n - 1;
+    }
+    arm();
+    return act;
+}
+
+const autobaud_stats_t *autobaud_stats(void) { return &st; }
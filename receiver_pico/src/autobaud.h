@@ -0,0 +1,64 @@
+// autobaud.h
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include "pico/stdlib.h"
+
+// Baud detection and clock recovery from the frame preamble.
+//
+// A run-length timer (lifi_edge.pio) on pio1 times every level run on the
+// RX pin at clk_sys resolution; DMA collects AUTOBAUD_WORDS runs at a time.
+// Each snapshot is searched for the run pattern of the 4 preamble bytes
+// (start + 8 data + stop each), which is the same at any baud. Only spans
+// from one rising edge to a later rising edge inside a byte are summed, so
+// pulse-width distortion (HIGH runs stretched by comparator delay) and
+// idle time after a stop bit don't bias the estimate.
+//
+// An estimate more than AUTOBAUD_COARSE off the current rate retunes once
+// a second preamble agrees with it. Closer estimates feed a filter, and the
+// rate is trimmed when the filtered value drifts past AUTOBAUD_FINE.
+
+#define AUTOBAUD_WORDS   512      // runs per snapshot
+#define AUTOBAUD_TOL     0.4f     // per-run tolerance, in bit times
+#define AUTOBAUD_COARSE  0.03f    // retune above 3% error
+#define AUTOBAUD_AGREE   0.01f    // two estimates within 1% confirm a retune
+#define AUTOBAUD_FINE    0.001f   // trim above 0.1% filtered error
+#define AUTOBAUD_FILTER  8        // fine filter weight 1/8
+
+typedef enum {
+    AUTOBAUD_NONE = 0,
+    AUTOBAUD_TRIM,      // small correction of the current rate
+    AUTOBAUD_RETUNE,    // the sender runs at a different rate
+} autobaud_action_t;
+
+typedef struct {
+    uint32_t snapshots;   // run snapshots searched
+    uint32_t matches;     // preambles measured
+    uint32_t retunes;
+    uint32_t trims;
+    float    last_hz;     // last single-preamble estimate
+    float    filt_hz;     // filtered estimate (0 = none yet)
+} autobaud_stats_t;
+
+// Loads the run timer on pio1 and claims a DMA channel. Starts disabled.
+//
+// @return false if pio1 has no free SM / program space or no DMA channel
+bool autobaud_init(uint pin);
+
+void autobaud_enable(bool on);
+
+bool autobaud_enabled(void);
+
+// Forgets the filter and any unconfirmed estimate (after a manual rate
+// change).
+void autobaud_reset(void);
+
+// Searches a finished snapshot and starts the next one. Cheap when the
+// snapshot is still filling.
+//
+// @param cur_hz Rate the RX SM currently runs at
+// @param new_hz Out: rate to switch to (valid unless AUTOBAUD_NONE)
+// @return the strongest action the snapshot called for
+autobaud_action_t autobaud_poll(float cur_hz, float *new_hz);
+
+const autobaud_stats_t *autobaud_stats(void);
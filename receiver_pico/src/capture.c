@@ -0,0 +1,170 @@
+// capture.c
+#include "capture.h"
+
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "pico/stdio_usb.h"
+#include "hardware/clocks.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "lifi_capture.pio.h"
+#include "../../include/capture_format.h"
+
+// 8 x 8 KB ring. At 8x oversampling of 250 kbaud the sampler produces
+// 250 KB/s, so the ring covers ~250 ms of USB stalls.
+#define CAPTURE_BLOCK_WORDS 2048
+#define CAPTURE_NUM_BLOCKS  8
+
+// USB full-speed CDC tops out around 1 MB/s in practice.
+#define CAPTURE_USB_BYTES_PER_S 900000u
+
+static uint32_t blocks[CAPTURE_NUM_BLOCKS][CAPTURE_BLOCK_WORDS];
+static int dma_ch[2] = { -1, -1 };
+static volatile uint32_t blocks_done;  // blocks completed by DMA
+static volatile uint32_t next_block;   // next block to hand to an idle channel
+
+// Two channels chained to each other ping-pong through the ring. When one
+// finishes, the other is already running, so the finished one is re-aimed
+// at the block after it without triggering.
+static void capture_dma_irq(void) {
+    for (int i = 0; i < 2; i++) {
+        if (dma_ch[i] < 0 || !dma_channel_get_irq0_status(dma_ch[i])) continue;
+        dma_channel_acknowledge_irq0(dma_ch[i]);
+        blocks_done++;
+        dma_channel_set_write_addr(dma_ch[i],
+                                   blocks[next_block % CAPTURE_NUM_BLOCKS], false);
+        next_block++;
+    }
+}
+
+static void capture_dma_setup(PIO pio, uint sm, int ch, int other, uint32_t *dst) {
+    dma_channel_config c = dma_channel_get_default_config(ch);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+    channel_config_set_read_increment(&c, false);
+    channel_config_set_write_increment(&c, true);
+    channel_config_set_dreq(&c, pio_get_dreq(pio, sm, false));
+    channel_config_set_chain_to(&c, other);
+    dma_channel_configure(ch, &c, dst, &pio->rxf[sm], CAPTURE_BLOCK_WORDS, false);
+    dma_channel_set_irq0_enabled(ch, true);
+}
+
+static void capture_dma_stop(void) {
+    for (int i = 0; i < 2; i++) {
+        // Chain to self first so aborting one channel cannot start the other
+        hw_write_masked(&dma_hw->ch[dma_ch[i]].al1_ctrl,
+                        (uint)dma_ch[i] << DMA_CH0_CTRL_TRIG_CHAIN_TO_LSB,
+                        DMA_CH0_CTRL_TRIG_CHAIN_TO_BITS);
+        dma_channel_set_irq0_enabled(dma_ch[i], false);
+    }
+    for (int i = 0; i < 2; i++) {
+        dma_channel_abort(dma_ch[i]);
+        dma_channel_acknowledge_irq0(dma_ch[i]);
+        dma_channel_unclaim(dma_ch[i]);
+        dma_ch[i] = -1;
+    }
+}
+
+static void capture_write(const void *data, size_t len) {
+    fwrite(data, 1, len, stdout);
+}
+
+bool capture_run(PIO pio, uint pin, uint32_t baud, uint osr, uint32_t ms,
+                 capture_result_t *res) {
+    memset(res, 0, sizeof(*res));
+
+    int sm = pio_claim_unused_sm(pio, false);
+    if (sm < 0) return false;
+    if (!pio_can_add_program(pio, &lifi_capture_program)) {
+        pio_sm_unclaim(pio, (uint)sm);
+        return false;
+    }
+    dma_ch[0] = dma_claim_unused_channel(false);
+    dma_ch[1] = dma_claim_unused_channel(false);
+    if (dma_ch[0] < 0 || dma_ch[1] < 0) {
+        if (dma_ch[0] >= 0) dma_channel_unclaim(dma_ch[0]);
+        if (dma_ch[1] >= 0) dma_channel_unclaim(dma_ch[1]);
+        dma_ch[0] = dma_ch[1] = -1;
+        pio_sm_unclaim(pio, (uint)sm);
+        return false;
+    }
+
+    uint32_t sys_hz = clock_get_hz(clk_sys);
+    float div = (float)sys_hz / ((float)baud * (float)osr);
+    if (div < 1.0f) div = 1.0f;
+    uint16_t div_int;
+    uint8_t div_frac;
+    pio_calculate_clkdiv_from_float(div, &div_int, &div_frac);
+    res->sample_hz = (uint32_t)(((uint64_t)sys_hz * 256u) /
+                                ((uint32_t)div_int * 256u + div_frac));
+
+    // Whole blocks only, so the consumer never waits on a partial one
+    uint64_t want = ((uint64_t)res->sample_hz * ms / 1000u + 31u) / 32u;
+    uint32_t nblocks = (uint32_t)((want + CAPTURE_BLOCK_WORDS - 1) / CAPTURE_BLOCK_WORDS);
+    if (nblocks == 0) nblocks = 1;
+    res->words = nblocks * CAPTURE_BLOCK_WORDS;
+
+    if (res->sample_hz / 8u > CAPTURE_USB_BYTES_PER_S) {
+        printf("[CAPTURE] warning: %lu B/s exceeds USB bandwidth, expect overruns\n",
+               res->sample_hz / 8u);
+    }
+
+    lifi_capture_hdr_t hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, CAPTURE_MAGIC, CAPTURE_MAGIC_SIZE);
+    hdr.version   = CAPTURE_VERSION;
+    hdr.osr       = (uint16_t)osr;
+    hdr.baud      = baud;
+    hdr.sample_hz = res->sample_hz;
+    hdr.sys_hz    = sys_hz;
+    hdr.words     = res->words;
+    hdr.pin       = (uint8_t)pin;
+    hdr.inverted  = 1;  // idle LOW on the TLV3501 output
+
+    uint offset = pio_add_program(pio, &lifi_capture_program);
+    lifi_capture_program_init(pio, (uint)sm, offset, pin, div);
+
+    blocks_done = 0;
+    next_block  = 2;
+    capture_dma_setup(pio, (uint)sm, dma_ch[0], dma_ch[1], blocks[0]);
+    capture_dma_setup(pio, (uint)sm, dma_ch[1], dma_ch[0], blocks[1]);
+    irq_add_shared_handler(DMA_IRQ_0, capture_dma_irq,
+                           PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+    irq_set_enabled(DMA_IRQ_0, true);
+
+    printf("[CAPTURE] start words=%lu sample_hz=%lu\n", res->words, res->sample_hz);
+    fflush(stdout);
+
+    // Binary from here on: no \n -> \r\n rewriting
+    stdio_set_translate_crlf(&stdio_usb, false);
+    capture_write(&hdr, sizeof(hdr));
+
+    dma_channel_start(dma_ch[0]);
+    pio_sm_set_enabled(pio, (uint)sm, true);
+
+    for (uint32_t sent = 0; sent < nblocks; ) {
+        uint32_t done = blocks_done;
+        if (done == sent) {
+            tight_loop_contents();
+            continue;
+        }
+        // DMA is filling block `done` and the next one is already armed;
+        // anything older than one ring behind has been overwritten.
+        if (done + 2 > sent + CAPTURE_NUM_BLOCKS) res->overruns++;
+        capture_write(blocks[sent % CAPTURE_NUM_BLOCKS], sizeof(blocks[0]));
+        sent++;
+    }
+    fflush(stdout);
+
+    pio_sm_set_enabled(pio, (uint)sm, false);
+    capture_dma_stop();
+    irq_remove_handler(DMA_IRQ_0, capture_dma_irq);
+    pio_sm_clear_fifos(pio, (uint)sm);
+    pio_remove_program(pio, &lifi_capture_program, offset);
+    pio_sm_unclaim(pio, (uint)sm);
+
+    stdio_set_translate_crlf(&stdio_usb, true);
+    printf("\n[CAPTURE] done words=%lu overruns=%lu\n", res->words, res->overruns);
+    fflush(stdout);
+    return true;
+}
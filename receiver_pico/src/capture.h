@@ -0,0 +1,32 @@
+// capture.h
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include "hardware/pio.h"
+
+// Oversampled capture of the RX pin for offline decoding (soft_uart_decoder).
+// A free-running PIO sampler feeds a ring of DMA blocks; the blocks are
+// written to USB stdout as they fill, as described in capture_format.h.
+
+typedef struct {
+    uint32_t words;       // sample words streamed after the header
+    uint32_t sample_hz;   // actual sample rate after the clock divider
+    uint32_t overruns;    // blocks DMA overwrote before USB drained them
+} capture_result_t;
+
+// Streams `ms` milliseconds of `pin` sampled at baud * osr. Blocks until the
+// last word is written. Output on stdout:
+//
+//   [CAPTURE] start words=N sample_hz=H\n
+//   <lifi_capture_hdr_t><N words>
+//   \n[CAPTURE] done words=N overruns=K\n
+//
+// @param pio PIO block with one free state machine and room for 1 instruction
+// @param pin GPIO to sample (already configured as input)
+// @param baud Line rate the oversampling is relative to
+// @param osr Samples per bit (CAPTURE_OSR_MIN..CAPTURE_OSR_MAX)
+// @param ms Capture length in milliseconds
+// @param res Out: what was streamed
+// @return false if no state machine / DMA channel / program space was free
+bool capture_run(PIO pio, uint pin, uint32_t baud, uint osr, uint32_t ms,
+                 capture_result_t *res);
@@ -3,193 +3,389 @@
 #include <string.h>
 #include "pico/stdlib.h"
 #include "hardware/pio.h"
-#include "hardware/clocks.h"
-#include "lifi_rx.pio.h"
+#include "autobaud.h"
+#include "capture.h"
+#include "rx_core.h"
+#include "rx_events.h"
+#include "rx_ring.h"
+#include "sst_endpoint.h"
+#include "threshold.h"
+#include "usb_out.h"
+#include "../../include/capture_format.h"
+#include "../../include/prbs.h"
 #include "../../include/protocol.h"
 
-#define RX_PIN    27
-
-typedef enum {
-    STATE_HUNT = 0,
-    STATE_PRE1,
-    STATE_PRE2,
-    STATE_PRE3,
-    STATE_PAYLOAD
-} rx_state_t;
-
-static PIO        pio          = pio0;
-static uint       sm           = 0;
-static uint32_t   current_baud = 9600;
-static char       buf[512];
-static int        buf_idx      = 0;
-static rx_state_t state        = STATE_HUNT;
-static uint32_t   msg_count    = 0;
-static bool       raw_mode     = false;
-
-// Auto-benchmark state
-static bool       test_active  = false;
-static uint32_t   test_recv    = 0;
-static uint32_t   test_baud    = 0;
+// Core0: USB commands, heartbeat and printing of what core1 (rx_core.c)
+// receives. Nothing here touches the RX state machine directly.
 
 static char cmd[64];
 static int  cmd_idx = 0;
 
+// Bench protocol event: text line or USBREC_TEST record
+static void report_test(uint8_t event, uint32_t baud, uint32_t sent, uint32_t recv,
+                        uint v) {
+    if (usb_out_bin()) {
+        usbrec_test_t rec = { .event = event, .vote = (uint8_t)v, .baud = baud,
+                              .sent = sent, .recv = recv };
+        usb_out_record(USBREC_TEST, &rec, sizeof(rec), NULL, 0);
+        return;
+    }
+    switch (event) {
+        case USBREC_TEST_START:
+            printf("[TEST_START] baud=%lu vote=%u\n", baud, v);
+            break;
+        case USBREC_TEST_RESULT:
+            printf("[TEST_RESULT] baud=%lu sent=%lu recv=%lu vote=%u\n",
+                   baud, sent, recv, v);
+            break;
+        case USBREC_TEST_BAUD:
+            printf("[TEST] baud_switch=%lu\n", baud);
+            break;
+        case USBREC_TEST_DONE:
+            printf("[TEST_DONE]\n");
+            break;
+    }
+    fflush(stdout);
+}
+
+static void report_alive(uint32_t now) {
+    bool raw = rx_core_raw(), text = rx_core_text();
+    if (usb_out_bin()) {
+        const sst_endpoint_stats_t *st = sst_endpoint_stats();
+        usbrec_stats_t rec = {
+            .uptime_ms = now, .baud = rx_core_baud(), .vote = (uint8_t)rx_core_vote(),
+            .mode = raw ? 2 : (text ? 1 : 0),
+            .dac_code = threshold_state()->code,
+            .msgs = rx_core_msgs(), .ring_overflows = rx_ring_overflows(),
+            .fifo_stalls = rx_ring_stalls(),
+            .frames_ok = st->frames_ok, .crc_fail = st->crc_fail,
+            .dropped = st->dropped, .decrypted = st->decrypted,
+            .auth_fail = st->auth_fail, .replays = st->replays,
+            .no_key = st->no_key, .files = st->files,
+        };
+        usb_out_record(USBREC_STATS, &rec, sizeof(rec), NULL, 0);
+        return;
+    }
+    printf("[ALIVE] %s | baud=%lu | vote=%u | msgs=%lu | ring_ovf=%lu | dac=0x%03X\n",
+           raw ? "RAW MODE" : "listening...", rx_core_baud(), rx_core_vote(),
+           rx_core_msgs(), rx_ring_overflows(), threshold_state()->code);
+    fflush(stdout);
+}
+
+static void report_prbs(const rx_event_t *ev) {
+    const prbs_stats_t *st = &ev->prbs.stats;
+    if (usb_out_bin()) {
+        usbrec_prbs_t rec = {
+            .baud = ev->prbs.baud, .order = (uint8_t)ev->prbs.order, .vote = ev->vote,
+            .sent = ev->prbs.sent, .recv = st->bytes, .bits = st->bits,
+            .errors = st->errors, .unchecked_bits = st->unchecked_bits,
+            .slips = st->slips, .bytes_lost = st->bytes_lost,
+            .bytes_extra = st->bytes_extra, .resyncs = st->resyncs,
+            .max_burst = st->max_burst,
+        };
+        memcpy(rec.bursts, st->bursts, sizeof(rec.bursts));
+        usb_out_record(USBREC_PRBS, &rec, sizeof(rec), NULL, 0);
+        return;
+    }
+    double ber = st->bits ? (double)st->errors / (double)st->bits : 0.0;
+    printf("[PRBS_RESULT] baud=%lu order=%d sent=%lu recv=%lu bits=%llu errors=%llu "
+           "ber=%.3e unchecked=%llu slips=%lu lost=%lu extra=%lu resyncs=%lu "
+           "bursts=%lu,%lu,%lu,%lu,%lu,%lu max_burst=%lu vote=%u\n",
+           ev->prbs.baud, ev->prbs.order, ev->prbs.sent, st->bytes, st->bits,
+           st->errors, ber, st->unchecked_bits, st->slips, st->bytes_lost,
+           st->bytes_extra, st->resyncs, st->bursts[0], st->bursts[1], st->bursts[2],
+           st->bursts[3], st->bursts[4], st->bursts[5], st->max_burst, ev->vote);
+    fflush(stdout);
+}
+
+// Plaintext line (`mode text`) or authenticated frame from the endpoint
+static void report_frame(const rx_event_t *ev, const uint8_t *data) {
+    bool line = ev->kind == RX_EV_LINE;
+    if (usb_out_bin()) {
+        usbrec_frame_t rec = {
+            .type = line ? USBREC_FRAME_PLAINTEXT : ev->flag, .seq = ev->seq,
+            .wire_len = line ? ev->data_len : ev->wire_len,
+        };
+        usb_out_record(USBREC_FRAME, &rec, sizeof(rec), data, ev->data_len);
+        return;
+    }
+    if (line) {
+        printf("[RX #%lu] %.*s%s\n", ev->seq, (int)ev->data_len, (const char *)data,
+               ev->flag ? " ... [TRUNCATED]" : "");
+    } else if (ev->flag == MSG_TYPE_FILE) {
+        printf("[FILE #%lu] %lu -> %lu bytes\n", ev->seq, ev->wire_len, ev->data_len);
+        fwrite(data, 1, ev->data_len, stdout);
+        printf("\n");
+    } else {
+        printf("[MSG #%lu] %.*s\n", ev->seq, (int)ev->data_len, (const char *)data);
+    }
+    fflush(stdout);
+}
+
+static void report_key_id(const rx_event_t *ev) {
+    if (usb_out_bin()) {
+        usbrec_key_id_t rec;
+        memcpy(rec.key_id, ev->key_id, sizeof(rec.key_id));
+        rec.status = ev->flag;
+        usb_out_record(USBREC_KEY_ID, &rec, sizeof(rec), NULL, 0);
+        return;
+    }
+    printf("[KEY_ID] ");
+    for (int i = 0; i < 8; i++) printf("%02X", ev->key_id[i]);
+    printf(" %s\n", ev->flag == USBREC_KEY_MATCH      ? "match"
+                    : ev->flag == USBREC_KEY_MISMATCH ? "mismatch"
+                                                      : "no key");
+    fflush(stdout);
+}
+
+static void report_raw(const rx_event_t *ev) {
+    for (int i = 0; i < ev->raw_n; i++) {
+        uint8_t byte = ev->raw[i];
+        if (usb_out_bin()) {
+            usb_out_raw(byte);
+        } else {
+            printf("[RAW] 0x%02X '%c'\n", byte, (byte >= 32 && byte < 127) ? byte : '.');
+        }
+    }
+    if (!usb_out_bin()) fflush(stdout);
+}
+
+static void print_threshold(const char *tag) {
+    const threshold_state_t *t = threshold_state();
+    if (!t->dac_found) {
+        printf("%s no MCP4725 on I2C1 (0x60-0x63)\n", tag);
+        return;
+    }
+    printf("%s dac=0x%03X (%.3fV) idle=0x%03X (%.3fV) active=0x%03X (%.3fV) "
+           "frac=%.2f auto=%s tracks=%lu moves=%lu rejects=%lu\n",
+           tag, t->code, threshold_volts(t->code), t->idle, threshold_volts(t->idle),
+           t->active, threshold_volts(t->active), t->frac, t->auto_track ? "on" : "off",
+           t->tracks, t->moves, t->rejects);
+}
+
+static void print_autobaud(void) {
+    const autobaud_stats_t *a = autobaud_stats();
+    printf("Autobaud: %s | trim=%+ld ppm | snapshots=%lu matches=%lu retunes=%lu trims=%lu | "
+           "last=%.0f Hz\n",
+           autobaud_enabled() ? "on" : "off", (long)((rx_core_trim() - 1.0f) * 1e6f),
+           a->snapshots, a->matches, a->retunes, a->trims, a->last_hz);
+}
+
+static void report_event(const rx_event_t *ev) {
+    const uint8_t *data = rx_events_data(ev);
+    switch (ev->kind) {
+        case RX_EV_LINE:
+        case RX_EV_FRAME:
+            report_frame(ev, data);
+            break;
+        case RX_EV_KEY_ID:
+            report_key_id(ev);
+            break;
+        case RX_EV_RAW:
+            report_raw(ev);
+            break;
+        case RX_EV_TEST:
+            report_test(ev->flag, ev->test.baud, ev->test.sent, ev->test.recv, ev->vote);
+            break;
+        case RX_EV_PRBS_START:
+            if (!usb_out_bin()) {
+                printf("[PRBS_START] baud=%lu order=%d bytes=%lu vote=%u\n",
+                       ev->prbs_start.baud, ev->prbs_start.order, ev->prbs_start.bytes,
+                       ev->vote);
+                fflush(stdout);
+            }
+            break;
+        case RX_EV_PRBS:
+            report_prbs(ev);
+            break;
+        case RX_EV_AUTOBAUD:
+            if (!usb_out_bin()) {
+                printf("[AUTOBAUD] baud=%lu (was %lu) div=%.3f\n", ev->autobaud.baud,
+                       ev->autobaud.was, ev->autobaud.div);
+                fflush(stdout);
+            }
+            break;
+        case RX_EV_CAL:
+            if (!ev->flag) printf("[CAL] failed: no DAC, line not idle, or no traffic\n");
+            print_threshold("[CAL]");
+            fflush(stdout);
+            break;
+    }
+    rx_events_release(ev);
+}
+
 int main() {
     stdio_init_all();
     sleep_ms(3000);  // Allow USB to enumerate
 
+    rx_core_launch();
+
     printf("\n=== Pico 2 LiFi Receiver ===\n");
     printf("RX pin  : GP%d\n", RX_PIN);
-    printf("Baud    : %lu\n", current_baud);
+    printf("Baud    : %lu\n", rx_core_baud());
+    printf("Vote    : %u sample(s)/bit\n", rx_core_vote());
     printf("Preamble: 0x%02X 0x%02X 0x%02X 0x%02X\n",
            PREAMBLE_BYTE_1, PREAMBLE_BYTE_2, PREAMBLE_BYTE_3, PREAMBLE_BYTE_4);
-    printf("Commands: raw on/off | status | pintest | baud <rate>\n");
+    printf("Commands: raw on/off | status | pintest | baud <rate> [vote] | vote <1|3|5> | capture <osr> <ms>\n");
+    printf("          key <id> <cipher_key> | key clear | mode sst|text | out text|bin\n");
+    printf("          cal | cal auto on|off | cal frac <f> | cal dac <code> | autobaud on|off\n");
+    print_threshold("[CAL]");
+    if (!autobaud_enabled())
+        printf("Autobaud: unavailable (no free pio1 SM or DMA channel)\n");
     printf("Listening...\n\n");
     fflush(stdout);
 
-    uint offset = pio_add_program(pio, &lifi_rx_program);
-    float div = (float)clock_get_hz(clk_sys) / (current_baud * 8.0f);
-    lifi_rx_program_init(pio, sm, offset, RX_PIN, div);
-
     uint32_t last_heartbeat = 0;
 
     while (true) {
         // Heartbeat every 2s so we know USB output is working
         uint32_t now = to_ms_since_boot(get_absolute_time());
         if (now - last_heartbeat >= 2000) {
-            printf("[ALIVE] %s | baud=%lu | msgs=%lu\n",
-                   raw_mode ? "RAW MODE" : "listening...", current_baud, msg_count);
-            fflush(stdout);
+            report_alive(now);
             last_heartbeat = now;
         }
 
+        // Everything core1 received since the last pass
+        rx_event_t ev;
+        while (rx_events_get(&ev)) report_event(&ev);
+        usb_out_raw_flush();
+
         // Non-blocking USB command input
         int c = getchar_timeout_us(0);
-        if (c != PICO_ERROR_TIMEOUT) {
-            if (c == '\n' || c == '\r') {
-                cmd[cmd_idx] = '\0';
-                cmd_idx = 0;
-                if (strcmp(cmd, "raw on") == 0) {
-                    raw_mode = true;
-                    printf("Raw mode ON\n");
-                } else if (strcmp(cmd, "raw off") == 0) {
-                    raw_mode = false;
-                    printf("Raw mode OFF\n");
-                } else if (strcmp(cmd, "status") == 0) {
-                    printf("RX: GP%d | Baud: %lu | Mode: %s | Msgs: %lu\n",
-                           RX_PIN, current_baud, raw_mode ? "RAW" : "SST", msg_count);
-                } else if (strcmp(cmd, "pintest") == 0) {
-                    printf("Sampling GP%d for 3s...\n", RX_PIN);
-                    fflush(stdout);
-                    uint32_t end = to_ms_since_boot(get_absolute_time()) + 3000;
-                    uint32_t transitions = 0;
-                    bool last = gpio_get(RX_PIN);
-                    while (to_ms_since_boot(get_absolute_time()) < end) {
-                        bool cur = gpio_get(RX_PIN);
-                        if (cur != last) { transitions++; last = cur; }
-                    }
-                    printf("GP%d transitions in 3s: %lu (idle level: %d)\n",
-                           RX_PIN, transitions, (int)gpio_get(RX_PIN));
-                    fflush(stdout);
-                } else if (strncmp(cmd, "baud ", 5) == 0) {
-                    uint32_t b = (uint32_t)strtoul(cmd + 5, NULL, 10);
-                    if (b < 1000 || b > 4000000) {
-                        printf("Invalid baud rate (1000-4000000)\n");
-                    } else {
-                        current_baud = b;
-                        float d = (float)clock_get_hz(clk_sys) / (current_baud * 8.0f);
-                        pio_sm_set_clkdiv(pio, sm, d);
-                        printf("Baud set to %lu (div=%.3f)\n", current_baud, d);
-                    }
-                } else if (strlen(cmd) > 0) {
-                    printf("Unknown: '%s'\n", cmd);
-                }
-                fflush(stdout);
-            } else if (cmd_idx < (int)sizeof(cmd) - 1) {
-                cmd[cmd_idx++] = (char)c;
-            }
-        }
-
-        // PIO RX
-        if (pio_sm_get_rx_fifo_level(pio, sm) == 0) continue;
-
-        uint32_t word = pio_sm_get(pio, sm);
-        // Right-shift: data in bits [31:24]. Invert for reverse-biased photodiode.
-        uint8_t byte = ~(uint8_t)(word >> 24);
-
-        if (raw_mode) {
-            printf("[RAW] 0x%02X '%c'\n", byte, (byte >= 32 && byte < 127) ? byte : '.');
-            fflush(stdout);
+        if (c == PICO_ERROR_TIMEOUT) continue;
+        if (c != '\n' && c != '\r') {
+            if (cmd_idx < (int)sizeof(cmd) - 1) cmd[cmd_idx++] = (char)c;
             continue;
         }
+        cmd[cmd_idx] = '\0';
+        cmd_idx = 0;
 
-        switch (state) {
-            case STATE_HUNT:
-                if (byte == PREAMBLE_BYTE_1) state = STATE_PRE1;
-                break;
-            case STATE_PRE1:
-                state = (byte == PREAMBLE_BYTE_2) ? STATE_PRE2 : STATE_HUNT;
-                break;
-            case STATE_PRE2:
-                state = (byte == PREAMBLE_BYTE_3) ? STATE_PRE3 : STATE_HUNT;
-                break;
-            case STATE_PRE3:
-                if (byte == PREAMBLE_BYTE_4) {
-                    state   = STATE_PAYLOAD;
-                    buf_idx = 0;
-                } else {
-                    state = STATE_HUNT;
-                }
-                break;
-            case STATE_PAYLOAD:
-                if (byte == '\n' || byte == '\r') {
-                    buf[buf_idx] = '\0';
-                    msg_count++;
-
-                    // --- Test protocol dispatch ---
-                    if (strncmp(buf, "__BAUD:", 7) == 0) {
-                        uint32_t nb = (uint32_t)strtoul(buf + 7, NULL, 10);
-                        if (nb >= 1000 && nb <= 4000000) {
-                            current_baud = nb;
-                            float d = (float)clock_get_hz(clk_sys) / (current_baud * 8.0f);
-                            pio_sm_set_clkdiv(pio, sm, d);
-                            printf("[TEST] baud_switch=%lu\n", current_baud);
-                            fflush(stdout);
-                        }
-                    } else if (strcmp(buf, "__TEST_START__") == 0) {
-                        test_active = true;
-                        test_recv   = 0;
-                        test_baud   = current_baud;
-                        printf("[TEST_START] baud=%lu\n", test_baud);
-                        fflush(stdout);
-                    } else if (strncmp(buf, "__TEST_END:", 11) == 0) {
-                        uint32_t sent = (uint32_t)strtoul(buf + 11, NULL, 10);
-                        test_active = false;
-                        printf("[TEST_RESULT] baud=%lu sent=%lu recv=%lu\n",
-                               test_baud, sent, test_recv);
-                        fflush(stdout);
-                    } else if (strcmp(buf, "__DONE__") == 0) {
-                        printf("[TEST_DONE]\n");
-                        fflush(stdout);
-                    } else if (test_active && strncmp(buf, "PKT", 3) == 0) {
-                        test_recv++;  // count silently during test
-                    } else {
-                        printf("[RX #%lu] %s\n", msg_count, buf);
-                        fflush(stdout);
-                    }
-
-                    state = STATE_HUNT;
-                } else if (buf_idx < (int)sizeof(buf) - 1) {
-                    buf[buf_idx++] = (char)byte;
-                } else {
-                    buf[buf_idx] = '\0';
-                    msg_count++;
-                    printf("[RX #%lu] %s ... [TRUNCATED]\n", msg_count, buf);
-                    fflush(stdout);
-                    state = STATE_HUNT;
+        if (strcmp(cmd, "raw on") == 0) {
+            rx_core_set_raw(true);
+            printf("Raw mode ON\n");
+        } else if (strcmp(cmd, "raw off") == 0) {
+            rx_core_set_raw(false);
+            printf("Raw mode OFF\n");
+        } else if (strcmp(cmd, "status") == 0) {
+            bool raw = rx_core_raw(), text = rx_core_text();
+            printf("RX: GP%d | Baud: %lu | Vote: %u | Mode: %s | Msgs: %lu\n",
+                   RX_PIN, rx_core_baud(), rx_core_vote(),
+                   raw ? "RAW" : (text ? "TEXT" : "SST"), rx_core_msgs());
+            printf("Ring: %lu/%d words | Overflows: %lu words | FIFO stalls: %lu\n",
+                   rx_ring_level(), RX_RING_WORDS, rx_ring_overflows(),
+                   rx_ring_stalls());
+            printf("Events: %lu/%d queued | Dropped: %lu\n",
+                   rx_events_level(), RX_EVENTS_DEPTH, rx_events_dropped());
+            sst_endpoint_print_status();
+            print_threshold("Threshold:");
+            print_autobaud();
+        } else if (strcmp(cmd, "pintest") == 0) {
+            // Reception carries on in core1 meanwhile
+            printf("Sampling GP%d for 3s...\n", RX_PIN);
+            fflush(stdout);
+            uint32_t end = to_ms_since_boot(get_absolute_time()) + 3000;
+            uint32_t transitions = 0;
+            bool last = gpio_get(RX_PIN);
+            while (to_ms_since_boot(get_absolute_time()) < end) {
+                bool cur = gpio_get(RX_PIN);
+                if (cur != last) { transitions++; last = cur; }
+            }
+            printf("GP%d transitions in 3s: %lu (idle level: %d)\n",
+                   RX_PIN, transitions, (int)gpio_get(RX_PIN));
+        } else if (strncmp(cmd, "baud ", 5) == 0) {
+            // baud <rate> [vote]
+            char *p = cmd + 5;
+            uint32_t b = (uint32_t)strtoul(p, &p, 10);
+            uint32_t v = (uint32_t)strtoul(p, NULL, 10);
+            if (b < 1000 || b > 4000000) {
+                printf("Invalid baud rate (1000-4000000)\n");
+            } else if (v != 0 && v != 1 && v != 3 && v != 5) {
+                printf("Invalid vote (1, 3 or 5)\n");
+            } else {
+                rx_core_set_baud(b, v);
+                if (v == 0) v = rx_core_vote();
+                printf("Baud set to %lu (vote=%lu, div=%.3f)\n", b, v,
+                       rx_core_clkdiv(b, v));
+            }
+        } else if (strncmp(cmd, "vote ", 5) == 0) {
+            uint32_t v = (uint32_t)strtoul(cmd + 5, NULL, 10);
+            if (v != 1 && v != 3 && v != 5) {
+                printf("Invalid vote (1, 3 or 5)\n");
+            } else {
+                rx_core_set_vote(v);
+                printf("Vote set to %lu sample(s)/bit (div=%.3f)\n",
+                       v, rx_core_clkdiv(rx_core_baud(), v));
+            }
+        } else if (strncmp(cmd, "capture", 7) == 0 &&
+                   (cmd[7] == '\0' || cmd[7] == ' ')) {
+            // capture [osr] [ms] — defaults 8x, 1000 ms. Runs on a spare
+            // pio0 SM next to the RX SM; received frames queue up meanwhile.
+            char *p = cmd + 7;
+            uint32_t osr = (uint32_t)strtoul(p, &p, 10);
+            uint32_t ms  = (uint32_t)strtoul(p, &p, 10);
+            if (osr == 0) osr = CAPTURE_OSR_MAX;
+            if (ms == 0) ms = 1000;
+            if (osr < CAPTURE_OSR_MIN || osr > CAPTURE_OSR_MAX || ms > 60000) {
+                printf("Usage: capture <osr %d-%d> <ms 1-60000>\n",
+                       CAPTURE_OSR_MIN, CAPTURE_OSR_MAX);
+            } else {
+                capture_result_t cap;
+                fflush(stdout);
+                if (!capture_run(pio0, RX_PIN, rx_core_baud(), osr, ms, &cap)) {
+                    printf("[CAPTURE] error: no free PIO state machine or DMA channel\n");
                 }
-                break;
+            }
+        } else if (strncmp(cmd, "key ", 4) == 0) {
+            // key <16 hex id> <32 hex cipher key> | key clear
+            uint8_t id[SST_KEY_ID_SIZE], key[SST_KEY_SIZE];
+            if (strcmp(cmd + 4, "clear") == 0) {
+                rx_core_clear_key();
+                printf("Key cleared\n");
+            } else if (sst_endpoint_parse_key(cmd + 4, id, key)) {
+                rx_core_set_key(id, key);
+                printf("Key set\n");
+            } else {
+                printf("Usage: key <16 hex id> <32 hex cipher key> | key clear\n");
+            }
+            memset(key, 0, sizeof(key));
+            memset(cmd, 0, sizeof(cmd));
+        } else if (strcmp(cmd, "out text") == 0) {
+            usb_out_set_mode(USB_OUT_TEXT);
+            printf("Output TEXT\n");
+        } else if (strcmp(cmd, "out bin") == 0) {
+            printf("Output BIN: COBS records (usb_records.h)\n");
+            fflush(stdout);
+            usb_out_set_mode(USB_OUT_BIN);
+        } else if (strcmp(cmd, "cal") == 0) {
+            // Answered by an RX_EV_CAL once core1 is done
+            printf("[CAL] measuring idle and active levels (sender must be sending)...\n");
+            rx_core_calibrate();
+        } else if (strcmp(cmd, "cal auto on") == 0 || strcmp(cmd, "cal auto off") == 0) {
+            threshold_set_auto(cmd[9] == 'o' && cmd[10] == 'n');
+            print_threshold("[CAL]");
+        } else if (strncmp(cmd, "cal frac ", 9) == 0) {
+            threshold_set_frac(strtof(cmd + 9, NULL));
+            print_threshold("[CAL]");
+        } else if (strncmp(cmd, "cal dac ", 8) == 0) {
+            uint32_t code = (uint32_t)strtoul(cmd + 8, NULL, 0);
+            if (code > THRESH_DAC_MAX || !threshold_state()->dac_found) {
+                printf("Usage: cal dac <0-4095> (needs the MCP4725)\n");
+            } else {
+                rx_core_set_dac((uint16_t)code);
+            }
+        } else if (strcmp(cmd, "autobaud on") == 0 || strcmp(cmd, "autobaud off") == 0) {
+            rx_core_set_autobaud(cmd[10] == 'n');
+            printf("Autobaud %s\n", cmd[10] == 'n' ? "ON" : "OFF");
+        } else if (strcmp(cmd, "mode sst") == 0) {
+            rx_core_set_text(false);
+            printf("Mode SST: authenticated plaintext only\n");
+        } else if (strcmp(cmd, "mode text") == 0) {
+            rx_core_set_text(true);
+            printf("Mode TEXT: plaintext lines echoed\n");
+        } else if (strlen(cmd) > 0) {
+            printf("Unknown: '%s'\n", cmd);
         }
+        fflush(stdout);
     }
     return 0;
 }
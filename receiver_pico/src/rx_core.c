@@ -0,0 +1,475 @@
+// rx_core.c
+#include "rx_core.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include "pico/multicore.h"
+#include "pico/util/queue.h"
+#include "hardware/clocks.h"
+#include "hardware/pio.h"
+#include "lifi_rx.pio.h"
+#include "autobaud.h"
+#include "rx_events.h"
+#include "rx_ring.h"
+#include "sst_endpoint.h"
+#include "threshold.h"
+#include "../../include/prbs.h"
+#include "../../include/protocol.h"
+#include "../../include/usb_records.h"
+
+typedef enum {
+    STATE_HUNT = 0,
+    STATE_PRE1,
+    STATE_PRE2,
+    STATE_PRE3,
+    STATE_PAYLOAD
+} rx_state_t;
+
+typedef enum {
+    CTRL_BAUD = 0,   // a = baud, b = vote (0 = keep)
+    CTRL_VOTE,       // a = vote
+    CTRL_RAW,        // a = on
+    CTRL_TEXT,       // a = on
+    CTRL_KEY,        // key = id | cipher key
+    CTRL_KEY_CLEAR,
+    CTRL_AUTOBAUD,   // a = on
+    CTRL_CAL,
+    CTRL_DAC,        // a = code
+} ctrl_op_t;
+
+typedef struct {
+    uint8_t  op;
+    uint32_t a, b;
+    uint8_t  key[SST_KEY_ID_SIZE + SST_KEY_SIZE];
+} ctrl_t;
+
+#define CTRL_DEPTH 8
+
+static queue_t    ctrl;
+
+static PIO        pio          = pio0;
+static uint       sm           = 0;
+static volatile uint32_t current_baud = 9600;
+static volatile float    baud_trim    = 1.0f;  // measured / nominal rate (autobaud)
+static volatile uint     vote         = 1;     // samples per bit: 1, 3 or 5
+static volatile bool     raw_mode     = false;
+static volatile bool     text_mode    = false; // echo plaintext lines as [RX #n]
+static volatile uint32_t msg_count    = 0;
+
+static char       buf[512];
+static int        buf_idx      = 0;
+static rx_state_t state        = STATE_HUNT;
+
+// Program offsets, one per vote mode (all loaded at boot)
+static uint       off_mv1, off_mv3, off_mv5;
+
+// 3-of-5 vote: second FIFO word of a byte still pending
+static bool       mv5_half     = false;
+static uint32_t   mv5_lo       = 0;
+
+// Raw-mode bytes not yet posted
+static rx_event_t raw_ev;
+
+// Auto-benchmark state
+static bool       test_active  = false;
+static uint32_t   test_recv    = 0;
+static uint32_t   test_baud    = 0;
+static uint       test_vote    = 1;
+
+// PRBS BER run (__PRBS_START:<order>:<bytes>__ ... idle ... __PRBS_END:<n>__)
+#define PRBS_IDLE_MS 20
+static prbs_check_t prbs;
+static bool       prbs_active  = false;   // bytes go to the checker
+static bool       prbs_done    = false;   // a finished run awaits __PRBS_END
+static uint32_t   prbs_left    = 0;
+static uint32_t   prbs_last_ms = 0;
+static uint32_t   prbs_baud    = 0;
+
+// Threshold tracking: once a second, after the line has been quiet a while
+#define TRACK_PERIOD_MS 1000
+#define TRACK_QUIET_MS  50
+static uint32_t   last_rx_ms    = 0;
+static uint32_t   last_track_ms = 0;
+
+// lifi_rx runs at 8 PIO cycles per bit, the majority-vote variants at 16
+float rx_core_clkdiv(uint32_t baud, uint v) {
+    return (float)clock_get_hz(clk_sys) / (baud * (v == 1 ? 8.0f : 16.0f));
+}
+
+static float rx_clkdiv(void) {
+    return rx_core_clkdiv(current_baud, vote) / baud_trim;
+}
+
+// Nominal rate changed by hand or in-band: drop the autobaud correction
+static void set_baud(uint32_t baud) {
+    current_baud = baud;
+    baud_trim    = 1.0f;
+    autobaud_reset();
+}
+
+// (Re)loads the RX state machine with the program for the current vote
+// mode. pio_sm_init() clears the FIFOs and restarts the SM.
+static void rx_start(void) {
+    pio_sm_set_enabled(pio, sm, false);
+    float div = rx_clkdiv();
+    switch (vote) {
+        case 3:  lifi_rx_mv3_program_init(pio, sm, off_mv3, RX_PIN, div); break;
+        case 5:  lifi_rx_mv5_program_init(pio, sm, off_mv5, RX_PIN, div); break;
+        default: lifi_rx_program_init(pio, sm, off_mv1, RX_PIN, div);     break;
+    }
+    mv5_half = false;
+    rx_ring_reset();
+    state = STATE_HUNT;
+}
+
+static void post_test(uint8_t event, uint32_t baud, uint32_t sent, uint32_t recv,
+                      uint v) {
+    rx_event_t ev = { .kind = RX_EV_TEST, .flag = event, .vote = (uint8_t)v,
+                      .test = { baud, sent, recv } };
+    rx_events_post(&ev);
+}
+
+static void raw_flush(void) {
+    if (raw_ev.raw_n == 0) return;
+    raw_ev.kind = RX_EV_RAW;
+    rx_events_post(&raw_ev);
+    raw_ev.raw_n = 0;
+}
+
+static void post_line(bool truncated) {
+    rx_event_t ev = { .kind = RX_EV_LINE, .flag = truncated, .seq = msg_count };
+    uint8_t *data = rx_events_alloc(&ev, (size_t)buf_idx);
+    if (!data) return;
+    memcpy(data, buf, (size_t)buf_idx);
+    rx_events_post(&ev);
+}
+
+static void prbs_stop(void) {
+    if (!prbs_active) return;
+    prbs_check_finish(&prbs);
+    prbs_active = false;
+    prbs_done   = true;
+}
+
+static void post_prbs(uint32_t sent) {
+    rx_event_t ev = { .kind = RX_EV_PRBS, .vote = (uint8_t)vote };
+    ev.prbs.baud  = prbs_baud;
+    ev.prbs.sent  = sent;
+    ev.prbs.order = prbs.order;
+    ev.prbs.stats = prbs.stats;
+    rx_events_post(&ev);
+}
+
+// Follows the sender's rate: a different rate restarts framing at the new
+// one, a small drift only nudges the clock divider.
+static void autobaud_service(void) {
+    float hz;
+    autobaud_action_t act = autobaud_poll(current_baud * baud_trim, &hz);
+    if (act == AUTOBAUD_NONE) return;
+    if (act == AUTOBAUD_RETUNE) {
+        uint32_t was = current_baud;
+        current_baud = (uint32_t)(hz + 0.5f);
+        baud_trim    = hz / current_baud;
+        rx_start();  // what the ring holds was sampled at the wrong rate
+        rx_event_t ev = { .kind = RX_EV_AUTOBAUD,
+                          .autobaud = { current_baud, was, rx_clkdiv() } };
+        rx_events_post(&ev);
+        return;
+    }
+    baud_trim = hz / current_baud;
+    pio_sm_set_clkdiv(pio, sm, rx_clkdiv());
+}
+
+static void serve_ctrl(void) {
+    ctrl_t c;
+    while (queue_try_remove(&ctrl, &c)) {
+        switch (c.op) {
+            case CTRL_BAUD:
+                set_baud(c.a);
+                if (c.b != 0 && c.b != vote) {
+                    vote = c.b;
+                    rx_start();
+                } else {
+                    pio_sm_set_clkdiv(pio, sm, rx_clkdiv());
+                }
+                break;
+            case CTRL_VOTE:
+                vote = c.a;
+                rx_start();
+                break;
+            case CTRL_RAW:
+                raw_flush();
+                raw_mode = c.a;
+                break;
+            case CTRL_TEXT:
+                text_mode = c.a;
+                break;
+            case CTRL_KEY:
+                sst_endpoint_set_key(c.key, c.key + SST_KEY_ID_SIZE);
+                break;
+            case CTRL_KEY_CLEAR:
+                sst_endpoint_clear_key();
+                break;
+            case CTRL_AUTOBAUD:
+                autobaud_enable(c.a);
+                break;
+            case CTRL_CAL: {
+                // Full calibration: needs the sender transmitting
+                pio_sm_set_enabled(pio, sm, false);
+                rx_event_t ev = { .kind = RX_EV_CAL, .flag = threshold_calibrate() };
+                rx_start();
+                rx_events_post(&ev);
+                break;
+            }
+            case CTRL_DAC: {
+                // Manual threshold; stops tracking from moving it again
+                rx_event_t ev = { .kind = RX_EV_CAL,
+                                  .flag = threshold_set((uint16_t)c.a) };
+                threshold_set_auto(false);
+                rx_events_post(&ev);
+                break;
+            }
+        }
+        memset(&c, 0, sizeof(c));  // don't leave key copies on the stack
+    }
+}
+
+// Majority of the low 3 / low 5 samples
+static inline uint32_t maj3(uint32_t s) { return (0xE8u >> (s & 7)) & 1; }
+static inline uint32_t maj5(uint32_t s) { return __builtin_popcount(s & 31) >= 3; }
+
+// Turns one RX FIFO word into bytes. Returns how many: up to 3 for the
+// packed lifi_rx words, 0 while a 5-sample byte has only its first half
+// (bits 0-3) in.
+static int rx_decode(uint32_t word, uint8_t *out) {
+    uint32_t bits = 0;
+    switch (vote) {
+        case 3: {
+            uint32_t s = word >> 8;  // 24 samples, bit 0 first
+            for (int i = 0; i < 8; i++) bits |= maj3(s >> (3 * i)) << i;
+            break;
+        }
+        case 5: {
+            uint32_t s = word >> 12;  // 20 samples, 4 bits
+            uint32_t nib = 0;
+            for (int i = 0; i < 4; i++) nib |= maj5(s >> (5 * i)) << i;
+            if (!mv5_half) {
+                mv5_lo   = nib;
+                mv5_half = true;
+                return 0;
+            }
+            mv5_half = false;
+            bits = mv5_lo | (nib << 4);
+            break;
+        }
+        default: {
+            // [31:24] = free slots, then the bytes in arrival order
+            // ending just below it (right shift)
+            int n = 3 - (int)(word >> 24);
+            if (n < 1 || n > 3) return 0;
+            for (int i = 0; i < n; i++)
+                out[i] = ~(uint8_t)(word >> (24 - 8 * (n - i)));
+            return n;
+        }
+    }
+    // Invert for reverse-biased photodiode
+    out[0] = ~(uint8_t)bits;
+    return 1;
+}
+
+// Completed line from the preamble state machine: bench protocol or text
+static void handle_line(uint32_t now) {
+    if (strncmp(buf, "__BAUD:", 7) == 0) {
+        uint32_t nb = (uint32_t)strtoul(buf + 7, NULL, 10);
+        if (nb >= 1000 && nb <= 4000000) {
+            set_baud(nb);
+            pio_sm_set_clkdiv(pio, sm, rx_clkdiv());
+            post_test(USBREC_TEST_BAUD, current_baud, 0, 0, vote);
+        }
+    } else if (strcmp(buf, "__TEST_START__") == 0) {
+        test_active = true;
+        test_recv   = 0;
+        test_baud   = current_baud;
+        test_vote   = vote;
+        post_test(USBREC_TEST_START, test_baud, 0, 0, test_vote);
+    } else if (strncmp(buf, "__TEST_END:", 11) == 0) {
+        uint32_t sent = (uint32_t)strtoul(buf + 11, NULL, 10);
+        test_active = false;
+        post_test(USBREC_TEST_RESULT, test_baud, sent, test_recv, test_vote);
+    } else if (strncmp(buf, "__PRBS_START:", 13) == 0) {
+        char *p = buf + 13;
+        int order = (int)strtol(p, &p, 10);
+        uint32_t n = (*p == ':') ? (uint32_t)strtoul(p + 1, NULL, 10) : 0;
+        if (prbs_order_valid(order) && n > 0) {
+            prbs_check_init(&prbs, order);
+            prbs_active  = true;
+            prbs_done    = false;
+            prbs_left    = n;
+            prbs_last_ms = now;
+            prbs_baud    = current_baud;
+            rx_event_t ev = { .kind = RX_EV_PRBS_START, .vote = (uint8_t)vote,
+                              .prbs_start = { current_baud, n, order } };
+            rx_events_post(&ev);
+        }
+    } else if (strncmp(buf, "__PRBS_END:", 11) == 0) {
+        prbs_stop();
+        if (prbs_done) {
+            post_prbs((uint32_t)strtoul(buf + 11, NULL, 10));
+            prbs_done = false;
+        }
+    } else if (strcmp(buf, "__DONE__") == 0) {
+        post_test(USBREC_TEST_DONE, 0, 0, 0, vote);
+    } else if (test_active && strncmp(buf, "PKT", 3) == 0) {
+        test_recv++;  // count silently during test
+    } else if (text_mode) {
+        post_line(false);
+    }
+}
+
+static void handle_byte(uint8_t byte, uint32_t now) {
+    if (raw_mode) {
+        raw_ev.raw[raw_ev.raw_n++] = byte;
+        if (raw_ev.raw_n == RX_EV_RAW_MAX) raw_flush();
+        return;
+    }
+
+    if (prbs_active) {
+        prbs_check_byte(&prbs, byte);
+        prbs_last_ms = now;
+        if (--prbs_left == 0) prbs_stop();
+        return;
+    }
+
+    switch (state) {
+        case STATE_HUNT:
+            if (byte == PREAMBLE_BYTE_1) state = STATE_PRE1;
+            break;
+        case STATE_PRE1:
+            state = (byte == PREAMBLE_BYTE_2) ? STATE_PRE2 : STATE_HUNT;
+            break;
+        case STATE_PRE2:
+            state = (byte == PREAMBLE_BYTE_3) ? STATE_PRE3 : STATE_HUNT;
+            break;
+        case STATE_PRE3:
+            if (byte == PREAMBLE_BYTE_4) {
+                state   = STATE_PAYLOAD;
+                buf_idx = 0;
+            } else {
+                state = STATE_HUNT;
+            }
+            break;
+        case STATE_PAYLOAD:
+            if (byte == '\n' || byte == '\r') {
+                buf[buf_idx] = '\0';
+                msg_count++;
+                handle_line(now);
+                state = STATE_HUNT;
+            } else if (buf_idx < (int)sizeof(buf) - 1) {
+                buf[buf_idx++] = (char)byte;
+            } else {
+                buf[buf_idx] = '\0';
+                msg_count++;
+                if (text_mode) post_line(true);
+                state = STATE_HUNT;
+            }
+            break;
+    }
+}
+
+// Nothing in the ring: flush partial work and run the housekeeping that
+// needs a quiet line.
+static void rx_idle(uint32_t now) {
+    raw_flush();
+    if (prbs_active && now - prbs_last_ms > PRBS_IDLE_MS) prbs_stop();
+    // Recentre the threshold in quiet gaps. The RX SM is stopped
+    // while the search moves the threshold, then restarted.
+    if (!prbs_active && now - last_rx_ms >= TRACK_QUIET_MS &&
+        now - last_track_ms >= TRACK_PERIOD_MS) {
+        last_track_ms = now;
+        if (threshold_state()->auto_track && !gpio_get(RX_PIN)) {
+            pio_sm_set_enabled(pio, sm, false);
+            threshold_track();
+            rx_start();
+        }
+    }
+    sst_endpoint_poll(now);
+}
+
+static void core1_main(void) {
+    while (true) {
+        serve_ctrl();
+        autobaud_service();
+
+        uint32_t now = to_ms_since_boot(get_absolute_time());
+        uint32_t word;
+        if (!rx_ring_get(&word)) {
+            rx_idle(now);
+            continue;
+        }
+        last_rx_ms = now;
+
+        uint8_t bytes[3];
+        int n = rx_decode(word, bytes);
+        if (n == 0) continue;
+        if (!raw_mode && !prbs_active) sst_endpoint_push(bytes, (size_t)n, now);
+        for (int i = 0; i < n; i++) handle_byte(bytes[i], now);
+    }
+}
+
+void rx_core_launch(void) {
+    rx_events_init();
+    queue_init(&ctrl, sizeof(ctrl_t), CTRL_DEPTH);
+
+    pio_sm_claim(pio, sm);  // keep capture from taking the RX state machine
+    off_mv1 = pio_add_program(pio, &lifi_rx_program);
+    off_mv3 = pio_add_program(pio, &lifi_rx_mv3_program);
+    off_mv5 = pio_add_program(pio, &lifi_rx_mv5_program);
+    rx_ring_init(pio, sm);
+    rx_start();
+    sst_endpoint_init();
+    threshold_init(RX_PIN);
+    if (autobaud_init(RX_PIN)) autobaud_enable(true);
+
+    multicore_launch_core1(core1_main);
+}
+
+static void post_ctrl(uint8_t op, uint32_t a, uint32_t b) {
+    ctrl_t c = { .op = op, .a = a, .b = b };
+    queue_add_blocking(&ctrl, &c);
+}
+
+void rx_core_set_baud(uint32_t baud, uint v) { post_ctrl(CTRL_BAUD, baud, v); }
+
+void rx_core_set_vote(uint v) { post_ctrl(CTRL_VOTE, v, 0); }
+
+void rx_core_set_raw(bool on) { post_ctrl(CTRL_RAW, on, 0); }
+
+void rx_core_set_text(bool on) { post_ctrl(CTRL_TEXT, on, 0); }
+
+void rx_core_set_key(const uint8_t *id, const uint8_t *key) {
+    ctrl_t c = { .op = CTRL_KEY };
+    memcpy(c.key, id, SST_KEY_ID_SIZE);
+    memcpy(c.key + SST_KEY_ID_SIZE, key, SST_KEY_SIZE);
+    queue_add_blocking(&ctrl, &c);
+    memset(&c, 0, sizeof(c));
+}
+
+void rx_core_clear_key(void) { post_ctrl(CTRL_KEY_CLEAR, 0, 0); }
+
+void rx_core_set_autobaud(bool on) { post_ctrl(CTRL_AUTOBAUD, on, 0); }
+
+void rx_core_calibrate(void) { post_ctrl(CTRL_CAL, 0, 0); }
+
+void rx_core_set_dac(uint16_t code) { post_ctrl(CTRL_DAC, code, 0); }
+
+uint32_t rx_core_baud(void) { return current_baud; }
+
+float rx_core_trim(void) { return baud_trim; }
+
+uint rx_core_vote(void) { return vote; }
+
+bool rx_core_raw(void) { return raw_mode; }
+
+bool rx_core_text(void) { return text_mode; }
+
+uint32_t rx_core_msgs(void) { return msg_count; }
@@ -0,0 +1,61 @@
+// rx_core.h
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include "pico/stdlib.h"
+
+// The receive side of lifi_pico2_rx, run on core1: RX state machine and
+// its DMA ring, byte decoding, preamble framing, the bench / PRBS protocol,
+// the decrypting endpoint, autobaud and idle threshold tracking. Results go
+// to core0 as rx_events; core0 only does USB I/O and commands, so a slow
+// host or a blocking diagnostic never stalls reception.
+//
+// Settings are changed through a control queue and applied by core1
+// between FIFO words. The setters return once the request is queued; the
+// getters read core1's current values.
+
+#define RX_PIN 27
+
+// Loads the RX programs, sets up the ring, endpoint, threshold DAC and
+// autobaud, then starts core1. Call once from core0.
+void rx_core_launch(void);
+
+// @param baud Nominal rate (1000-4000000)
+// @param vote 1, 3 or 5; 0 keeps the current mode
+void rx_core_set_baud(uint32_t baud, uint vote);
+
+void rx_core_set_vote(uint vote);
+
+void rx_core_set_raw(bool on);
+
+// Echo plaintext lines as RX_EV_LINE (`mode text`).
+void rx_core_set_text(bool on);
+
+void rx_core_set_key(const uint8_t *id, const uint8_t *key);
+
+void rx_core_clear_key(void);
+
+void rx_core_set_autobaud(bool on);
+
+// Full idle + active threshold calibration; answers with RX_EV_CAL.
+void rx_core_calibrate(void);
+
+// Manual DAC code (turns tracking off); answers with RX_EV_CAL.
+void rx_core_set_dac(uint16_t code);
+
+// Clock divider for `baud` in `vote` mode, without autobaud trim.
+float rx_core_clkdiv(uint32_t baud, uint vote);
+
+uint32_t rx_core_baud(void);
+
+// Autobaud correction: measured / nominal rate.
+float rx_core_trim(void);
+
+uint rx_core_vote(void);
+
+bool rx_core_raw(void);
+
+bool rx_core_text(void);
+
+// Preamble-framed lines received.
+uint32_t rx_core_msgs(void);
@@ -0,0 +1,71 @@
+// rx_events.c
+#include "rx_events.h"
+
+#include "pico/util/queue.h"
+#include "hardware/sync.h"
+
+static queue_t  queue;
+static uint8_t  arena[RX_EVENTS_ARENA];
+static volatile uint32_t head;   // next free byte (core1 only writes)
+static volatile uint32_t tail;   // oldest byte in use (core0 only writes)
+static uint32_t prev_head;       // head before the last alloc, for rollback
+static volatile uint32_t dropped;
+
+void rx_events_init(void) {
+    queue_init(&queue, sizeof(rx_event_t), RX_EVENTS_DEPTH);
+    head = tail = 0;
+    dropped = 0;
+}
+
+uint8_t *rx_events_alloc(rx_event_t *ev, size_t len) {
+    uint32_t h = head, t = tail, off;
+    // One byte stays free so that head == tail always means empty
+    if (h >= t) {
+        if (len < RX_EVENTS_ARENA - h || (len == RX_EVENTS_ARENA - h && t != 0)) {
+            off = h;
+        } else if (len < t) {
+            off = 0;  // the end is too short; skip it
+        } else {
+            dropped++;
+            return NULL;
+        }
+    } else if (len < t - h) {
+        off = h;
+    } else {
+        dropped++;
+        return NULL;
+    }
+    prev_head    = h;
+    head         = (off + (uint32_t)len) % RX_EVENTS_ARENA;
+    ev->data_off = off;
+    ev->data_len = (uint32_t)len;
+    ev->data_end = head;
+    return &arena[off];
+}
+
+bool rx_events_post(rx_event_t *ev) {
+    if (ev->data_len == 0) ev->data_end = UINT32_MAX;
+    // The queue's spin lock orders the payload writes before the event
+    if (queue_try_add(&queue, ev)) return true;
+    if (ev->data_end != UINT32_MAX) head = prev_head;
+    dropped++;
+    return false;
+}
+
+bool rx_events_get(rx_event_t *ev) {
+    return queue_try_remove(&queue, ev);
+}
+
+const uint8_t *rx_events_data(const rx_event_t *ev) {
+    return &arena[ev->data_off];
+}
+
+void rx_events_release(const rx_event_t *ev) {
+    if (ev->data_end == UINT32_MAX) return;
+    __dmb();  // finish reading the payload before core1 may reuse it
+    tail = ev->data_end;
+}
+
+uint32_t rx_events_dropped(void) { return dropped; }
+
+uint32_t rx_events_level(void) { return queue_get_level(&queue); }
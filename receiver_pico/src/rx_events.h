@@ -0,0 +1,86 @@
+// rx_events.h
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "../../include/prbs.h"
+
+// Core1 -> core0 hand-off. Core1 (rx_core.c) turns the line into events;
+// core0 prints them in text or binary form. Variable-size data (plaintext,
+// expanded files, text lines) goes into a byte arena that core0 frees in
+// the same order it takes events, so a USB stall only backs up the queue
+// and arena instead of the RX path. When either is full the event is
+// dropped and counted.
+
+#define RX_EVENTS_DEPTH  128
+#define RX_EVENTS_ARENA  (64 * 1024)  // holds a full 32 KB file plus messages
+#define RX_EV_RAW_MAX    32
+
+typedef enum {
+    RX_EV_LINE = 0,     // plaintext line (`mode text`); flag = truncated
+    RX_EV_FRAME,        // authenticated frame; flag = MSG_TYPE_*
+    RX_EV_KEY_ID,       // KEY_ID_ONLY broadcast; flag = USBREC_KEY_*
+    RX_EV_RAW,          // raw-mode bytes
+    RX_EV_TEST,         // bench protocol; flag = USBREC_TEST_*
+    RX_EV_PRBS_START,
+    RX_EV_PRBS,
+    RX_EV_AUTOBAUD,     // rate change found by autobaud
+    RX_EV_CAL,          // threshold calibration / manual DAC finished; flag = ok
+} rx_event_kind_t;
+
+typedef struct {
+    uint8_t  kind;
+    uint8_t  flag;
+    uint8_t  vote;
+    uint8_t  raw_n;
+    uint32_t seq;
+    uint32_t data_off;   // payload in the arena
+    uint32_t data_len;
+    uint32_t data_end;   // arena position to free up to (UINT32_MAX: none)
+    union {
+        uint32_t wire_len;                       // FRAME
+        uint8_t  key_id[8];                      // KEY_ID
+        uint8_t  raw[RX_EV_RAW_MAX];             // RAW
+        struct { uint32_t baud, sent, recv; } test;
+        struct { uint32_t baud, was; float div; } autobaud;
+        struct { uint32_t baud, bytes; int order; } prbs_start;
+        struct {
+            uint32_t     baud, sent;
+            int          order;
+            prbs_stats_t stats;
+        } prbs;
+    };
+} rx_event_t;
+
+void rx_events_init(void);
+
+// ── Core1 (producer) ────────────────────────────────────────────────────────
+
+// Reserves `len` contiguous arena bytes for `ev`'s payload; fill them, then
+// rx_events_post(). On failure nothing is reserved and the drop is counted.
+//
+// @return the payload buffer, or NULL if the arena is full
+uint8_t *rx_events_alloc(rx_event_t *ev, size_t len);
+
+// Queues `ev` (with or without a payload). If the queue is full the event
+// and its reservation are dropped.
+//
+// @return false if dropped
+bool rx_events_post(rx_event_t *ev);
+
+// ── Core0 (consumer) ────────────────────────────────────────────────────────
+
+// @param ev Out: oldest event
+// @return false if none is waiting
+bool rx_events_get(rx_event_t *ev);
+
+const uint8_t *rx_events_data(const rx_event_t *ev);
+
+// Frees `ev`'s payload; call once it has been printed.
+void rx_events_release(const rx_event_t *ev);
+
+// Events lost because the queue or arena was full.
+uint32_t rx_events_dropped(void);
+
+// Events waiting.
+uint32_t rx_events_level(void);
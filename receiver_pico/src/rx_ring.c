@@ -0,0 +1,81 @@
+// rx_ring.c
+#include "rx_ring.h"
+
+#include "hardware/dma.h"
+
+// Largest count that is a plain transfer count on both RP2040 and RP2350
+// (RP2350 uses the top 4 bits as a mode field). At 4 Mbaud this lasts for
+// hours; rx_ring_service() re-arms the channel when it does run out.
+#define RX_RING_XFER 0x0FFFFFFFu
+
+// DMA ring wrap needs the buffer aligned to its size
+static uint32_t ring[RX_RING_WORDS] __attribute__((aligned(RX_RING_WORDS * 4)));
+
+static PIO      rx_pio;
+static uint     rx_sm;
+static int      dma_ch = -1;
+static uint32_t armed;      // words covered by transfers that already finished
+static uint32_t consumed;   // words handed out by rx_ring_get()
+static uint32_t overflows;
+static uint32_t stalls;
+
+static uint32_t rx_ring_produced(void) {
+    uint32_t left = dma_channel_hw_addr(dma_ch)->transfer_count & RX_RING_XFER;
+    return armed + (RX_RING_XFER - left);
+}
+
+static void rx_ring_service(void) {
+    if (!dma_channel_is_busy(dma_ch)) {
+        armed += RX_RING_XFER;
+        dma_channel_set_trans_count(dma_ch, RX_RING_XFER, true);
+    }
+    uint32_t stall = 1u << (PIO_FDEBUG_RXSTALL_LSB + rx_sm);
+    if (rx_pio->fdebug & stall) {
+        stalls++;
+        rx_pio->fdebug = stall;  // write-1-to-clear
+    }
+}
+
+void rx_ring_init(PIO pio, uint sm) {
+    rx_pio = pio;
+    rx_sm  = sm;
+    dma_ch = dma_claim_unused_channel(true);
+
+    dma_channel_config c = dma_channel_get_default_config(dma_ch);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+    channel_config_set_read_increment(&c, false);
+    channel_config_set_write_increment(&c, true);
+    channel_config_set_ring(&c, true, __builtin_ctz(sizeof(ring)));  // wrap writes
+    channel_config_set_dreq(&c, pio_get_dreq(pio, sm, false));
+    dma_channel_configure(dma_ch, &c, ring, &pio->rxf[sm], RX_RING_XFER, true);
+
+    armed = consumed = overflows = stalls = 0;
+}
+
+void rx_ring_reset(void) {
+    rx_ring_service();
+    consumed = rx_ring_produced();
+    rx_pio->fdebug = 1u << (PIO_FDEBUG_RXSTALL_LSB + rx_sm);
+}
+
+bool rx_ring_get(uint32_t *word) {
+    rx_ring_service();
+    uint32_t avail = rx_ring_produced() - consumed;
+    if (avail == 0) return false;
+    if (avail >= RX_RING_WORDS) {
+        // Lapped: the oldest words are gone. Jump to the newer half of the
+        // ring, skipping an even count so 2-word (vote 5) bytes stay paired.
+        uint32_t lost = (avail - RX_RING_WORDS / 2 + 1) & ~1u;
+        overflows += lost;
+        consumed  += lost;
+    }
+    *word = ring[consumed & (RX_RING_WORDS - 1)];
+    consumed++;
+    return true;
+}
+
+uint32_t rx_ring_overflows(void) { return overflows; }
+
+uint32_t rx_ring_stalls(void) { return stalls; }
+
+uint32_t rx_ring_level(void) { return rx_ring_produced() - consumed; }
@@ -0,0 +1,34 @@
+// rx_ring.h
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include "hardware/pio.h"
+
+// DMA drain for the RX state machine. One channel copies every RX FIFO word
+// into a 16 KB ring (DMA address wrap), so the FIFO never fills while the
+// main loop is busy in USB I/O; the main loop consumes the ring at its own
+// pace.
+
+#define RX_RING_WORDS 4096  // power of two; 16 KB
+
+// Claims a DMA channel and starts draining `sm`'s RX FIFO.
+//
+// @param pio PIO block of the RX state machine
+// @param sm RX state machine
+void rx_ring_init(PIO pio, uint sm);
+
+// Drops everything not yet read (after the RX SM is re-initialized).
+void rx_ring_reset(void);
+
+// @param word Out: next FIFO word
+// @return false if the ring is empty
+bool rx_ring_get(uint32_t *word);
+
+// Words the DMA wrote over before they were read.
+uint32_t rx_ring_overflows(void);
+
+// Times the RX SM stalled on a full FIFO (should stay 0 with DMA running).
+uint32_t rx_ring_stalls(void);
+
+// Words waiting in the ring.
+uint32_t rx_ring_level(void);
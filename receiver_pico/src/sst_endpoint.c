@@ -0,0 +1,239 @@
+// sst_endpoint.c
+#include "sst_endpoint.h"
+
+#include <stdio.h>
+#include <string.h>
+#include "heatshrink_decoder.h"
+#include "rx_events.h"
+#include "../../include/frame_decrypt.h"
+#include "../../include/frame_parser.h"
+#include "../../include/protocol.h"
+#include "../../include/usb_records.h"
+#include "../../receiver/include/replay_window.h"
+
+// Same limit as flash_receiver's file buffer
+#define FILE_MAX_EXPANDED 32768
+
+static frame_parser_t        parser;
+static frame_decrypt_t       fdec;  // plaintext lands in fdec.plain
+static replay_window_t       rwin;
+static sst_endpoint_stats_t  stats;
+static uint32_t              msg_count;
+
+static bool    key_valid = false;
+static uint8_t key_id[SST_KEY_ID_SIZE];
+static uint8_t cipher_key[SST_KEY_SIZE];
+
+static uint8_t expanded[FILE_MAX_EXPANDED];
+
+static void print_hex(const uint8_t *b, size_t n) {
+    for (size_t i = 0; i < n; i++) printf("%02X", b[i]);
+}
+
+static int hex_nibble(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// Parses exactly 2*n hex digits; returns a pointer past them or NULL
+static const char *parse_hex(const char *s, uint8_t *out, size_t n) {
+    while (*s == ' ') s++;
+    for (size_t i = 0; i < n; i++) {
+        int hi = hex_nibble(s[0]);
+        int lo = (hi < 0) ? -1 : hex_nibble(s[1]);
+        if (lo < 0) return NULL;
+        out[i] = (uint8_t)((hi << 4) | lo);
+        s += 2;
+    }
+    return (*s == '\0' || *s == ' ') ? s : NULL;
+}
+
+// Decompresses a file into `expanded`. The decoder stops taking input
+// once `expanded` is full, so a file that fills it is refused rather than
+// truncated.
+//
+// @param out_len Expanded length
+// @return 0 on success, -1 if the file is corrupt or too large
+static int file_expand(const uint8_t *in, size_t in_len, size_t *out_len) {
+    heatshrink_decoder *hsd = heatshrink_decoder_alloc(512, 8, 4);
+    if (!hsd) return -1;
+
+    int ret = -1;
+    size_t sunk_total = 0, out_total = 0;
+    while (sunk_total < in_len) {
+        if (out_total == sizeof(expanded)) goto out;
+        size_t sunk = 0;
+        if (heatshrink_decoder_sink(hsd, (uint8_t *)&in[sunk_total],
+                                    in_len - sunk_total, &sunk) < 0 ||
+            sunk == 0)
+            goto out;
+        sunk_total += sunk;
+        HSD_poll_res pres;
+        do {
+            size_t p = 0;
+            pres = heatshrink_decoder_poll(hsd, &expanded[out_total],
+                                           sizeof(expanded) - out_total, &p);
+            out_total += p;
+        } while (pres == HSDR_POLL_MORE && out_total < sizeof(expanded));
+    }
+    heatshrink_decoder_finish(hsd);
+    HSD_poll_res pres;
+    do {
+        size_t p = 0;
+        pres = heatshrink_decoder_poll(hsd, &expanded[out_total],
+                                       sizeof(expanded) - out_total, &p);
+        out_total += p;
+    } while (pres == HSDR_POLL_MORE && out_total < sizeof(expanded));
+    if (pres != HSDR_POLL_EMPTY) goto out;
+    *out_len = out_total;
+    ret = 0;
+
+out:
+    heatshrink_decoder_free(hsd);
+    return ret;
+}
+
+static void handle_encrypted(const lifi_frame_t *f) {
+    // LEN is bounds-checked by the parser: NONCE + TAG <= LEN <= MAX_MSG_LEN
+    size_t ctext_len = f->len - NONCE_SIZE - TAG_SIZE;
+    const uint8_t *nonce = f->payload;
+
+    if (!key_valid) {
+        stats.no_key++;
+        return;
+    }
+    if (replay_window_seen(&rwin, nonce)) {
+        stats.replays++;
+        return;
+    }
+    // Usually only the tail is left: drain() kept decrypting while the
+    // frame arrived. V2 and ChaCha20-Poly1305 frames bind TYPE|LEN as AAD.
+    if (frame_decrypt_finish(&fdec, f, cipher_key) != 0) {
+        stats.auth_fail++;
+        // With no CRC the parser took LEN on trust; rescan these bytes
+        if (MSG_TYPE_HAS_AAD(f->type)) frame_parser_reject(&parser);
+        return;
+    }
+    // Only authenticated nonces enter the window, so forged frames can't
+    // evict real ones.
+    replay_window_add(&rwin, nonce);
+    stats.decrypted++;
+    msg_count++;
+
+    const uint8_t *out = fdec.plain;
+    size_t out_len = ctext_len;
+    if (MSG_TYPE_IS_FILE(f->type)) {
+        if (file_expand(fdec.plain, ctext_len, &out_len) != 0) {
+            stats.file_errors++;
+            return;
+        }
+        out = expanded;
+        stats.files++;
+    }
+
+    rx_event_t ev = { .kind = RX_EV_FRAME, .seq = msg_count,
+                      .flag = MSG_TYPE_IS_FILE(f->type) ? MSG_TYPE_FILE : MSG_TYPE_ENCRYPTED,
+                      .wire_len = (uint32_t)ctext_len };
+    uint8_t *data = rx_events_alloc(&ev, out_len);
+    if (!data) return;
+    memcpy(data, out, out_len);
+    rx_events_post(&ev);
+}
+
+static void handle_key_id(const lifi_frame_t *f) {
+    rx_event_t ev = { .kind = RX_EV_KEY_ID };
+    memcpy(ev.key_id, f->payload, SST_KEY_ID_SIZE);
+    ev.flag = !key_valid ? USBREC_KEY_NONE
+            : memcmp(f->payload, key_id, SST_KEY_ID_SIZE) == 0 ? USBREC_KEY_MATCH
+            : USBREC_KEY_MISMATCH;
+    rx_events_post(&ev);
+}
+
+static void drain(uint32_t now_ms) {
+    lifi_frame_t frame;
+    frame_result_t r;
+    while ((r = frame_parser_next(&parser, now_ms, &frame)) != FRAME_NONE) {
+        if (r == FRAME_DROPPED) {
+            if (frame.error == FRAME_ERR_CRC) stats.crc_fail++;
+            else stats.dropped++;
+            continue;
+        }
+        stats.frames_ok++;
+        switch (frame.type) {
+            case MSG_TYPE_ENCRYPTED:
+            case MSG_TYPE_FILE:
+            case MSG_TYPE_ENCRYPTED_V2:
+            case MSG_TYPE_FILE_V2:
+            case MSG_TYPE_ENCRYPTED_CC:
+            case MSG_TYPE_FILE_CC:
+                handle_encrypted(&frame);
+                break;
+            case MSG_TYPE_KEY_ID_ONLY:
+                handle_key_id(&frame);
+                break;
+            default:
+                // HS2 is for the Pi4's SST handshake; nothing to do here
+                break;
+        }
+    }
+    frame_decrypt_poll(&fdec, &parser, key_valid ? cipher_key : NULL);
+}
+
+void sst_endpoint_init(void) {
+    frame_parser_init(&parser);
+    frame_decrypt_init(&fdec);
+    replay_window_init(&rwin, NONCE_SIZE, NONCE_HISTORY_SIZE);
+    memset(&stats, 0, sizeof(stats));
+    msg_count = 0;
+}
+
+void sst_endpoint_push(const uint8_t *data, size_t len, uint32_t now_ms) {
+    while (len) {
+        size_t n = frame_parser_push(&parser, data, len);
+        drain(now_ms);
+        if (n == 0) break;  // still full after draining; counted as overflow
+        data += n;
+        len  -= n;
+    }
+}
+
+void sst_endpoint_poll(uint32_t now_ms) {
+    if (!frame_parser_idle(&parser)) drain(now_ms);
+}
+
+bool sst_endpoint_parse_key(const char *args, uint8_t id[SST_KEY_ID_SIZE],
+                            uint8_t key[SST_KEY_SIZE]) {
+    const char *p = parse_hex(args, id, SST_KEY_ID_SIZE);
+    return p && parse_hex(p, key, SST_KEY_SIZE);
+}
+
+void sst_endpoint_set_key(const uint8_t id[SST_KEY_ID_SIZE],
+                          const uint8_t key[SST_KEY_SIZE]) {
+    memcpy(key_id, id, sizeof(key_id));
+    memcpy(cipher_key, key, sizeof(cipher_key));
+    key_valid = true;
+    replay_window_init(&rwin, NONCE_SIZE, NONCE_HISTORY_SIZE);
+}
+
+void sst_endpoint_clear_key(void) {
+    memset(cipher_key, 0, sizeof(cipher_key));
+    memset(key_id, 0, sizeof(key_id));
+    key_valid = false;
+    replay_window_init(&rwin, NONCE_SIZE, NONCE_HISTORY_SIZE);
+}
+
+void sst_endpoint_print_status(void) {
+    printf("SST: key=");
+    if (key_valid) print_hex(key_id, SST_KEY_ID_SIZE);
+    else printf("none");
+    printf(" | frames=%lu crc_fail=%lu dropped=%lu | decrypted=%lu auth_fail=%lu "
+           "replay=%lu no_key=%lu files=%lu file_err=%lu streamed=%lu\n",
+           stats.frames_ok, stats.crc_fail, stats.dropped, stats.decrypted,
+           stats.auth_fail, stats.replays, stats.no_key, stats.files,
+           stats.file_errors,
+           fdec.streamed);
+}
+
+const sst_endpoint_stats_t *sst_endpoint_stats(void) { return &stats; }
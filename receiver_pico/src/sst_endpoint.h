@@ -0,0 +1,62 @@
+// sst_endpoint.h
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "../../include/sst_crypto_embedded.h"
+
+// Decrypting LiFi endpoint: runs the shared frame parser over received
+// bytes, checks CRC, replay window and the AES-GCM tag, and passes only
+// authenticated plaintext on to core0 (rx_events.h), which prints:
+//
+//   [MSG #n] <plaintext>
+//   [FILE #n] <compressed> -> <expanded> bytes\n<expanded data>
+//   [KEY_ID] <hex> match|mismatch|no key
+//
+// Runs on core1. The session key is provisioned over USB (`key <id>
+// <cipher_key>`), so the Pico never needs SST credentials of its own.
+
+typedef struct {
+    uint32_t frames_ok;
+    uint32_t crc_fail;
+    uint32_t dropped;      // type/length/timeout rejects
+    uint32_t decrypted;
+    uint32_t auth_fail;    // GCM tag mismatch
+    uint32_t replays;
+    uint32_t no_key;       // encrypted frame before a key was set
+    uint32_t files;
+    uint32_t file_errors;  // corrupt, or larger than FILE_MAX_EXPANDED
+} sst_endpoint_stats_t;
+
+void sst_endpoint_init(void);
+
+// Feeds received bytes and handles every frame they complete.
+//
+// @param data Bytes from the RX ring
+// @param len Number of bytes
+// @param now_ms Milliseconds since boot
+void sst_endpoint_push(const uint8_t *data, size_t len, uint32_t now_ms);
+
+// Expires a stalled partial frame; call from the main loop when idle.
+void sst_endpoint_poll(uint32_t now_ms);
+
+// Parses "<16 hex key id> <32 hex cipher key>" (core0, before handing the
+// key to core1).
+//
+// @param args Command argument
+// @param id Out: key ID
+// @param key Out: cipher key
+// @return false on a malformed argument
+bool sst_endpoint_parse_key(const char *args, uint8_t id[SST_KEY_ID_SIZE],
+                            uint8_t key[SST_KEY_SIZE]);
+
+// Installs the session key and clears the replay window.
+void sst_endpoint_set_key(const uint8_t id[SST_KEY_ID_SIZE],
+                          const uint8_t key[SST_KEY_SIZE]);
+
+void sst_endpoint_clear_key(void);
+
+// Prints key ID and counters (for `status`).
+void sst_endpoint_print_status(void);
+
+const sst_endpoint_stats_t *sst_endpoint_stats(void);
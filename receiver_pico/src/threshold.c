@@ -0,0 +1,169 @@
+// threshold.c
+#include "threshold.h"
+
+#include "hardware/gpio.h"
+#include "hardware/i2c.h"
+
+#define I2C_PORT   i2c1
+#define SDA_PIN    2
+#define SCL_PIN    3
+#define I2C_HZ     400000
+#define SETTLE_US  20     // MCP4725 settles in ~6 us; allow comparator delay too
+
+static threshold_state_t st = { .auto_track = false, .frac = 0.5f };
+static uint rx;
+static uint16_t last_raw_idle;   // previous idle reading, trusted or not
+static bool auto_chosen;         // set by threshold_set_auto(), not by `cal`
+
+static bool dac_write(uint16_t code) {
+    // Fast-mode write: [0 0 PD1 PD0 D11..D8][D7..D0], power-down bits 0
+    uint8_t cmd[2] = { (uint8_t)((code >> 8) & 0x0F), (uint8_t)code };
+    return i2c_write_timeout_us(I2C_PORT, st.dac_addr, cmd, 2, false, 5000) == 2;
+}
+
+// Number of HIGH reads in `n` samples
+static int pin_ones(int n) {
+    int ones = 0;
+    for (int i = 0; i < n; i++) ones += gpio_get(rx);
+    return ones;
+}
+
+// True if the pin shows a HIGH at any time within `ms`
+static bool pin_any_high(uint32_t ms) {
+    absolute_time_t end = make_timeout_time_ms(ms);
+    while (!time_reached(end))
+        if (gpio_get(rx)) return true;
+    return false;
+}
+
+static uint16_t centre(uint16_t idle, uint16_t active) {
+    uint32_t t = idle + THRESH_DEFAULT_MARGIN;  // swing not measured yet
+    if (active > idle) {
+        t = idle + (uint32_t)((active - idle) * st.frac + 0.5f);
+        if (t < idle + THRESH_MIN_MARGIN) t = idle + (uint32_t)THRESH_MIN_MARGIN;
+    }
+    return (uint16_t)(t > THRESH_DAC_MAX ? THRESH_DAC_MAX : t);
+}
+
+bool threshold_init(uint rx_pin) {
+    rx = rx_pin;
+    i2c_init(I2C_PORT, I2C_HZ);
+    gpio_set_function(SDA_PIN, GPIO_FUNC_I2C);
+    gpio_set_function(SCL_PIN, GPIO_FUNC_I2C);
+    gpio_pull_up(SDA_PIN);
+    gpio_pull_up(SCL_PIN);
+
+    for (uint8_t addr = 0x60; addr <= 0x63 && !st.dac_found; addr++) {
+        uint8_t dummy[5];
+        // A read returns the DAC register without changing the output
+        if (i2c_read_timeout_us(I2C_PORT, addr, dummy, sizeof(dummy), false, 5000) ==
+            (int)sizeof(dummy)) {
+            st.dac_found = true;
+            st.dac_addr  = addr;
+            st.code      = (uint16_t)((dummy[1] << 4) | (dummy[2] >> 4));
+        }
+    }
+    return st.dac_found;
+}
+
+bool threshold_set(uint16_t code) {
+    if (!st.dac_found || code > THRESH_DAC_MAX) return false;
+    if (!dac_write(code)) return false;
+    st.code = code;
+    return true;
+}
+
+bool threshold_measure_idle(uint16_t *code) {
+    if (!st.dac_found) return false;
+    // Lowest code that reads LOW: above it the amplifier is below the DAC
+    uint16_t lo = 0, hi = THRESH_DAC_MAX;
+    dac_write(hi);
+    sleep_us(SETTLE_US);
+    if (pin_ones(64)) {
+        dac_write(st.code);
+        return false;  // HIGH even at full scale: not idle, or no light path
+    }
+    while (lo < hi) {
+        uint16_t mid = (uint16_t)((lo + hi) / 2);
+        dac_write(mid);
+        sleep_us(SETTLE_US);
+        if (pin_ones(64) == 0) hi = mid;
+        else lo = (uint16_t)(mid + 1);
+    }
+    dac_write(st.code);
+    *code = lo;
+    return true;
+}
+
+bool threshold_measure_active(uint32_t window_ms, uint16_t *code) {
+    if (!st.dac_found) return false;
+    // Highest code at which the traffic still crosses the threshold
+    uint16_t lo = (uint16_t)(st.idle + THRESH_MIN_MARGIN / 2), hi = THRESH_DAC_MAX;
+    dac_write(lo);
+    sleep_us(SETTLE_US);
+    if (!pin_any_high(window_ms)) {
+        dac_write(st.code);
+        return false;  // no traffic
+    }
+    while (lo < hi) {
+        uint16_t mid = (uint16_t)((lo + hi + 1) / 2);
+        dac_write(mid);
+        sleep_us(SETTLE_US);
+        if (pin_any_high(window_ms)) lo = mid;
+        else hi = (uint16_t)(mid - 1);
+    }
+    dac_write(st.code);
+    *code = lo;
+    return true;
+}
+
+bool threshold_calibrate(void) {
+    uint16_t idle, active;
+    if (!threshold_measure_idle(&idle)) return false;
+    st.idle = last_raw_idle = idle;
+    if (!threshold_measure_active(20, &active)) return false;
+    st.active = active;
+    if (!threshold_set(centre(st.idle, st.active))) return false;
+    if (!auto_chosen) st.auto_track = true;
+    return true;
+}
+
+bool threshold_track(void) {
+    uint16_t idle;
+    if (!st.auto_track || !threshold_measure_idle(&idle)) return false;
+    st.tracks++;
+
+    // A start bit arriving mid-search reads as a high idle level; only
+    // trust a reading that the previous one confirms.
+    int d = (int)idle - (int)last_raw_idle;
+    last_raw_idle = idle;
+    if (d > THRESH_AGREE || d < -THRESH_AGREE) {
+        st.rejects++;
+        return false;
+    }
+
+    // Ambient light shifts both levels; keep the measured swing
+    if (st.active > st.idle) {
+        int a = (int)st.active + ((int)idle - (int)st.idle);
+        st.active = (uint16_t)(a < 0 ? 0 : a > THRESH_DAC_MAX ? THRESH_DAC_MAX : a);
+    }
+    st.idle = idle;
+
+    uint16_t want = centre(st.idle, st.active);
+    int move = (int)want - (int)st.code;
+    if (move <= THRESH_HYST && move >= -THRESH_HYST) return false;
+    if (!threshold_set(want)) return false;
+    st.moves++;
+    return true;
+}
+
+const threshold_state_t *threshold_state(void) { return &st; }
+
+void threshold_set_auto(bool on) {
+    st.auto_track = on;
+    auto_chosen = true;
+}
+
+void threshold_set_frac(float frac) {
+    if (frac > 0.05f && frac < 0.95f) st.frac = frac;
+}
@@ -0,0 +1,89 @@
+// threshold.h
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include "pico/stdlib.h"
+
+// Comparator threshold control through the MCP4725 DAC (I2C1, GP2/GP3),
+// the same wiring raw_bit_monitor uses for bring-up.
+//
+// The comparator output is HIGH while the photodiode amplifier is above the
+// DAC voltage, so a DAC level can be found by binary search on the pin:
+//
+//   idle level    lowest code where the steady idle line reads LOW
+//   active level  highest code where traffic still produces a HIGH
+//
+// The threshold sits `frac` of the way from idle to active, but at least
+// THRESH_MIN_MARGIN above idle (THRESH_DEFAULT_MARGIN before the active
+// level is known, as raw_bit_monitor does). Ambient light moves both
+// levels together, so tracking the idle level during quiet gaps keeps the
+// threshold centred between full calibrations (`cal`), which need the
+// sender transmitting. Tracking starts with the first successful `cal`,
+// unless `cal auto` or `cal dac` has already decided it.
+//
+// The caller must stop the RX state machine around the measure calls; the
+// pin reads garbage while the search moves the threshold.
+
+#define THRESH_DAC_MAX     4095
+#define THRESH_VREF        3.3f
+#define THRESH_MIN_MARGIN  62u    // ~50 mV: dark floor noise allowance
+#define THRESH_DEFAULT_MARGIN 248 // ~200 mV above idle until `cal` measures the swing
+#define THRESH_HYST        8      // only move the DAC for changes above this
+#define THRESH_AGREE       12     // idle readings must agree to be trusted
+
+typedef struct {
+    bool     dac_found;
+    uint8_t  dac_addr;
+    uint16_t code;           // DAC code currently programmed
+    uint16_t idle;           // last trusted idle level
+    uint16_t active;         // last active level (0 = never measured)
+    bool     auto_track;     // idle tracking in quiet gaps (off until `cal`)
+    float    frac;           // position between idle and active
+    uint32_t tracks;         // idle measurements taken
+    uint32_t moves;          // times tracking moved the DAC
+    uint32_t rejects;        // idle readings dropped as inconsistent
+} threshold_state_t;
+
+// Sets up I2C1 and probes 0x60-0x63 for the DAC. Leaves the DAC at its
+// current (EEPROM) output until a calibration runs.
+//
+// @return false if no MCP4725 answered
+bool threshold_init(uint rx_pin);
+
+// Programs a fixed DAC code (manual override; keeps auto tracking as is).
+bool threshold_set(uint16_t code);
+
+// Binary-searches the idle level. Only meaningful on a quiet line.
+//
+// @param code Out: idle level
+// @return false without a DAC or if the line never read LOW
+bool threshold_measure_idle(uint16_t *code);
+
+// Binary-searches the active level; needs traffic for `window_ms` per step.
+//
+// @param code Out: active level
+// @return false without a DAC or if no HIGH was seen above the idle level
+bool threshold_measure_active(uint32_t window_ms, uint16_t *code);
+
+// Full calibration: idle, then active, then recentre. Needs the sender
+// transmitting (e.g. `loop`) for the active half. The first one turns idle
+// tracking on, unless threshold_set_auto() was called before it.
+//
+// @return false if either measurement failed (the old threshold is kept)
+bool threshold_calibrate(void);
+
+// Periodic idle tracking step: measures the idle level and recentres the
+// threshold if it moved by more than THRESH_HYST.
+//
+// @return true if the DAC was rewritten
+bool threshold_track(void);
+
+const threshold_state_t *threshold_state(void);
+
+void threshold_set_auto(bool on);
+
+void threshold_set_frac(float frac);
+
+static inline float threshold_volts(uint16_t code) {
+    return code * THRESH_VREF / THRESH_DAC_MAX;
+}
@@ -0,0 +1,80 @@
+// usb_out.c
+#include "usb_out.h"
+
+#include <stdio.h>
+#include "pico/stdio_usb.h"
+#include "../../include/crc16.h"
+
+// One USB full-speed bulk packet of raw bytes per record
+#define RAW_BATCH 64
+
+static usb_out_mode_t mode = USB_OUT_TEXT;
+
+// Streaming COBS: blk[0] is the code byte, blk[1..n] the block's data
+static uint8_t  blk[255];
+static uint8_t  blk_n;
+static uint16_t rec_crc;
+
+static uint8_t  raw_buf[RAW_BATCH];
+static size_t   raw_n;
+
+static void enc_flush(void) {
+    blk[0] = blk_n + 1;
+    fwrite(blk, 1, blk_n + 1, stdout);
+    blk_n = 0;
+}
+
+static void enc_put(const uint8_t *p, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        if (p[i] == 0) {
+            enc_flush();  // the zero is implied by the code byte
+            continue;
+        }
+        blk[++blk_n] = p[i];
+        if (blk_n == 254) enc_flush();
+    }
+}
+
+// Record body: covered by the CRC
+static void enc_body(const void *p, size_t len) {
+    rec_crc = crc16_ccitt_update(rec_crc, p, len);
+    enc_put(p, len);
+}
+
+void usb_out_set_mode(usb_out_mode_t m) {
+    usb_out_raw_flush();
+    mode = m;
+    stdio_set_translate_crlf(&stdio_usb, m == USB_OUT_TEXT);
+}
+
+bool usb_out_bin(void) { return mode == USB_OUT_BIN; }
+
+void usb_out_record(uint8_t type, const void *hdr, size_t hdr_len,
+                    const void *data, size_t data_len) {
+    static const uint8_t delim = 0;
+    fwrite(&delim, 1, 1, stdout);
+
+    blk_n   = 0;
+    rec_crc = 0xFFFF;
+    enc_body(&type, 1);
+    if (hdr_len) enc_body(hdr, hdr_len);
+    if (data_len) enc_body(data, data_len);
+
+    uint8_t crc[USBREC_CRC_SIZE] = { (uint8_t)(rec_crc >> 8), (uint8_t)rec_crc };
+    enc_put(crc, sizeof(crc));
+    enc_flush();
+
+    fwrite(&delim, 1, 1, stdout);
+    fflush(stdout);
+}
+
+void usb_out_raw(uint8_t byte) {
+    raw_buf[raw_n++] = byte;
+    if (raw_n == RAW_BATCH) usb_out_raw_flush();
+}
+
+void usb_out_raw_flush(void) {
+    if (raw_n == 0) return;
+    usb_out_record(USBREC_RAW, NULL, 0, raw_buf, raw_n);
+    raw_n = 0;
+}
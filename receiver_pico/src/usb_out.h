@@ -0,0 +1,37 @@
+// usb_out.h
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "../../include/usb_records.h"
+
+// USB output format. TEXT is the original printf lines; BIN sends typed
+// COBS records (include/usb_records.h). Command replies and the banner stay
+// text in both modes.
+
+typedef enum {
+    USB_OUT_TEXT = 0,
+    USB_OUT_BIN
+} usb_out_mode_t;
+
+// Switching to BIN turns off stdio's LF -> CRLF translation, which would
+// corrupt records.
+void usb_out_set_mode(usb_out_mode_t mode);
+
+bool usb_out_bin(void);
+
+// Sends one record: TYPE | hdr | data | CRC16, COBS-encoded and delimited.
+//
+// @param type USBREC_*
+// @param hdr Fixed payload struct (may be NULL)
+// @param hdr_len Size of hdr
+// @param data Variable part (may be NULL)
+// @param data_len Size of data
+void usb_out_record(uint8_t type, const void *hdr, size_t hdr_len,
+                    const void *data, size_t data_len);
+
+// Queues one received byte for a USBREC_RAW record; records go out when
+// the batch is full or on usb_out_raw_flush().
+void usb_out_raw(uint8_t byte);
+
+void usb_out_raw_flush(void);
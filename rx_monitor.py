@@ -23,8 +23,25 @@ def _log(line):
     ts = datetime.now().strftime('%H:%M:%S.%f')[:12]
     _log_f.write(f'[{ts}] {line}\n')
 
-# Matches: [TEST_RESULT] baud=100000 sent=50 recv=47
-_RESULT_RE = re.compile(r'\[TEST_RESULT\] baud=(\d+) sent=(\d+) recv=(\d+)')
+# Matches: [TEST_RESULT] baud=100000 sent=50 recv=47 vote=3  (vote= optional)
+_RESULT_RE = re.compile(r'\[TEST_RESULT\] baud=(\d+) sent=(\d+) recv=(\d+)(?: vote=(\d+))?')
+
+# Matches: [PRBS_RESULT] baud=500000 order=15 sent=100000 recv=99998 bits=... errors=... ber=...
+_PRBS_RE = re.compile(r'\[PRBS_RESULT\] baud=(\d+) order=(\d+) sent=(\d+) recv=(\d+) '
+                      r'bits=(\d+) errors=(\d+) ber=(\S+) unchecked=(\d+) slips=(\d+) '
+                      r'lost=(\d+) extra=(\d+) resyncs=(\d+) bursts=([\d,]+) max_burst=(\d+)'
+                      r'(?: vote=(\d+))?')
+
+def _print_prbs(m):
+    baud, order = int(m.group(1)), int(m.group(2))
+    bursts = m.group(13).split(',')
+    print(f'  ┌── PRBS-{order} @ {baud:>9,} baud  vote={m.group(15) or 1} ───────')
+    print(f'  │  Bits: {m.group(5)}  Errors: {m.group(6)}  BER: {m.group(7)}  Unchecked: {m.group(8)}')
+    print(f'  │  Bytes sent/recv: {m.group(3)}/{m.group(4)}  Slips: {m.group(9)} '
+          f'(lost {m.group(10)}, extra {m.group(11)})  Resyncs: {m.group(12)}')
+    print(f'  │  Bursts 1/2/3-4/5-8/9-16/17+: {"/".join(bursts)}  max {m.group(14)} bits')
+    print(f'  └──────────────────────────────────────────────')
+    sys.stdout.flush()
 
 def _handle_line(line):
     if not line:
@@ -33,14 +50,20 @@ def _handle_line(line):
     sys.stdout.flush()
     _log(line)
 
+    m = _PRBS_RE.match(line)
+    if m:
+        _print_prbs(m)
+        return
+
     m = _RESULT_RE.match(line)
     if m:
         baud = int(m.group(1))
         sent = int(m.group(2))
         recv = int(m.group(3))
+        vote = int(m.group(4)) if m.group(4) else 1
         loss = max(0, sent - recv)
         pct  = round(recv / sent * 100.0, 1) if sent > 0 else 0.0
-        print(f'  ┌── RESULT @ {baud:>9,} baud ───────────────────')
+        print(f'  ┌── RESULT @ {baud:>9,} baud  vote={vote} ───────────')
         print(f'  │  Sent: {sent:<5}  Received: {recv:<5}  Loss: {loss:<5}  ({pct:.1f}% success)')
         print(f'  └──────────────────────────────────────────────')
         sys.stdout.flush()
@@ -48,7 +71,8 @@ def _handle_line(line):
             try:
                 requests.post(FLASK_URL,
                               json={'baud': baud, 'sent': sent,
-                                    'recv': recv, 'loss': loss, 'pct': pct},
+                                    'recv': recv, 'loss': loss, 'pct': pct,
+                                    'vote': vote},
                               timeout=2)
             except Exception as e:
                 print(f'[rx_monitor] POST failed: {e}')
@@ -243,9 +243,9 @@ RX2_BAUD    = 115200
 rx2_serial_conn = None
 rx2_serial_lock = threading.Lock()
 
-RESULT_RE = re.compile(r'\[TEST_RESULT\] baud=(\d+) sent=(\d+) recv=(\d+)')
+RESULT_RE = re.compile(r'\[TEST_RESULT\] baud=(\d+) sent=(\d+) recv=(\d+)(?: vote=(\d+))?')
 
-def _emit_test_result(baud, sent, recv):
+def _emit_test_result(baud, sent, recv, vote=1):
     loss = max(0, sent - recv)
     pct  = round(recv / sent * 100.0, 1) if sent > 0 else 0.0
     socketio.emit('test_result', {
@@ -254,6 +254,7 @@ def _emit_test_result(baud, sent, recv):
         'recv':     recv,
         'loss':     loss,
         'pct':      pct,
+        'vote':     vote,
         'rf_label': current_rf_label,
         'dist':     current_dist_label,
         'mode':     current_test_mode,
@@ -271,7 +272,8 @@ def read_from_rx2_serial():
                         socketio.emit('rx_log_message', {'data': f'[RX2] {line}'})
                         m = RESULT_RE.match(line)
                         if m:
-                            _emit_test_result(int(m.group(1)), int(m.group(2)), int(m.group(3)))
+                            _emit_test_result(int(m.group(1)), int(m.group(2)), int(m.group(3)),
+                                              int(m.group(4) or 1))
             except (OSError, serial.SerialException):
                 pass
             except Exception as e:
@@ -292,7 +294,8 @@ def read_from_rx_serial():
                         socketio.emit('rx_log_message', {'data': line})
                         m = RESULT_RE.match(line)
                         if m:
-                            _emit_test_result(int(m.group(1)), int(m.group(2)), int(m.group(3)))
+                            _emit_test_result(int(m.group(1)), int(m.group(2)), int(m.group(3)),
+                                              int(m.group(4) or 1))
             except (OSError, serial.SerialException):
                 pass
             except Exception as e:
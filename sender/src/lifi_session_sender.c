@@ -1,4 +1,5 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "../../include/cmd_handler.h"
@@ -7,6 +8,7 @@
 #include "../../include/sst_crypto_embedded.h"
 #include "mbedtls/aes.h"
 #include "../../include/crc16.h"
+#include "../../include/gcm_keystream.h"
 #include "heatshrink_encoder.h"
 #include "hardware/flash.h"
 #include "hardware/gpio.h"
@@ -81,6 +83,18 @@ void lifi_wait_tx() {
     // sleep_us(100); // Small guard
 }
 
+// AEAD for the next message frame. Auto picks ChaCha20-Poly1305 once the
+// receiver has listed it; version 1 frames are always AES-GCM.
+static uint8_t pick_suite(int tx_proto, uint8_t tx_suite, uint8_t rx_suites) {
+    if (tx_proto != 2) return SUITE_AES_GCM;
+    if (tx_suite) return tx_suite;
+    return (rx_suites & SUITE_CHACHAPOLY) ? SUITE_CHACHAPOLY : SUITE_AES_GCM;
+}
+
+// AES blocks precomputed per idle pass (~15 us each on the M0+ at
+// 125 MHz), well inside the 320 us the UART FIFO takes to fill.
+#define KS_IDLE_BLOCKS 4
+
 // Helper: Read bytes with a total timeout
 bool uart_read_blocking_timeout_us(uart_inst_t *uart, uint8_t *dst, size_t len, uint32_t timeout_us) {
     absolute_time_t deadline = make_timeout_time_us(timeout_us);
@@ -148,7 +162,14 @@ int main() {
     }
 
     uint8_t session_key[SST_KEY_SIZE] = {0};
-    uint8_t session_mac_key[SST_MAC_KEY_SIZE] = {0}; // 32 bytes
+    // HMAC state for the 32-byte SST mac_key, keyed once per key instead of
+    // rehashing its pads in every HS1/HS2/HS3 MAC. All-zero until provisioned.
+    static sst_hmac_ctx_t session_mac;
+    {
+        uint8_t zero_mac_key[SST_MAC_KEY_SIZE] = {0};
+        sst_hmac_init(&session_mac);
+        sst_hmac_setkey(&session_mac, zero_mac_key, SST_MAC_KEY_SIZE);
+    }
     uint8_t session_key_id[SST_KEY_ID_SIZE] = {0};
     // Preserved across HS1→HS3: Pico's own nonce sent in HS2; zeroed after HS3 verify
     static uint8_t saved_pico_nonce[SST_HS_NONCE_SIZE];
@@ -169,6 +190,20 @@ int main() {
     static uint8_t ciphertext[8192];
     static uint8_t compressed_buf[8192];  // For FILEB/FILE compression
     static uint8_t crc_buf[1 + 2 + 12 + 8192 + 16];  // TYPE + LEN + NONCE + CIPHERTEXT + TAG
+    // Frame version for messages: 2 binds TYPE|LEN as GCM AAD and drops the
+    // CRC16; 1 keeps the old CRC-checked frames for older receivers.
+    static int tx_proto = PROTO_VERSION;
+    // AEAD for version 2 frames. Auto uses ChaCha20-Poly1305 once the
+    // receiver has listed it (MSG_TYPE_SUITES): no AES hardware on the
+    // RP2040, and ChaCha20 needs no tables. `CMD: suite` overrides.
+    static uint8_t rx_suites = SUITE_AES_GCM;
+    static uint8_t tx_suite = 0;  // 0 = auto, else SUITE_AES_GCM / SUITE_CHACHAPOLY
+    static uint8_t cc_key[SST_CHACHAPOLY_KEY_SIZE];
+    static uint8_t cc_key_src[SST_KEY_SIZE];  // session key cc_key came from
+    static bool cc_key_ok = false;
+    // AES-CTR blocks for the next few nonces, filled while idle
+    static gcm_ks_pool_t ks_pool;
+    gcm_ks_init(&ks_pool);
 
     while (true) {
         size_t msg_len = 0;
@@ -242,9 +277,9 @@ int main() {
 
                             // 2. Verify HMAC-SHA256(mac_key_32, IV||ctext)
                             uint8_t computed_mac[SST_HS_MAC_SIZE];
-                            if (sst_hmac_sha256_ex(session_mac_key, SST_MAC_KEY_SIZE,
-                                                   blob, SST_HS_IV_SIZE + 16,
-                                                   computed_mac) != 0 ||
+                            if (sst_hmac_compute(&session_mac,
+                                                 blob, SST_HS_IV_SIZE + 16,
+                                                 computed_mac) != 0 ||
                                 memcmp(computed_mac, recv_mac, SST_HS_MAC_SIZE) != 0) {
                                 printf("[SST HS1] HMAC verification failed.\n");
                                 secure_zero(computed_mac, sizeof(computed_mac));
@@ -310,9 +345,9 @@ int main() {
                             memcpy(hs2_blob,                          iv2,       SST_HS_IV_SIZE);
                             memcpy(hs2_blob + SST_HS_IV_SIZE,          hs2_ctext, hs2_ctext_len);
                             uint8_t hs2_mac[SST_HS_MAC_SIZE];
-                            if (sst_hmac_sha256_ex(session_mac_key, SST_MAC_KEY_SIZE,
-                                                   hs2_blob, SST_HS_IV_SIZE + hs2_ctext_len,
-                                                   hs2_mac) != 0) {
+                            if (sst_hmac_compute(&session_mac,
+                                                 hs2_blob, SST_HS_IV_SIZE + hs2_ctext_len,
+                                                 hs2_mac) != 0) {
                                 printf("[SST HS1] HS2 HMAC failed.\n");
                                 secure_zero(entity_nonce, sizeof(entity_nonce));
                                 secure_zero(pico_nonce,   sizeof(pico_nonce));
@@ -383,9 +418,9 @@ int main() {
 
                             // 1. Verify HMAC(mac_key:32, IV||ctext:48)
                             uint8_t computed_mac3[SST_HS_MAC_SIZE];
-                            if (sst_hmac_sha256_ex(session_mac_key, SST_MAC_KEY_SIZE,
-                                                   hs3, SST_HS_IV_SIZE + 32,
-                                                   computed_mac3) != 0 ||
+                            if (sst_hmac_compute(&session_mac,
+                                                 hs3, SST_HS_IV_SIZE + 32,
+                                                 computed_mac3) != 0 ||
                                 memcmp(computed_mac3, mac3, SST_HS_MAC_SIZE) != 0) {
                                 printf("[SST HS3] HMAC verification FAILED – Pi4 not trusted.\n");
                                 secure_zero(computed_mac3, sizeof(computed_mac3));
@@ -418,6 +453,17 @@ int main() {
                             secure_zero(plain3, sizeof(plain3));
                             secure_zero(saved_pico_nonce, sizeof(saved_pico_nonce));
                         }
+                        else if (uart_byte == MSG_TYPE_SUITES) {
+                            // [LEN:2][SUITE mask:1], sent after each key push
+                            uint8_t sb[3];
+                            if (uart_read_blocking_timeout_us(UART_ID, sb, sizeof(sb), 50000) &&
+                                sb[0] == 0 && sb[1] == 1) {
+                                rx_suites = sb[2] | SUITE_AES_GCM;
+                                printf("[Suites] Receiver accepts%s%s\n",
+                                       (rx_suites & SUITE_AES_GCM) ? " AES-GCM" : "",
+                                       (rx_suites & SUITE_CHACHAPOLY) ? " ChaCha20-Poly1305" : "");
+                            }
+                        }
                         else if (uart_byte == MSG_TYPE_KEY) {
                             // New key format: [LEN:2][KEY_ID:8][CIPHER_KEY:16][MAC_KEY:32]
                             uint8_t len_bytes[2];
@@ -451,9 +497,10 @@ int main() {
                                     keyram_set_with_id(new_id, new_key);
                                     memcpy(session_key, new_key, SST_KEY_SIZE);
                                     memcpy(session_key_id, new_id, SST_KEY_ID_SIZE);
-                                    memcpy(session_mac_key, new_mac_key, SST_MAC_KEY_SIZE);
+                                    sst_hmac_setkey(&session_mac, new_mac_key, SST_MAC_KEY_SIZE);
                                     
                                     pico_nonce_on_key_change();
+                                    gcm_ks_reset(&ks_pool);
                                     
                                     printf("[Auto-Provision] Key saved to Slot %c and activated.\n", 
                                            current_slot == 0 ? 'A' : 'B');
@@ -480,6 +527,13 @@ int main() {
             ch = getchar_timeout_us(0);  // Non-blocking poll
             if (ch == PICO_ERROR_TIMEOUT) {
                 // watchdog_update(); //when enabled
+                // Nothing typed: get the next GCM frames' AES work done now
+                if (pick_suite(tx_proto, tx_suite, rx_suites) == SUITE_AES_GCM &&
+                    !is_key_zeroed(session_key)) {
+                    uint8_t next_nonce[SST_NONCE_SIZE];
+                    pico_nonce_peek(next_nonce);
+                    gcm_ks_fill(&ks_pool, session_key, next_nonce, KS_IDLE_BLOCKS);
+                }
                 continue;
             }
 
@@ -576,6 +630,40 @@ int main() {
                  continue;
             }
 
+            // Special Command: pick the encrypted frame version
+            if (strncmp(cmd_trimmed, "proto", 5) == 0) {
+                 int v = atoi(cmd_trimmed + 5);
+                 if (v == 1 || v == 2) tx_proto = v;
+                 printf("[TX] Frame version %d (%s)\n", tx_proto,
+                        tx_proto == 2 ? "header as GCM AAD, no CRC16" : "CRC16");
+                 memset(message_buffer, 0, sizeof(message_buffer));
+                 continue;
+            }
+
+            // Special Command: pick the AEAD for version 2 frames
+            if (strncmp(cmd_trimmed, "suite", 5) == 0) {
+                 const char *arg = cmd_trimmed + 5;
+                 while (*arg == ' ') arg++;
+                 if (strncmp(arg, "gcm", 3) == 0) tx_suite = SUITE_AES_GCM;
+                 else if (strncmp(arg, "chacha", 6) == 0) tx_suite = SUITE_CHACHAPOLY;
+                 else if (strncmp(arg, "auto", 4) == 0) tx_suite = 0;
+                 printf("[TX] AEAD %s (receiver accepts 0x%02X)\n",
+                        tx_suite == SUITE_AES_GCM ? "AES-GCM" :
+                        tx_suite == SUITE_CHACHAPOLY ? "ChaCha20-Poly1305" : "auto",
+                        rx_suites);
+                 memset(message_buffer, 0, sizeof(message_buffer));
+                 continue;
+            }
+
+            // Special Command: keystream pool counters
+            if (strncmp(cmd_trimmed, "ks", 2) == 0) {
+                 printf("[TX] Keystream pool: hits=%lu misses=%lu blocks_used=%lu\n",
+                        (unsigned long)ks_pool.hits, (unsigned long)ks_pool.misses,
+                        (unsigned long)ks_pool.blocks_used);
+                 memset(message_buffer, 0, sizeof(message_buffer));
+                 continue;
+            }
+
             // Run the command handler and check if it modified the active
             // session key (e.g., load new key, clear key, or switch slots).
             bool key_changed = handle_commands(cmd, session_key, &current_slot);
@@ -585,6 +673,7 @@ int main() {
             // new key.
             if (key_changed) {
                 pico_nonce_on_key_change();
+                gcm_ks_reset(&ks_pool);
                 // Reload both from current slot to be safe and get the matching ID
                 // Best practice: Reload from flash slot that is now active.
                 if (current_slot == 0 || current_slot == 1) {
@@ -659,30 +748,58 @@ int main() {
         pico_nonce_generate(
             nonce);  // 96-bit nonce = boot_salt||counter (unique per message)
 
-        int ret =
-            sst_encrypt_gcm(session_key, nonce, (const uint8_t *)message_buffer,
-                            msg_len, ciphertext, tag);
-        if (ret != 0) {
-            printf("Encryption failed! ret=%d\n", ret);
-            continue;
+        bool chacha = pick_suite(tx_proto, tx_suite, rx_suites) == SUITE_CHACHAPOLY;
+        if (chacha) {
+            current_msg_type = (current_msg_type == MSG_TYPE_FILE)
+                                   ? MSG_TYPE_FILE_CC : MSG_TYPE_ENCRYPTED_CC;
+        } else if (tx_proto == 2) {
+            current_msg_type = (current_msg_type == MSG_TYPE_FILE)
+                                   ? MSG_TYPE_FILE_V2 : MSG_TYPE_ENCRYPTED_V2;
         }
 
         // Build frame: [PREAMBLE:4][TYPE:1][LEN:2][NONCE:12][CIPHERTEXT:msg_len][TAG:16][CRC16:2]
         // Total payload after TYPE = NONCE + CIPHERTEXT + TAG = 12 + msg_len + 16
+        // Version 2 frames end at TAG; TYPE|LEN is authenticated as AEAD AAD.
         size_t payload_len = SST_NONCE_SIZE + msg_len + SST_TAG_SIZE;
         uint8_t len_bytes[2] = {(payload_len >> 8) & 0xFF, payload_len & 0xFF};
-        
-        // Build CRC buffer: TYPE + LEN + NONCE + CIPHERTEXT + TAG (uses static crc_buf)
-        size_t crc_idx = 0;
-        crc_buf[crc_idx++] = current_msg_type;
-        crc_buf[crc_idx++] = len_bytes[0];
-        crc_buf[crc_idx++] = len_bytes[1];
-        memcpy(&crc_buf[crc_idx], nonce, SST_NONCE_SIZE); crc_idx += SST_NONCE_SIZE;
-        memcpy(&crc_buf[crc_idx], ciphertext, msg_len); crc_idx += msg_len;
-        memcpy(&crc_buf[crc_idx], tag, SST_TAG_SIZE); crc_idx += SST_TAG_SIZE;
-        
-        uint16_t crc = crc16_ccitt(crc_buf, crc_idx);
-        uint8_t crc_bytes[2] = {(crc >> 8) & 0xFF, crc & 0xFF};
+        uint8_t hdr[3] = {current_msg_type, len_bytes[0], len_bytes[1]};
+
+        int ret;
+        if (chacha) {
+            // Derived once per session key, not per message
+            if (!cc_key_ok || memcmp(cc_key_src, session_key, SST_KEY_SIZE) != 0) {
+                cc_key_ok = sst_chachapoly_derive_key(session_key, cc_key) == 0;
+                memcpy(cc_key_src, session_key, SST_KEY_SIZE);
+            }
+            ret = cc_key_ok ? sst_encrypt_chachapoly(cc_key, nonce, hdr, sizeof(hdr),
+                                                     (const uint8_t *)message_buffer,
+                                                     msg_len, ciphertext, tag)
+                            : -1;
+        } else {
+            // Usually only XOR + GHASH left: the AES ran while idle
+            ret = gcm_ks_encrypt(&ks_pool, session_key, nonce, hdr,
+                                 MSG_TYPE_HAS_AAD(current_msg_type) ? sizeof(hdr) : 0,
+                                 (const uint8_t *)message_buffer, msg_len,
+                                 ciphertext, tag);
+        }
+        if (ret != 0) {
+            printf("Encryption failed! ret=%d\n", ret);
+            continue;
+        }
+
+        uint8_t crc_bytes[2] = {0};
+        if (!MSG_TYPE_HAS_AAD(current_msg_type)) {
+            // Build CRC buffer: TYPE + LEN + NONCE + CIPHERTEXT + TAG (uses static crc_buf)
+            size_t crc_idx = 0;
+            memcpy(&crc_buf[crc_idx], hdr, sizeof(hdr)); crc_idx += sizeof(hdr);
+            memcpy(&crc_buf[crc_idx], nonce, SST_NONCE_SIZE); crc_idx += SST_NONCE_SIZE;
+            memcpy(&crc_buf[crc_idx], ciphertext, msg_len); crc_idx += msg_len;
+            memcpy(&crc_buf[crc_idx], tag, SST_TAG_SIZE); crc_idx += SST_TAG_SIZE;
+
+            uint16_t crc = crc16_ccitt(crc_buf, crc_idx);
+            crc_bytes[0] = (crc >> 8) & 0xFF;
+            crc_bytes[1] = crc & 0xFF;
+        }
         
         // Send preamble and header
         lifi_send_byte(PREAMBLE_BYTE_1);
@@ -709,8 +826,8 @@ int main() {
         lifi_send_bytes(tag, SST_TAG_SIZE);
         sleep_us(250);  // 250us after tag
         
-        // Send CRC
-        lifi_send_bytes(crc_bytes, 2);
+        // Send CRC (version 1 only)
+        if (!MSG_TYPE_HAS_AAD(current_msg_type)) lifi_send_bytes(crc_bytes, 2);
         lifi_wait_tx();
 
         // Clear sensitive data from memory
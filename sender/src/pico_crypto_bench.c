@@ -0,0 +1,81 @@
+// Firmware side of the crypto microbenchmarks (src/crypto_bench.c): the
+// same rows as crypto_bench_mbedtls on the host, measured on the RP2040
+// (or RP2350 when built with PICO_BOARD=pico2) with the vendored mbedTLS.
+// Cycles/byte is derived from clk_sys, which the core runs at. Built twice:
+// pico_crypto_bench runs the crypto XIP from flash, pico_crypto_bench_sram
+// from SRAM.
+//
+// Commands over USB serial:
+//   bench [op]   run every primitive, or those starting with `op`
+//   ms <n>       time spent on each row (default 500)
+//   help
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "hardware/clocks.h"
+#include "../../include/crypto_bench.h"
+#include "../../include/pico_handler.h"
+#include "../../include/sst_crypto_embedded.h"
+
+#if PICO_RP2350
+#define BENCH_CHIP "rp2350"
+#else
+#define BENCH_CHIP "rp2040"
+#endif
+
+// pico_crypto_bench_sram links the mbedTLS objects into SRAM instead of
+// running them XIP from flash (lifi_crypto_in_sram() in sender/CMakeLists.txt)
+#if BENCH_CRYPTO_IN_SRAM
+#define BENCH_PLATFORM BENCH_CHIP "-sram"
+#else
+#define BENCH_PLATFORM BENCH_CHIP
+#endif
+
+static uint64_t now_ns(void) { return time_us_64() * 1000u; }
+
+static void print_help(void) {
+    printf("# commands: bench [op] | ms <n> | help\n");
+    printf("# ops: %s\n", crypto_bench_ops());
+}
+
+int main() {
+    stdio_init_all();
+    sleep_ms(2000);
+
+    crypto_bench_cfg_t cfg = {
+        .platform = BENCH_PLATFORM,
+        .now_ns   = now_ns,
+        .cpu_hz   = clock_get_hz(clk_sys),
+        .min_ms   = 500,
+        .key_hash = compute_key_hash,
+    };
+
+    printf("\n# pico_crypto_bench backend=%s platform=%s clk_sys=%lu\n",
+           sst_crypto_backend(), cfg.platform, (unsigned long)cfg.cpu_hz);
+    print_help();
+
+    char cmd[64];
+    while (true) {
+        printf("\n> ");
+        fflush(stdout);
+        if (!fgets(cmd, sizeof(cmd), stdin)) continue;
+        cmd[strcspn(cmd, "\r\n")] = '\0';
+        if (cmd[0] == '\0') continue;
+
+        if (strncmp(cmd, "bench", 5) == 0) {
+            const char *op = cmd + 5;
+            while (*op == ' ') op++;
+            crypto_bench_header();
+            int rows = crypto_bench_run(&cfg, op);
+            printf("# done rows=%d\n", rows);
+        } else if (strncmp(cmd, "ms ", 3) == 0) {
+            uint32_t ms = strtoul(cmd + 3, NULL, 10);
+            if (ms > 0) cfg.min_ms = ms;
+            printf("# ms=%lu\n", (unsigned long)cfg.min_ms);
+        } else {
+            print_help();
+        }
+    }
+}
@@ -6,6 +6,7 @@
 #include "hardware/clocks.h"
 #include "lifi_multi_tx.pio.h"
 #include "../../include/protocol.h"
+#include "../../include/prbs.h"
 
 #define PIO_TX_PIN_BASE   6
 #define PIO_TX_PIN_COUNT  4
@@ -69,6 +70,7 @@ void print_help() {
     printf("  loopdelay <ms>    : Set loop delay in ms\n");
     printf("  stoploop          : Stop loop mode\n");
     printf("  test [n]          : Auto-benchmark 4 baud rates, n pkts each (default 50)\n");
+    printf("  prbs <7|15|23> [bytes] [b1,b2,..] : PRBS bit-error-rate run per baud (default 100000 bytes)\n");
     printf("  status            : Show current status\n");
     printf("  help              : Show this menu\n");
     printf("================\n");
@@ -277,6 +279,64 @@ aborted:
     printf("[TEST] ABORTED — baud reset to 9600\n");
     fflush(stdout);
 }
+
+// PRBS BER run: per baud, a continuous PRBS byte stream with no framing, so
+// the receiver can count every bit error and byte slip instead of whole
+// lines. Same __BAUD handshake as run_auto_test; the receiver stops
+// checking after `nbytes` bytes or when the line goes idle.
+void run_prbs_test(int order, uint32_t nbytes, const uint32_t *bauds, int n_bauds) {
+    loop_mode = false;
+    char tmp[48];
+    prbs_t gen;
+
+    printf("\n=== PRBS-%d BENCHMARK: %lu bytes x %d rates ===\n", order, nbytes, n_bauds);
+    fflush(stdout);
+
+    for (int s = 0; s < n_bauds; s++) {
+        uint32_t baud = bauds[s];
+
+        printf("[PRBS] switch baud=%lu step=%d/%d\n", baud, s + 1, n_bauds);
+        fflush(stdout);
+        snprintf(tmp, sizeof(tmp), "__BAUD:%lu__", baud);
+        lifi_send_message(tmp);
+        if (!test_sleep_abortable(500)) goto aborted;
+        update_baud(baud);
+        if (!test_sleep_abortable(100)) goto aborted;
+
+        snprintf(tmp, sizeof(tmp), "__PRBS_START:%d:%lu__", order, nbytes);
+        lifi_send_message(tmp);
+        sleep_ms(30);
+
+        prbs_init(&gen, order);
+        for (uint32_t i = 0; i < nbytes; i++) {
+            if ((i & 0xFFF) == 0 && getchar_timeout_us(0) != PICO_ERROR_TIMEOUT) goto aborted;
+            lifi_send_byte(prbs_next_byte(&gen));
+        }
+
+        // Idle gap ends the receiver's PRBS window even if it lost bytes
+        if (!test_sleep_abortable(50)) goto aborted;
+        snprintf(tmp, sizeof(tmp), "__PRBS_END:%lu__", nbytes);
+        lifi_send_message(tmp);
+        printf("[PRBS] done baud=%lu\n", baud);
+        fflush(stdout);
+
+        if (!test_sleep_abortable(1200)) goto aborted;
+    }
+
+    lifi_send_message("__BAUD:9600__");
+    if (!test_sleep_abortable(400)) goto aborted;
+    update_baud(9600);
+    lifi_send_message("__DONE__");
+    printf("[PRBS] complete\n=================\n");
+    fflush(stdout);
+    return;
+
+aborted:
+    drain_stdin_buf();
+    update_baud(9600);
+    printf("[PRBS] ABORTED — baud reset to 9600\n");
+    fflush(stdout);
+}
 // ─────────────────────────────────────────────────────────────────────────────
 
 int main() {
@@ -444,6 +504,34 @@ int main() {
                 else
                     run_auto_test(n, TEST_BAUDS, TEST_BAUD_COUNT);
 
+            } else if (strncmp(cmd, "prbs ", 5) == 0) {
+                // prbs <order> [bytes] [b1,b2,...]
+                char *p = cmd + 5;
+                int order = (int)strtol(p, &p, 10);
+                uint32_t nbytes = 100000;
+                uint32_t custom_bauds[32];
+                int custom_n = 0;
+                if (*p == ' ') {
+                    p++;
+                    nbytes = strtoul(p, &p, 10);
+                    if (nbytes == 0 || nbytes > 100000000) nbytes = 100000;
+                    if (*p == ' ') {
+                        p++;
+                        while (*p && custom_n < 32) {
+                            uint32_t b = strtoul(p, &p, 10);
+                            if (b >= 1000 && b <= 4000000) custom_bauds[custom_n++] = b;
+                            if (*p == ',') p++;
+                            else if (*p) break;
+                        }
+                    }
+                }
+                if (!prbs_order_valid(order))
+                    printf("Usage: prbs <7|15|23> [bytes] [b1,b2,...]\n");
+                else if (custom_n > 0)
+                    run_prbs_test(order, nbytes, custom_bauds, custom_n);
+                else
+                    run_prbs_test(order, nbytes, TEST_BAUDS, TEST_BAUD_COUNT);
+
             } else {
                 printf("Unknown command: '%s' — type 'help'\n", cmd);
             }
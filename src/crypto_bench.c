@@ -0,0 +1,203 @@
+#include "crypto_bench.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "protocol.h"
+#include "sst_crypto_embedded.h"
+
+static const size_t sizes[] = {16, 64, 256, 1024, 2048, 4096, CRYPTO_BENCH_MAX_LEN};
+#define N_SIZES (sizeof(sizes) / sizeof(sizes[0]))
+#define JITTER_SAMPLES 32  // single timed calls per row for min_ns / max_ns
+
+// Static so the Pico keeps them off its small stack
+static uint8_t in_buf[CRYPTO_BENCH_MAX_LEN + 16];
+static uint8_t out_buf[CRYPTO_BENCH_MAX_LEN + 16];
+static uint8_t ct_buf[CRYPTO_BENCH_MAX_LEN + 16];
+
+static const crypto_bench_cfg_t *cur;
+static uint8_t key[32];   // AES uses the first 16 bytes; HMAC and ChaCha20 all 32
+static uint8_t nonce[SST_NONCE_SIZE];
+static uint8_t iv[16];
+static uint8_t hdr[3];    // V2 frame TYPE|LEN, the GCM AAD
+static uint8_t tag[SST_TAG_SIZE];
+static size_t  len;
+static sst_hmac_ctx_t hmac_ctx;
+
+static int op_gcm_enc(void) {
+    return sst_encrypt_gcm_aad(key, nonce, hdr, sizeof(hdr), in_buf, len,
+                               out_buf, tag);
+}
+
+static int op_gcm_dec(void) {
+    return sst_decrypt_gcm_aad(key, nonce, hdr, sizeof(hdr), ct_buf, len, tag,
+                               out_buf);
+}
+
+// Same frame as gcm_enc, sealed the way MSG_TYPE_ENCRYPTED_CC frames are
+static int op_chachapoly_enc(void) {
+    return sst_encrypt_chachapoly(key, nonce, hdr, sizeof(hdr), in_buf, len,
+                                  out_buf, tag);
+}
+
+static int op_chachapoly_dec(void) {
+    return sst_decrypt_chachapoly(key, nonce, hdr, sizeof(hdr), ct_buf, len,
+                                  tag, out_buf);
+}
+
+static int op_hmac(void) {
+    return sst_hmac_sha256_ex(key, sizeof(key), in_buf, len, out_buf);
+}
+
+static int op_hmac_ctx(void) {
+    return sst_hmac_compute(&hmac_ctx, in_buf, len, out_buf);
+}
+
+static int op_sha256(void) { return sst_sha256(in_buf, len, out_buf); }
+
+static int op_cbc_enc(void) {
+    size_t out_len;
+    return sst_aes_128_cbc_encrypt_pkcs7(key, iv, in_buf, len, out_buf, &out_len);
+}
+
+static int op_cbc_dec(void) {
+    return sst_aes_128_cbc_decrypt(key, iv, ct_buf, len, out_buf);
+}
+
+static int op_key_hash(void) {
+    if (cur->key_hash) {
+        cur->key_hash(in_buf, key, out_buf);
+        return 0;
+    }
+    uint8_t blob[SST_KEY_ID_SIZE + SST_KEY_SIZE];
+    memcpy(blob, in_buf, SST_KEY_ID_SIZE);
+    memcpy(blob + SST_KEY_ID_SIZE, key, SST_KEY_SIZE);
+    return sst_sha256(blob, sizeof(blob), out_buf);
+}
+
+typedef struct {
+    const char *name;
+    int (*fn)(void);
+    size_t fixed_len;  // input size if it doesn't scale, else 0
+    int (*prep)(void); // per-row setup (ct_buf for the decrypt ops)
+} bench_op_t;
+
+static int prep_gcm(void) {
+    return sst_encrypt_gcm_aad(key, nonce, hdr, sizeof(hdr), in_buf, len,
+                               ct_buf, tag);
+}
+
+static int prep_chachapoly(void) {
+    return sst_encrypt_chachapoly(key, nonce, hdr, sizeof(hdr), in_buf, len,
+                                  ct_buf, tag);
+}
+
+static int prep_cbc(void) {
+    size_t out_len;
+    // Unpadded decrypt of the first len bytes; CBC doesn't care what's after
+    return sst_aes_128_cbc_encrypt_pkcs7(key, iv, in_buf, len, ct_buf, &out_len);
+}
+
+// Keying is outside the timed loop, as it is once per session key
+static int prep_hmac_ctx(void) {
+    return sst_hmac_setkey(&hmac_ctx, key, sizeof(key));
+}
+
+static const bench_op_t ops[] = {
+    {"gcm_enc", op_gcm_enc, 0, NULL},
+    {"gcm_dec", op_gcm_dec, 0, prep_gcm},
+    {"chachapoly_enc", op_chachapoly_enc, 0, NULL},
+    {"chachapoly_dec", op_chachapoly_dec, 0, prep_chachapoly},
+    {"hmac_sha256", op_hmac, 0, NULL},
+    {"hmac_ctx", op_hmac_ctx, 0, prep_hmac_ctx},
+    {"sha256", op_sha256, 0, NULL},
+    {"cbc_enc", op_cbc_enc, 0, NULL},
+    {"cbc_dec", op_cbc_dec, 0, prep_cbc},
+    {"key_hash", op_key_hash, SST_KEY_ID_SIZE + SST_KEY_SIZE, NULL},
+};
+#define N_OPS (sizeof(ops) / sizeof(ops[0]))
+
+const char *crypto_bench_ops(void) {
+    return "gcm_enc gcm_dec chachapoly_enc chachapoly_dec hmac_sha256 hmac_ctx sha256 cbc_enc cbc_dec key_hash";
+}
+
+void crypto_bench_header(void) {
+    printf("backend,platform,op,bytes,iters,ns_per_op,ops_per_sec,mb_per_sec,"
+           "cycles_per_byte,min_ns,max_ns\n");
+}
+
+// Times one op at the current `len` and prints its row.
+static int bench_row(const bench_op_t *op) {
+    uint64_t window = (uint64_t)cur->min_ms * 1000000u;
+
+    // Warm up caches and any lazy setup in the backend
+    for (int i = 0; i < 4; i++)
+        if (op->fn() != 0) return -1;
+
+    // Batches grow until a batch takes ~1/16 of the window, so the clock is
+    // read rarely even for 16-byte ops
+    uint32_t batch = 1, iters = 0;
+    uint64_t c0 = cur->cycles ? cur->cycles() : 0;
+    uint64_t t0 = cur->now_ns(), t = t0;
+    while (t - t0 < window) {
+        uint64_t b0 = t;
+        for (uint32_t i = 0; i < batch; i++)
+            if (op->fn() != 0) return -1;
+        iters += batch;
+        t = cur->now_ns();
+        if ((t - b0) * 16 < window && batch < (1u << 20)) batch *= 2;
+    }
+    uint64_t c1 = cur->cycles ? cur->cycles() : 0;
+
+    // Jitter: spread of single calls, e.g. flash cache misses on the Pico
+    uint64_t lo = UINT64_MAX, hi = 0;
+    for (int i = 0; i < JITTER_SAMPLES; i++) {
+        uint64_t s0 = cur->now_ns();
+        if (op->fn() != 0) return -1;
+        uint64_t d = cur->now_ns() - s0;
+        if (d < lo) lo = d;
+        if (d > hi) hi = d;
+    }
+
+    double ns = (double)(t - t0) / iters;
+    double bytes = (double)len;
+    printf("%s,%s,%s,%u,%lu,%.1f,%.0f,%.2f,", sst_crypto_backend(),
+           cur->platform, op->name, (unsigned)len, (unsigned long)iters, ns,
+           1e9 / ns, bytes / ns * 1e3);
+    if (cur->cycles)
+        printf("%.2f", (double)(c1 - c0) / iters / bytes);
+    else if (cur->cpu_hz)
+        printf("%.2f", ns * cur->cpu_hz / 1e9 / bytes);
+    printf(",%llu,%llu\n", (unsigned long long)lo, (unsigned long long)hi);
+    return 0;
+}
+
+int crypto_bench_run(const crypto_bench_cfg_t *cfg, const char *name) {
+    cur = cfg;
+    for (size_t i = 0; i < sizeof(in_buf); i++) in_buf[i] = (uint8_t)(i * 31 + 7);
+    for (size_t i = 0; i < sizeof(key); i++) key[i] = (uint8_t)(0xA5 ^ i);
+    for (size_t i = 0; i < sizeof(nonce); i++) nonce[i] = (uint8_t)i;
+    memset(iv, 0x3C, sizeof(iv));
+
+    int rows = 0;
+    for (size_t o = 0; o < N_OPS; o++) {
+        const bench_op_t *op = &ops[o];
+        if (name && *name && strncmp(op->name, name, strlen(name)) != 0)
+            continue;
+        for (size_t s = 0; s < N_SIZES; s++) {
+            len = op->fixed_len ? op->fixed_len : sizes[s];
+            size_t wire = SST_NONCE_SIZE + len + SST_TAG_SIZE;
+            hdr[0] = MSG_TYPE_ENCRYPTED_V2;
+            hdr[1] = (uint8_t)(wire >> 8);
+            hdr[2] = (uint8_t)wire;
+            if (op->prep && op->prep() != 0) return -1;
+            if (bench_row(op) != 0) {
+                printf("# %s failed at %u bytes\n", op->name, (unsigned)len);
+                return -1;
+            }
+            rows++;
+            if (op->fixed_len) break;
+        }
+    }
+    return rows;
+}
@@ -0,0 +1,97 @@
+#include "frame_decrypt.h"
+
+#include <string.h>
+
+void frame_decrypt_init(frame_decrypt_t *d) {
+    memset(d, 0, sizeof(*d));
+    sst_gcm_stream_init(&d->gcm);
+}
+
+void frame_decrypt_free(frame_decrypt_t *d) {
+    sst_gcm_stream_free(&d->gcm);
+    d->active = false;
+    d->have_cc = false;
+    memset(d->key, 0, sizeof(d->key));
+    memset(d->cc_src, 0, sizeof(d->cc_src));
+    memset(d->cc_key, 0, sizeof(d->cc_key));
+}
+
+// Starts d->gcm on the frame whose bytes begin at `raw` (TYPE|LEN|NONCE...).
+static int frame_decrypt_start(frame_decrypt_t *d, const uint8_t *raw,
+                               uint8_t type, uint32_t seq, const uint8_t *key) {
+    size_t aad_len = MSG_TYPE_HAS_AAD(type) ? FRAME_HDR_SIZE : 0;
+    d->active = false;
+    if (sst_gcm_stream_start(&d->gcm, key, raw + FRAME_HDR_SIZE, raw, aad_len,
+                             d->plain) != 0)
+        return -1;
+    d->active = true;
+    d->seq = seq;
+    memcpy(d->key, key, sizeof(d->key));
+    return 0;
+}
+
+void frame_decrypt_poll(frame_decrypt_t *d, const frame_parser_t *p,
+                        const uint8_t *key) {
+    lifi_frame_t f;
+    if (!key || !frame_parser_peek(p, &f) || !MSG_TYPE_IS_GCM(f.type)) return;
+
+    const size_t ct_off = FRAME_HDR_SIZE + NONCE_SIZE;
+    if (f.raw_len < ct_off) return;  // nonce not in yet
+
+    if (!d->active || d->seq != f.seq ||
+        memcmp(d->key, key, sizeof(d->key)) != 0) {
+        if (frame_decrypt_start(d, f.raw, f.type, f.seq, key) != 0) return;
+    }
+
+    // The tag is handled by frame_decrypt_finish()
+    size_t ct_len = (size_t)f.len - NONCE_SIZE - TAG_SIZE;
+    size_t have = f.raw_len - ct_off;
+    if (have > ct_len) have = ct_len;
+    if (have > d->gcm.done &&
+        sst_gcm_stream_update(&d->gcm, f.raw + ct_off + d->gcm.done,
+                              have - d->gcm.done) != 0)
+        d->active = false;
+}
+
+// ChaCha20-Poly1305 frames: one pass once the whole frame is in. The
+// derived key is kept until the session key changes.
+static int frame_decrypt_chacha(frame_decrypt_t *d, const lifi_frame_t *f,
+                                const uint8_t *key) {
+    if (!d->have_cc || memcmp(d->cc_src, key, sizeof(d->cc_src)) != 0) {
+        d->have_cc = false;
+        if (sst_chachapoly_derive_key(key, d->cc_key) != 0) return -1;
+        memcpy(d->cc_src, key, sizeof(d->cc_src));
+        d->have_cc = true;
+    }
+    size_t ct_len = (size_t)f->len - NONCE_SIZE - TAG_SIZE;
+    const uint8_t *ciphertext = f->payload + NONCE_SIZE;
+    d->oneshot++;
+    return sst_decrypt_chachapoly(d->cc_key, f->payload, f->raw, FRAME_HDR_SIZE,
+                                  ciphertext, ct_len, ciphertext + ct_len,
+                                  d->plain);
+}
+
+int frame_decrypt_finish(frame_decrypt_t *d, const lifi_frame_t *f,
+                         const uint8_t *key) {
+    size_t ct_len = (size_t)f->len - NONCE_SIZE - TAG_SIZE;
+    const uint8_t *ciphertext = f->payload + NONCE_SIZE;
+
+    if (MSG_TYPE_IS_CHACHA(f->type)) return frame_decrypt_chacha(d, f, key);
+
+    bool resume = d->active && d->seq == f->seq &&
+                  memcmp(d->key, key, sizeof(d->key)) == 0;
+    if (!resume && frame_decrypt_start(d, f->raw, f->type, f->seq, key) != 0)
+        return -1;
+    d->active = false;
+
+    if (sst_gcm_stream_update(&d->gcm, ciphertext + d->gcm.done,
+                              ct_len - d->gcm.done) != 0) {
+        memset(d->plain, 0, ct_len);  // partial, unauthenticated
+        return -1;
+    }
+    if (resume)
+        d->streamed++;
+    else
+        d->oneshot++;
+    return sst_gcm_stream_finish(&d->gcm, ciphertext + ct_len);
+}
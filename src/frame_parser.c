@@ -0,0 +1,258 @@
+#include "frame_parser.h"
+
+#include <string.h>
+
+#include "crc16.h"
+
+static const uint8_t k_preamble[PREAMBLE_SIZE] = {
+    PREAMBLE_BYTE_1, PREAMBLE_BYTE_2, PREAMBLE_BYTE_3, PREAMBLE_BYTE_4};
+
+// Payload bounds for every TYPE that travels over the optical link. Anything
+// else after a preamble is treated as a false match.
+static bool frame_len_bounds(uint8_t type, uint16_t *min, uint16_t *max) {
+    switch (type) {
+        case MSG_TYPE_ENCRYPTED:
+        case MSG_TYPE_FILE:
+        case MSG_TYPE_ENCRYPTED_V2:
+        case MSG_TYPE_FILE_V2:
+        case MSG_TYPE_ENCRYPTED_CC:
+        case MSG_TYPE_FILE_CC:
+            *min = NONCE_SIZE + TAG_SIZE;
+            *max = MAX_MSG_LEN;
+            return true;
+        case MSG_TYPE_KEY_ID_ONLY:
+            *min = SESSION_KEY_ID_SIZE;
+            *max = 64;
+            return true;
+        case MSG_TYPE_SST_HS2:
+            *min = SST_HS2_PAYLOAD_SIZE;
+            *max = SST_HS2_PAYLOAD_SIZE;
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Version 2 and ChaCha20-Poly1305 frames are checked by their tag alone and carry no CRC16.
+static size_t frame_trailer(uint8_t type) {
+    return MSG_TYPE_HAS_AAD(type) ? 0 : CRC16_SIZE;
+}
+
+void frame_parser_reset(frame_parser_t *p) {
+    p->head = 0;
+    p->tail = 0;
+    p->waiting = false;
+    p->wait_start_ms = 0;
+    p->last_ok = false;
+}
+
+void frame_parser_init(frame_parser_t *p) {
+    memset(p, 0, sizeof(*p));
+    frame_parser_reset(p);
+}
+
+// Slides the unconsumed bytes down to the start of the buffer.
+static void frame_parser_compact(frame_parser_t *p) {
+    if (p->head == 0) return;
+    p->last_ok = false;  // last_head no longer points at that frame
+    size_t n = p->tail - p->head;
+    if (n) memmove(p->buf, p->buf + p->head, n);
+    p->head = 0;
+    p->tail = n;
+}
+
+uint8_t *frame_parser_write_ptr(frame_parser_t *p, size_t *space) {
+    if (p->tail == sizeof(p->buf)) frame_parser_compact(p);
+    *space = sizeof(p->buf) - p->tail;
+    return p->buf + p->tail;
+}
+
+void frame_parser_commit(frame_parser_t *p, size_t n) {
+    if (n > sizeof(p->buf) - p->tail) n = sizeof(p->buf) - p->tail;
+    p->tail += n;
+}
+
+size_t frame_parser_push(frame_parser_t *p, const uint8_t *data, size_t len) {
+    size_t done = 0;
+    while (done < len) {
+        size_t space;
+        uint8_t *dst = frame_parser_write_ptr(p, &space);
+        if (space == 0) break;
+        size_t n = (len - done < space) ? len - done : space;
+        memcpy(dst, data + done, n);
+        frame_parser_commit(p, n);
+        done += n;
+    }
+    p->overflows += (uint32_t)(len - done);
+    return done;
+}
+
+bool frame_parser_idle(const frame_parser_t *p) { return !p->waiting; }
+
+// Rejects the candidate at `head` and resumes the scan one byte after its
+// first preamble byte.
+static frame_result_t frame_parser_drop(frame_parser_t *p, frame_error_t err,
+                                        lifi_frame_t *out) {
+    out->error = err;
+    out->payload = NULL;
+    out->raw = p->buf + p->head + PREAMBLE_SIZE;
+    size_t avail = p->tail - p->head;
+    size_t cap = (err == FRAME_ERR_CRC || err == FRAME_ERR_TIMEOUT)
+                     ? FRAME_HDR_SIZE + (size_t)out->len + frame_trailer(out->type)
+                     : 16;  // LEN is garbage; a short hex dump is enough
+    out->raw_len = (avail > PREAMBLE_SIZE) ? avail - PREAMBLE_SIZE : 0;
+    if (out->raw_len > cap) out->raw_len = cap;
+
+    switch (err) {
+        case FRAME_ERR_TYPE: p->type_fail++; break;
+        case FRAME_ERR_LEN: p->len_fail++; break;
+        case FRAME_ERR_CRC: p->crc_fail++; break;
+        case FRAME_ERR_TIMEOUT: p->timeouts++; break;
+        default: break;
+    }
+    p->resyncs++;
+    p->head += 1;
+    p->waiting = false;
+    return FRAME_DROPPED;
+}
+
+frame_result_t frame_parser_next(frame_parser_t *p, uint32_t now_ms,
+                                 lifi_frame_t *out) {
+    memset(out, 0, sizeof(*out));
+    p->last_ok = false;
+
+    for (;;) {
+        // Hunt for the first preamble byte with memchr over the whole
+        // backlog instead of stepping a byte-at-a-time state machine.
+        if (!p->waiting) {
+            size_t avail = p->tail - p->head;
+            const uint8_t *hit = avail ? memchr(p->buf + p->head,
+                                                PREAMBLE_BYTE_1, avail)
+                                       : NULL;
+            if (!hit) {
+                p->bytes_skipped += (uint32_t)avail;
+                p->head = p->tail = 0;
+                return FRAME_NONE;
+            }
+            size_t skip = (size_t)(hit - (p->buf + p->head));
+            p->bytes_skipped += (uint32_t)skip;
+            p->head += skip;
+        }
+
+        const uint8_t *f = p->buf + p->head;
+        size_t avail = p->tail - p->head;
+
+        // Confirm the rest of the preamble with whatever has arrived.
+        size_t pre = (avail < PREAMBLE_SIZE) ? avail : PREAMBLE_SIZE;
+        if (memcmp(f, k_preamble, pre) != 0) {
+            p->head += 1;
+            p->bytes_skipped += 1;
+            p->waiting = false;
+            continue;
+        }
+
+        if (!p->waiting) {
+            p->waiting = true;
+            p->wait_start_ms = now_ms;
+            p->seq++;
+        }
+        out->seq = p->seq;
+
+        uint32_t deadline = FRAME_TIMEOUT_BASE_MS;
+        if (avail >= PREAMBLE_SIZE + FRAME_HDR_SIZE) {
+            out->type = f[PREAMBLE_SIZE];
+            out->len = (uint16_t)((f[PREAMBLE_SIZE + 1] << 8) |
+                                  f[PREAMBLE_SIZE + 2]);
+            uint16_t min, max;
+            if (!frame_len_bounds(out->type, &min, &max))
+                return frame_parser_drop(p, FRAME_ERR_TYPE, out);
+            if (out->len < min || out->len > max)
+                return frame_parser_drop(p, FRAME_ERR_LEN, out);
+            deadline += out->len / 10;
+        } else if (avail > PREAMBLE_SIZE) {
+            // TYPE alone is enough to reject most false preambles early.
+            uint16_t min, max;
+            out->type = f[PREAMBLE_SIZE];
+            if (!frame_len_bounds(out->type, &min, &max))
+                return frame_parser_drop(p, FRAME_ERR_TYPE, out);
+        }
+
+        size_t trailer = frame_trailer(out->type);
+        size_t need = PREAMBLE_SIZE + FRAME_HDR_SIZE + (size_t)out->len +
+                      trailer;
+        if (avail < PREAMBLE_SIZE + FRAME_HDR_SIZE || avail < need) {
+            if ((uint32_t)(now_ms - p->wait_start_ms) >= deadline) {
+                // A partial preamble at the very end of the buffer is only a
+                // prefix match; there is nothing to report for it.
+                if (avail < PREAMBLE_SIZE) {
+                    p->head += 1;
+                    p->bytes_skipped += 1;
+                    p->waiting = false;
+                    continue;
+                }
+                return frame_parser_drop(p, FRAME_ERR_TIMEOUT, out);
+            }
+            // Make sure the whole frame will fit behind the candidate.
+            if (p->head + need > sizeof(p->buf)) frame_parser_compact(p);
+            return FRAME_NONE;
+        }
+
+        const uint8_t *body = f + PREAMBLE_SIZE;
+        size_t body_len = FRAME_HDR_SIZE + (size_t)out->len;
+        if (trailer) {
+            out->crc_calc = crc16_ccitt(body, body_len);
+            out->crc_rx = (uint16_t)((body[body_len] << 8) | body[body_len + 1]);
+            if (out->crc_calc != out->crc_rx)
+                return frame_parser_drop(p, FRAME_ERR_CRC, out);
+        }
+
+        out->payload = body + FRAME_HDR_SIZE;
+        out->raw = body;
+        out->raw_len = body_len + trailer;
+        out->error = FRAME_ERR_NONE;
+        p->frames_ok++;
+        p->last_ok = true;
+        p->last_head = p->head;
+        p->head += need;
+        p->waiting = false;
+        return FRAME_OK;
+    }
+}
+
+bool frame_parser_peek(const frame_parser_t *p, lifi_frame_t *out) {
+    memset(out, 0, sizeof(*out));
+    size_t avail = p->tail - p->head;
+    // frame_parser_next() has already vetted TYPE and LEN of a waiting
+    // candidate once its header is in
+    if (!p->waiting || avail < PREAMBLE_SIZE + FRAME_HDR_SIZE) return false;
+
+    const uint8_t *body = p->buf + p->head + PREAMBLE_SIZE;
+    out->type = body[0];
+    out->len = (uint16_t)((body[1] << 8) | body[2]);
+    out->raw = body;
+    out->raw_len = avail - PREAMBLE_SIZE;
+    size_t full = FRAME_HDR_SIZE + (size_t)out->len + frame_trailer(out->type);
+    if (out->raw_len > full) out->raw_len = full;
+    out->seq = p->seq;
+    return true;
+}
+
+void frame_parser_reject(frame_parser_t *p) {
+    if (!p->last_ok) return;
+    p->last_ok = false;
+    p->frames_ok--;
+    p->auth_fail++;
+    p->resyncs++;
+    p->head = p->last_head + 1;
+}
+
+const char *frame_error_str(frame_error_t err) {
+    switch (err) {
+        case FRAME_ERR_NONE: return "ok";
+        case FRAME_ERR_TYPE: return "unknown type";
+        case FRAME_ERR_LEN: return "bad length";
+        case FRAME_ERR_CRC: return "CRC mismatch";
+        case FRAME_ERR_TIMEOUT: return "timeout";
+    }
+    return "?";
+}
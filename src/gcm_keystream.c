@@ -0,0 +1,237 @@
+#include "gcm_keystream.h"
+
+#include <string.h>
+
+#include "mbedtls/platform_util.h"
+
+#define SALT_LEN (SST_NONCE_SIZE - 4)
+
+static uint32_t load_be32(const uint8_t *b) {
+    return ((uint32_t)b[0] << 24) | ((uint32_t)b[1] << 16) |
+           ((uint32_t)b[2] << 8) | b[3];
+}
+
+static void put_be32(uint8_t *b, uint32_t v) {
+    b[0] = (uint8_t)(v >> 24);
+    b[1] = (uint8_t)(v >> 16);
+    b[2] = (uint8_t)(v >> 8);
+    b[3] = (uint8_t)v;
+}
+
+static uint64_t load_be64(const uint8_t *b) {
+    return ((uint64_t)load_be32(b) << 32) | load_be32(b + 4);
+}
+
+static void put_be64(uint8_t *b, uint64_t v) {
+    put_be32(b, (uint32_t)(v >> 32));
+    put_be32(b + 4, (uint32_t)v);
+}
+
+// GHASH with Shoup's 4-bit tables: hl/hh[i] = i * H in GF(2^128), so each
+// nibble of the input costs one table lookup and a 4-bit shift instead of
+// a bit-by-bit multiply. Same tables and reduction as mbedTLS's gcm.c.
+static void ghash_tables(gcm_ks_pool_t *p, const uint8_t h[16]) {
+    uint64_t vh = load_be64(h), vl = load_be64(h + 8);
+    p->hl[8] = vl;
+    p->hh[8] = vh;
+    p->hl[0] = 0;
+    p->hh[0] = 0;
+    for (int i = 4; i > 0; i >>= 1) {
+        uint32_t t = (uint32_t)(vl & 1) * 0xe1000000U;
+        vl = (vh << 63) | (vl >> 1);
+        vh = (vh >> 1) ^ ((uint64_t)t << 32);
+        p->hl[i] = vl;
+        p->hh[i] = vh;
+    }
+    for (int i = 2; i <= 8; i *= 2) {
+        uint64_t *hil = p->hl + i, *hih = p->hh + i;
+        vh = *hih;
+        vl = *hil;
+        for (int j = 1; j < i; j++) {
+            hih[j] = vh ^ p->hh[j];
+            hil[j] = vl ^ p->hl[j];
+        }
+    }
+}
+
+static const uint16_t last4[16] = {
+    0x0000, 0x1c20, 0x3840, 0x2460, 0x7080, 0x6ca0, 0x48c0, 0x54e0,
+    0xe100, 0xfd20, 0xd940, 0xc560, 0x9180, 0x8da0, 0xa9c0, 0xb5e0};
+
+// x = x * H
+static void ghash_mult(const gcm_ks_pool_t *p, uint8_t x[16]) {
+    uint8_t lo = x[15] & 0xf, hi, rem;
+    uint64_t zh = p->hh[lo], zl = p->hl[lo];
+    for (int i = 15; i >= 0; i--) {
+        lo = x[i] & 0xf;
+        hi = (x[i] >> 4) & 0xf;
+        if (i != 15) {
+            rem = (uint8_t)(zl & 0xf);
+            zl = (zh << 60) | (zl >> 4);
+            zh = (zh >> 4) ^ ((uint64_t)last4[rem] << 48);
+            zh ^= p->hh[lo];
+            zl ^= p->hl[lo];
+        }
+        rem = (uint8_t)(zl & 0xf);
+        zl = (zh << 60) | (zl >> 4);
+        zh = (zh >> 4) ^ ((uint64_t)last4[rem] << 48);
+        zh ^= p->hh[hi];
+        zl ^= p->hl[hi];
+    }
+    put_be64(x, zh);
+    put_be64(x + 8, zl);
+}
+
+// Absorbs `len` bytes into y, zero-padding the last block
+static void ghash_update(const gcm_ks_pool_t *p, uint8_t y[16],
+                         const uint8_t *in, size_t len) {
+    while (len > 0) {
+        size_t n = len < 16 ? len : 16;
+        for (size_t i = 0; i < n; i++) y[i] ^= in[i];
+        ghash_mult(p, y);
+        in += n;
+        len -= n;
+    }
+}
+
+// E(K, nonce || ctr32)
+static int ctr_block(gcm_ks_pool_t *p, const uint8_t *nonce, uint32_t ctr32,
+                     uint8_t out[16]) {
+    uint8_t cb[16];
+    memcpy(cb, nonce, SST_NONCE_SIZE);
+    put_be32(cb + SST_NONCE_SIZE, ctr32);
+    return mbedtls_aes_crypt_ecb(&p->aes, MBEDTLS_AES_ENCRYPT, cb, out);
+}
+
+static void wipe_entry(gcm_ks_entry_t *e) {
+    mbedtls_platform_zeroize(e, sizeof(*e));
+}
+
+void gcm_ks_init(gcm_ks_pool_t *p) {
+    memset(p, 0, sizeof(*p));
+    mbedtls_aes_init(&p->aes);
+}
+
+void gcm_ks_reset(gcm_ks_pool_t *p) {
+    mbedtls_aes_free(&p->aes);  // zeroizes the key schedule
+    mbedtls_platform_zeroize(p->key, sizeof(p->key));
+    mbedtls_platform_zeroize(p->hl, sizeof(p->hl));
+    mbedtls_platform_zeroize(p->hh, sizeof(p->hh));
+    for (int i = 0; i < GCM_KS_DEPTH; i++) wipe_entry(&p->ent[i]);
+    memset(p->salt, 0, sizeof(p->salt));
+    p->keyed = false;
+    mbedtls_aes_init(&p->aes);
+}
+
+static bool pool_matches(const gcm_ks_pool_t *p, const uint8_t *key,
+                         const uint8_t *nonce) {
+    return p->keyed && memcmp(p->key, key, sizeof(p->key)) == 0 &&
+           memcmp(p->salt, nonce, SALT_LEN) == 0;
+}
+
+// Keys the pool for `key` and the salt of `nonce`, dropping anything else
+static int pool_rekey(gcm_ks_pool_t *p, const uint8_t *key,
+                      const uint8_t *nonce) {
+    if (p->keyed && memcmp(p->key, key, sizeof(p->key)) == 0) {
+        // Same key, new salt: only the entries are stale
+        for (int i = 0; i < GCM_KS_DEPTH; i++) wipe_entry(&p->ent[i]);
+        memcpy(p->salt, nonce, SALT_LEN);
+        return 0;
+    }
+    gcm_ks_reset(p);
+    uint8_t h[16] = {0};
+    int ret = mbedtls_aes_setkey_enc(&p->aes, key, 128);
+    if (ret == 0) ret = mbedtls_aes_crypt_ecb(&p->aes, MBEDTLS_AES_ENCRYPT, h, h);
+    if (ret != 0) {
+        gcm_ks_reset(p);
+        return ret;
+    }
+    ghash_tables(p, h);
+    mbedtls_platform_zeroize(h, sizeof(h));
+    memcpy(p->key, key, sizeof(p->key));
+    memcpy(p->salt, nonce, SALT_LEN);
+    p->keyed = true;
+    return 0;
+}
+
+int gcm_ks_fill(gcm_ks_pool_t *p, const uint8_t *key,
+                const uint8_t *next_nonce, int max_blocks) {
+    if (!pool_matches(p, key, next_nonce) &&
+        pool_rekey(p, key, next_nonce) != 0)
+        return 0;
+
+    uint32_t next = load_be32(next_nonce + SALT_LEN);
+    uint8_t nonce[SST_NONCE_SIZE];
+    memcpy(nonce, next_nonce, SALT_LEN);
+    int n = 0;
+    for (uint32_t a = 0; a < GCM_KS_DEPTH && n < max_blocks; a++) {
+        uint32_t ctr = next + a;
+        if (ctr < next) break;  // counter wraps; pico_nonce_generate() reboots
+        gcm_ks_entry_t *e = &p->ent[ctr % GCM_KS_DEPTH];
+        if (!e->used || e->ctr != ctr) {
+            wipe_entry(e);
+            e->used = true;
+            e->ctr = ctr;
+        }
+        put_be32(nonce + SALT_LEN, ctr);
+        while (e->done < GCM_KS_BLOCKS + 1 && n < max_blocks) {
+            // Block 0 is E(J0) for the tag; keystream starts at counter 2
+            uint8_t *out = e->done == 0 ? e->ekj0 : e->ks + (e->done - 1) * 16;
+            if (ctr_block(p, nonce, 1u + e->done, out) != 0) {
+                wipe_entry(e);
+                return n;
+            }
+            e->done++;
+            n++;
+        }
+    }
+    return n;
+}
+
+int gcm_ks_encrypt(gcm_ks_pool_t *p, const uint8_t *key, const uint8_t *nonce,
+                   const uint8_t *aad, size_t aad_len,
+                   const uint8_t *input, size_t input_len,
+                   uint8_t *ciphertext, uint8_t *tag) {
+    uint32_t ctr = load_be32(nonce + SALT_LEN);
+    gcm_ks_entry_t *e = &p->ent[ctr % GCM_KS_DEPTH];
+    bool mine = pool_matches(p, key, nonce) && e->used && e->ctr == ctr;
+
+    if (!mine || e->done == 0) {
+        // This nonce is spent either way; its blocks must not outlive it
+        if (mine) wipe_entry(e);
+        p->misses++;
+        return sst_encrypt_gcm_aad(key, nonce, aad, aad_len, input, input_len,
+                                   ciphertext, tag);
+    }
+
+    uint8_t y[16] = {0};
+    uint8_t ks[16];
+    int ret = 0;
+    ghash_update(p, y, aad, aad_len);
+    for (size_t off = 0, i = 0; off < input_len; off += 16, i++) {
+        const uint8_t *k;
+        if (i + 1 < e->done) {
+            k = e->ks + i * 16;
+            p->blocks_used++;
+        } else {
+            ret = ctr_block(p, nonce, 2u + (uint32_t)i, ks);
+            if (ret != 0) break;
+            k = ks;
+        }
+        size_t n = input_len - off < 16 ? input_len - off : 16;
+        for (size_t j = 0; j < n; j++) ciphertext[off + j] = input[off + j] ^ k[j];
+    }
+    if (ret == 0) {
+        ghash_update(p, y, ciphertext, input_len);
+        uint8_t lens[16];
+        put_be64(lens, (uint64_t)aad_len * 8);
+        put_be64(lens + 8, (uint64_t)input_len * 8);
+        ghash_update(p, y, lens, sizeof(lens));
+        for (int j = 0; j < 16; j++) tag[j] = y[j] ^ e->ekj0[j];
+        p->hits++;
+    }
+    wipe_entry(e);
+    mbedtls_platform_zeroize(ks, sizeof(ks));
+    mbedtls_platform_zeroize(y, sizeof(y));
+    return ret;
+}
@@ -98,6 +98,14 @@ void pico_nonce_generate(uint8_t out12[GCM_IV_LEN]) {
     store_be32(out12 + NONCE_SALT_LEN, ctr);
 }
 
+void pico_nonce_peek(uint8_t out12[GCM_IV_LEN]) {
+    uint32_t ints = save_and_disable_interrupts();
+    uint32_t ctr = g_msg_counter;
+    restore_interrupts(ints);
+    memcpy(out12, g_boot_salt, NONCE_SALT_LEN);
+    store_be32(out12 + NONCE_SALT_LEN, ctr);
+}
+
 void pico_nonce_on_key_change(void) {  // call whenever session key changes
     // Safe to reset counter when key changes (new (key,nonce) space)
     pico_nonce_init();
@@ -0,0 +1,150 @@
+#include "prbs.h"
+
+#include <string.h>
+
+static int burst_bin(uint32_t span) {
+    if (span <= 1) return 0;
+    if (span <= 2) return 1;
+    if (span <= 4) return 2;
+    if (span <= 8) return 3;
+    if (span <= 16) return 4;
+    return 5;
+}
+
+static void burst_close(prbs_check_t *c) {
+    if (!c->in_burst) return;
+    c->stats.bursts[burst_bin(c->burst_span)]++;
+    if (c->burst_span > c->stats.max_burst) c->stats.max_burst = c->burst_span;
+    c->in_burst = false;
+}
+
+// Moves the oldest window byte into the totals and the burst tracker.
+static void commit_oldest(prbs_check_t *c) {
+    uint8_t err = c->win_err[c->win_head];
+    c->win_head = (c->win_head + 1) % PRBS_WIN_BYTES;
+    c->win_n--;
+    c->win_errors -= (uint32_t)__builtin_popcount(err);
+
+    c->stats.bits += 8;
+    for (int i = 0; i < 8; i++) {
+        if (err & (1u << i)) {
+            c->stats.errors++;
+            if (c->in_burst) {
+                c->burst_span += c->burst_gap + 1;
+            } else {
+                c->in_burst   = true;
+                c->burst_span = 1;
+            }
+            c->burst_gap = 0;
+        } else if (c->in_burst && ++c->burst_gap > PRBS_BURST_GAP) {
+            burst_close(c);
+        }
+    }
+}
+
+static void acquire_restart(prbs_check_t *c) {
+    c->phase    = 0;
+    c->acq      = 0;
+    c->acq_bits = 0;
+}
+
+static void acquire_byte(prbs_check_t *c, uint8_t byte) {
+    for (int i = 0; i < 8; i++)
+        c->acq = (c->acq << 1) | ((byte >> i) & 1u);
+    c->acq_bits += 8;
+    c->stats.unchecked_bits += 8;
+    // An all-zero state is the LFSR's lockup state: a dead line, not PRBS
+    if (c->acq_bits >= c->order && (c->acq & ((1u << c->order) - 1))) {
+        c->gen.state   = c->acq & ((1u << c->order) - 1);
+        c->phase       = 1;
+        c->verify_left = PRBS_VERIFY_BYTES;
+    }
+}
+
+// Fresh lock confirmed: compare it with where the old lock would be by now.
+// Advancing the old generator by exactly the bytes received means no slip;
+// k bytes further means k bytes never arrived, k bytes short means k extra.
+static void measure_slip(prbs_check_t *c) {
+    if (!c->have_ref) return;
+    c->have_ref = false;
+
+    uint32_t d = c->stats.bytes - c->ref_byte;
+    prbs_t g = c->gen;
+    g.state = c->ref_state;
+    for (uint32_t m = 0; m <= d + PRBS_MAX_SLIP; m++) {
+        if (m + PRBS_MAX_SLIP >= d && g.state == c->gen.state) {
+            int32_t k = (int32_t)m - (int32_t)d;
+            if (k == 0) {
+                c->stats.resyncs++;
+            } else {
+                c->stats.slips++;
+                if (k > 0) c->stats.bytes_lost += (uint32_t)k;
+                else c->stats.bytes_extra += (uint32_t)-k;
+            }
+            return;
+        }
+        prbs_next_byte(&g);
+    }
+    c->stats.resyncs++;
+}
+
+void prbs_check_init(prbs_check_t *c, int order) {
+    memset(c, 0, sizeof(*c));
+    prbs_init(&c->gen, order);
+    c->order = order;
+    acquire_restart(c);
+}
+
+void prbs_check_byte(prbs_check_t *c, uint8_t byte) {
+    if (c->phase == 0) {
+        acquire_byte(c, byte);
+        c->stats.bytes++;
+        return;
+    }
+
+    uint32_t state_before = c->gen.state;
+    uint8_t err = byte ^ prbs_next_byte(&c->gen);
+    c->stats.bytes++;
+
+    if (c->phase == 1) {
+        if (err) {
+            // Acquired through an error; start over from this byte
+            c->stats.unchecked_bits += 8 * (PRBS_VERIFY_BYTES - c->verify_left);
+            acquire_restart(c);
+            acquire_byte(c, byte);
+        } else if (--c->verify_left == 0) {
+            c->phase = 2;
+            c->stats.bits += 8 * PRBS_VERIFY_BYTES;
+            c->stats.ever_locked = true;
+            measure_slip(c);
+        }
+        return;
+    }
+
+    if (c->win_n == PRBS_WIN_BYTES) commit_oldest(c);
+    int tail = (c->win_head + c->win_n) % PRBS_WIN_BYTES;
+    c->win_err[tail]   = err;
+    c->win_state[tail] = state_before;
+    c->win_n++;
+    c->win_errors += (uint32_t)__builtin_popcount(err);
+
+    if (c->win_errors > PRBS_LOSS_ERRORS) {
+        // Lost lock: the window is slip garbage, not bit errors
+        c->have_ref  = true;
+        c->ref_state = c->win_state[c->win_head];
+        c->ref_byte  = c->stats.bytes - (uint32_t)c->win_n;
+        c->stats.unchecked_bits += 8u * (uint32_t)c->win_n;
+        c->win_n = c->win_head = 0;
+        c->win_errors = 0;
+        burst_close(c);
+        acquire_restart(c);
+    }
+}
+
+void prbs_check_finish(prbs_check_t *c) {
+    while (c->win_n) commit_oldest(c);
+    burst_close(c);
+    if (c->phase == 1)
+        c->stats.unchecked_bits += 8 * (PRBS_VERIFY_BYTES - c->verify_left);
+    acquire_restart(c);
+}
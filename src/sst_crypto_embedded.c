@@ -2,9 +2,300 @@
 #include "../include/sst_crypto_embedded.h"
 
 #include <string.h>
+
+#ifdef SST_CRYPTO_BACKEND_OPENSSL
+// Linux receivers: OpenSSL EVP, which picks AES-NI / PCLMUL on x86 and the
+// NEON (or ARMv8 Crypto Extension) AES and GHASH code on the Pi 4.
+#include <pthread.h>
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+
+// OpenSSL 3 looks the cipher up in the provider on every init unless it
+// is fetched once up front; for short frames that lookup costs more than
+// the AES itself.
+static const EVP_CIPHER *cipher_gcm;
+static const EVP_CIPHER *cipher_cbc;
+static const EVP_CIPHER *cipher_chachapoly;
+static pthread_once_t cipher_once = PTHREAD_ONCE_INIT;
+
+static void fetch_ciphers(void) {
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+    cipher_gcm = EVP_CIPHER_fetch(NULL, "AES-128-GCM", NULL);
+    cipher_cbc = EVP_CIPHER_fetch(NULL, "AES-128-CBC", NULL);
+    cipher_chachapoly = EVP_CIPHER_fetch(NULL, "ChaCha20-Poly1305", NULL);
+#endif
+    if (!cipher_gcm) cipher_gcm = EVP_aes_128_gcm();
+    if (!cipher_cbc) cipher_cbc = EVP_aes_128_cbc();
+    if (!cipher_chachapoly) cipher_chachapoly = EVP_chacha20_poly1305();
+}
+
+static const EVP_CIPHER *gcm(void) {
+    pthread_once(&cipher_once, fetch_ciphers);
+    return cipher_gcm;
+}
+
+static const EVP_CIPHER *cbc(void) {
+    pthread_once(&cipher_once, fetch_ciphers);
+    return cipher_cbc;
+}
+
+static const EVP_CIPHER *chachapoly(void) {
+    pthread_once(&cipher_once, fetch_ciphers);
+    return cipher_chachapoly;
+}
+
+const char *sst_crypto_backend(void) { return "openssl"; }
+
+int sst_sha256(const uint8_t *input, size_t input_len, uint8_t *output) {
+    unsigned int out_len = 0;
+    if (!EVP_Digest(input, input_len, output, &out_len, EVP_sha256(), NULL))
+        return -1;
+    return out_len == 32 ? 0 : -1;
+}
+
+int sst_hmac_sha256(const uint8_t *key, const uint8_t *input, size_t input_len, uint8_t *output) {
+    // Uses SST_KEY_SIZE (16 bytes) – for 32-byte mac_keys use sst_hmac_sha256_ex
+    return sst_hmac_sha256_ex(key, SST_KEY_SIZE, input, input_len, output);
+}
+
+int sst_hmac_sha256_ex(const uint8_t *key, size_t key_len,
+                        const uint8_t *input, size_t input_len,
+                        uint8_t *output) {
+    unsigned int out_len = 0;
+    if (!HMAC(EVP_sha256(), key, (int)key_len, input, input_len, output, &out_len))
+        return -1;
+    return out_len == 32 ? 0 : -1;
+}
+
+// HMAC pads: key (hashed first if longer than a block) XOR 0x36 / 0x5C
+static void hmac_pads(const uint8_t *key, size_t key_len,
+                      uint8_t ipad[64], uint8_t opad[64]) {
+    uint8_t k[64] = {0};
+    if (key_len > sizeof(k)) {
+        sst_sha256(key, key_len, k);
+    } else {
+        memcpy(k, key, key_len);
+    }
+    for (int i = 0; i < 64; i++) {
+        ipad[i] = k[i] ^ 0x36;
+        opad[i] = k[i] ^ 0x5C;
+    }
+    OPENSSL_cleanse(k, sizeof(k));
+}
+
+void sst_hmac_init(sst_hmac_ctx_t *ctx) {
+    ctx->inner = NULL;
+    ctx->outer = NULL;
+}
+
+int sst_hmac_setkey(sst_hmac_ctx_t *ctx, const uint8_t *key, size_t key_len) {
+    if (!ctx->inner) ctx->inner = EVP_MD_CTX_new();
+    if (!ctx->outer) ctx->outer = EVP_MD_CTX_new();
+    if (!ctx->inner || !ctx->outer) return -1;
+
+    uint8_t ipad[64], opad[64];
+    hmac_pads(key, key_len, ipad, opad);
+    int ok = EVP_DigestInit_ex(ctx->inner, EVP_sha256(), NULL) &&
+             EVP_DigestUpdate(ctx->inner, ipad, sizeof(ipad)) &&
+             EVP_DigestInit_ex(ctx->outer, EVP_sha256(), NULL) &&
+             EVP_DigestUpdate(ctx->outer, opad, sizeof(opad));
+    OPENSSL_cleanse(ipad, sizeof(ipad));
+    OPENSSL_cleanse(opad, sizeof(opad));
+    return ok ? 0 : -1;
+}
+
+int sst_hmac_compute(const sst_hmac_ctx_t *ctx, const uint8_t *input,
+                     size_t input_len, uint8_t *output) {
+    if (!ctx->inner || !ctx->outer) return -1;
+    EVP_MD_CTX *c = EVP_MD_CTX_new();
+    if (!c) return -1;
+    uint8_t ihash[32];
+    int ok = EVP_MD_CTX_copy_ex(c, ctx->inner) &&
+             EVP_DigestUpdate(c, input, input_len) &&
+             EVP_DigestFinal_ex(c, ihash, NULL) &&
+             EVP_MD_CTX_copy_ex(c, ctx->outer) &&
+             EVP_DigestUpdate(c, ihash, sizeof(ihash)) &&
+             EVP_DigestFinal_ex(c, output, NULL);
+    EVP_MD_CTX_free(c);
+    OPENSSL_cleanse(ihash, sizeof(ihash));
+    return ok ? 0 : -1;
+}
+
+void sst_hmac_free(sst_hmac_ctx_t *ctx) {
+    EVP_MD_CTX_free(ctx->inner);  // resets (and so wipes) the state
+    EVP_MD_CTX_free(ctx->outer);
+    sst_hmac_init(ctx);
+}
+
+int sst_aes_128_cbc_decrypt(const uint8_t *key_16, const uint8_t *iv,
+                              const uint8_t *input, size_t input_len,
+                              uint8_t *output) {
+    EVP_CIPHER_CTX *ctx = EVP_CIPHER_CTX_new();
+    if (!ctx) return -1;
+    int n = 0, fin = 0;
+    int ok = EVP_DecryptInit_ex(ctx, cbc(), NULL, key_16, iv) &&
+             EVP_CIPHER_CTX_set_padding(ctx, 0) &&
+             EVP_DecryptUpdate(ctx, output, &n, input, (int)input_len) &&
+             EVP_DecryptFinal_ex(ctx, output + n, &fin);
+    EVP_CIPHER_CTX_free(ctx);
+    return ok ? 0 : -1;
+}
+
+int sst_aes_128_cbc_encrypt_pkcs7(const uint8_t *key_16, const uint8_t *iv,
+                                   const uint8_t *input, size_t input_len,
+                                   uint8_t *output, size_t *output_len) {
+    EVP_CIPHER_CTX *ctx = EVP_CIPHER_CTX_new();
+    if (!ctx) return -1;
+    // EVP pads with PKCS7 by default
+    int n = 0, fin = 0;
+    int ok = EVP_EncryptInit_ex(ctx, cbc(), NULL, key_16, iv) &&
+             EVP_EncryptUpdate(ctx, output, &n, input, (int)input_len) &&
+             EVP_EncryptFinal_ex(ctx, output + n, &fin);
+    EVP_CIPHER_CTX_free(ctx);
+    *output_len = (size_t)n + (size_t)fin;
+    return ok ? 0 : -1;
+}
+
+// One AEAD pass (AES-GCM or ChaCha20-Poly1305): encrypts and writes `tag`,
+// or decrypts and checks it.
+static int aead_crypt(const EVP_CIPHER *cipher, int enc, const uint8_t *key,
+                      const uint8_t *nonce, const uint8_t *aad, size_t aad_len,
+                      const uint8_t *input, size_t len, uint8_t *output,
+                      uint8_t *tag) {
+    EVP_CIPHER_CTX *ctx = EVP_CIPHER_CTX_new();
+    if (!ctx) return -1;
+    int n = 0;
+    int ok = EVP_CipherInit_ex(ctx, cipher, NULL, NULL, NULL, enc) &&
+             EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_SET_IVLEN, SST_NONCE_SIZE, NULL) &&
+             EVP_CipherInit_ex(ctx, NULL, NULL, key, nonce, enc);
+    if (ok && aad_len)
+        ok = EVP_CipherUpdate(ctx, NULL, &n, aad, (int)aad_len);
+    if (ok && !enc)
+        ok = EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_SET_TAG, SST_TAG_SIZE, tag);
+    if (ok && len)
+        ok = EVP_CipherUpdate(ctx, output, &n, input, (int)len);
+    // For decryption, Final is where the tag is checked
+    if (ok)
+        ok = EVP_CipherFinal_ex(ctx, output + (len ? n : 0), &n);
+    if (ok && enc)
+        ok = EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_GET_TAG, SST_TAG_SIZE, tag);
+    EVP_CIPHER_CTX_free(ctx);
+    if (!ok && !enc) OPENSSL_cleanse(output, len);  // no unauthenticated plaintext
+    return ok ? 0 : -1;
+}
+
+int sst_encrypt_gcm(const uint8_t *key, const uint8_t *nonce,
+                    const uint8_t *input, size_t input_len, uint8_t *ciphertext,
+                    uint8_t *tag) {
+    return sst_encrypt_gcm_aad(key, nonce, NULL, 0, input, input_len,
+                               ciphertext, tag);
+}
+
+int sst_decrypt_gcm(const uint8_t *key, const uint8_t *nonce,
+                    const uint8_t *ciphertext, size_t ciphertext_len,
+                    const uint8_t *tag, uint8_t *output) {
+    return sst_decrypt_gcm_aad(key, nonce, NULL, 0, ciphertext, ciphertext_len,
+                               tag, output);
+}
+
+int sst_encrypt_gcm_aad(const uint8_t *key, const uint8_t *nonce,
+                        const uint8_t *aad, size_t aad_len,
+                        const uint8_t *input, size_t input_len,
+                        uint8_t *ciphertext, uint8_t *tag) {
+    return aead_crypt(gcm(), 1, key, nonce, aad, aad_len, input, input_len,
+                      ciphertext, tag);
+}
+
+int sst_decrypt_gcm_aad(const uint8_t *key, const uint8_t *nonce,
+                        const uint8_t *aad, size_t aad_len,
+                        const uint8_t *ciphertext, size_t ciphertext_len,
+                        const uint8_t *tag, uint8_t *output) {
+    return aead_crypt(gcm(), 0, key, nonce, aad, aad_len, ciphertext,
+                      ciphertext_len, output, (uint8_t *)tag);
+}
+
+int sst_encrypt_chachapoly(const uint8_t *key, const uint8_t *nonce,
+                           const uint8_t *aad, size_t aad_len,
+                           const uint8_t *input, size_t input_len,
+                           uint8_t *ciphertext, uint8_t *tag) {
+    return aead_crypt(chachapoly(), 1, key, nonce, aad, aad_len, input,
+                      input_len, ciphertext, tag);
+}
+
+int sst_decrypt_chachapoly(const uint8_t *key, const uint8_t *nonce,
+                           const uint8_t *aad, size_t aad_len,
+                           const uint8_t *ciphertext, size_t ciphertext_len,
+                           const uint8_t *tag, uint8_t *output) {
+    return aead_crypt(chachapoly(), 0, key, nonce, aad, aad_len, ciphertext,
+                      ciphertext_len, output, (uint8_t *)tag);
+}
+
+void sst_gcm_stream_init(sst_gcm_stream_t *s) {
+    s->impl = NULL;
+    s->out = NULL;
+    s->done = 0;
+}
+
+int sst_gcm_stream_start(sst_gcm_stream_t *s, const uint8_t *key,
+                         const uint8_t *nonce, const uint8_t *aad,
+                         size_t aad_len, uint8_t *output) {
+    if (!s->impl && !(s->impl = EVP_CIPHER_CTX_new())) return -1;
+    EVP_CIPHER_CTX *ctx = s->impl;
+    s->out = output;
+    s->done = 0;
+    int n = 0;
+    int ok = EVP_DecryptInit_ex(ctx, gcm(), NULL, NULL, NULL) &&
+             EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_IVLEN, SST_NONCE_SIZE, NULL) &&
+             EVP_DecryptInit_ex(ctx, NULL, NULL, key, nonce);
+    if (ok && aad_len)
+        ok = EVP_DecryptUpdate(ctx, NULL, &n, aad, (int)aad_len);
+    return ok ? 0 : -1;
+}
+
+int sst_gcm_stream_update(sst_gcm_stream_t *s, const uint8_t *ciphertext,
+                          size_t len) {
+    if (len == 0) return 0;
+    int n = 0;
+    // GCM is a stream mode: EVP hands back exactly as many bytes as it got
+    if (!EVP_DecryptUpdate(s->impl, s->out + s->done, &n, ciphertext, (int)len) ||
+        (size_t)n != len)
+        return -1;
+    s->done += len;
+    return 0;
+}
+
+int sst_gcm_stream_finish(sst_gcm_stream_t *s, const uint8_t *tag) {
+    int n = 0;
+    int ok = EVP_CIPHER_CTX_ctrl(s->impl, EVP_CTRL_GCM_SET_TAG, SST_TAG_SIZE,
+                                 (uint8_t *)tag) &&
+             EVP_DecryptFinal_ex(s->impl, s->out + s->done, &n);
+    if (!ok) OPENSSL_cleanse(s->out, s->done);
+    return ok ? 0 : -1;
+}
+
+void sst_gcm_stream_free(sst_gcm_stream_t *s) {
+    EVP_CIPHER_CTX_free(s->impl);
+    sst_gcm_stream_init(s);
+}
+
+#else  // mbedTLS: the Pico builds, and Linux with SST_CRYPTO_BACKEND=mbedtls
+
+#include <stdlib.h>
 #include "mbedtls/aes.h"
+#include "mbedtls/chachapoly.h"
 #include "mbedtls/gcm.h"
 #include "mbedtls/md.h"
+#include "mbedtls/platform_util.h"
+#include "mbedtls/sha256.h"
+
+const char *sst_crypto_backend(void) { return "mbedtls"; }
+
+int sst_sha256(const uint8_t *input, size_t input_len, uint8_t *output) {
+    const mbedtls_md_info_t *md_info = mbedtls_md_info_from_type(MBEDTLS_MD_SHA256);
+    if (md_info == NULL) return -1;
+    return mbedtls_md(md_info, input, input_len, output);
+}
 
 int sst_hmac_sha256(const uint8_t *key, const uint8_t *input, size_t input_len, uint8_t *output) {
     const mbedtls_md_info_t *md_info = mbedtls_md_info_from_type(MBEDTLS_MD_SHA256);
@@ -21,6 +312,81 @@ int sst_hmac_sha256_ex(const uint8_t *key, size_t key_len,
     return mbedtls_md_hmac(md_info, key, key_len, input, input_len, output);
 }
 
+// HMAC pads: key (hashed first if longer than a block) XOR 0x36 / 0x5C
+static void hmac_pads(const uint8_t *key, size_t key_len,
+                      uint8_t ipad[64], uint8_t opad[64]) {
+    uint8_t k[64] = {0};
+    if (key_len > sizeof(k)) {
+        sst_sha256(key, key_len, k);
+    } else {
+        memcpy(k, key, key_len);
+    }
+    for (int i = 0; i < 64; i++) {
+        ipad[i] = k[i] ^ 0x36;
+        opad[i] = k[i] ^ 0x5C;
+    }
+    mbedtls_platform_zeroize(k, sizeof(k));
+}
+
+// SHA-256 state that has absorbed one pad block
+static int hmac_half(void **slot, const uint8_t pad[64]) {
+    mbedtls_sha256_context *st = *slot;
+    if (st) {
+        mbedtls_sha256_free(st);
+    } else {
+        st = malloc(sizeof(*st));
+        if (!st) return -1;
+        *slot = st;
+    }
+    mbedtls_sha256_init(st);
+    int ret = mbedtls_sha256_starts(st, 0);
+    if (ret == 0) ret = mbedtls_sha256_update(st, pad, 64);
+    return ret;
+}
+
+void sst_hmac_init(sst_hmac_ctx_t *ctx) {
+    ctx->inner = NULL;
+    ctx->outer = NULL;
+}
+
+int sst_hmac_setkey(sst_hmac_ctx_t *ctx, const uint8_t *key, size_t key_len) {
+    uint8_t ipad[64], opad[64];
+    hmac_pads(key, key_len, ipad, opad);
+    int ret = hmac_half(&ctx->inner, ipad);
+    if (ret == 0) ret = hmac_half(&ctx->outer, opad);
+    mbedtls_platform_zeroize(ipad, sizeof(ipad));
+    mbedtls_platform_zeroize(opad, sizeof(opad));
+    return ret;
+}
+
+int sst_hmac_compute(const sst_hmac_ctx_t *ctx, const uint8_t *input,
+                     size_t input_len, uint8_t *output) {
+    if (!ctx->inner || !ctx->outer) return -1;
+    mbedtls_sha256_context c;
+    uint8_t ihash[32];
+    mbedtls_sha256_init(&c);
+    mbedtls_sha256_clone(&c, ctx->inner);
+    int ret = mbedtls_sha256_update(&c, input, input_len);
+    if (ret == 0) ret = mbedtls_sha256_finish(&c, ihash);
+    if (ret == 0) {
+        mbedtls_sha256_clone(&c, ctx->outer);
+        ret = mbedtls_sha256_update(&c, ihash, sizeof(ihash));
+    }
+    if (ret == 0) ret = mbedtls_sha256_finish(&c, output);
+    mbedtls_sha256_free(&c);
+    mbedtls_platform_zeroize(ihash, sizeof(ihash));
+    return ret;
+}
+
+void sst_hmac_free(sst_hmac_ctx_t *ctx) {
+    // mbedtls_sha256_free() zeroizes the state
+    if (ctx->inner) mbedtls_sha256_free(ctx->inner);
+    if (ctx->outer) mbedtls_sha256_free(ctx->outer);
+    free(ctx->inner);
+    free(ctx->outer);
+    sst_hmac_init(ctx);
+}
+
 int sst_aes_128_cbc_decrypt(const uint8_t *key_16, const uint8_t *iv,
                               const uint8_t *input, size_t input_len,
                               uint8_t *output) {
@@ -62,6 +428,21 @@ int sst_aes_128_cbc_encrypt_pkcs7(const uint8_t *key_16, const uint8_t *iv,
 int sst_encrypt_gcm(const uint8_t *key, const uint8_t *nonce,
                     const uint8_t *input, size_t input_len, uint8_t *ciphertext,
                     uint8_t *tag) {
+    return sst_encrypt_gcm_aad(key, nonce, NULL, 0, input, input_len,
+                               ciphertext, tag);
+}
+
+int sst_decrypt_gcm(const uint8_t *key, const uint8_t *nonce,
+                    const uint8_t *ciphertext, size_t ciphertext_len,
+                    const uint8_t *tag, uint8_t *output) {
+    return sst_decrypt_gcm_aad(key, nonce, NULL, 0, ciphertext, ciphertext_len,
+                               tag, output);
+}
+
+int sst_encrypt_gcm_aad(const uint8_t *key, const uint8_t *nonce,
+                        const uint8_t *aad, size_t aad_len,
+                        const uint8_t *input, size_t input_len,
+                        uint8_t *ciphertext, uint8_t *tag) {
     mbedtls_gcm_context gcm;
     mbedtls_gcm_init(&gcm);
 
@@ -72,16 +453,17 @@ int sst_encrypt_gcm(const uint8_t *key, const uint8_t *nonce,
     }
 
     ret = mbedtls_gcm_crypt_and_tag(&gcm, MBEDTLS_GCM_ENCRYPT, input_len, nonce,
-                                    SST_NONCE_SIZE, NULL, 0, input, ciphertext,
-                                    SST_TAG_SIZE, tag);
+                                    SST_NONCE_SIZE, aad, aad_len, input,
+                                    ciphertext, SST_TAG_SIZE, tag);
 
     mbedtls_gcm_free(&gcm);
     return ret;
 }
 
-int sst_decrypt_gcm(const uint8_t *key, const uint8_t *nonce,
-                    const uint8_t *ciphertext, size_t ciphertext_len,
-                    const uint8_t *tag, uint8_t *output) {
+int sst_decrypt_gcm_aad(const uint8_t *key, const uint8_t *nonce,
+                        const uint8_t *aad, size_t aad_len,
+                        const uint8_t *ciphertext, size_t ciphertext_len,
+                        const uint8_t *tag, uint8_t *output) {
     mbedtls_gcm_context gcm;
     mbedtls_gcm_init(&gcm);
 
@@ -92,9 +474,104 @@ int sst_decrypt_gcm(const uint8_t *key, const uint8_t *nonce,
     }
 
     ret = mbedtls_gcm_auth_decrypt(&gcm, ciphertext_len, nonce, SST_NONCE_SIZE,
-                                   NULL, 0, tag, SST_TAG_SIZE, ciphertext,
+                                   aad, aad_len, tag, SST_TAG_SIZE, ciphertext,
                                    output);
 
     mbedtls_gcm_free(&gcm);
     return ret;
 }
+
+int sst_encrypt_chachapoly(const uint8_t *key, const uint8_t *nonce,
+                           const uint8_t *aad, size_t aad_len,
+                           const uint8_t *input, size_t input_len,
+                           uint8_t *ciphertext, uint8_t *tag) {
+    mbedtls_chachapoly_context cc;
+    mbedtls_chachapoly_init(&cc);
+    int ret = mbedtls_chachapoly_setkey(&cc, key);
+    if (ret == 0)
+        ret = mbedtls_chachapoly_encrypt_and_tag(&cc, input_len, nonce, aad,
+                                                 aad_len, input, ciphertext, tag);
+    mbedtls_chachapoly_free(&cc);
+    return ret;
+}
+
+int sst_decrypt_chachapoly(const uint8_t *key, const uint8_t *nonce,
+                           const uint8_t *aad, size_t aad_len,
+                           const uint8_t *ciphertext, size_t ciphertext_len,
+                           const uint8_t *tag, uint8_t *output) {
+    mbedtls_chachapoly_context cc;
+    mbedtls_chachapoly_init(&cc);
+    int ret = mbedtls_chachapoly_setkey(&cc, key);
+    // Wipes the output itself if the tag does not match
+    if (ret == 0)
+        ret = mbedtls_chachapoly_auth_decrypt(&cc, ciphertext_len, nonce, aad,
+                                              aad_len, tag, ciphertext, output);
+    mbedtls_chachapoly_free(&cc);
+    return ret;
+}
+
+void sst_gcm_stream_init(sst_gcm_stream_t *s) {
+    s->impl = NULL;
+    s->out = NULL;
+    s->done = 0;
+}
+
+int sst_gcm_stream_start(sst_gcm_stream_t *s, const uint8_t *key,
+                         const uint8_t *nonce, const uint8_t *aad,
+                         size_t aad_len, uint8_t *output) {
+    mbedtls_gcm_context *gcm = s->impl;
+    if (!gcm) {
+        gcm = malloc(sizeof(*gcm));
+        if (!gcm) return -1;
+        mbedtls_gcm_init(gcm);
+        s->impl = gcm;
+    }
+    s->out = output;
+    s->done = 0;
+    int ret = mbedtls_gcm_setkey(gcm, MBEDTLS_CIPHER_ID_AES, key, 128);
+    if (ret == 0)
+        ret = mbedtls_gcm_starts(gcm, MBEDTLS_GCM_DECRYPT, nonce, SST_NONCE_SIZE);
+    if (ret == 0 && aad_len)
+        ret = mbedtls_gcm_update_ad(gcm, aad, aad_len);
+    return ret;
+}
+
+int sst_gcm_stream_update(sst_gcm_stream_t *s, const uint8_t *ciphertext,
+                          size_t len) {
+    if (len == 0) return 0;
+    size_t olen = 0;
+    // mbedTLS 3 keeps the partial-block keystream itself, so olen == len
+    int ret = mbedtls_gcm_update(s->impl, ciphertext, len, s->out + s->done,
+                                 len, &olen);
+    if (ret == 0 && olen != len) ret = -1;
+    if (ret == 0) s->done += len;
+    return ret;
+}
+
+int sst_gcm_stream_finish(sst_gcm_stream_t *s, const uint8_t *tag) {
+    uint8_t calc[SST_TAG_SIZE];
+    size_t olen = 0;
+    int ret = mbedtls_gcm_finish(s->impl, NULL, 0, &olen, calc, sizeof(calc));
+    if (ret == 0) {
+        // Constant-time compare, as mbedtls_gcm_auth_decrypt() does
+        uint8_t diff = 0;
+        for (size_t i = 0; i < sizeof(calc); i++) diff |= calc[i] ^ tag[i];
+        if (diff) ret = MBEDTLS_ERR_GCM_AUTH_FAILED;
+    }
+    if (ret != 0) mbedtls_platform_zeroize(s->out, s->done);
+    mbedtls_platform_zeroize(calc, sizeof(calc));
+    return ret;
+}
+
+void sst_gcm_stream_free(sst_gcm_stream_t *s) {
+    if (s->impl) mbedtls_gcm_free(s->impl);  // zeroizes the key schedule
+    free(s->impl);
+    sst_gcm_stream_init(s);
+}
+
+#endif  // SST_CRYPTO_BACKEND_OPENSSL
+
+int sst_chachapoly_derive_key(const uint8_t *key, uint8_t *out) {
+    static const char label[] = "LiFi ChaCha20-Poly1305";
+    return sst_hmac_sha256(key, (const uint8_t *)label, sizeof(label) - 1, out);
+}